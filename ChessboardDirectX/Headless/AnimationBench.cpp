@@ -0,0 +1,243 @@
+//
+// BGTD 9201
+//	Times a frame of piece moves for many tracks at once. Each track slides
+//	a piece from one square to another, turning as it goes, and sets the
+//	transform of that piece in a TransformStore. Once the way ChessScene used
+//	to, decomposing both end matrices of every track every frame, and once
+//	through PieceAnimator's pre-decomposed clips. Writes a CSV row per count
+//
+
+#include <DirectXMath.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ChessSet.h"
+#include "PieceAnimator.h"
+#include "TransformStore.h"
+
+using namespace DirectX;
+
+// how long one move takes
+static const float MOVE_TIME = 1.5f;
+
+// a 60Hz frame
+static const float FRAME_TIME = 1.0f / 60.0f;
+
+struct Options
+{
+	std::vector<int> tracks;
+	int frames;
+	std::string output;
+};
+
+// ------------------------------------------------------------------------------------
+// What ChessScene's LerpMatrices did for the pawn, decomposing both ends every call
+// ------------------------------------------------------------------------------------
+static XMMATRIX LerpMatrices(const XMFLOAT4X4& start, const XMFLOAT4X4& end, float t)
+{
+	XMMATRIX a = XMLoadFloat4x4(&start);
+	XMMATRIX b = XMLoadFloat4x4(&end);
+
+	XMVECTOR scaleA, scaleB;
+	XMVECTOR rotA, rotB;
+	XMVECTOR transA, transB;
+
+	if (XMMatrixDecompose(&scaleA, &rotA, &transA, a) && XMMatrixDecompose(&scaleB, &rotB, &transB, b))
+	{
+		XMVECTOR scale = XMVectorLerp(scaleA, scaleB, t);
+		XMVECTOR trans = XMVectorLerp(transA, transB, t);
+		if (XMVectorGetX(XMQuaternionDot(rotA, rotB)) < 0)
+		{
+			rotB = XMVectorNegate(rotB);
+		}
+		XMVECTOR rot = XMQuaternionNormalize(XMVectorLerp(rotA, rotB, t));
+
+		return XMMatrixScalingFromVector(scale) * XMMatrixRotationQuaternion(rot) * XMMatrixTranslationFromVector(trans);
+	}
+
+	XMMATRIX result;
+	for (int i = 0; i < 4; i++)
+	{
+		result.r[i] = XMVectorLerp(a.r[i], b.r[i], t);
+	}
+	return result;
+}
+
+// ------------------------------------------------------------------------------------
+// A piece standing on a square, turned by rotationY
+// ------------------------------------------------------------------------------------
+static XMFLOAT4X4 GetSquareMatrix(int x, int y, float rotationY)
+{
+	PiecePlacement placement;
+	placement.type = PawnPiece;
+	placement.x = x;
+	placement.y = y;
+	placement.playerOne = true;
+	placement.rotationY = rotationY;
+
+	XMFLOAT4X4 matrix;
+	XMStoreFloat4x4(&matrix, ChessSet::GetPlacementMatrix(placement, ChessSet::PIECE_BASE_OFFSET));
+	return matrix;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+	printf("usage: animation_bench [options]\n"
+		"  --tracks LIST        comma separated counts of moving pieces (default 32,320,3200,32000)\n"
+		"  --frames N           timed frames per row (default 100)\n"
+		"  --output FILE        write the CSV here instead of stdout\n");
+}
+
+// ------------------------------------------------------------------------------------
+// Read the options, false if any of them are wrong
+// ------------------------------------------------------------------------------------
+static bool ParseOptions(int argc, char** argv, Options& options)
+{
+	std::string tracks = "32,320,3200,32000";
+	options.frames = 100;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--help")
+		{
+			return false;
+		}
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "%s needs a value\n", option.c_str());
+			return false;
+		}
+		std::string value = argv[++i];
+
+		if (option == "--tracks") tracks = value;
+		else if (option == "--frames") options.frames = atoi(value.c_str());
+		else if (option == "--output") options.output = value;
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", option.c_str());
+			return false;
+		}
+	}
+
+	size_t start = 0;
+	while (start < tracks.size())
+	{
+		size_t end = tracks.find(',', start);
+		if (end == std::string::npos)
+		{
+			end = tracks.size();
+		}
+		int count = atoi(tracks.substr(start, end - start).c_str());
+		if (count <= 0)
+		{
+			fprintf(stderr, "bad track count in %s\n", tracks.c_str());
+			return false;
+		}
+		options.tracks.push_back(count);
+		start = end + 1;
+	}
+
+	if (options.tracks.empty() || options.frames <= 0)
+	{
+		fprintf(stderr, "need at least one track count and one frame\n");
+		return false;
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	FILE* pOutput = stdout;
+	if (!options.output.empty())
+	{
+		pOutput = fopen(options.output.c_str(), "w");
+		if (!pOutput)
+		{
+			fprintf(stderr, "couldn't open %s\n", options.output.c_str());
+			return 1;
+		}
+	}
+
+	fprintf(pOutput, "tracks,method,frame_ms,ns_per_track\n");
+
+	for (size_t c = 0; c < options.tracks.size(); c++)
+	{
+		int numTracks = options.tracks[c];
+
+		// every piece moves two squares forward and turns to face the way back, starting
+		// at a different time so the tracks are spread along their clips
+		TransformStore store;
+		PieceAnimator animator;
+		std::vector<XMFLOAT4X4> starts(numTracks), ends(numTracks);
+		std::vector<float> startTimes(numTracks);
+		for (int i = 0; i < numTracks; i++)
+		{
+			int x = i % ChessSet::BOARD_SIZE;
+			int y = (i / ChessSet::BOARD_SIZE) % (ChessSet::BOARD_SIZE - 2);
+			starts[i] = GetSquareMatrix(x, y, 0);
+			ends[i] = GetSquareMatrix(x, y + 2, XM_PI);
+			startTimes[i] = -(float)(i % 97) / 97.0f * MOVE_TIME;
+
+			AnimationClip move;
+			move.AddKey(0, starts[i], EaseInOutEasing);
+			move.AddKey(MOVE_TIME, ends[i]);
+			animator.Play(animator.AddClip(move), store.Add(starts[i], TransformStore::NO_PARENT, RigidTransform), startTimes[i], PlayPingPong);
+		}
+
+		for (int method = 0; method < 2; method++)
+		{
+			float time = 0;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (int frame = 0; frame < options.frames; frame++)
+			{
+				time += FRAME_TIME;
+				if (method == 0)
+				{
+					for (int i = 0; i < numTracks; i++)
+					{
+						float t = (time - startTimes[i]) / MOVE_TIME;
+						t = fmodf(t, 2);
+						t = t > 1 ? 2 - t : t;
+						t = ApplyEasing(EaseInOutEasing, t);
+
+						XMFLOAT4X4 local;
+						XMStoreFloat4x4(&local, LerpMatrices(starts[i], ends[i], t));
+						store.SetLocal(i, local, RigidTransform);
+					}
+				}
+				else
+				{
+					animator.Evaluate(time);
+					animator.Apply(store);
+				}
+			}
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+			double frameMs = std::chrono::duration<double, std::milli>(end - start).count() / options.frames;
+			fprintf(pOutput, "%d,%s,%.4f,%.1f\n", numTracks, method == 0 ? "decompose" : "animator", frameMs,
+				frameMs * 1e6 / numTracks);
+		}
+	}
+
+	if (pOutput != stdout)
+	{
+		fclose(pOutput);
+	}
+	return 0;
+}
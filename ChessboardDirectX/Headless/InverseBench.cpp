@@ -0,0 +1,279 @@
+//
+// BGTD 9201
+//	Times the inverses a draw needs, per call, for rigid, uniformly scaled,
+//	axis scaled and sheared world matrices. Each kind goes through the full
+//	4x4 inverse the shader used to do, through AffineTransform after working
+//	out the kind and with the kind already known, then the whole per-draw
+//	matrix setup before and after. Writes a CSV row per kind and method with
+//	the largest difference from the full inverse
+//
+
+#include <DirectXMath.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "AffineTransform.h"
+#include "TransformStore.h"
+
+using namespace DirectX;
+
+// what each row times
+enum InverseMethod
+{
+	FullInverseMethod,		// XMMatrixInverse, what SetShaders did
+	ClassifyMethod,			// AffineTransform::Classify then Invert
+	KnownKindMethod,		// Invert with the kind the matrix was built with
+	DrawBeforeMethod,		// the world, WVP and full inverse of a draw
+	DrawAfterMethod,		// the same with the inverse for the kind the draw knows
+	NUM_METHODS
+};
+
+static const char* METHOD_NAMES[NUM_METHODS] = { "full_inverse", "classify", "known_kind", "draw_before", "draw_after" };
+static const char* KIND_NAMES[] = { "rigid", "uniform", "axis", "general" };
+static const int NUM_KINDS = GeneralTransform + 1;
+
+struct Options
+{
+	int count;
+	int passes;
+	std::string output;
+};
+
+// ------------------------------------------------------------------------------------
+// The same numbers on every run
+// ------------------------------------------------------------------------------------
+static float Random(unsigned int& seed, float low, float high)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return low + (high - low) * (float)(seed >> 8) / (float)(1 << 24);
+}
+
+// ------------------------------------------------------------------------------------
+// A world matrix of the given kind, general ones scale after rotating so they shear
+// ------------------------------------------------------------------------------------
+static XMFLOAT4X4 MakeMatrix(TransformKind kind, unsigned int& seed)
+{
+	XMMATRIX rotation = XMMatrixRotationRollPitchYaw(Random(seed, -XM_PI, XM_PI), Random(seed, -XM_PI, XM_PI), Random(seed, -XM_PI, XM_PI));
+	XMMATRIX translation = XMMatrixTranslation(Random(seed, -50, 50), Random(seed, -50, 50), Random(seed, -50, 50));
+	float scale = Random(seed, 0.25f, 4);
+	XMMATRIX axisScale = XMMatrixScaling(Random(seed, 0.25f, 4), Random(seed, 0.25f, 4), Random(seed, 0.25f, 4));
+
+	XMMATRIX m;
+	switch (kind)
+	{
+		case RigidTransform:
+			m = rotation * translation;
+			break;
+		case UniformScaleTransform:
+			m = XMMatrixScaling(scale, scale, scale) * rotation * translation;
+			break;
+		case AxisScaleTransform:
+			m = axisScale * rotation * translation;
+			break;
+		default:
+			m = rotation * axisScale * translation;
+			break;
+	}
+
+	XMFLOAT4X4 matrix;
+	XMStoreFloat4x4(&matrix, m);
+	return matrix;
+}
+
+// ------------------------------------------------------------------------------------
+// The largest difference from the full inverse, relative to the size of the element
+// ------------------------------------------------------------------------------------
+static double MaxError(const XMFLOAT4X4& inverse, const XMFLOAT4X4& expected)
+{
+	double maxError = 0;
+	for (int r = 0; r < 4; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			double error = fabs(inverse.m[r][c] - expected.m[r][c]) / (1 + fabs(expected.m[r][c]));
+			if (error > maxError)
+			{
+				maxError = error;
+			}
+		}
+	}
+	return maxError;
+}
+
+// ------------------------------------------------------------------------------------
+// Run one method over every matrix, the results land in pResults
+// ------------------------------------------------------------------------------------
+static void RunMethod(InverseMethod method, const std::vector<XMFLOAT4X4>& matrices, TransformKind kind,
+	FXMMATRIX viewProjection, TransformMatrices* pResults)
+{
+	for (size_t i = 0; i < matrices.size(); i++)
+	{
+		const XMFLOAT4X4& world = matrices[i];
+		TransformMatrices& result = pResults[i];
+
+		switch (method)
+		{
+			case FullInverseMethod:
+				XMStoreFloat4x4(&result.worldMatrixIT, XMMatrixInverse(nullptr, XMLoadFloat4x4(&world)));
+				break;
+			case ClassifyMethod:
+				XMStoreFloat4x4(&result.worldMatrixIT, AffineTransform::Classify(world).Invert());
+				break;
+			case KnownKindMethod:
+				XMStoreFloat4x4(&result.worldMatrixIT, AffineTransform(world, kind).Invert());
+				break;
+			case DrawBeforeMethod:
+			case DrawAfterMethod:
+			{
+				// LitColourShader::ComputeMatrices
+				XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+				XMStoreFloat4x4(&result.worldMatrix, XMMatrixTranspose(worldMatrix));
+				XMStoreFloat4x4(&result.worldViewProjectionMatrix, XMMatrixTranspose(XMMatrixMultiply(worldMatrix, viewProjection)));
+				if (method == DrawBeforeMethod)
+				{
+					XMStoreFloat4x4(&result.worldMatrixIT, XMMatrixInverse(nullptr, worldMatrix));
+				}
+				else
+				{
+					XMStoreFloat4x4(&result.worldMatrixIT, AffineTransform(world, kind).Invert());
+				}
+				break;
+			}
+			default:
+				break;
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+	printf("usage: inverse_bench [options]\n"
+		"  --count N            matrices of each kind (default 4096)\n"
+		"  --passes N           timed passes over them (default 200)\n"
+		"  --output FILE        write the CSV here instead of stdout\n");
+}
+
+// ------------------------------------------------------------------------------------
+// Read the options, false if any of them are wrong
+// ------------------------------------------------------------------------------------
+static bool ParseOptions(int argc, char** argv, Options& options)
+{
+	options.count = 4096;
+	options.passes = 200;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--help")
+		{
+			return false;
+		}
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "%s needs a value\n", option.c_str());
+			return false;
+		}
+		std::string value = argv[++i];
+
+		if (option == "--count") options.count = atoi(value.c_str());
+		else if (option == "--passes") options.passes = atoi(value.c_str());
+		else if (option == "--output") options.output = value;
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", option.c_str());
+			return false;
+		}
+	}
+
+	if (options.count <= 0 || options.passes <= 0)
+	{
+		fprintf(stderr, "--count and --passes have to be above 0\n");
+		return false;
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	FILE* pOutput = stdout;
+	if (!options.output.empty())
+	{
+		pOutput = fopen(options.output.c_str(), "w");
+		if (!pOutput)
+		{
+			fprintf(stderr, "couldn't open %s\n", options.output.c_str());
+			return 1;
+		}
+	}
+
+	XMMATRIX viewProjection = XMMatrixLookAtRH(XMVectorSet(0, 40, 60, 1), XMVectorZero(), XMVectorSet(0, 1, 0, 0))
+		* XMMatrixPerspectiveFovRH(XM_PI / 3, 1280.0f / 720.0f, 0.1f, 1000);
+
+	fprintf(pOutput, "kind,method,classified_as,ns_per_call,max_error\n");
+
+	unsigned int seed = 9201;
+	std::vector<TransformMatrices> expected(options.count);
+	std::vector<TransformMatrices> results(options.count);
+	for (int k = 0; k < NUM_KINDS; k++)
+	{
+		TransformKind kind = (TransformKind)k;
+		std::vector<XMFLOAT4X4> matrices;
+		for (int i = 0; i < options.count; i++)
+		{
+			matrices.push_back(MakeMatrix(kind, seed));
+		}
+		RunMethod(FullInverseMethod, matrices, kind, viewProjection, expected.data());
+
+		// what Classify makes of the first one, the rest are built the same way
+		TransformKind classified = AffineTransform::FindKind(matrices[0]);
+
+		for (int m = 0; m < NUM_METHODS; m++)
+		{
+			InverseMethod method = (InverseMethod)m;
+
+			// one untimed pass to warm the caches
+			RunMethod(method, matrices, kind, viewProjection, results.data());
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (int pass = 0; pass < options.passes; pass++)
+			{
+				RunMethod(method, matrices, kind, viewProjection, results.data());
+			}
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			double ns = std::chrono::duration<double, std::nano>(end - start).count() / ((double)options.passes * options.count);
+
+			double maxError = 0;
+			for (int i = 0; i < options.count; i++)
+			{
+				double error = MaxError(results[i].worldMatrixIT, expected[i].worldMatrixIT);
+				if (error > maxError)
+				{
+					maxError = error;
+				}
+			}
+
+			fprintf(pOutput, "%s,%s,%s,%.2f,%.3g\n", KIND_NAMES[k], METHOD_NAMES[m], KIND_NAMES[classified], ns, maxError);
+		}
+	}
+
+	if (pOutput != stdout)
+	{
+		fclose(pOutput);
+	}
+	return 0;
+}
@@ -0,0 +1,351 @@
+//
+// BGTD 9201
+//	Makes and unmakes every move of the test positions' trees, reading the
+//	position's keys after each one, either the ones kept up to date as the
+//	pieces move or ones worked out from scratch the way they were before.
+//	Writes a CSV row per mode and position with the moves per second. With
+//	--verify the kept keys are checked against the scratch ones at every
+//	node, a knight shuffle from the start is checked for repetitions and a
+//	long game is played and taken back to check the keys come back
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ChessPosition.h"
+#include "PerftPositions.h"
+
+// how the keys are read after each move
+enum KeyMode
+{
+	IncrementalKeys,			// GetKey and GetPawnKey, kept by MakeMove
+	ScratchKeys					// ComputeKey and ComputePawnKey, a pass over the pieces each
+};
+
+struct Options
+{
+	int depth;
+	std::vector<KeyMode> modes;
+	std::vector<std::string> positions;
+	bool verify;
+	std::string output;
+};
+
+// what the walk adds the keys into, so reading them can't be left out
+static volatile uint64_t keySink;
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+	printf("usage: makemove_bench [options]\n"
+		"  --depth N            plies to walk (default 5)\n"
+		"  --mode MODE          incremental, scratch or both (default both)\n"
+		"  --positions LIST     comma separated test positions (default all of them)\n"
+		"  --verify             check the kept keys and repetitions against the slow way\n"
+		"  --output FILE        write the CSV here instead of stdout\n");
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static std::vector<std::string> SplitList(const std::string& list)
+{
+	std::vector<std::string> items;
+	size_t start = 0;
+	while (start < list.size())
+	{
+		size_t end = list.find(',', start);
+		if (end == std::string::npos)
+		{
+			end = list.size();
+		}
+		items.push_back(list.substr(start, end - start));
+		start = end + 1;
+	}
+	return items;
+}
+
+// ------------------------------------------------------------------------------------
+// Read the options, false if any of them are wrong
+// ------------------------------------------------------------------------------------
+static bool ParseOptions(int argc, char** argv, Options& options)
+{
+	options.depth = 5;
+	options.verify = false;
+	std::string mode = "both";
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--help")
+		{
+			return false;
+		}
+		if (option == "--verify")
+		{
+			options.verify = true;
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "%s needs a value\n", option.c_str());
+			return false;
+		}
+		std::string value = argv[++i];
+
+		if (option == "--depth") options.depth = atoi(value.c_str());
+		else if (option == "--mode") mode = value;
+		else if (option == "--positions") options.positions = SplitList(value);
+		else if (option == "--output") options.output = value;
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", option.c_str());
+			return false;
+		}
+	}
+
+	if (mode == "incremental" || mode == "both") options.modes.push_back(IncrementalKeys);
+	if (mode == "scratch" || mode == "both") options.modes.push_back(ScratchKeys);
+	if (options.modes.empty())
+	{
+		fprintf(stderr, "unknown mode %s\n", mode.c_str());
+		return false;
+	}
+	if (options.depth < 1)
+	{
+		fprintf(stderr, "the depth must be from 1\n");
+		return false;
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// Make and unmake every move depth plies deep, reading the keys after each. Returns the
+// moves made, and counts the nodes whose kept keys aren't what they should be
+// ------------------------------------------------------------------------------------
+static uint64_t Walk(ChessPosition& position, int depth, KeyMode mode, bool verify, uint64_t& sum, uint64_t& mismatches)
+{
+	MoveList list;
+	position.GenerateMoves(list);
+
+	uint64_t key = position.GetKey();
+	uint64_t pawnKey = position.GetPawnKey();
+	uint64_t moves = list.count;
+	MoveUndo undo;
+	for (int i = 0; i < list.count; i++)
+	{
+		position.MakeMove(list.moves[i], undo);
+
+		if (mode == IncrementalKeys)
+		{
+			sum += position.GetKey() ^ position.GetPawnKey();
+		}
+		else
+		{
+			sum += position.ComputeKey() ^ position.ComputePawnKey();
+		}
+		if (verify && (position.GetKey() != position.ComputeKey() || position.GetPawnKey() != position.ComputePawnKey()))
+		{
+			mismatches++;
+		}
+
+		if (depth > 1)
+		{
+			moves += Walk(position, depth - 1, mode, verify, sum, mismatches);
+		}
+		position.UnmakeMove(list.moves[i], undo);
+
+		// taking the move back has to bring back the keys from before it
+		if (verify && (position.GetKey() != key || position.GetPawnKey() != pawnKey))
+		{
+			mismatches++;
+		}
+	}
+	return moves;
+}
+
+// ------------------------------------------------------------------------------------
+// The knights out and back twice from the start comes round to the start a second and
+// third time, and each time it should be seen
+// ------------------------------------------------------------------------------------
+static bool CheckRepetitions()
+{
+	static const char* SHUFFLE[4] = { "g1f3", "g8f6", "f3g1", "f6g8" };
+
+	ChessPosition position;
+	std::vector<MoveUndo> undos;
+	for (int round = 1; round <= 2; round++)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			ChessMove move = position.FindMove(SHUFFLE[i]);
+			if (move == NO_MOVE)
+			{
+				return false;
+			}
+			undos.push_back(MoveUndo());
+			position.MakeMove(move, undos.back());
+		}
+		if (position.GetRepetitions() != round || position.IsDraw() != (round == 2))
+		{
+			return false;
+		}
+	}
+
+	// a pawn move can't be undone on the board, so nothing before it repeats
+	MoveUndo undo;
+	position.MakeMove(position.FindMove("e2e4"), undo);
+	position.MakeMove(position.FindMove("e7e5"), undo);
+	return position.GetRepetitions() == 0 && !position.IsDraw();
+}
+
+// ------------------------------------------------------------------------------------
+// Plays a long game of moves picked from a fixed seed and takes it all back, so the keys
+// and repetitions have to come back from further than the repetition window reaches
+// ------------------------------------------------------------------------------------
+static bool CheckDeepUnmake()
+{
+	static const int DEEP_PLIES = 300;
+
+	ChessPosition position;
+	uint64_t startKey = position.GetKey();
+	uint32_t seed = 12345;
+
+	std::vector<ChessMove> moves;
+	std::vector<MoveUndo> undos(DEEP_PLIES);
+	std::vector<uint64_t> keys;
+	std::vector<int> repetitions;
+	for (int ply = 0; ply < DEEP_PLIES; ply++)
+	{
+		MoveList list;
+		position.GenerateMoves(list);
+		if (list.count == 0)
+		{
+			break;
+		}
+
+		keys.push_back(position.GetKey());
+		repetitions.push_back(position.GetRepetitions());
+
+		seed = seed * 1664525 + 1013904223;
+		moves.push_back(list.moves[(seed >> 8) % list.count]);
+		position.MakeMove(moves.back(), undos[ply]);
+		if (position.GetKey() != position.ComputeKey())
+		{
+			return false;
+		}
+	}
+	if (moves.size() <= 128)
+	{
+		return false;
+	}
+
+	for (int ply = (int)moves.size() - 1; ply >= 0; ply--)
+	{
+		position.UnmakeMove(moves[ply], undos[ply]);
+		if (position.GetKey() != keys[ply] || position.GetKey() != position.ComputeKey()
+			|| position.GetRepetitions() != repetitions[ply])
+		{
+			return false;
+		}
+	}
+	return position.GetKey() == startKey;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	// the positions asked for, or every test position
+	std::vector<PerftPosition> positions;
+	if (options.positions.empty())
+	{
+		positions.assign(PERFT_POSITIONS, PERFT_POSITIONS + NUM_PERFT_POSITIONS);
+	}
+	for (size_t i = 0; i < options.positions.size(); i++)
+	{
+		int found = 0;
+		while (found < NUM_PERFT_POSITIONS && options.positions[i] != PERFT_POSITIONS[found].name)
+		{
+			found++;
+		}
+		if (found == NUM_PERFT_POSITIONS)
+		{
+			fprintf(stderr, "there's no test position called %s\n", options.positions[i].c_str());
+			return 1;
+		}
+		positions.push_back(PERFT_POSITIONS[found]);
+	}
+
+	if (options.verify && !CheckRepetitions())
+	{
+		fprintf(stderr, "the knight shuffle's repetitions weren't found\n");
+		return 1;
+	}
+	if (options.verify && !CheckDeepUnmake())
+	{
+		fprintf(stderr, "taking back a long game didn't bring back its keys\n");
+		return 1;
+	}
+
+	FILE* pOutput = stdout;
+	if (!options.output.empty())
+	{
+		pOutput = fopen(options.output.c_str(), "w");
+		if (!pOutput)
+		{
+			fprintf(stderr, "couldn't open %s\n", options.output.c_str());
+			return 1;
+		}
+	}
+
+	fprintf(pOutput, "mode,position,depth,moves,ms,moves_per_second,ns_per_move,mismatches\n");
+
+	uint64_t totalMismatches = 0;
+	for (size_t m = 0; m < options.modes.size(); m++)
+	{
+		for (size_t i = 0; i < positions.size(); i++)
+		{
+			ChessPosition position;
+			if (!position.SetFen(positions[i].fen))
+			{
+				fprintf(stderr, "couldn't read %s\n", positions[i].fen);
+				return 1;
+			}
+
+			uint64_t sum = 0, mismatches = 0;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			uint64_t moves = Walk(position, options.depth, options.modes[m], options.verify, sum, mismatches);
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			keySink = keySink + sum;
+			totalMismatches += mismatches;
+
+			double ms = std::chrono::duration<double, std::milli>(end - start).count();
+			fprintf(pOutput, "%s,%s,%d,%llu,%.2f,%.0f,%.2f,%llu\n", options.modes[m] == IncrementalKeys ? "incremental" : "scratch",
+				positions[i].name, options.depth, (unsigned long long)moves, ms, ms > 0 ? moves * 1000.0 / ms : 0.0,
+				moves > 0 ? ms * 1e6 / moves : 0.0, (unsigned long long)mismatches);
+		}
+	}
+
+	if (pOutput != stdout)
+	{
+		fclose(pOutput);
+	}
+
+	if (totalMismatches > 0)
+	{
+		fprintf(stderr, "%llu nodes had the wrong keys\n", (unsigned long long)totalMismatches);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,257 @@
+//
+// BGTD 9201
+//	Keeps N piece moves playing at once, the way a fast replay or a room of
+//	boards being watched would, and times the frames. Every move that ends
+//	is replaced by a new one on the same piece, so the count stays flat and
+//	retiring and starting moves is timed along with posing them. Counts the
+//	heap allocations made while the frames are timed, which should be none
+//
+
+#include <DirectXMath.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "ChessSet.h"
+#include "MoveScheduler.h"
+#include "TransformStore.h"
+
+using namespace DirectX;
+
+// a 60Hz frame
+static const float FRAME_TIME = 1.0f / 60.0f;
+
+// moves take between these many seconds
+static const float SHORTEST_MOVE = 0.25f;
+static const float LONGEST_MOVE = 1.5f;
+
+// every allocation the program makes, read before and after the timed frames
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size)
+{
+	allocations++;
+	void* p = malloc(size ? size : 1);
+	if (p == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+struct Options
+{
+	std::vector<int> moves;
+	int frames;
+	std::string output;
+};
+
+// ------------------------------------------------------------------------------------
+// The same numbers on every run
+// ------------------------------------------------------------------------------------
+static UINT Random(UINT& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return seed >> 8;
+}
+
+// ------------------------------------------------------------------------------------
+// A move from square to square on one of the boards, knights' jumps and captures mixed
+// in about as often as a game has them
+// ------------------------------------------------------------------------------------
+static PieceMove MakeMove(UINT target, float startTime, UINT& seed)
+{
+	PieceMove move;
+	UINT style = Random(seed) % 8;
+	move.style = style == 0 ? ArcMove : style == 1 ? CaptureMove : SlideMove;
+	move.target = target;
+
+	XMFLOAT3 from, to;
+	XMStoreFloat3(&from, ChessSet::GetBoardPosition(Random(seed) % ChessSet::BOARD_SIZE, Random(seed) % ChessSet::BOARD_SIZE,
+		ChessSet::PIECE_BASE_OFFSET).r[3]);
+	XMStoreFloat3(&to, ChessSet::GetBoardPosition(Random(seed) % ChessSet::BOARD_SIZE, Random(seed) % ChessSet::BOARD_SIZE,
+		ChessSet::PIECE_BASE_OFFSET).r[3]);
+	move.from = from;
+	move.to = move.style == CaptureMove ? from : to;
+	move.fromYaw = 0;
+	move.toYaw = Random(seed) % 4 == 0 ? XM_PI : 0;
+	move.startTime = startTime;
+	move.duration = SHORTEST_MOVE + (LONGEST_MOVE - SHORTEST_MOVE) * (float)(Random(seed) % 1024) / 1024.0f;
+	move.easing = (EasingCurve)(Random(seed) % 4);
+	move.arcHeight = ChessSet::GRID_SCALE;
+	return move;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+	printf("usage: move_bench [options]\n"
+		"  --moves LIST         comma separated counts of moves playing at once (default 100,1000,10000,100000)\n"
+		"  --frames N           timed frames per row (default 600)\n"
+		"  --output FILE        write the CSV here instead of stdout\n");
+}
+
+// ------------------------------------------------------------------------------------
+// Read the options, false if any of them are wrong
+// ------------------------------------------------------------------------------------
+static bool ParseOptions(int argc, char** argv, Options& options)
+{
+	std::string moves = "100,1000,10000,100000";
+	options.frames = 600;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--help")
+		{
+			return false;
+		}
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "%s needs a value\n", option.c_str());
+			return false;
+		}
+		std::string value = argv[++i];
+
+		if (option == "--moves") moves = value;
+		else if (option == "--frames") options.frames = atoi(value.c_str());
+		else if (option == "--output") options.output = value;
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", option.c_str());
+			return false;
+		}
+	}
+
+	size_t start = 0;
+	while (start < moves.size())
+	{
+		size_t end = moves.find(',', start);
+		if (end == std::string::npos)
+		{
+			end = moves.size();
+		}
+		int count = atoi(moves.substr(start, end - start).c_str());
+		if (count <= 0 || count > (1 << MoveScheduler::MOVE_SLOT_BITS))
+		{
+			fprintf(stderr, "bad move count in %s\n", moves.c_str());
+			return false;
+		}
+		options.moves.push_back(count);
+		start = end + 1;
+	}
+
+	if (options.moves.empty() || options.frames <= 0)
+	{
+		fprintf(stderr, "need at least one move count and one frame\n");
+		return false;
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	FILE* pOutput = stdout;
+	if (!options.output.empty())
+	{
+		pOutput = fopen(options.output.c_str(), "w");
+		if (!pOutput)
+		{
+			fprintf(stderr, "couldn't open %s\n", options.output.c_str());
+			return 1;
+		}
+	}
+
+	fprintf(pOutput, "moves,frame_ms_mean,frame_ms_p50,frame_ms_p95,frame_ms_max,ns_per_move,started_per_frame,allocations\n");
+
+	for (size_t c = 0; c < options.moves.size(); c++)
+	{
+		int numMoves = options.moves[c];
+
+		// a piece per move, each starting partway through so they don't all end together
+		UINT seed = 9201;
+		TransformStore store;
+		XMFLOAT4X4 identity;
+		XMStoreFloat4x4(&identity, XMMatrixIdentity());
+		for (int i = 0; i < numMoves; i++)
+		{
+			store.Add(identity, TransformStore::NO_PARENT, RigidTransform);
+		}
+
+		MoveScheduler scheduler(numMoves);
+		for (int i = 0; i < numMoves; i++)
+		{
+			scheduler.Start(MakeMove(i, -LONGEST_MOVE * (float)(Random(seed) % 1024) / 1024.0f, seed));
+		}
+
+		std::vector<double> frameTimes;
+		frameTimes.reserve(options.frames);
+		size_t started = 0;
+		float time = 0;
+
+		size_t allocationsBefore = allocations;
+		for (int frame = 0; frame < options.frames; frame++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			time += FRAME_TIME;
+			scheduler.Update(time);
+			for (UINT i = 0; i < scheduler.GetFinishedCount(); i++)
+			{
+				scheduler.Start(MakeMove(scheduler.GetFinished(i).target, time, seed));
+			}
+			scheduler.Apply(store, 0);
+			started += scheduler.GetFinishedCount();
+
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			frameTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		size_t frameAllocations = allocations - allocationsBefore;
+
+		double total = 0;
+		for (size_t i = 0; i < frameTimes.size(); i++)
+		{
+			total += frameTimes[i];
+		}
+		double mean = total / frameTimes.size();
+		std::sort(frameTimes.begin(), frameTimes.end());
+		double p50 = frameTimes[frameTimes.size() / 2];
+		double p95 = frameTimes[(frameTimes.size() * 95) / 100];
+		double worst = frameTimes.back();
+
+		fprintf(pOutput, "%d,%.4f,%.4f,%.4f,%.4f,%.1f,%.1f,%zu\n", numMoves, mean, p50, p95, worst, mean * 1e6 / numMoves,
+			(double)started / options.frames, frameAllocations);
+		fprintf(stderr, "%7d moves  %8.4f ms mean  %8.4f ms p95  %zu allocations\n", numMoves, mean, p95, frameAllocations);
+	}
+
+	if (pOutput != stdout)
+	{
+		fclose(pOutput);
+	}
+	return 0;
+}
@@ -0,0 +1,170 @@
+//
+// BGTD 9201
+//	Counts the legal move tree of the standard test positions and checks
+//	the counts against the published ones, which catches almost any mistake
+//	in move generation, castling, en passant or promotion. Writes a CSV row
+//	per position with the nodes per second, and fails if any count is wrong
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ChessPosition.h"
+#include "PerftPositions.h"
+
+struct Options
+{
+	int depth;
+	std::string fen;
+	bool divide;
+	std::string output;
+};
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+	printf("usage: perft [options]\n"
+		"  --depth N            plies to count, up to 6 for the test positions (default 4)\n"
+		"  --fen FEN            count this position instead of the test positions\n"
+		"  --divide             the count under each root move as well, to stderr\n"
+		"  --output FILE        write the CSV here instead of stdout\n");
+}
+
+// ------------------------------------------------------------------------------------
+// Read the options, false if any of them are wrong
+// ------------------------------------------------------------------------------------
+static bool ParseOptions(int argc, char** argv, Options& options)
+{
+	options.depth = 4;
+	options.divide = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--help")
+		{
+			return false;
+		}
+		if (option == "--divide")
+		{
+			options.divide = true;
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "%s needs a value\n", option.c_str());
+			return false;
+		}
+		std::string value = argv[++i];
+
+		if (option == "--depth") options.depth = atoi(value.c_str());
+		else if (option == "--fen") options.fen = value;
+		else if (option == "--output") options.output = value;
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", option.c_str());
+			return false;
+		}
+	}
+
+	if (options.depth < 1 || (options.fen.empty() && options.depth > 6))
+	{
+		fprintf(stderr, "the depth must be from 1, and up to 6 for the test positions\n");
+		return false;
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	FILE* pOutput = stdout;
+	if (!options.output.empty())
+	{
+		pOutput = fopen(options.output.c_str(), "w");
+		if (!pOutput)
+		{
+			fprintf(stderr, "couldn't open %s\n", options.output.c_str());
+			return 1;
+		}
+	}
+
+	// a position from the command line, or every test position
+	std::vector<PerftPosition> positions;
+	if (!options.fen.empty())
+	{
+		PerftPosition position = { "fen", options.fen.c_str(), { 0, 0, 0, 0, 0, 0 } };
+		positions.push_back(position);
+	}
+	else
+	{
+		positions.assign(PERFT_POSITIONS, PERFT_POSITIONS + NUM_PERFT_POSITIONS);
+	}
+
+	fprintf(pOutput, "position,depth,nodes,expected,ms,nodes_per_second,match\n");
+
+	int failures = 0;
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		ChessPosition position;
+		if (!position.SetFen(positions[i].fen))
+		{
+			fprintf(stderr, "couldn't read %s\n", positions[i].fen);
+			return 1;
+		}
+
+		// the count under each root move, to find where two move generators disagree
+		if (options.divide)
+		{
+			MoveList list;
+			position.GenerateMoves(list);
+			for (int j = 0; j < list.count; j++)
+			{
+				MoveUndo undo;
+				position.MakeMove(list.moves[j], undo);
+				fprintf(stderr, "%s: %llu\n", ChessPosition::GetMoveText(list.moves[j]).c_str(),
+					(unsigned long long)position.Perft(options.depth - 1));
+				position.UnmakeMove(list.moves[j], undo);
+			}
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		uint64_t nodes = position.Perft(options.depth);
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		double ms = std::chrono::duration<double, std::milli>(end - start).count();
+		uint64_t expected = options.depth <= 6 ? positions[i].nodes[options.depth - 1] : 0;
+		const char* match = expected == 0 ? "unknown" : nodes == expected ? "yes" : "no";
+		if (expected != 0 && nodes != expected)
+		{
+			failures++;
+		}
+
+		fprintf(pOutput, "%s,%d,%llu,%llu,%.2f,%.0f,%s\n", positions[i].name, options.depth, (unsigned long long)nodes,
+			(unsigned long long)expected, ms, ms > 0 ? nodes * 1000.0 / ms : 0.0, match);
+	}
+
+	if (pOutput != stdout)
+	{
+		fclose(pOutput);
+	}
+
+	if (failures > 0)
+	{
+		fprintf(stderr, "%d of the counts are wrong\n", failures);
+		return 1;
+	}
+	return 0;
+}
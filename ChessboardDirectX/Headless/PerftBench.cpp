@@ -0,0 +1,632 @@
+//
+// BGTD 9201
+//	Counts the legal move tree of the test positions on 1 to every core and
+//	writes the nodes per second and how well they scale as JSON. The tree is
+//	cut into a task per root move, or per reply to one when the tree is deep,
+//	and the tasks are dealt out to a queue per thread. A thread that runs out
+//	steals from the others. With --hash the counts of subtrees already seen
+//	come from a table every thread shares without locks
+//
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ChessPosition.h"
+#include "PerftPositions.h"
+
+struct Options
+{
+	int depth;
+	std::vector<int> threads;
+	std::vector<std::string> positions;
+	std::string fen;
+	int hashMegabytes;
+	std::string output;
+};
+
+// ------------------------------------------------------------------------------------
+// Subtree counts by position and depth. An entry is two words written without a lock,
+// the first is the key XORed with the second, so an entry half written by one thread
+// while another reads it doesn't match any key and is just a miss
+// ------------------------------------------------------------------------------------
+class PerftTable
+{
+public:
+	PerftTable(int megabytes);
+
+	void Clear();
+
+	// false if the position hasn't been counted to this depth
+	bool Probe(uint64_t key, int depth, uint64_t& nodes) const;
+	void Store(uint64_t key, int depth, uint64_t nodes);
+
+	bool IsEnabled() const { return !entries.empty(); }
+
+private:
+
+	struct Entry
+	{
+		std::atomic<uint64_t> check;
+		std::atomic<uint64_t> data;			// the count above the bottom 8 bits, the depth in them
+	};
+
+	std::vector<Entry> entries;
+	uint64_t mask;
+};
+
+// ------------------------------------------------------------------------------------
+// The largest power of two entries that fits, none for 0
+// ------------------------------------------------------------------------------------
+PerftTable::PerftTable(int megabytes) : mask(0)
+{
+	uint64_t bytes = (uint64_t)megabytes << 20;
+	uint64_t count = 1;
+	while (count * 2 * sizeof(Entry) <= bytes)
+	{
+		count *= 2;
+	}
+	if (megabytes > 0)
+	{
+		entries = std::vector<Entry>((size_t)count);
+		mask = count - 1;
+		Clear();
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void PerftTable::Clear()
+{
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		entries[i].check.store(0, std::memory_order_relaxed);
+		entries[i].data.store(0, std::memory_order_relaxed);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+bool PerftTable::Probe(uint64_t key, int depth, uint64_t& nodes) const
+{
+	const Entry& entry = entries[key & mask];
+	uint64_t data = entry.data.load(std::memory_order_relaxed);
+	uint64_t check = entry.check.load(std::memory_order_relaxed);
+	if ((check ^ data) != key || (int)(data & 0xFF) != depth)
+	{
+		return false;
+	}
+	nodes = data >> 8;
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// Always replaces, deeper counts aren't worth more here as every count is exact
+// ------------------------------------------------------------------------------------
+void PerftTable::Store(uint64_t key, int depth, uint64_t nodes)
+{
+	Entry& entry = entries[key & mask];
+	uint64_t data = (nodes << 8) | (uint64_t)depth;
+	entry.check.store(key ^ data, std::memory_order_relaxed);
+	entry.data.store(data, std::memory_order_relaxed);
+}
+
+// ------------------------------------------------------------------------------------
+// Perft, looking each subtree up in the table first. The last ply is counted from the
+// move list as Perft does, so only positions two or more plies from the leaves are kept
+// ------------------------------------------------------------------------------------
+static uint64_t HashedPerft(ChessPosition& position, int depth, PerftTable& table)
+{
+	if (depth <= 1)
+	{
+		return position.Perft(depth);
+	}
+
+	uint64_t key = position.GetKey();
+	uint64_t nodes;
+	if (table.Probe(key, depth, nodes))
+	{
+		return nodes;
+	}
+
+	MoveList list;
+	position.GenerateMoves(list);
+
+	nodes = 0;
+	MoveUndo undo;
+	for (int i = 0; i < list.count; i++)
+	{
+		position.MakeMove(list.moves[i], undo);
+		nodes += HashedPerft(position, depth - 1, table);
+		position.UnmakeMove(list.moves[i], undo);
+	}
+
+	table.Store(key, depth, nodes);
+	return nodes;
+}
+
+// a subtree to count
+struct PerftTask
+{
+	ChessPosition position;
+	int depth;
+	uint64_t nodes;
+};
+
+// ------------------------------------------------------------------------------------
+// Threads that count a list of tasks. Each thread starts with its own share and takes
+// from the back of its queue, and one that runs dry takes from the front of another's,
+// the tasks there being the ones its owner is furthest from reaching
+// ------------------------------------------------------------------------------------
+class PerftPool
+{
+public:
+	PerftPool(int numThreads);
+	~PerftPool();
+
+	// count every task, the calling thread is the first worker
+	void Run(std::vector<PerftTask>& tasks, PerftTable& table);
+
+	// tasks run by a thread other than the one they were dealt to, over every Run
+	uint64_t GetSteals() const { return steals; }
+
+private:
+
+	void WorkerLoop(int worker);
+	void RunTasks(int worker);
+
+	// take a task for a worker, its own first, false when every queue is empty
+	bool TakeTask(int worker, size_t& task);
+
+	struct TaskQueue
+	{
+		std::mutex mutex;
+		std::deque<size_t> tasks;
+	};
+
+	std::vector<TaskQueue> queues;
+	std::vector<std::thread> workers;
+
+	std::vector<PerftTask>* pTasks;
+	PerftTable* pTable;
+
+	std::mutex jobMutex;
+	std::condition_variable jobReady;
+	std::condition_variable jobDone;
+	uint64_t jobGeneration;
+	int workersBusy;
+	bool quitting;
+
+	std::atomic<uint64_t> steals;
+};
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+PerftPool::PerftPool(int numThreads) : queues(numThreads)
+{
+	pTasks = nullptr;
+	pTable = nullptr;
+	jobGeneration = 0;
+	workersBusy = 0;
+	quitting = false;
+	steals = 0;
+
+	for (int i = 1; i < numThreads; i++)
+	{
+		workers.push_back(std::thread(&PerftPool::WorkerLoop, this, i));
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+PerftPool::~PerftPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		quitting = true;
+	}
+	jobReady.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Deal the tasks round the queues, so every thread starts with some of each root move
+// ------------------------------------------------------------------------------------
+void PerftPool::Run(std::vector<PerftTask>& tasks, PerftTable& table)
+{
+	for (size_t i = 0; i < tasks.size(); i++)
+	{
+		queues[i % queues.size()].tasks.push_back(i);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		pTasks = &tasks;
+		pTable = &table;
+		workersBusy = (int)workers.size();
+		jobGeneration++;
+	}
+	jobReady.notify_all();
+
+	RunTasks(0);
+
+	// the tasks live on the caller's stack, so every worker has to be finished with them
+	std::unique_lock<std::mutex> lock(jobMutex);
+	jobDone.wait(lock, [this] { return workersBusy == 0; });
+	pTasks = nullptr;
+	pTable = nullptr;
+}
+
+// ------------------------------------------------------------------------------------
+// Wait for a run, help with it, repeat
+// ------------------------------------------------------------------------------------
+void PerftPool::WorkerLoop(int worker)
+{
+	uint64_t seenGeneration = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobReady.wait(lock, [&] { return quitting || jobGeneration != seenGeneration; });
+			if (quitting)
+			{
+				return;
+			}
+			seenGeneration = jobGeneration;
+		}
+
+		RunTasks(worker);
+
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			if (--workersBusy == 0)
+			{
+				jobDone.notify_one();
+			}
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void PerftPool::RunTasks(int worker)
+{
+	size_t index;
+	while (TakeTask(worker, index))
+	{
+		PerftTask& task = (*pTasks)[index];
+		task.nodes = pTable->IsEnabled() ? HashedPerft(task.position, task.depth, *pTable) : task.position.Perft(task.depth);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// No tasks are added during a run, so once a pass over every queue finds nothing the
+// run is out of work for this thread
+// ------------------------------------------------------------------------------------
+bool PerftPool::TakeTask(int worker, size_t& task)
+{
+	{
+		TaskQueue& own = queues[worker];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.tasks.empty())
+		{
+			task = own.tasks.back();
+			own.tasks.pop_back();
+			return true;
+		}
+	}
+
+	for (size_t i = 1; i < queues.size(); i++)
+	{
+		TaskQueue& victim = queues[(worker + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = victim.tasks.front();
+			victim.tasks.pop_front();
+			steals++;
+			return true;
+		}
+	}
+	return false;
+}
+
+// ------------------------------------------------------------------------------------
+// A task per position plies moves in, a ply or two being enough that no one task keeps
+// the other threads waiting at the end
+// ------------------------------------------------------------------------------------
+static void SplitTree(ChessPosition& position, int depth, int plies, std::vector<PerftTask>& tasks)
+{
+	if (plies == 0 || depth <= 1)
+	{
+		PerftTask task;
+		task.position = position;
+		task.depth = depth;
+		task.nodes = 0;
+		tasks.push_back(task);
+		return;
+	}
+
+	MoveList list;
+	position.GenerateMoves(list);
+
+	MoveUndo undo;
+	for (int i = 0; i < list.count; i++)
+	{
+		position.MakeMove(list.moves[i], undo);
+		SplitTree(position, depth - 1, plies - 1, tasks);
+		position.UnmakeMove(list.moves[i], undo);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static uint64_t ParallelPerft(ChessPosition position, int depth, PerftPool& pool, PerftTable& table)
+{
+	std::vector<PerftTask> tasks;
+	SplitTree(position, depth, depth >= 4 ? 2 : 1, tasks);
+	pool.Run(tasks, table);
+
+	uint64_t nodes = 0;
+	for (size_t i = 0; i < tasks.size(); i++)
+	{
+		nodes += tasks[i].nodes;
+	}
+	return nodes;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+	printf("usage: perft_bench [options]\n"
+		"  --depth N            plies to count, up to 6 for the test positions (default 5)\n"
+		"  --threads LIST       comma separated thread counts (default 1 to every core)\n"
+		"  --positions LIST     comma separated test positions (default all of them)\n"
+		"  --fen FEN            count this position instead of the test positions\n"
+		"  --hash MB            share a table of subtree counts this big, 0 for none (default 0)\n"
+		"  --output FILE        write the JSON here instead of stdout\n");
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static std::vector<std::string> SplitList(const std::string& list)
+{
+	std::vector<std::string> items;
+	size_t start = 0;
+	while (start < list.size())
+	{
+		size_t end = list.find(',', start);
+		if (end == std::string::npos)
+		{
+			end = list.size();
+		}
+		items.push_back(list.substr(start, end - start));
+		start = end + 1;
+	}
+	return items;
+}
+
+// ------------------------------------------------------------------------------------
+// Read the options, false if any of them are wrong
+// ------------------------------------------------------------------------------------
+static bool ParseOptions(int argc, char** argv, Options& options)
+{
+	std::string threads;
+	options.depth = 5;
+	options.hashMegabytes = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--help")
+		{
+			return false;
+		}
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "%s needs a value\n", option.c_str());
+			return false;
+		}
+		std::string value = argv[++i];
+
+		if (option == "--depth") options.depth = atoi(value.c_str());
+		else if (option == "--threads") threads = value;
+		else if (option == "--positions") options.positions = SplitList(value);
+		else if (option == "--fen") options.fen = value;
+		else if (option == "--hash") options.hashMegabytes = atoi(value.c_str());
+		else if (option == "--output") options.output = value;
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", option.c_str());
+			return false;
+		}
+	}
+
+	if (threads.empty())
+	{
+		int cores = (int)std::thread::hardware_concurrency();
+		for (int i = 1; i <= (cores > 0 ? cores : 1); i++)
+		{
+			options.threads.push_back(i);
+		}
+	}
+	else
+	{
+		std::vector<std::string> counts = SplitList(threads);
+		for (size_t i = 0; i < counts.size(); i++)
+		{
+			int count = atoi(counts[i].c_str());
+			if (count <= 0)
+			{
+				fprintf(stderr, "bad thread count in %s\n", threads.c_str());
+				return false;
+			}
+			options.threads.push_back(count);
+		}
+	}
+
+	if (options.threads.empty() || options.hashMegabytes < 0)
+	{
+		fprintf(stderr, "need at least one thread count, and the table can't be negative\n");
+		return false;
+	}
+	if (options.depth < 1 || (options.fen.empty() && options.depth > 6))
+	{
+		fprintf(stderr, "the depth must be from 1, and up to 6 for the test positions\n");
+		return false;
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	// a position from the command line, the ones asked for or every test position
+	std::vector<PerftPosition> positions;
+	if (!options.fen.empty())
+	{
+		PerftPosition position = { "fen", options.fen.c_str(), { 0, 0, 0, 0, 0, 0 } };
+		positions.push_back(position);
+	}
+	else if (options.positions.empty())
+	{
+		positions.assign(PERFT_POSITIONS, PERFT_POSITIONS + NUM_PERFT_POSITIONS);
+	}
+	for (size_t i = 0; i < options.positions.size() && options.fen.empty(); i++)
+	{
+		int found = 0;
+		while (found < NUM_PERFT_POSITIONS && options.positions[i] != PERFT_POSITIONS[found].name)
+		{
+			found++;
+		}
+		if (found == NUM_PERFT_POSITIONS)
+		{
+			fprintf(stderr, "there's no test position called %s\n", options.positions[i].c_str());
+			return 1;
+		}
+		positions.push_back(PERFT_POSITIONS[found]);
+	}
+
+	std::vector<ChessPosition> boards(positions.size());
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		if (!boards[i].SetFen(positions[i].fen))
+		{
+			fprintf(stderr, "couldn't read %s\n", positions[i].fen);
+			return 1;
+		}
+	}
+
+	FILE* pOutput = stdout;
+	if (!options.output.empty())
+	{
+		pOutput = fopen(options.output.c_str(), "w");
+		if (!pOutput)
+		{
+			fprintf(stderr, "couldn't open %s\n", options.output.c_str());
+			return 1;
+		}
+	}
+
+	PerftTable table(options.hashMegabytes);
+
+	fprintf(pOutput, "{\n");
+	fprintf(pOutput, "  \"depth\": %d,\n", options.depth);
+	fprintf(pOutput, "  \"hash_mb\": %d,\n", options.hashMegabytes);
+	fprintf(pOutput, "  \"cores\": %u,\n", std::thread::hardware_concurrency());
+	fprintf(pOutput, "  \"runs\": [\n");
+
+	int failures = 0;
+	double baseRate = 0;
+	int baseThreads = 0;
+	for (size_t run = 0; run < options.threads.size(); run++)
+	{
+		int numThreads = options.threads[run];
+		PerftPool pool(numThreads);
+
+		fprintf(pOutput, "    {\n");
+		fprintf(pOutput, "      \"threads\": %d,\n", numThreads);
+		fprintf(pOutput, "      \"positions\": [\n");
+
+		uint64_t totalNodes = 0;
+		double totalMs = 0;
+		for (size_t i = 0; i < positions.size(); i++)
+		{
+			// every run starts from an empty table, or later runs would only be looking counts up
+			table.Clear();
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			uint64_t nodes = ParallelPerft(boards[i], options.depth, pool, table);
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+			double ms = std::chrono::duration<double, std::milli>(end - start).count();
+			uint64_t expected = options.depth <= 6 ? positions[i].nodes[options.depth - 1] : 0;
+			if (expected != 0 && nodes != expected)
+			{
+				failures++;
+			}
+			totalNodes += nodes;
+			totalMs += ms;
+
+			fprintf(pOutput, "        { \"name\": \"%s\", \"nodes\": %llu, \"expected\": %llu, \"ms\": %.2f, \"nodes_per_second\": %.0f, \"match\": %s }%s\n",
+				positions[i].name, (unsigned long long)nodes, (unsigned long long)expected, ms, ms > 0 ? nodes * 1000.0 / ms : 0.0,
+				expected == 0 ? "null" : nodes == expected ? "true" : "false", i + 1 < positions.size() ? "," : "");
+		}
+
+		// scaling is against the first run, so its thread count is the baseline
+		double rate = totalMs > 0 ? totalNodes * 1000.0 / totalMs : 0;
+		if (run == 0)
+		{
+			baseRate = rate;
+			baseThreads = numThreads;
+		}
+		double speedup = baseRate > 0 ? rate / baseRate : 0;
+		double efficiency = speedup * baseThreads / numThreads;
+
+		fprintf(pOutput, "      ],\n");
+		fprintf(pOutput, "      \"nodes\": %llu,\n", (unsigned long long)totalNodes);
+		fprintf(pOutput, "      \"ms\": %.2f,\n", totalMs);
+		fprintf(pOutput, "      \"nodes_per_second\": %.0f,\n", rate);
+		fprintf(pOutput, "      \"speedup\": %.3f,\n", speedup);
+		fprintf(pOutput, "      \"efficiency\": %.3f,\n", efficiency);
+		fprintf(pOutput, "      \"steals\": %llu\n", (unsigned long long)pool.GetSteals());
+		fprintf(pOutput, "    }%s\n", run + 1 < options.threads.size() ? "," : "");
+
+		fprintf(stderr, "%d threads: %.0f nodes/s, %.2fx, %.0f%% efficient\n", numThreads, rate, speedup, efficiency * 100);
+	}
+
+	fprintf(pOutput, "  ]\n");
+	fprintf(pOutput, "}\n");
+
+	if (pOutput != stdout)
+	{
+		fclose(pOutput);
+	}
+
+	if (failures > 0)
+	{
+		fprintf(stderr, "%d of the counts are wrong\n", failures);
+		return 1;
+	}
+	return 0;
+}
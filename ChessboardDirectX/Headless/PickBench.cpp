@@ -0,0 +1,269 @@
+//
+// BGTD 9201
+//	Times hover queries over a grid of full boards that fills the screen, the
+//	way the mouse asks on every move. Each query unprojects a point on the
+//	screen and picks through the ScenePicker's tree, then the same ray is
+//	tested against every board and piece to check the tree's answer and time
+//	it against. Writes a CSV row per board count
+//
+
+#include <DirectXMath.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ChessSet.h"
+#include "Models.h"
+#include "ScenePicker.h"
+
+using namespace DirectX;
+
+// boards sit a two square gap apart, as in scene_bench
+static const float BOARD_SPACING = (ChessSet::BOARD_SIZE + 2) * ChessSet::GRID_SCALE;
+
+// the window MyProject opens and the camera it draws with
+static const float SCREEN_WIDTH = 1280;
+static const float SCREEN_HEIGHT = 720;
+static const float FIELD_OF_VIEW = 60.0f * XM_PI / 180.0f;
+
+// the camera looks down this steeply at the middle of the grid
+static const float FIT_PITCH = XM_PI / 3.0f;
+
+struct Options
+{
+	std::vector<int> boards;
+	int queries;
+	std::string output;
+};
+
+// ------------------------------------------------------------------------------------
+// The same numbers on every run
+// ------------------------------------------------------------------------------------
+static UINT Random(UINT& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return seed >> 8;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static int GetColumns(int numBoards)
+{
+	return (int)ceilf(sqrtf((float)numBoards));
+}
+
+// ------------------------------------------------------------------------------------
+// Looking down at the middle of the grid from close enough that it fills the screen's
+// height, so most of the mouse lands on a square or a piece
+// ------------------------------------------------------------------------------------
+static void ComputeFillCamera(int numBoards, XMFLOAT4X4& view, XMFLOAT4X4& projection)
+{
+	int columns = GetColumns(numBoards);
+	int rows = (numBoards + columns - 1) / columns;
+
+	float halfDepth = rows * BOARD_SPACING * 0.5f;
+	float distance = halfDepth / tanf(FIELD_OF_VIEW * 0.5f);
+	XMVECTOR eye = XMVectorSet(0, distance * sinf(FIT_PITCH), distance * cosf(FIT_PITCH), 0);
+
+	XMStoreFloat4x4(&view, XMMatrixLookAtRH(eye, XMVectorZero(), XMVectorSet(0, 1, 0, 0)));
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovRH(FIELD_OF_VIEW, SCREEN_WIDTH / SCREEN_HEIGHT, 1, distance * 4));
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+	printf("usage: pick_bench [options]\n"
+		"  --boards LIST        comma separated board counts (default 1,16,256,4096)\n"
+		"  --queries N          hover queries per row (default 2000)\n"
+		"  --output FILE        write the CSV here instead of stdout\n");
+}
+
+// ------------------------------------------------------------------------------------
+// Read the options, false if any of them are wrong
+// ------------------------------------------------------------------------------------
+static bool ParseOptions(int argc, char** argv, Options& options)
+{
+	std::string boards = "1,16,256,4096";
+	options.queries = 2000;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--help")
+		{
+			return false;
+		}
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "%s needs a value\n", option.c_str());
+			return false;
+		}
+		std::string value = argv[++i];
+
+		if (option == "--boards") boards = value;
+		else if (option == "--queries") options.queries = atoi(value.c_str());
+		else if (option == "--output") options.output = value;
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", option.c_str());
+			return false;
+		}
+	}
+
+	size_t start = 0;
+	while (start < boards.size())
+	{
+		size_t end = boards.find(',', start);
+		if (end == std::string::npos)
+		{
+			end = boards.size();
+		}
+		int count = atoi(boards.substr(start, end - start).c_str());
+		if (count <= 0)
+		{
+			fprintf(stderr, "bad board count in %s\n", boards.c_str());
+			return false;
+		}
+		options.boards.push_back(count);
+		start = end + 1;
+	}
+
+	if (options.boards.empty() || options.queries <= 0)
+	{
+		fprintf(stderr, "need at least one board count and one query\n");
+		return false;
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	FILE* pOutput = stdout;
+	if (!options.output.empty())
+	{
+		pOutput = fopen(options.output.c_str(), "w");
+		if (!pOutput)
+		{
+			fprintf(stderr, "couldn't open %s\n", options.output.c_str());
+			return 1;
+		}
+	}
+
+	// the box around every piece type's baked mesh
+	MeshBounds pieceBounds[NUM_PIECE_TYPES];
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		std::vector<PiecePart> parts;
+		BakedParts piece;
+		ChessSet::GetPieceParts((PieceType)i, parts);
+		ChessSet::BakeParts(parts, piece);
+		pieceBounds[i] = piece.bounds;
+	}
+
+	std::vector<PiecePlacement> placements;
+	ChessSet::GetStartingPlacements(placements);
+
+	fprintf(pOutput, "boards,objects,nodes,build_ms,tree_ns_per_query,every_object_ns_per_query,squares,pieces,misses,mismatches\n");
+
+	for (size_t c = 0; c < options.boards.size(); c++)
+	{
+		int numBoards = options.boards[c];
+		int columns = GetColumns(numBoards);
+		int rows = (numBoards + columns - 1) / columns;
+
+		// every board and its pieces, the ids are the board and the board's piece
+		ScenePicker picker;
+		std::chrono::steady_clock::time_point buildStart = std::chrono::steady_clock::now();
+		picker.Begin();
+		for (int i = 0; i < numBoards; i++)
+		{
+			float x = ((i % columns) - (columns - 1) * 0.5f) * BOARD_SPACING;
+			float z = ((i / columns) - (rows - 1) * 0.5f) * BOARD_SPACING;
+			XMMATRIX offset = XMMatrixTranslation(x, 0, z);
+
+			XMFLOAT4X4 world;
+			XMStoreFloat4x4(&world, offset);
+			picker.AddBoard(i, world);
+
+			for (size_t j = 0; j < placements.size(); j++)
+			{
+				XMStoreFloat4x4(&world, ChessSet::GetPlacementMatrix(placements[j], ChessSet::PIECE_BASE_OFFSET) * offset);
+				picker.AddPiece((UINT)(i * placements.size() + j), pieceBounds[placements[j].type], world);
+			}
+		}
+		picker.Build();
+		std::chrono::steady_clock::time_point buildEnd = std::chrono::steady_clock::now();
+
+		XMFLOAT4X4 view, projection;
+		ComputeFillCamera(numBoards, view, projection);
+
+		// the mouse somewhere on the screen, unprojected as part of each query
+		std::vector<XMFLOAT2> mousePositions(options.queries);
+		UINT seed = 9201;
+		for (int i = 0; i < options.queries; i++)
+		{
+			mousePositions[i].x = (float)(Random(seed) % (UINT)SCREEN_WIDTH);
+			mousePositions[i].y = (float)(Random(seed) % (UINT)SCREEN_HEIGHT);
+		}
+
+		std::vector<PickResult> treeResults(options.queries);
+		std::chrono::steady_clock::time_point treeStart = std::chrono::steady_clock::now();
+		for (int i = 0; i < options.queries; i++)
+		{
+			PickRay ray = ScenePicker::Unproject(mousePositions[i].x, mousePositions[i].y, SCREEN_WIDTH, SCREEN_HEIGHT, view, projection);
+			picker.Pick(ray, treeResults[i]);
+		}
+		std::chrono::steady_clock::time_point treeEnd = std::chrono::steady_clock::now();
+
+		std::vector<PickResult> everyResults(options.queries);
+		std::chrono::steady_clock::time_point everyStart = std::chrono::steady_clock::now();
+		for (int i = 0; i < options.queries; i++)
+		{
+			PickRay ray = ScenePicker::Unproject(mousePositions[i].x, mousePositions[i].y, SCREEN_WIDTH, SCREEN_HEIGHT, view, projection);
+			picker.PickEveryObject(ray, everyResults[i]);
+		}
+		std::chrono::steady_clock::time_point everyEnd = std::chrono::steady_clock::now();
+
+		int squares = 0, pieces = 0, misses = 0, mismatches = 0;
+		for (int i = 0; i < options.queries; i++)
+		{
+			const PickResult& a = treeResults[i];
+			const PickResult& b = everyResults[i];
+			if (a.object == PickedSquare) squares++;
+			else if (a.object == PickedPiece) pieces++;
+			else misses++;
+
+			if (a.object != b.object || (a.object != PickedNothing && (a.id != b.id || a.squareX != b.squareX || a.squareY != b.squareY)))
+			{
+				mismatches++;
+			}
+		}
+
+		double buildMs = std::chrono::duration<double, std::milli>(buildEnd - buildStart).count();
+		double treeNs = std::chrono::duration<double, std::nano>(treeEnd - treeStart).count() / options.queries;
+		double everyNs = std::chrono::duration<double, std::nano>(everyEnd - everyStart).count() / options.queries;
+
+		fprintf(pOutput, "%d,%u,%u,%.4f,%.1f,%.1f,%d,%d,%d,%d\n", numBoards, picker.GetObjectCount(), picker.GetNodeCount(),
+			buildMs, treeNs, everyNs, squares, pieces, misses, mismatches);
+		fprintf(stderr, "%5d boards  %9.1f ns tree  %11.1f ns every object  %d mismatches\n", numBoards, treeNs, everyNs, mismatches);
+	}
+
+	if (pOutput != stdout)
+	{
+		fclose(pOutput);
+	}
+	return 0;
+}
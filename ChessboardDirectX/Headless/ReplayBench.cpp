@@ -0,0 +1,196 @@
+//
+// BGTD 9201
+//	Plays a capture saved by the game (C key) back through the null or the
+//	recording device and reports what each frame's submission cost, so
+//	submission changes can be measured without a window, input or timer
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "CommandCapture.h"
+#include "NullRenderDevice.h"
+#include "RecordingRenderDevice.h"
+
+// what the command line asked for
+struct Options
+{
+	std::string capture;
+	std::string device;
+	int passes;
+	int warmup;
+};
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+	printf("usage: replay_bench [options] CAPTURE\n"
+		"  --device NAME        null or recording (default null)\n"
+		"  --passes N           times the whole capture is timed (default 10)\n"
+		"  --warmup N           untimed passes first (default 1)\n");
+}
+
+// ------------------------------------------------------------------------------------
+// Read the options, false if any of them are wrong
+// ------------------------------------------------------------------------------------
+static bool ParseOptions(int argc, char** argv, Options& options)
+{
+	options.device = "null";
+	options.passes = 10;
+	options.warmup = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--help")
+		{
+			return false;
+		}
+		if (option.compare(0, 2, "--") != 0)
+		{
+			options.capture = option;
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "%s needs a value\n", option.c_str());
+			return false;
+		}
+		std::string value = argv[++i];
+
+		if (option == "--device") options.device = value;
+		else if (option == "--passes") options.passes = atoi(value.c_str());
+		else if (option == "--warmup") options.warmup = atoi(value.c_str());
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", option.c_str());
+			return false;
+		}
+	}
+
+	if (options.capture.empty())
+	{
+		fprintf(stderr, "no capture given\n");
+		return false;
+	}
+	if (options.device != "null" && options.device != "recording")
+	{
+		fprintf(stderr, "unknown device %s\n", options.device.c_str());
+		return false;
+	}
+	if (options.passes <= 0 || options.warmup < 0)
+	{
+		fprintf(stderr, "passes must be positive and warmup can't be negative\n");
+		return false;
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// The value below which this fraction of the sorted times fall
+// ------------------------------------------------------------------------------------
+static double Percentile(const std::vector<double>& sorted, double fraction)
+{
+	size_t index = (size_t)(fraction * (double)(sorted.size() - 1) + 0.5);
+	return sorted[index];
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	CommandCapture capture;
+	if (!capture.Load(options.capture.c_str()))
+	{
+		fprintf(stderr, "%s is not a capture\n", options.capture.c_str());
+		return 1;
+	}
+	if (capture.GetNumFrames() == 0)
+	{
+		fprintf(stderr, "%s has no frames\n", options.capture.c_str());
+		return 1;
+	}
+
+	NullRenderDevice nullDevice;
+	RecordingRenderDevice recordingDevice;
+	RenderDevice* pRenderDevice = &nullDevice;
+	if (options.device == "recording")
+	{
+		pRenderDevice = &recordingDevice;
+	}
+
+	CommandReplayer replayer(capture.GetNumObjects());
+	std::vector<double> frameTimes;
+	frameTimes.reserve((size_t)capture.GetNumFrames() * options.passes);
+	double totalCommands = 0;
+
+	for (int pass = 0; pass < options.warmup + options.passes; pass++)
+	{
+		bool timed = pass >= options.warmup;
+		for (int i = 0; i < capture.GetNumFrames(); i++)
+		{
+			const CaptureFrame& frame = capture.GetFrame(i);
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			pRenderDevice->BeginFrame();
+			bool replayed = replayer.ReplayFrame(pRenderDevice, frame.stream);
+			pRenderDevice->EndFrame();
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+			if (!replayed)
+			{
+				fprintf(stderr, "frame %d of %s is damaged\n", i, options.capture.c_str());
+				return 1;
+			}
+			if (timed)
+			{
+				frameTimes.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+				totalCommands += replayer.GetNumCommands();
+			}
+		}
+	}
+
+	double total = 0;
+	for (size_t i = 0; i < frameTimes.size(); i++)
+	{
+		total += frameTimes[i];
+	}
+	std::vector<double> sorted = frameTimes;
+	std::sort(sorted.begin(), sorted.end());
+
+	double mean = total / (double)frameTimes.size();
+	double commandsPerFrame = totalCommands / (double)frameTimes.size();
+
+	printf("%s: %d frames x %d passes on the %s device, %.1f commands per frame\n", options.capture.c_str(),
+		capture.GetNumFrames(), options.passes, options.device.c_str(), commandsPerFrame);
+	printf("  frame us: mean %.3f  p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n", mean,
+		Percentile(sorted, 0.5), Percentile(sorted, 0.9), Percentile(sorted, 0.99), sorted.back());
+	printf("  %.1f ns per command\n", commandsPerFrame > 0 ? mean * 1000.0 / commandsPerFrame : 0.0);
+
+	// the last frame as the recording device saw it
+	if (pRenderDevice == &recordingDevice)
+	{
+		const DeviceFrameStats& stats = recordingDevice.GetFrameStats();
+		printf("  last frame: %d draws, %d instances, %u constant bytes, %u other bytes, %u stream bytes\n",
+			stats.draws, stats.instances, stats.constantBytes, stats.otherBytes, stats.streamBytes);
+	}
+
+	// where the camera went, to tell captures apart
+	const CaptureCamera& first = capture.GetFrame(0).camera;
+	const CaptureCamera& last = capture.GetFrame(capture.GetNumFrames() - 1).camera;
+	printf("  camera: radius %.2f -> %.2f, orbit %.3f -> %.3f, tilt %.3f -> %.3f\n",
+		first.radius, last.radius, first.rotation[0], last.rotation[0], first.rotation[1], last.rotation[1]);
+	return 0;
+}
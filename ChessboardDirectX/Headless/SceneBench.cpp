@@ -0,0 +1,1352 @@
+//
+// BGTD 9201
+//	Lays out N full boards in a grid, 64 squares and 32 pieces each, and
+//	times what a frame costs the CPU to place, cull, queue, sort and submit
+//	them to a device without a GPU. Sweeps N and writes a CSV row for each,
+//	once with every object drawn through its own SetShaders upload and once
+//	the way the game batches them now, so batching changes show up as a
+//	shift in the curve. The world matrices either come from a TransformStore
+//	updated once a frame or are worked out object by object as they are used
+//
+
+#include <DirectXMath.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "ChessScene.h"
+#include "ChessSet.h"
+#include "ConstantRing.h"
+#include "FrustumCuller.h"
+#include "NullRenderDevice.h"
+#include "RecordingRenderDevice.h"
+#include "RenderQueue.h"
+#include "StateCache.h"
+#include "TransformStore.h"
+
+using namespace DirectX;
+
+// boards sit a two square gap apart
+static const float BOARD_SPACING = (ChessSet::BOARD_SIZE + 2) * ChessSet::GRID_SCALE;
+
+// the window MyProject opens and the camera it draws with
+static const float ASPECT_RATIO = 1280.0f / 720.0f;
+static const float FIELD_OF_VIEW = 60.0f * XM_PI / 180.0f;
+
+// the fitted camera looks down this steeply at the middle of the grid
+static const float FIT_PITCH = XM_PI / 3.0f;
+
+// the same ring MyProject creates
+static const UINT RING_SIZE = 64 * 1024;
+
+// how the frame's objects reach the device
+enum SubmitMode
+{
+	PerDrawMode,		// a packet, a constant upload and a draw for every square and piece
+	InstancedMode,		// a draw per board's squares and one per piece type for every board
+};
+
+// where the objects' world matrices come from
+enum TransformMode
+{
+	InlineTransforms,	// multiplied out where they are used, and inverted for every draw
+	StoreTransforms,	// one TransformStore update a frame, draws copy what it worked out
+};
+
+// what the command line asked for
+struct Options
+{
+	std::vector<int> boards;
+	std::vector<SubmitMode> modes;
+	std::vector<TransformMode> transforms;
+	std::string output;
+	std::string camera;
+	std::string device;
+	int frames;
+	int warmup;
+	int threads;
+	TransformKernel kernel;
+};
+
+// aligns with the per-object constants in LitColourShader
+struct ObjectConstants
+{
+	XMFLOAT4X4 worldMatrix;
+	XMFLOAT4X4 worldViewProjectionMatrix;
+	XMFLOAT4X4 worldMatrixIT;
+};
+
+// aligns with LitColourShader's FrameConstants, LightConstants and InstanceData
+struct FrameConstants
+{
+	XMFLOAT4X4 viewMatrix;
+	XMFLOAT4X4 projectionMatrix;
+	XMFLOAT4X4 viewProjectionMatrix;
+	XMFLOAT4 worldCameraPosition;
+};
+
+struct LightConstants
+{
+	XMFLOAT4 values[10];
+};
+
+struct InstanceData
+{
+	XMFLOAT4X4 worldMatrix;
+	XMFLOAT4 colour;
+};
+
+// a mesh as the draw path sees it, without a GPU only the handles and index count matter
+struct BenchMesh
+{
+	DeviceBuffer* pVertexBuffer;
+	DeviceBuffer* pIndexBuffer;
+	UINT numIndices;
+	MeshBounds bounds;
+};
+
+// what one frame did
+struct BenchCounts
+{
+	int visible;
+	int packets;
+	int draws;
+	UINT constantBytes;
+	UINT instanceBytes;
+	double transformMs;		// spent in the store's update
+};
+
+// handles for the state that is only ever bound, never created or read
+static unsigned char stateHandles[8];
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+template <typename T> static T* StateHandle(int index)
+{
+	return (T*)&stateHandles[index];
+}
+
+// ------------------------------------------------------------------------------------
+// Stands in for LitColourShader, uploading and binding exactly what it does per draw
+// ------------------------------------------------------------------------------------
+class BenchShader
+{
+public:
+	BenchShader()
+	{
+		pObjectBuffer = nullptr;
+		pFrameBuffer = nullptr;
+		pLightsBuffer = nullptr;
+		frameAllocation.pBuffer = nullptr;
+		lightsAllocation.pBuffer = nullptr;
+		objectAllocation.pBuffer = nullptr;
+		lights = LightConstants();
+		pCounts = nullptr;
+	}
+
+	void Initialize(RenderDevice* pRenderDevice, BenchCounts* pFrameCounts)
+	{
+		pObjectBuffer = pRenderDevice->CreateConstantBuffer(sizeof(ObjectConstants));
+		pFrameBuffer = pRenderDevice->CreateConstantBuffer(sizeof(FrameConstants));
+		pLightsBuffer = pRenderDevice->CreateConstantBuffer(sizeof(LightConstants));
+		pCounts = pFrameCounts;
+	}
+
+	void Release(RenderDevice* pRenderDevice)
+	{
+		pRenderDevice->ReleaseBuffer(pObjectBuffer);
+		pRenderDevice->ReleaseBuffer(pFrameBuffer);
+		pRenderDevice->ReleaseBuffer(pLightsBuffer);
+	}
+
+	// the camera constants, once a frame. The lights go up again with the first draw
+	void SetFrameConstants(RenderDevice* pRenderDevice, const XMFLOAT4X4& view, const XMFLOAT4X4& projection)
+	{
+		XMMATRIX viewMatrix = XMLoadFloat4x4(&view);
+		XMMATRIX projectionMatrix = XMLoadFloat4x4(&projection);
+		viewProjection = XMMatrixMultiply(viewMatrix, projectionMatrix);
+
+		XMStoreFloat4x4(&frameValues.viewMatrix, XMMatrixTranspose(viewMatrix));
+		XMStoreFloat4x4(&frameValues.projectionMatrix, XMMatrixTranspose(projectionMatrix));
+		XMStoreFloat4x4(&frameValues.viewProjectionMatrix, XMMatrixTranspose(viewProjection));
+		XMStoreFloat4(&frameValues.worldCameraPosition, AffineTransform(view, RigidTransform).Invert().r[3]);
+
+		ConstantRing::Get().Upload(pRenderDevice, pFrameBuffer, &frameValues, sizeof(FrameConstants), frameAllocation);
+		pCounts->constantBytes += sizeof(FrameConstants);
+	}
+
+	// LitColourShader::SetShaders with a world matrix, its WVP and its inverse for every draw
+	void Bind(RenderDevice* pRenderDevice, DeviceVertexShader* pVS, const XMFLOAT4X4& world, TransformKind kind)
+	{
+		XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+		TransformMatrices matrices;
+		XMStoreFloat4x4(&matrices.worldMatrix, XMMatrixTranspose(worldMatrix));
+		XMStoreFloat4x4(&matrices.worldViewProjectionMatrix, XMMatrixTranspose(XMMatrixMultiply(worldMatrix, viewProjection)));
+		XMStoreFloat4x4(&matrices.worldMatrixIT, AffineTransform(world, kind).Invert());
+		Bind(pRenderDevice, pVS, matrices);
+	}
+
+	// LitColourShader::BindShaders, the matrices only have to be copied
+	void Bind(RenderDevice* pRenderDevice, DeviceVertexShader* pVS, const TransformMatrices& matrices)
+	{
+		ConstantRing& ring = ConstantRing::Get();
+		ring.Reserve(ConstantRing::AlignedSize(sizeof(ObjectConstants)) + ConstantRing::AlignedSize(sizeof(FrameConstants))
+			+ ConstantRing::AlignedSize(sizeof(LightConstants)));
+
+		ObjectConstants constants;
+		constants.worldMatrix = matrices.worldMatrix;
+		constants.worldViewProjectionMatrix = matrices.worldViewProjectionMatrix;
+		constants.worldMatrixIT = matrices.worldMatrixIT;
+
+		ring.Upload(pRenderDevice, pObjectBuffer, &constants, sizeof(ObjectConstants), objectAllocation);
+		pCounts->constantBytes += sizeof(ObjectConstants);
+
+		if (!ring.IsCurrent(frameAllocation))
+		{
+			ring.Upload(pRenderDevice, pFrameBuffer, &frameValues, sizeof(FrameConstants), frameAllocation);
+			pCounts->constantBytes += sizeof(FrameConstants);
+		}
+		if (!ring.IsCurrent(lightsAllocation))
+		{
+			ring.Upload(pRenderDevice, pLightsBuffer, &lights, sizeof(LightConstants), lightsAllocation);
+			pCounts->constantBytes += sizeof(LightConstants);
+		}
+
+		StateCache::Get().VSSetShader(pRenderDevice, pVS);
+		StateCache::Get().PSSetShader(pRenderDevice, StateHandle<DevicePixelShader>(2));
+
+		ring.BindVS(pRenderDevice, 0, objectAllocation);
+		ring.BindVS(pRenderDevice, 1, lightsAllocation);
+		ring.BindVS(pRenderDevice, 3, frameAllocation);
+		ring.BindPS(pRenderDevice, 0, objectAllocation);
+		ring.BindPS(pRenderDevice, 1, lightsAllocation);
+		ring.BindPS(pRenderDevice, 3, frameAllocation);
+
+		StateCache::Get().PSSetSampler(pRenderDevice, 0, StateHandle<DeviceSampler>(3));
+	}
+
+	// the textures and material table every piece and the board bind before drawing
+	void SetMaterials(RenderDevice* pRenderDevice)
+	{
+		StateCache::Get().PSSetShaderResource(pRenderDevice, 0, StateHandle<DeviceTexture>(4));
+		StateCache::Get().PSSetShaderResource(pRenderDevice, 1, StateHandle<DeviceTexture>(4));
+		StateCache::Get().PSSetShaderResource(pRenderDevice, 2, StateHandle<DeviceTexture>(5));
+
+		// the shared table's immutable constant buffer, bound as it is like LitColourShader::SetMaterials
+		ConstantAllocation materials;
+		materials.pBuffer = StateHandle<DeviceBuffer>(6);
+		materials.firstConstant = 0;
+		materials.numConstants = 0;
+		materials.generation = 0;
+		ConstantRing::Get().BindPS(pRenderDevice, 2, materials);
+	}
+
+private:
+	DeviceBuffer* pObjectBuffer;
+	DeviceBuffer* pFrameBuffer;
+	DeviceBuffer* pLightsBuffer;
+
+	XMMATRIX viewProjection;
+	FrameConstants frameValues;
+	LightConstants lights;
+
+	ConstantAllocation frameAllocation;
+	ConstantAllocation lightsAllocation;
+	ConstantAllocation objectAllocation;
+
+	BenchCounts* pCounts;
+};
+
+// ------------------------------------------------------------------------------------
+// Bind a mesh the way IndexedPrimitive and BakedMesh do, with or without instances
+// ------------------------------------------------------------------------------------
+static void BindMesh(RenderDevice* pRenderDevice, const BenchMesh& mesh, DeviceBuffer* pInstanceBuffer)
+{
+	StateCache::Get().IASetInputLayout(pRenderDevice, StateHandle<DeviceInputLayout>(pInstanceBuffer ? 1 : 0));
+	StateCache::Get().IASetPrimitiveTopology(pRenderDevice, TriangleListTopology);
+
+	DeviceBuffer* buffers[2] = { mesh.pVertexBuffer, pInstanceBuffer };
+	UINT strides[2] = { sizeof(BakedVertex), sizeof(InstanceData) };
+	UINT offsets[2] = { 0, 0 };
+	StateCache::Get().IASetVertexBuffers(pRenderDevice, 0, pInstanceBuffer ? 2 : 1, buffers, strides, offsets);
+	StateCache::Get().IASetIndexBuffer(pRenderDevice, mesh.pIndexBuffer, Index32Format, 0);
+}
+
+// ------------------------------------------------------------------------------------
+// Every object of one mesh drawn on its own, the packet's startInstance says which. With
+// a store it is the object's transform, otherwise its place in worlds
+// ------------------------------------------------------------------------------------
+class PerDrawObjects : public Renderable
+{
+public:
+	PerDrawObjects() : pTransforms(nullptr), kind(GeneralTransform), pShader(nullptr), pMesh(nullptr), pCounts(nullptr) {}
+
+	void Initialize(BenchShader* pBenchShader, const BenchMesh* pBenchMesh, BenchCounts* pFrameCounts)
+	{
+		pShader = pBenchShader;
+		pMesh = pBenchMesh;
+		pCounts = pFrameCounts;
+	}
+
+	void DrawPacket(RenderDevice* pRenderDevice, const RenderPacket& packet)
+	{
+		pShader->SetMaterials(pRenderDevice);
+		if (pTransforms != nullptr)
+		{
+			pShader->Bind(pRenderDevice, StateHandle<DeviceVertexShader>(0), pTransforms->GetMatrices(packet.startInstance));
+		}
+		else
+		{
+			pShader->Bind(pRenderDevice, StateHandle<DeviceVertexShader>(0), worlds[packet.startInstance], kind);
+		}
+		BindMesh(pRenderDevice, *pMesh, nullptr);
+		pRenderDevice->DrawIndexed(pMesh->numIndices, 0, 0);
+		pCounts->draws++;
+	}
+
+	// this frame's world matrix of every object
+	std::vector<XMFLOAT4X4> worlds;
+
+	// draw with the matrices this store worked out instead, nullptr to use worlds
+	const TransformStore* pTransforms;
+
+	// what every one of worlds is, squares are scaled per axis and pieces rigid
+	TransformKind kind;
+
+private:
+	BenchShader* pShader;
+	const BenchMesh* pMesh;
+	BenchCounts* pCounts;
+};
+
+// ------------------------------------------------------------------------------------
+// Instances of one mesh drawn together, a Chessboard's squares or a piece type
+// ------------------------------------------------------------------------------------
+class InstancedObjects : public Renderable
+{
+public:
+	InstancedObjects() : pShader(nullptr), pMesh(nullptr), pCounts(nullptr) {}
+
+	void Initialize(BenchShader* pBenchShader, const BenchMesh* pBenchMesh, BenchCounts* pFrameCounts)
+	{
+		pShader = pBenchShader;
+		pMesh = pBenchMesh;
+		pCounts = pFrameCounts;
+	}
+
+	void DrawPacket(RenderDevice* pRenderDevice, const RenderPacket& packet)
+	{
+		XMFLOAT4X4 identity;
+		XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+		pShader->SetMaterials(pRenderDevice);
+		pShader->Bind(pRenderDevice, StateHandle<DeviceVertexShader>(1), identity, RigidTransform);
+		BindMesh(pRenderDevice, *pMesh, packet.pInstanceBuffer);
+		pRenderDevice->DrawIndexedInstanced(pMesh->numIndices, packet.numInstances, 0, 0, packet.startInstance);
+		pCounts->draws++;
+	}
+
+private:
+	BenchShader* pShader;
+	const BenchMesh* pMesh;
+	BenchCounts* pCounts;
+};
+
+// one board in the instanced path, its squares kept in their own buffer like a Chessboard
+struct BenchBoard
+{
+	XMFLOAT4X4 worldPositionMatrix;
+	DeviceBuffer* pInstanceBuffer;
+	InstanceData squareInstances[ChessSet::BOARD_SIZE * ChessSet::BOARD_SIZE];
+	bool squareVisible[ChessSet::BOARD_SIZE * ChessSet::BOARD_SIZE];
+	UINT numVisibleSquares;
+	bool visibleSquaresChanged;
+	UINT firstCullIndex;
+};
+
+// ------------------------------------------------------------------------------------
+// The boards, the meshes they are drawn with and everything needed to submit a frame
+// ------------------------------------------------------------------------------------
+class BenchScene
+{
+public:
+	BenchScene(RenderDevice* pRenderDevice, int numThreads);
+	~BenchScene();
+
+	// lay out numBoards boards in a grid as close to square as it can be
+	void Build(int numBoards);
+
+	// the camera every frame is drawn from
+	void SetCamera(const XMFLOAT4X4& view, const XMFLOAT4X4& projection, float nearPlane, float farPlane);
+
+	// place, cull, queue and draw every object once
+	void Frame(SubmitMode mode, TransformMode transformMode);
+
+	// the store's kernel, the best one the CPU has by default
+	void SetKernel(TransformKernel kernel) { transforms.SetKernel(kernel); }
+	TransformKernel GetKernel() const { return transforms.GetKernel(); }
+
+	// how wide the grid is, in boards
+	static int GetColumns(int numBoards);
+
+	// what the last frame did
+	const BenchCounts& GetCounts() const { return counts; }
+
+	// memory the scene and its frame hold on the CPU
+	size_t GetSceneBytes() const;
+
+private:
+
+	// the world matrix of every piece, recomputed every frame as MyProject does
+	void PlacePieces(XMFLOAT4X4* pWorlds);
+
+	// place the pieces in the store and update it, with the draws' matrices if asked
+	void UpdateTransforms(bool shaderMatrices);
+
+	// this frame's world matrix of square or piece i, from the store or the inline copies
+	const XMFLOAT4X4& GetSquareWorld(size_t i) const;
+	const XMFLOAT4X4& GetPieceWorld(size_t i) const;
+
+	void PerDrawFrame();
+	void InstancedFrame();
+
+	// how far in front of the camera a world position is
+	float GetViewDepth(const XMFLOAT4X4& world) const;
+
+	RenderDevice* pDevice;
+
+	BenchMesh squareMesh;
+	BenchMesh pieceMeshes[NUM_PIECE_TYPES];
+
+	std::vector<PiecePlacement> placements;
+	std::vector<XMFLOAT4X4> boardOffsets;
+	std::vector<XMFLOAT4X4> squareMatrices;
+
+	BenchShader shader;
+	FrustumCuller culler;
+	RenderQueue queue;
+	BenchCounts counts;
+
+	XMFLOAT4X4 viewMatrix;
+	XMFLOAT4X4 projectionMatrix;
+
+	// every board is a root with its squares and then its pieces under it
+	TransformStore transforms;
+	UINT firstSquareTransform;
+	UINT firstPieceTransform;
+	std::vector<XMFLOAT4X4> placementMatrices;
+	bool useStore;
+
+	// one per mesh, squares first
+	PerDrawObjects perDraw[NUM_PIECE_TYPES + 1];
+
+	// boards with their own square buffers, and every piece in one buffer grouped by type
+	std::vector<BenchBoard> boards;
+	InstancedObjects squareDrawer;
+	InstancedObjects pieceDrawers[NUM_PIECE_TYPES];
+	std::vector<InstanceData> pieceInstances[NUM_PIECE_TYPES];
+	std::vector<XMFLOAT4X4> pieceWorlds;
+	DeviceBuffer* pPieceBuffer;
+};
+
+// ------------------------------------------------------------------------------------
+// Bake every piece once for its index count and bounds
+// ------------------------------------------------------------------------------------
+BenchScene::BenchScene(RenderDevice* pRenderDevice, int numThreads) : transforms(numThreads)
+{
+	pDevice = pRenderDevice;
+	firstSquareTransform = 0;
+	firstPieceTransform = 0;
+	useStore = false;
+	pPieceBuffer = pDevice->CreateConstantBuffer(sizeof(InstanceData));
+	memset(&counts, 0, sizeof(counts));
+
+	shader.Initialize(pDevice, &counts);
+
+	// baked the same way as the game's meshes
+	BakedParts square;
+	ChessSet::BakePart(Cube, 1.0f, Models::DEFAULT_TESSELLATION, XMMatrixIdentity(), 0, square);
+	ChessSet::FitSphere(square);
+	squareMesh.bounds = square.bounds;
+	squareMesh.numIndices = (UINT)square.indices.size();
+
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		std::vector<PiecePart> parts;
+		BakedParts piece;
+		ChessSet::GetPieceParts((PieceType)i, parts);
+		ChessSet::BakeParts(parts, piece);
+		pieceMeshes[i].bounds = piece.bounds;
+		pieceMeshes[i].numIndices = (UINT)piece.indices.size();
+	}
+
+	// the handles only have to be distinct
+	BenchMesh* meshes[NUM_PIECE_TYPES + 1] = { &squareMesh };
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		meshes[i + 1] = &pieceMeshes[i];
+	}
+	for (int i = 0; i <= NUM_PIECE_TYPES; i++)
+	{
+		meshes[i]->pVertexBuffer = pDevice->CreateConstantBuffer(1);
+		meshes[i]->pIndexBuffer = pDevice->CreateConstantBuffer(1);
+		perDraw[i].Initialize(&shader, meshes[i], &counts);
+	}
+
+	squareDrawer.Initialize(&shader, &squareMesh, &counts);
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		pieceDrawers[i].Initialize(&shader, &pieceMeshes[i], &counts);
+	}
+
+	ChessSet::GetStartingPlacements(placements);
+
+	// the same on every board, only set in the store each frame
+	for (size_t i = 0; i < placements.size(); i++)
+	{
+		XMFLOAT4X4 placement;
+		XMStoreFloat4x4(&placement, ChessSet::GetPlacementMatrix(placements[i], ChessSet::PIECE_BASE_OFFSET));
+		placementMatrices.push_back(placement);
+	}
+
+	XMMATRIX boardMatrix = ChessSet::GetBoardMatrix();
+	for (int x = 0; x < ChessSet::BOARD_SIZE; x++)
+	{
+		for (int y = 0; y < ChessSet::BOARD_SIZE; y++)
+		{
+			XMFLOAT4X4 square;
+			XMStoreFloat4x4(&square, ChessSet::GetSquareMatrix(x, y) * boardMatrix);
+			squareMatrices.push_back(square);
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+BenchScene::~BenchScene()
+{
+	for (size_t i = 0; i < boards.size(); i++)
+	{
+		pDevice->ReleaseBuffer(boards[i].pInstanceBuffer);
+	}
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		pDevice->ReleaseBuffer(pieceMeshes[i].pVertexBuffer);
+		pDevice->ReleaseBuffer(pieceMeshes[i].pIndexBuffer);
+	}
+	pDevice->ReleaseBuffer(squareMesh.pVertexBuffer);
+	pDevice->ReleaseBuffer(squareMesh.pIndexBuffer);
+	pDevice->ReleaseBuffer(pPieceBuffer);
+	shader.Release(pDevice);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+int BenchScene::GetColumns(int numBoards)
+{
+	int columns = (int)ceil(sqrt((double)numBoards));
+	return columns > 0 ? columns : 1;
+}
+
+// ------------------------------------------------------------------------------------
+// The grid is centred on the origin so the game's camera looks at its middle board
+// ------------------------------------------------------------------------------------
+void BenchScene::Build(int numBoards)
+{
+	for (size_t i = 0; i < boards.size(); i++)
+	{
+		pDevice->ReleaseBuffer(boards[i].pInstanceBuffer);
+	}
+	boards.clear();
+	boardOffsets.clear();
+
+	int columns = GetColumns(numBoards);
+	int rows = (numBoards + columns - 1) / columns;
+	XMMATRIX boardMatrix = ChessSet::GetBoardMatrix();
+	const XMFLOAT4 colours[2] = { XMFLOAT4(0.96f, 0.96f, 0.86f, 1), XMFLOAT4(0.65f, 0.16f, 0.16f, 1) };
+
+	boards.resize(numBoards);
+	for (int i = 0; i < numBoards; i++)
+	{
+		float x = ((i % columns) - (columns - 1) * 0.5f) * BOARD_SPACING;
+		float z = ((i / columns) - (rows - 1) * 0.5f) * BOARD_SPACING;
+
+		XMFLOAT4X4 offset;
+		XMStoreFloat4x4(&offset, XMMatrixTranslation(x, 0, z));
+		boardOffsets.push_back(offset);
+
+		// the squares start out visible and uploaded, as a Chessboard does after Initialize
+		BenchBoard& board = boards[i];
+		XMStoreFloat4x4(&board.worldPositionMatrix, boardMatrix * XMMatrixTranslation(x, 0, z));
+		board.pInstanceBuffer = pDevice->CreateConstantBuffer(sizeof(board.squareInstances));
+		for (int j = 0; j < ChessSet::BOARD_SIZE * ChessSet::BOARD_SIZE; j++)
+		{
+			int squareX = j / ChessSet::BOARD_SIZE;
+			int squareY = j % ChessSet::BOARD_SIZE;
+			XMStoreFloat4x4(&board.squareInstances[j].worldMatrix, ChessSet::GetSquareMatrix(squareX, squareY) * XMLoadFloat4x4(&board.worldPositionMatrix));
+			board.squareInstances[j].colour = colours[ChessSet::IsFirstColour(squareX, squareY) ? 0 : 1];
+			board.squareVisible[j] = true;
+		}
+		board.numVisibleSquares = ChessSet::BOARD_SIZE * ChessSet::BOARD_SIZE;
+		board.visibleSquaresChanged = false;
+		board.firstCullIndex = 0;
+	}
+
+	size_t numPieces = (size_t)numBoards * placements.size();
+	size_t numSquares = (size_t)numBoards * squareMatrices.size();
+	pieceWorlds.resize(numPieces);
+
+	// the boards first, then every square and every piece a level below them
+	transforms.Clear();
+	for (int i = 0; i < numBoards; i++)
+	{
+		transforms.Add(boardOffsets[i], TransformStore::NO_PARENT, RigidTransform);
+	}
+	firstSquareTransform = transforms.GetCount();
+	for (int i = 0; i < numBoards; i++)
+	{
+		for (size_t j = 0; j < squareMatrices.size(); j++)
+		{
+			transforms.Add(squareMatrices[j], i, AffineTransform::FindKind(squareMatrices[j]));
+		}
+	}
+	firstPieceTransform = transforms.GetCount();
+	for (int i = 0; i < numBoards; i++)
+	{
+		for (size_t j = 0; j < placementMatrices.size(); j++)
+		{
+			transforms.Add(placementMatrices[j], i, RigidTransform);
+		}
+	}
+
+	// the per-draw path keeps a matrix per object of each mesh, the boards only move them
+	perDraw[0].worlds.resize(numSquares);
+	perDraw[0].kind = AffineTransform::FindKind(squareMatrices[0]);
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		size_t ofType = 0;
+		for (size_t j = 0; j < placements.size(); j++)
+		{
+			if (placements[j].type == i)
+			{
+				ofType++;
+			}
+		}
+		perDraw[i + 1].worlds.reserve(ofType * numBoards);
+		perDraw[i + 1].kind = RigidTransform;
+		pieceInstances[i].reserve(ofType * numBoards);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void BenchScene::SetCamera(const XMFLOAT4X4& view, const XMFLOAT4X4& projection, float nearPlane, float farPlane)
+{
+	viewMatrix = view;
+	projectionMatrix = projection;
+	queue.SetDepthRange(nearPlane, farPlane);
+
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection)));
+	culler.SetFrustum(viewProjection);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+float BenchScene::GetViewDepth(const XMFLOAT4X4& world) const
+{
+	// the camera looks down -z
+	XMVECTOR position = XMVectorSet(world._41, world._42, world._43, 1);
+	return -XMVectorGetZ(XMVector3Transform(position, XMLoadFloat4x4(&viewMatrix)));
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void BenchScene::PlacePieces(XMFLOAT4X4* pWorlds)
+{
+	for (size_t i = 0; i < boards.size(); i++)
+	{
+		XMMATRIX offset = XMLoadFloat4x4(&boardOffsets[i]);
+		for (size_t j = 0; j < placements.size(); j++)
+		{
+			XMStoreFloat4x4(pWorlds++, ChessSet::GetPlacementMatrix(placements[j], ChessSet::PIECE_BASE_OFFSET) * offset);
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// What MyProject::Render does with its store, the pieces set and every matrix worked out
+// ------------------------------------------------------------------------------------
+void BenchScene::UpdateTransforms(bool shaderMatrices)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	UINT index = firstPieceTransform;
+	for (size_t i = 0; i < boards.size(); i++)
+	{
+		for (size_t j = 0; j < placementMatrices.size(); j++)
+		{
+			transforms.SetLocal(index++, placementMatrices[j], RigidTransform);
+		}
+	}
+
+	if (shaderMatrices)
+	{
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(XMLoadFloat4x4(&viewMatrix), XMLoadFloat4x4(&projectionMatrix)));
+		transforms.Update(viewProjection);
+	}
+	else
+	{
+		transforms.Update();
+	}
+
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	counts.transformMs = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+const XMFLOAT4X4& BenchScene::GetSquareWorld(size_t i) const
+{
+	return useStore ? transforms.GetWorld(firstSquareTransform + (UINT)i) : perDraw[0].worlds[i];
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+const XMFLOAT4X4& BenchScene::GetPieceWorld(size_t i) const
+{
+	return useStore ? transforms.GetWorld(firstPieceTransform + (UINT)i) : pieceWorlds[i];
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void BenchScene::Frame(SubmitMode mode, TransformMode transformMode)
+{
+	memset(&counts, 0, sizeof(counts));
+	useStore = transformMode == StoreTransforms;
+	for (int i = 0; i <= NUM_PIECE_TYPES; i++)
+	{
+		perDraw[i].pTransforms = useStore ? &transforms : nullptr;
+	}
+
+	pDevice->BeginFrame();
+	ConstantRing::Get().BeginFrame();
+	StateCache::Get().Invalidate();
+	shader.SetFrameConstants(pDevice, viewMatrix, projectionMatrix);
+	queue.Begin();
+
+	if (mode == PerDrawMode)
+	{
+		PerDrawFrame();
+	}
+	else
+	{
+		InstancedFrame();
+	}
+
+	counts.packets = queue.GetNumPackets();
+	queue.Sort();
+	queue.Execute(pDevice);
+	pDevice->EndFrame();
+}
+
+// ------------------------------------------------------------------------------------
+// Every square and piece is culled, keyed and drawn on its own
+// ------------------------------------------------------------------------------------
+void BenchScene::PerDrawFrame()
+{
+	size_t numSquares = boards.size() * squareMatrices.size();
+
+	if (useStore)
+	{
+		UpdateTransforms(true);
+	}
+	else
+	{
+		PlacePieces(pieceWorlds.data());
+
+		std::vector<XMFLOAT4X4>& squareWorlds = perDraw[0].worlds;
+		for (size_t i = 0; i < boards.size(); i++)
+		{
+			XMMATRIX offset = XMLoadFloat4x4(&boardOffsets[i]);
+			for (size_t j = 0; j < squareMatrices.size(); j++)
+			{
+				XMStoreFloat4x4(&squareWorlds[i * squareMatrices.size() + j], XMLoadFloat4x4(&squareMatrices[j]) * offset);
+			}
+		}
+	}
+
+	culler.Begin();
+	for (size_t i = 0; i < numSquares; i++)
+	{
+		culler.AddBounds(squareMesh.bounds, GetSquareWorld(i));
+	}
+	for (size_t i = 0; i < pieceWorlds.size(); i++)
+	{
+		culler.AddBounds(pieceMeshes[placements[i % placements.size()].type].bounds, GetPieceWorld(i));
+	}
+	culler.Cull();
+
+	// visible squares keep their index, visible pieces are copied to their type's list
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		perDraw[i + 1].worlds.clear();
+	}
+
+	RenderPacket packet;
+	packet.pInstanceBuffer = nullptr;
+	packet.numInstances = 1;
+
+	UINT cullIndex = 0;
+	for (size_t i = 0; i < numSquares; i++, cullIndex++)
+	{
+		if (culler.IsVisible(cullIndex))
+		{
+			packet.key = queue.MakeKey(OpaquePass, &shader, 0, &squareMesh, GetViewDepth(GetSquareWorld(i)));
+			packet.pOwner = &perDraw[0];
+			packet.startInstance = useStore ? firstSquareTransform + (UINT)i : (UINT)i;
+			queue.Submit(packet);
+		}
+	}
+	for (size_t i = 0; i < pieceWorlds.size(); i++, cullIndex++)
+	{
+		if (culler.IsVisible(cullIndex))
+		{
+			PieceType type = placements[i % placements.size()].type;
+			PerDrawObjects& objects = perDraw[type + 1];
+
+			packet.key = queue.MakeKey(OpaquePass, &shader, 1 + type, &pieceMeshes[type], GetViewDepth(GetPieceWorld(i)));
+			packet.pOwner = &objects;
+			if (useStore)
+			{
+				packet.startInstance = firstPieceTransform + (UINT)i;
+			}
+			else
+			{
+				packet.startInstance = (UINT)objects.worlds.size();
+				objects.worlds.push_back(pieceWorlds[i]);
+			}
+			queue.Submit(packet);
+		}
+	}
+
+	counts.visible = queue.GetNumPackets();
+}
+
+// ------------------------------------------------------------------------------------
+// What MyProject::Render does for one board, repeated for every board: each board's
+// squares are one draw and every piece goes into one buffer drawn once per type
+// ------------------------------------------------------------------------------------
+void BenchScene::InstancedFrame()
+{
+	const int numSquares = ChessSet::BOARD_SIZE * ChessSet::BOARD_SIZE;
+
+	// PieceBatcher::Begin and AddPiece, the squares' instances never change so only their
+	// culling reads the store
+	if (useStore)
+	{
+		UpdateTransforms(false);
+	}
+	else
+	{
+		PlacePieces(pieceWorlds.data());
+	}
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		pieceInstances[i].clear();
+	}
+	for (size_t i = 0; i < pieceWorlds.size(); i++)
+	{
+		const PiecePlacement& placement = placements[i % placements.size()];
+		InstanceData instance;
+		instance.worldMatrix = GetPieceWorld(i);
+		instance.colour = placement.playerOne ? XMFLOAT4(1, 1, 1, 1) : XMFLOAT4(0, 0, 0, 1);
+		pieceInstances[placement.type].push_back(instance);
+	}
+
+	// Chessboard::AddToCuller and PieceBatcher::AddToCuller
+	culler.Begin();
+	for (size_t i = 0; i < boards.size(); i++)
+	{
+		BenchBoard& board = boards[i];
+		board.firstCullIndex = culler.GetNumSpheres();
+		if (useStore)
+		{
+			for (int j = 0; j < numSquares; j++)
+			{
+				culler.AddBounds(squareMesh.bounds, GetSquareWorld(i * numSquares + j));
+			}
+			continue;
+		}
+
+		XMMATRIX worldPosition = XMLoadFloat4x4(&board.worldPositionMatrix);
+		for (int x = 0; x < ChessSet::BOARD_SIZE; x++)
+		{
+			for (int y = 0; y < ChessSet::BOARD_SIZE; y++)
+			{
+				XMFLOAT4X4 world;
+				XMStoreFloat4x4(&world, ChessSet::GetSquareMatrix(x, y) * worldPosition);
+				culler.AddBounds(squareMesh.bounds, world);
+			}
+		}
+	}
+	UINT firstPieceIndex[NUM_PIECE_TYPES];
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		firstPieceIndex[i] = culler.GetNumSpheres();
+		for (size_t j = 0; j < pieceInstances[i].size(); j++)
+		{
+			culler.AddBounds(pieceMeshes[i].bounds, pieceInstances[i][j].worldMatrix);
+		}
+	}
+	culler.Cull();
+
+	// Chessboard::ApplyCulling and Submit, the squares only go up again when the visible set changed
+	for (size_t i = 0; i < boards.size(); i++)
+	{
+		BenchBoard& board = boards[i];
+		board.numVisibleSquares = 0;
+		for (int j = 0; j < numSquares; j++)
+		{
+			bool visible = culler.IsVisible(board.firstCullIndex + j);
+			if (visible != board.squareVisible[j])
+			{
+				board.squareVisible[j] = visible;
+				board.visibleSquaresChanged = true;
+			}
+			if (visible)
+			{
+				board.numVisibleSquares++;
+			}
+		}
+		counts.visible += board.numVisibleSquares;
+
+		if (board.numVisibleSquares == 0)
+		{
+			continue;
+		}
+
+		if (board.visibleSquaresChanged)
+		{
+			board.visibleSquaresChanged = false;
+			InstanceData* pInstances = (InstanceData*)pDevice->Map(board.pInstanceBuffer, MapWriteDiscard, 0, sizeof(board.squareInstances));
+			if (pInstances != nullptr)
+			{
+				for (int j = 0; j < numSquares; j++)
+				{
+					if (board.squareVisible[j])
+					{
+						*pInstances++ = board.squareInstances[j];
+					}
+				}
+				pDevice->Unmap(board.pInstanceBuffer);
+			}
+			counts.instanceBytes += sizeof(board.squareInstances);
+		}
+
+		RenderPacket packet;
+		packet.key = queue.MakeKey(OpaquePass, &shader, 0, &squareMesh, GetViewDepth(boardOffsets[i]));
+		packet.pOwner = &squareDrawer;
+		packet.pInstanceBuffer = board.pInstanceBuffer;
+		packet.startInstance = 0;
+		packet.numInstances = board.numVisibleSquares;
+		queue.Submit(packet);
+	}
+
+	// PieceBatcher::ApplyCulling and Upload, one map for every piece
+	UINT total = 0;
+	UINT startInstance[NUM_PIECE_TYPES];
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		size_t kept = 0;
+		for (size_t j = 0; j < pieceInstances[i].size(); j++)
+		{
+			if (culler.IsVisible(firstPieceIndex[i] + (UINT)j))
+			{
+				pieceInstances[i][kept++] = pieceInstances[i][j];
+			}
+		}
+		pieceInstances[i].resize(kept);
+
+		startInstance[i] = total;
+		total += (UINT)kept;
+	}
+	counts.visible += total;
+
+	if (total > 0)
+	{
+		InstanceData* pInstances = (InstanceData*)pDevice->Map(pPieceBuffer, MapWriteDiscard, 0, total * sizeof(InstanceData));
+		if (pInstances != nullptr)
+		{
+			for (int i = 0; i < NUM_PIECE_TYPES; i++)
+			{
+				if (!pieceInstances[i].empty())
+				{
+					memcpy(pInstances + startInstance[i], pieceInstances[i].data(), pieceInstances[i].size() * sizeof(InstanceData));
+				}
+			}
+			pDevice->Unmap(pPieceBuffer);
+		}
+		counts.instanceBytes += total * sizeof(InstanceData);
+	}
+
+	// a packet per piece type, sorted by its nearest instance
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		if (pieceInstances[i].empty())
+		{
+			continue;
+		}
+
+		float nearest = GetViewDepth(pieceInstances[i][0].worldMatrix);
+		for (size_t j = 1; j < pieceInstances[i].size(); j++)
+		{
+			nearest = std::min(nearest, GetViewDepth(pieceInstances[i][j].worldMatrix));
+		}
+
+		RenderPacket packet;
+		packet.key = queue.MakeKey(OpaquePass, &shader, 1 + i, &pieceMeshes[i], nearest);
+		packet.pOwner = &pieceDrawers[i];
+		packet.pInstanceBuffer = pPieceBuffer;
+		packet.startInstance = startInstance[i];
+		packet.numInstances = (UINT)pieceInstances[i].size();
+		queue.Submit(packet);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// What the scene holds on the CPU, the queue keeps its packets and a scratch copy
+// ------------------------------------------------------------------------------------
+size_t BenchScene::GetSceneBytes() const
+{
+	size_t bytes = boards.capacity() * sizeof(BenchBoard) + boardOffsets.capacity() * sizeof(XMFLOAT4X4)
+		+ pieceWorlds.capacity() * sizeof(XMFLOAT4X4);
+	for (int i = 0; i <= NUM_PIECE_TYPES; i++)
+	{
+		bytes += perDraw[i].worlds.capacity() * sizeof(XMFLOAT4X4);
+	}
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		bytes += pieceInstances[i].capacity() * sizeof(InstanceData);
+	}
+
+	// two copies of the elements, a parent and a level, and the whole matrices per transform
+	if (useStore)
+	{
+		bytes += transforms.GetCount() * (32 * sizeof(float) + 2 * sizeof(int) + sizeof(XMFLOAT4X4) + sizeof(TransformMatrices));
+	}
+
+	// four floats and a flag per sphere in the culler
+	bytes += culler.GetNumSpheres() * (4 * sizeof(float) + sizeof(uint32_t));
+	bytes += 2 * (size_t)queue.GetNumPackets() * sizeof(RenderPacket);
+	return bytes;
+}
+
+// ------------------------------------------------------------------------------------
+// The most memory the process has held, in KB
+// ------------------------------------------------------------------------------------
+static long GetPeakMemoryKB()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS memory;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory)))
+	{
+		return (long)(memory.PeakWorkingSetSize / 1024);
+	}
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return 0;
+	}
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+#endif
+}
+
+// ------------------------------------------------------------------------------------
+// Looking down at the middle of the grid from far enough back that every board fits
+// ------------------------------------------------------------------------------------
+static void ComputeFitCamera(int numBoards, XMFLOAT4X4& view, XMFLOAT4X4& projection, float& nearPlane, float& farPlane)
+{
+	int columns = BenchScene::GetColumns(numBoards);
+	int rows = (numBoards + columns - 1) / columns;
+
+	float halfWidth = columns * BOARD_SPACING * 0.5f;
+	float halfDepth = rows * BOARD_SPACING * 0.5f;
+	float radius = sqrtf(halfWidth * halfWidth + halfDepth * halfDepth) + ChessSet::GRID_SCALE * 2;
+
+	// the vertical field of view is the narrower one
+	float distance = radius / sinf(FIELD_OF_VIEW * 0.5f);
+	XMVECTOR eye = XMVectorSet(0, distance * sinf(FIT_PITCH), distance * cosf(FIT_PITCH), 0);
+
+	nearPlane = 1;
+	farPlane = distance + radius;
+	XMStoreFloat4x4(&view, XMMatrixLookAtRH(eye, XMVectorZero(), XMVectorSet(0, 1, 0, 0)));
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovRH(FIELD_OF_VIEW, ASPECT_RATIO, nearPlane, farPlane));
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+	printf("usage: scene_bench [options]\n"
+		"  --boards LIST        comma separated board counts (default 1,10,100,1000,10000)\n"
+		"  --mode NAME          per-draw, instanced or both (default both)\n"
+		"  --transforms NAME    inline, store or both (default both)\n"
+		"  --threads N          threads updating the store, 0 for every core (default 1)\n"
+		"  --kernel NAME        scalar, wide4 or avx2 for the store (default the best the CPU has)\n"
+		"  --camera NAME        fit to see every board, or game for MyProject's camera (default fit)\n"
+		"  --device NAME        null or recording (default null)\n"
+		"  --frames N           timed frames per row (default 10)\n"
+		"  --warmup N           untimed frames first (default 2)\n"
+		"  --output FILE        write the CSV here instead of stdout\n");
+}
+
+// ------------------------------------------------------------------------------------
+// Read the options, false if any of them are wrong
+// ------------------------------------------------------------------------------------
+static bool ParseOptions(int argc, char** argv, Options& options)
+{
+	std::string boards = "1,10,100,1000,10000";
+	std::string mode = "both";
+	std::string transforms = "both";
+	std::string kernel;
+	options.camera = "fit";
+	options.device = "null";
+	options.frames = 10;
+	options.warmup = 2;
+	options.threads = 1;
+	options.kernel = TransformStore::GetBestKernel();
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--help")
+		{
+			return false;
+		}
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "%s needs a value\n", option.c_str());
+			return false;
+		}
+		std::string value = argv[++i];
+
+		if (option == "--boards") boards = value;
+		else if (option == "--mode") mode = value;
+		else if (option == "--transforms") transforms = value;
+		else if (option == "--threads") options.threads = atoi(value.c_str());
+		else if (option == "--kernel") kernel = value;
+		else if (option == "--camera") options.camera = value;
+		else if (option == "--device") options.device = value;
+		else if (option == "--frames") options.frames = atoi(value.c_str());
+		else if (option == "--warmup") options.warmup = atoi(value.c_str());
+		else if (option == "--output") options.output = value;
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", option.c_str());
+			return false;
+		}
+	}
+
+	for (size_t start = 0; start < boards.size();)
+	{
+		size_t end = boards.find(',', start);
+		if (end == std::string::npos)
+		{
+			end = boards.size();
+		}
+		int count = atoi(boards.substr(start, end - start).c_str());
+		if (count <= 0)
+		{
+			fprintf(stderr, "board counts must be positive\n");
+			return false;
+		}
+		options.boards.push_back(count);
+		start = end + 1;
+	}
+
+	if (mode == "per-draw" || mode == "both") options.modes.push_back(PerDrawMode);
+	if (mode == "instanced" || mode == "both") options.modes.push_back(InstancedMode);
+
+	if (transforms == "inline" || transforms == "both") options.transforms.push_back(InlineTransforms);
+	if (transforms == "store" || transforms == "both") options.transforms.push_back(StoreTransforms);
+
+	if (options.boards.empty() || options.modes.empty() || options.transforms.empty())
+	{
+		fprintf(stderr, "nothing to run, check --boards, --mode and --transforms\n");
+		return false;
+	}
+	if (kernel == "scalar") options.kernel = ScalarTransformKernel;
+	else if (kernel == "wide4") options.kernel = Wide4TransformKernel;
+	else if (kernel == "avx2") options.kernel = AVX2TransformKernel;
+	else if (!kernel.empty())
+	{
+		fprintf(stderr, "unknown kernel %s\n", kernel.c_str());
+		return false;
+	}
+	if (options.threads < 0)
+	{
+		fprintf(stderr, "threads can't be negative\n");
+		return false;
+	}
+	if (options.camera != "fit" && options.camera != "game")
+	{
+		fprintf(stderr, "unknown camera %s\n", options.camera.c_str());
+		return false;
+	}
+	if (options.device != "null" && options.device != "recording")
+	{
+		fprintf(stderr, "unknown device %s\n", options.device.c_str());
+		return false;
+	}
+	if (options.frames <= 0 || options.warmup < 0)
+	{
+		fprintf(stderr, "frames must be positive and warmup can't be negative\n");
+		return false;
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// The value below which this fraction of the sorted times fall
+// ------------------------------------------------------------------------------------
+static double Percentile(const std::vector<double>& sorted, double fraction)
+{
+	size_t index = (size_t)(fraction * (double)(sorted.size() - 1) + 0.5);
+	return sorted[index];
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	FILE* pOutput = stdout;
+	if (!options.output.empty())
+	{
+		pOutput = fopen(options.output.c_str(), "w");
+		if (!pOutput)
+		{
+			fprintf(stderr, "couldn't open %s\n", options.output.c_str());
+			return 1;
+		}
+	}
+
+	NullRenderDevice nullDevice;
+	RecordingRenderDevice recordingDevice;
+	RenderDevice* pRenderDevice = &nullDevice;
+	if (options.device == "recording")
+	{
+		pRenderDevice = &recordingDevice;
+	}
+	ConstantRing::Get().Initialize(pRenderDevice, RING_SIZE);
+
+	fprintf(pOutput, "boards,mode,transforms,objects,visible,packets,draws,frame_ms_mean,frame_ms_p50,frame_ms_p95,ns_per_object,"
+		"transform_ms,constant_bytes,instance_bytes,stream_bytes,scene_kb,peak_rss_kb\n");
+
+	{
+		BenchScene scene(pRenderDevice, options.threads);
+		scene.SetKernel(options.kernel);
+
+		const char* kernelNames[] = { "scalar", "wide4", "avx2" };
+		fprintf(stderr, "transform store: %s kernel, %d threads\n", kernelNames[scene.GetKernel()], options.threads);
+
+		for (size_t b = 0; b < options.boards.size(); b++)
+		{
+			int numBoards = options.boards[b];
+			scene.Build(numBoards);
+
+			XMFLOAT4X4 view, projection;
+			float nearPlane, farPlane;
+			if (options.camera == "game")
+			{
+				ChessScene game;
+				game.ComputeViewProjection(ASPECT_RATIO, view, projection);
+				nearPlane = ChessScene::NEAR_PLANE;
+				farPlane = ChessScene::FAR_PLANE;
+			}
+			else
+			{
+				ComputeFitCamera(numBoards, view, projection, nearPlane, farPlane);
+			}
+			scene.SetCamera(view, projection, nearPlane, farPlane);
+
+			for (size_t m = 0; m < options.modes.size() * options.transforms.size(); m++)
+			{
+				SubmitMode mode = options.modes[m / options.transforms.size()];
+				TransformMode transformMode = options.transforms[m % options.transforms.size()];
+				std::vector<double> frameTimes;
+				double transformTotal = 0;
+
+				for (int frame = 0; frame < options.warmup + options.frames; frame++)
+				{
+					std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					scene.Frame(mode, transformMode);
+					std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+					if (frame >= options.warmup)
+					{
+						frameTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+						transformTotal += scene.GetCounts().transformMs;
+					}
+				}
+
+				double total = 0;
+				for (size_t i = 0; i < frameTimes.size(); i++)
+				{
+					total += frameTimes[i];
+				}
+				std::vector<double> sorted = frameTimes;
+				std::sort(sorted.begin(), sorted.end());
+				double mean = total / (double)frameTimes.size();
+
+				int objects = numBoards * (ChessSet::BOARD_SIZE * ChessSet::BOARD_SIZE + 32);
+				const BenchCounts& counts = scene.GetCounts();
+				UINT streamBytes = pRenderDevice == &recordingDevice ? recordingDevice.GetFrameStats().streamBytes : 0;
+				const char* modeName = mode == PerDrawMode ? "per-draw" : "instanced";
+				const char* transformName = transformMode == StoreTransforms ? "store" : "inline";
+				double transformMean = transformTotal / (double)frameTimes.size();
+
+				fprintf(pOutput, "%d,%s,%s,%d,%d,%d,%d,%.4f,%.4f,%.4f,%.1f,%.4f,%u,%u,%u,%zu,%ld\n", numBoards, modeName, transformName,
+					objects, counts.visible, counts.packets, counts.draws, mean, Percentile(sorted, 0.5), Percentile(sorted, 0.95),
+					mean * 1e6 / objects, transformMean, counts.constantBytes, counts.instanceBytes, streamBytes,
+					scene.GetSceneBytes() / 1024, GetPeakMemoryKB());
+				fflush(pOutput);
+
+				fprintf(stderr, "%6d boards %-9s %-6s %9.3f ms  %7d draws  %8.3f ms transforms\n", numBoards, modeName, transformName,
+					mean, counts.draws, transformMean);
+			}
+		}
+	}
+
+	ConstantRing::Get().Release();
+	if (pOutput != stdout)
+	{
+		fclose(pOutput);
+	}
+	return 0;
+}
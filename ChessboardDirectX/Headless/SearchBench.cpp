@@ -0,0 +1,267 @@
+//
+// BGTD 9201
+//	Searches the test positions on the engine's threads while this one plays
+//	the part of the render loop, polling the snapshot once a frame. Writes a
+//	CSV row per thread count and position with how deep the search got, its
+//	speed and move, what starting the search and polling it cost the frame,
+//	and with a depth limit how much sooner than the first thread count it
+//	got there
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ChessEngine.h"
+#include "PerftPositions.h"
+
+struct Options
+{
+	SearchLimits limits;
+	std::vector<int> threads;
+	int hashMegabytes;
+	std::vector<std::string> positions;
+	std::string fen;
+	int frameMs;
+	std::string output;
+};
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+	printf("usage: search_bench [options]\n"
+		"  --depth N            stop after this depth, 0 for no limit (default 0)\n"
+		"  --movetime MS        stop after this long, 0 for no limit (default 1000)\n"
+		"  --nodes N            stop after this many nodes, 0 for no limit (default 0)\n"
+		"  --threads LIST       comma separated thread counts, 0 for every core (default 1)\n"
+		"  --hash MB            transposition table size (default 16)\n"
+		"  --positions LIST     comma separated test positions (default all of them)\n"
+		"  --fen FEN            search this position instead of the test positions\n"
+		"  --frame-ms MS        how long a frame waits between polls (default 16)\n"
+		"  --output FILE        write the CSV here instead of stdout\n");
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static std::vector<std::string> SplitList(const std::string& list)
+{
+	std::vector<std::string> items;
+	size_t start = 0;
+	while (start < list.size())
+	{
+		size_t end = list.find(',', start);
+		if (end == std::string::npos)
+		{
+			end = list.size();
+		}
+		items.push_back(list.substr(start, end - start));
+		start = end + 1;
+	}
+	return items;
+}
+
+// ------------------------------------------------------------------------------------
+// Read the options, false if any of them are wrong
+// ------------------------------------------------------------------------------------
+static bool ParseOptions(int argc, char** argv, Options& options)
+{
+	options.limits.depth = 0;
+	options.limits.nodes = 0;
+	options.limits.milliseconds = 1000;
+	options.frameMs = 16;
+	options.hashMegabytes = 16;
+	std::string threads = "1";
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--help")
+		{
+			return false;
+		}
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "%s needs a value\n", option.c_str());
+			return false;
+		}
+		std::string value = argv[++i];
+
+		if (option == "--depth") options.limits.depth = atoi(value.c_str());
+		else if (option == "--movetime") options.limits.milliseconds = atoi(value.c_str());
+		else if (option == "--nodes") options.limits.nodes = strtoull(value.c_str(), nullptr, 10);
+		else if (option == "--threads") threads = value;
+		else if (option == "--hash") options.hashMegabytes = atoi(value.c_str());
+		else if (option == "--positions") options.positions = SplitList(value);
+		else if (option == "--fen") options.fen = value;
+		else if (option == "--frame-ms") options.frameMs = atoi(value.c_str());
+		else if (option == "--output") options.output = value;
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", option.c_str());
+			return false;
+		}
+	}
+
+	std::vector<std::string> counts = SplitList(threads);
+	for (size_t i = 0; i < counts.size(); i++)
+	{
+		int count = atoi(counts[i].c_str());
+		if (count < 0 || counts[i].empty())
+		{
+			fprintf(stderr, "bad thread count in %s\n", threads.c_str());
+			return false;
+		}
+		options.threads.push_back(count);
+	}
+
+	if (options.limits.depth < 0 || options.limits.milliseconds < 0 || options.frameMs < 0 || options.hashMegabytes <= 0 || options.threads.empty())
+	{
+		fprintf(stderr, "limits and the frame time can't be negative, and the table and thread counts can't be empty\n");
+		return false;
+	}
+	if (options.limits.depth == 0 && options.limits.milliseconds == 0 && options.limits.nodes == 0)
+	{
+		fprintf(stderr, "the search needs a depth, time or node limit\n");
+		return false;
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static double GetMicroseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+	return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	// a position from the command line, the ones asked for or every test position
+	std::vector<PerftPosition> positions;
+	if (!options.fen.empty())
+	{
+		PerftPosition position = { "fen", options.fen.c_str(), { 0, 0, 0, 0, 0, 0 } };
+		positions.push_back(position);
+	}
+	else if (options.positions.empty())
+	{
+		positions.assign(PERFT_POSITIONS, PERFT_POSITIONS + NUM_PERFT_POSITIONS);
+	}
+	for (size_t i = 0; i < options.positions.size() && options.fen.empty(); i++)
+	{
+		int found = 0;
+		while (found < NUM_PERFT_POSITIONS && options.positions[i] != PERFT_POSITIONS[found].name)
+		{
+			found++;
+		}
+		if (found == NUM_PERFT_POSITIONS)
+		{
+			fprintf(stderr, "there's no test position called %s\n", options.positions[i].c_str());
+			return 1;
+		}
+		positions.push_back(PERFT_POSITIONS[found]);
+	}
+
+	FILE* pOutput = stdout;
+	if (!options.output.empty())
+	{
+		pOutput = fopen(options.output.c_str(), "w");
+		if (!pOutput)
+		{
+			fprintf(stderr, "couldn't open %s\n", options.output.c_str());
+			return 1;
+		}
+	}
+
+	fprintf(pOutput, "threads,position,depth,score,nodes,ms,nodes_per_second,speedup,best_move,frames,start_us,max_poll_us,mean_poll_us,pv\n");
+
+	ChessEngine engine;
+	if (!engine.SetHashSize(options.hashMegabytes))
+	{
+		fprintf(stderr, "couldn't allocate a %d MB table\n", options.hashMegabytes);
+		return 1;
+	}
+	fprintf(stderr, "%d MB table, %d MB of it on large pages\n", (int)engine.GetTable().GetSizeMegabytes(),
+		(int)engine.GetTable().GetLargePageMegabytes());
+
+	// each position's time with the first thread count, the others' speedup is against it
+	std::vector<int> baseMs(positions.size(), 0);
+
+	for (size_t run = 0; run < options.threads.size(); run++)
+	{
+		engine.SetThreads(options.threads[run]);
+
+		for (size_t i = 0; i < positions.size(); i++)
+		{
+			ChessPosition position;
+			if (!position.SetFen(positions[i].fen))
+			{
+				fprintf(stderr, "couldn't read %s\n", positions[i].fen);
+				return 1;
+			}
+
+			// every search starts from an empty table, or later ones would find their answers in it
+			engine.ClearHash();
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			uint32_t searchId = engine.Start(position, options.limits);
+			double startUs = GetMicroseconds(start, std::chrono::steady_clock::now());
+
+			// a frame's worth of waiting, then the poll Update would make
+			int frames = 0;
+			double maxPollUs = 0, totalPollUs = 0;
+			const SearchSnapshot* pSnapshot;
+			do
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(options.frameMs));
+
+				std::chrono::steady_clock::time_point pollStart = std::chrono::steady_clock::now();
+				pSnapshot = &engine.Poll();
+				double pollUs = GetMicroseconds(pollStart, std::chrono::steady_clock::now());
+
+				maxPollUs = pollUs > maxPollUs ? pollUs : maxPollUs;
+				totalPollUs += pollUs;
+				frames++;
+			}
+			while (pSnapshot->searchId != searchId || pSnapshot->thinking);
+
+			std::string pv;
+			for (int j = 0; j < pSnapshot->pvLength; j++)
+			{
+				pv += (j > 0 ? " " : "") + ChessPosition::GetMoveText(pSnapshot->pv[j]);
+			}
+
+			// time to depth only means something when every run stops at the same depth
+			if (run == 0)
+			{
+				baseMs[i] = pSnapshot->milliseconds;
+			}
+			double speedup = options.limits.depth > 0 && pSnapshot->milliseconds > 0 ? (double)baseMs[i] / pSnapshot->milliseconds : 0.0;
+
+			fprintf(pOutput, "%d,%s,%d,%d,%llu,%d,%.0f,%.2f,%s,%d,%.1f,%.2f,%.3f,%s\n", engine.GetThreads(), positions[i].name,
+				pSnapshot->depth, pSnapshot->score, (unsigned long long)pSnapshot->nodes, pSnapshot->milliseconds,
+				pSnapshot->milliseconds > 0 ? pSnapshot->nodes * 1000.0 / pSnapshot->milliseconds : 0.0, speedup,
+				pSnapshot->bestMove == NO_MOVE ? "none" : ChessPosition::GetMoveText(pSnapshot->bestMove).c_str(),
+				frames, startUs, maxPollUs, totalPollUs / frames, pv.c_str());
+		}
+	}
+
+	if (pOutput != stdout)
+	{
+		fclose(pOutput);
+	}
+	return 0;
+}
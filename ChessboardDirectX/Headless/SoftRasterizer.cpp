@@ -0,0 +1,1139 @@
+//
+// BGTD 9201
+//	A CPU stand in for the LitColour pipeline
+//
+
+#include "SoftRasterizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SOFT_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SOFT_AVX2_TARGET
+#else
+#define SOFT_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#else
+#define SOFT_X86 0
+#endif
+
+// pixels that no triangle has covered
+static const uint32_t NO_TRIANGLE = 0xFFFFFFFF;
+
+// vertices are snapped to this fraction of a pixel
+static const float SUBPIXEL_STEPS = 16.0f;
+
+// triangles reaching further than this many pixels from the centre of the screen are
+// clipped, which keeps every edge function step exact in a float
+static const float GUARD_BAND = 2048.0f;
+
+// the planes a triangle can be clipped against, in the order they are applied
+enum ClipPlane
+{
+	NearPlane,
+	FarPlane,
+	LeftPlane,
+	RightPlane,
+	BottomPlane,
+	TopPlane,
+
+	NUM_CLIP_PLANES
+};
+
+// a clipped polygon never has more than this many vertices
+static const int MAX_CLIPPED_VERTICES = 3 + NUM_CLIP_PLANES;
+
+// the class's sizes are passed by reference to std::min, which needs them defined
+const int SoftRasterizer::MAX_SIZE;
+const int SoftRasterizer::TILE_SIZE;
+const int SoftRasterizer::CHUNK_SIZE;
+
+// ------------------------------------------------------------------------------------
+// Milliseconds between two clock readings
+// ------------------------------------------------------------------------------------
+static double Milliseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// ------------------------------------------------------------------------------------
+// Where a triangle's edges and depth stand at the corner of a tile. Worked out in
+// double, so the two triangles sharing an edge get exactly opposite values
+// ------------------------------------------------------------------------------------
+struct TileStart
+{
+	float edge[3];
+	float depth;
+	int x0, y0, x1, y1;	// pixels of the tile the triangle might cover
+};
+
+static bool GetTileStart(const SoftTriangle& triangle, int originX, int originY, int tileSize, TileStart& start)
+{
+	start.x0 = std::max(triangle.minX - originX, 0);
+	start.y0 = std::max(triangle.minY - originY, 0);
+	start.x1 = std::min(triangle.maxX - originX, tileSize);
+	start.y1 = std::min(triangle.maxY - originY, tileSize);
+	if (start.x0 >= start.x1 || start.y0 >= start.y1)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		start.edge[i] = (float)(triangle.edgeA[i] * (double)originX + triangle.edgeB[i] * (double)originY + triangle.edgeC[i]);
+	}
+	start.depth = (float)(triangle.depthX * (double)originX + triangle.depthY * (double)originY + triangle.depthC);
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// One pixel at a time. Every kernel does the same float operations in the same order,
+// so they all produce the same image
+// ------------------------------------------------------------------------------------
+static void RasterizeScalar(const SoftTriangle& triangle, const TileStart& start, int tileSize, float* pDepth, uint32_t* pIds, uint32_t id)
+{
+	for (int y = start.y0; y < start.y1; y++)
+	{
+		float dy = (float)y + 0.5f;
+		float rowEdge[3];
+		for (int i = 0; i < 3; i++)
+		{
+			rowEdge[i] = triangle.edgeB[i] * dy;
+		}
+		float rowDepth = triangle.depthY * dy;
+
+		for (int x = start.x0; x < start.x1; x++)
+		{
+			float dx = (float)x + 0.5f;
+
+			bool inside = true;
+			for (int i = 0; i < 3; i++)
+			{
+				float step = triangle.edgeA[i] * dx;
+				step = step + rowEdge[i];
+				float edge = start.edge[i] + step;
+				bool topLeft = (triangle.topLeft & (1 << i)) != 0;
+				inside = inside && (edge > 0 || (edge == 0 && topLeft));
+			}
+			if (!inside)
+			{
+				continue;
+			}
+
+			float depthStep = triangle.depthX * dx;
+			depthStep = depthStep + rowDepth;
+			float z = start.depth + depthStep;
+
+			int index = y * tileSize + x;
+			if (z < pDepth[index])
+			{
+				pDepth[index] = z;
+				pIds[index] = id;
+			}
+		}
+	}
+}
+
+#if SOFT_X86
+// ------------------------------------------------------------------------------------
+// Four pixels at a time
+// ------------------------------------------------------------------------------------
+static void RasterizeSSE2(const SoftTriangle& triangle, const TileStart& start, int tileSize, float* pDepth, uint32_t* pIds, uint32_t id)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 laneOffset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128i laneIndex = _mm_setr_epi32(0, 1, 2, 3);
+	const __m128i firstX = _mm_set1_epi32(start.x0 - 1);
+	const __m128i endX = _mm_set1_epi32(start.x1);
+	const __m128i idValue = _mm_set1_epi32((int)id);
+
+	__m128 edgeStart[3], edgeA[3], topLeft[3];
+	for (int i = 0; i < 3; i++)
+	{
+		edgeStart[i] = _mm_set1_ps(start.edge[i]);
+		edgeA[i] = _mm_set1_ps(triangle.edgeA[i]);
+		topLeft[i] = _mm_castsi128_ps(_mm_set1_epi32((triangle.topLeft & (1 << i)) ? -1 : 0));
+	}
+	const __m128 depthStart = _mm_set1_ps(start.depth);
+	const __m128 depthX = _mm_set1_ps(triangle.depthX);
+
+	for (int y = start.y0; y < start.y1; y++)
+	{
+		float dy = (float)y + 0.5f;
+		__m128 rowEdge[3];
+		for (int i = 0; i < 3; i++)
+		{
+			rowEdge[i] = _mm_set1_ps(triangle.edgeB[i] * dy);
+		}
+		__m128 rowDepth = _mm_set1_ps(triangle.depthY * dy);
+
+		for (int x = start.x0 & ~3; x < start.x1; x += 4)
+		{
+			__m128 dx = _mm_add_ps(_mm_set1_ps((float)x), laneOffset);
+
+			// lanes outside the triangle's box are left alone, like the scalar loop
+			__m128i laneX = _mm_add_epi32(_mm_set1_epi32(x), laneIndex);
+			__m128 mask = _mm_castsi128_ps(_mm_and_si128(_mm_cmpgt_epi32(laneX, firstX), _mm_cmplt_epi32(laneX, endX)));
+
+			for (int i = 0; i < 3; i++)
+			{
+				__m128 edge = _mm_add_ps(edgeStart[i], _mm_add_ps(_mm_mul_ps(edgeA[i], dx), rowEdge[i]));
+				__m128 inside = _mm_or_ps(_mm_cmpgt_ps(edge, zero), _mm_and_ps(_mm_cmpeq_ps(edge, zero), topLeft[i]));
+				mask = _mm_and_ps(mask, inside);
+			}
+			if (_mm_movemask_ps(mask) == 0)
+			{
+				continue;
+			}
+
+			__m128 z = _mm_add_ps(depthStart, _mm_add_ps(_mm_mul_ps(depthX, dx), rowDepth));
+
+			int index = y * tileSize + x;
+			__m128 oldDepth = _mm_load_ps(pDepth + index);
+			mask = _mm_and_ps(mask, _mm_cmplt_ps(z, oldDepth));
+
+			_mm_store_ps(pDepth + index, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, oldDepth)));
+
+			__m128i maskBits = _mm_castps_si128(mask);
+			__m128i oldIds = _mm_load_si128((const __m128i*)(pIds + index));
+			_mm_store_si128((__m128i*)(pIds + index), _mm_or_si128(_mm_and_si128(maskBits, idValue), _mm_andnot_si128(maskBits, oldIds)));
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Eight pixels at a time
+// ------------------------------------------------------------------------------------
+SOFT_AVX2_TARGET static void RasterizeAVX2(const SoftTriangle& triangle, const TileStart& start, int tileSize, float* pDepth, uint32_t* pIds, uint32_t id)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 laneOffset = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+	const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i firstX = _mm256_set1_epi32(start.x0 - 1);
+	const __m256i endX = _mm256_set1_epi32(start.x1);
+	const __m256i idValue = _mm256_set1_epi32((int)id);
+
+	__m256 edgeStart[3], edgeA[3], topLeft[3];
+	for (int i = 0; i < 3; i++)
+	{
+		edgeStart[i] = _mm256_set1_ps(start.edge[i]);
+		edgeA[i] = _mm256_set1_ps(triangle.edgeA[i]);
+		topLeft[i] = _mm256_castsi256_ps(_mm256_set1_epi32((triangle.topLeft & (1 << i)) ? -1 : 0));
+	}
+	const __m256 depthStart = _mm256_set1_ps(start.depth);
+	const __m256 depthX = _mm256_set1_ps(triangle.depthX);
+
+	for (int y = start.y0; y < start.y1; y++)
+	{
+		float dy = (float)y + 0.5f;
+		__m256 rowEdge[3];
+		for (int i = 0; i < 3; i++)
+		{
+			rowEdge[i] = _mm256_set1_ps(triangle.edgeB[i] * dy);
+		}
+		__m256 rowDepth = _mm256_set1_ps(triangle.depthY * dy);
+
+		for (int x = start.x0 & ~7; x < start.x1; x += 8)
+		{
+			__m256 dx = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffset);
+
+			// lanes outside the triangle's box are left alone, like the scalar loop
+			__m256i laneX = _mm256_add_epi32(_mm256_set1_epi32(x), laneIndex);
+			__m256 mask = _mm256_castsi256_ps(_mm256_and_si256(_mm256_cmpgt_epi32(laneX, firstX), _mm256_cmpgt_epi32(endX, laneX)));
+
+			for (int i = 0; i < 3; i++)
+			{
+				__m256 edge = _mm256_add_ps(edgeStart[i], _mm256_add_ps(_mm256_mul_ps(edgeA[i], dx), rowEdge[i]));
+				__m256 inside = _mm256_or_ps(_mm256_cmp_ps(edge, zero, _CMP_GT_OQ), _mm256_and_ps(_mm256_cmp_ps(edge, zero, _CMP_EQ_OQ), topLeft[i]));
+				mask = _mm256_and_ps(mask, inside);
+			}
+			if (_mm256_movemask_ps(mask) == 0)
+			{
+				continue;
+			}
+
+			__m256 z = _mm256_add_ps(depthStart, _mm256_add_ps(_mm256_mul_ps(depthX, dx), rowDepth));
+
+			int index = y * tileSize + x;
+			__m256 oldDepth = _mm256_load_ps(pDepth + index);
+			mask = _mm256_and_ps(mask, _mm256_cmp_ps(z, oldDepth, _CMP_LT_OQ));
+
+			_mm256_store_ps(pDepth + index, _mm256_blendv_ps(oldDepth, z, mask));
+
+			__m256i oldIds = _mm256_load_si256((const __m256i*)(pIds + index));
+			_mm256_store_si256((__m256i*)(pIds + index), _mm256_blendv_epi8(oldIds, idValue, _mm256_castps_si256(mask)));
+		}
+	}
+}
+#endif
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+SoftRasterizer::SoftRasterizer(int inWidth, int inHeight, int inNumThreads) : jobPool(inNumThreads)
+{
+	width = std::min(std::max(inWidth, 1), (int)MAX_SIZE);
+	height = std::min(std::max(inHeight, 1), (int)MAX_SIZE);
+	tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+	kernel = GetBestKernel();
+	cullMode = SoftCullBack;
+
+	for (int i = 0; i < 4; i++)
+	{
+		textureColour[i] = 1;
+	}
+
+	// the same blue DirectXClass clears to
+	clearColour[0] = 0.0f;
+	clearColour[1] = 0.0f;
+	clearColour[2] = 0.3f;
+	clearColour[3] = 1.0f;
+
+	memset(viewProjection, 0, sizeof(viewProjection));
+	memset(cameraPosition, 0, sizeof(cameraPosition));
+	memset(&lights, 0, sizeof(lights));
+	memset(&stats, 0, sizeof(stats));
+
+	numTriangles = 0;
+	numChunks = 0;
+	pixelsShaded = 0;
+
+	pixels.resize((size_t)width * height);
+	depth.resize((size_t)width * height);
+
+}
+
+// ------------------------------------------------------------------------------------
+// The widest kernel the CPU and OS support
+// ------------------------------------------------------------------------------------
+SoftKernel SoftRasterizer::GetBestKernel()
+{
+#if SOFT_X86
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] >= 7)
+	{
+		__cpuid(info, 1);
+		bool osSavesAVX = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0;
+
+		__cpuidex(info, 7, 0);
+		bool hasAVX2 = (info[1] & (1 << 5)) != 0;
+
+		if (osSavesAVX && hasAVX2 && (_xgetbv(0) & 6) == 6)
+		{
+			return SoftAVX2Kernel;
+		}
+	}
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return SoftAVX2Kernel;
+	}
+#endif
+	return SoftSSE2Kernel;
+#else
+	return SoftScalarKernel;
+#endif
+}
+
+// ------------------------------------------------------------------------------------
+// Pick a kernel, anything the CPU can't run falls back to the best one it can
+// ------------------------------------------------------------------------------------
+void SoftRasterizer::SetKernel(SoftKernel inKernel)
+{
+	kernel = std::min(inKernel, GetBestKernel());
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void SoftRasterizer::SetTextureColour(const float* pColour)
+{
+	memcpy(textureColour, pColour, sizeof(textureColour));
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void SoftRasterizer::SetClearColour(const float* pColour)
+{
+	memcpy(clearColour, pColour, sizeof(clearColour));
+}
+
+// ------------------------------------------------------------------------------------
+// Copy a mesh in, meshes with indices past their vertices are refused
+// ------------------------------------------------------------------------------------
+uint32_t SoftRasterizer::AddMesh(const SoftVertex* pVertices, size_t numVertices, const uint32_t* pIndices, size_t numIndices)
+{
+	for (size_t i = 0; i < numIndices; i++)
+	{
+		if (pIndices[i] >= numVertices)
+		{
+			return NO_TRIANGLE;
+		}
+	}
+
+	Mesh mesh;
+	mesh.vertices.assign(pVertices, pVertices + numVertices);
+	mesh.indices.assign(pIndices, pIndices + numIndices - numIndices % 3);
+	meshes.push_back(mesh);
+
+	return (uint32_t)meshes.size() - 1;
+}
+
+// ------------------------------------------------------------------------------------
+// Start a new frame
+// ------------------------------------------------------------------------------------
+void SoftRasterizer::Begin(const float* pViewProjection, const float* pCameraPosition, const SoftLights& inLights)
+{
+	memcpy(viewProjection, pViewProjection, sizeof(viewProjection));
+	memcpy(cameraPosition, pCameraPosition, sizeof(cameraPosition));
+	lights = inLights;
+
+	draws.clear();
+}
+
+// ------------------------------------------------------------------------------------
+// Queue one instance of a mesh
+// ------------------------------------------------------------------------------------
+void SoftRasterizer::DrawInstance(uint32_t meshId, const float* pWorldMatrix, const float* pColour)
+{
+	if (meshId >= meshes.size())
+	{
+		return;
+	}
+
+	Draw draw;
+	draw.meshId = meshId;
+	memcpy(draw.world, pWorldMatrix, sizeof(draw.world));
+	memcpy(draw.colour, pColour, sizeof(draw.colour));
+	draw.firstVertex = 0;
+	draw.firstTriangle = 0;
+	draws.push_back(draw);
+}
+
+// ------------------------------------------------------------------------------------
+// Draw the frame, each stage is spread over every thread before the next starts
+// ------------------------------------------------------------------------------------
+void SoftRasterizer::Render()
+{
+	std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+
+	// give every draw its place in the shaded vertices and the triangle order
+	size_t numVertices = 0;
+	numTriangles = 0;
+	for (size_t i = 0; i < draws.size(); i++)
+	{
+		const Mesh& mesh = meshes[draws[i].meshId];
+		draws[i].firstVertex = numVertices;
+		draws[i].firstTriangle = numTriangles;
+		numVertices += mesh.vertices.size();
+		numTriangles += mesh.indices.size() / 3;
+	}
+
+	// chunk and triangle numbers share a 32 bit id in the tiles
+	const size_t maxTriangles = (size_t)0xFFFE * CHUNK_SIZE;
+	if (numTriangles > maxTriangles)
+	{
+		numTriangles = maxTriangles;
+	}
+
+	shadedVertices.resize(numVertices);
+	jobPool.ParallelFor(draws.size(), [this](size_t i) { ShadeVertices(i); });
+
+	std::chrono::steady_clock::time_point vertexEnd = std::chrono::steady_clock::now();
+
+	numChunks = (numTriangles + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	if (chunks.size() < numChunks)
+	{
+		chunks.resize(numChunks);
+	}
+	jobPool.ParallelFor(numChunks, [this](size_t i) { SetupChunk(i); });
+
+	std::chrono::steady_clock::time_point setupEnd = std::chrono::steady_clock::now();
+
+	pixelsShaded = 0;
+	jobPool.ParallelFor((size_t)tilesX * tilesY, [this](size_t i) { RasterizeTile(i); });
+
+	std::chrono::steady_clock::time_point frameEnd = std::chrono::steady_clock::now();
+
+	stats.vertexMs = Milliseconds(frameStart, vertexEnd);
+	stats.setupMs = Milliseconds(vertexEnd, setupEnd);
+	stats.rasterMs = Milliseconds(setupEnd, frameEnd);
+	stats.totalMs = Milliseconds(frameStart, frameEnd);
+
+	stats.verticesShaded = numVertices;
+	stats.trianglesIn = numTriangles;
+	stats.trianglesCulled = 0;
+	stats.trianglesClipped = 0;
+	stats.trianglesSetUp = 0;
+	stats.binEntries = 0;
+	for (size_t i = 0; i < numChunks; i++)
+	{
+		stats.trianglesCulled += chunks[i].culled;
+		stats.trianglesClipped += chunks[i].clipped;
+		stats.trianglesSetUp += chunks[i].triangles.size();
+		stats.binEntries += chunks[i].binEntries;
+	}
+	stats.pixelsShaded = pixelsShaded;
+}
+
+// ------------------------------------------------------------------------------------
+// The instanced vertex shader, for every vertex of one draw
+// ------------------------------------------------------------------------------------
+void SoftRasterizer::ShadeVertices(size_t drawIndex)
+{
+	const Draw& draw = draws[drawIndex];
+	const Mesh& mesh = meshes[draw.meshId];
+	const float* w = draw.world;
+	const float* vp = viewProjection;
+
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		const SoftVertex& vertex = mesh.vertices[i];
+		ShadedVertex& out = shadedVertices[draw.firstVertex + i];
+
+		float px = vertex.position[0];
+		float py = vertex.position[1];
+		float pz = vertex.position[2];
+
+		// points are rows, so each output is a column of the matrix
+		float world[4];
+		for (int c = 0; c < 4; c++)
+		{
+			world[c] = px * w[c] + py * w[4 + c] + pz * w[8 + c] + w[12 + c];
+		}
+		for (int c = 0; c < 4; c++)
+		{
+			out.clip[c] = world[0] * vp[c] + world[1] * vp[4 + c] + world[2] * vp[8 + c] + world[3] * vp[12 + c];
+		}
+
+		float nx = vertex.normal[0];
+		float ny = vertex.normal[1];
+		float nz = vertex.normal[2];
+		for (int c = 0; c < 3; c++)
+		{
+			out.world[c] = world[c];
+			out.normal[c] = nx * w[c] + ny * w[4 + c] + nz * w[8 + c];
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Set up and bin one chunk of triangles
+// ------------------------------------------------------------------------------------
+void SoftRasterizer::SetupChunk(size_t chunkIndex)
+{
+	Chunk& chunk = chunks[chunkIndex];
+	chunk.triangles.clear();
+	chunk.bins.resize((size_t)tilesX * tilesY);
+	for (size_t i = 0; i < chunk.bins.size(); i++)
+	{
+		chunk.bins[i].clear();
+	}
+	chunk.culled = 0;
+	chunk.clipped = 0;
+	chunk.binEntries = 0;
+
+	size_t first = chunkIndex * CHUNK_SIZE;
+	size_t last = std::min(numTriangles, first + CHUNK_SIZE);
+
+	// the last draw starting at or before the chunk's first triangle
+	size_t low = 0;
+	size_t high = draws.size();
+	while (high - low > 1)
+	{
+		size_t middle = (low + high) / 2;
+		if (draws[middle].firstTriangle <= first) low = middle;
+		else high = middle;
+	}
+	size_t drawIndex = low;
+
+	for (size_t t = first; t < last; t++)
+	{
+		// skip past draws that end before this triangle, including empty ones
+		while (drawIndex + 1 < draws.size() && draws[drawIndex + 1].firstTriangle <= t)
+		{
+			drawIndex++;
+		}
+
+		const Draw& draw = draws[drawIndex];
+		const uint32_t* pIndices = &meshes[draw.meshId].indices[(t - draw.firstTriangle) * 3];
+
+		const ShadedVertex* pVertices[3];
+		for (int i = 0; i < 3; i++)
+		{
+			pVertices[i] = &shadedVertices[draw.firstVertex + pIndices[i]];
+		}
+		ClipAndSetup(chunk, pVertices, (uint32_t)drawIndex);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// How far inside a plane a vertex is, negative is outside
+// ------------------------------------------------------------------------------------
+static float PlaneDistance(const float* clip, int plane, float guardX, float guardY)
+{
+	switch (plane)
+	{
+		case NearPlane:		return clip[2];
+		case FarPlane:		return clip[3] - clip[2];
+		case LeftPlane:		return clip[0] + guardX * clip[3];
+		case RightPlane:	return guardX * clip[3] - clip[0];
+		case BottomPlane:	return clip[1] + guardY * clip[3];
+		case TopPlane:		return guardY * clip[3] - clip[1];
+	}
+	return 0;
+}
+
+// ------------------------------------------------------------------------------------
+// Throw away triangles outside the frustum, clip the ones that need it and set them up
+// ------------------------------------------------------------------------------------
+void SoftRasterizer::ClipAndSetup(Chunk& chunk, const ShadedVertex* pVertices[3], uint32_t drawIndex)
+{
+	// the guard band as a fraction of the screen, and the screen itself
+	float guardX = GUARD_BAND / (width * 0.5f);
+	float guardY = GUARD_BAND / (height * 0.5f);
+
+	uint32_t outsideScreen[3];
+	uint32_t outsideGuard[3];
+	for (int v = 0; v < 3; v++)
+	{
+		outsideScreen[v] = 0;
+		outsideGuard[v] = 0;
+		for (int plane = 0; plane < NUM_CLIP_PLANES; plane++)
+		{
+			if (PlaneDistance(pVertices[v]->clip, plane, 1, 1) < 0) outsideScreen[v] |= 1 << plane;
+			if (PlaneDistance(pVertices[v]->clip, plane, guardX, guardY) < 0) outsideGuard[v] |= 1 << plane;
+		}
+	}
+
+	// all three outside the same side of the screen
+	if (outsideScreen[0] & outsideScreen[1] & outsideScreen[2])
+	{
+		chunk.culled++;
+		return;
+	}
+
+	uint32_t planesCrossed = outsideGuard[0] | outsideGuard[1] | outsideGuard[2];
+	if (planesCrossed == 0)
+	{
+		SetupTriangle(chunk, *pVertices[0], *pVertices[1], *pVertices[2], drawIndex);
+		return;
+	}
+
+	chunk.clipped++;
+
+	// Sutherland-Hodgman, one plane at a time
+	ShadedVertex polygons[2][MAX_CLIPPED_VERTICES];
+	int count = 3;
+	for (int v = 0; v < 3; v++)
+	{
+		polygons[0][v] = *pVertices[v];
+	}
+
+	int current = 0;
+	for (int plane = 0; plane < NUM_CLIP_PLANES && count >= 3; plane++)
+	{
+		if ((planesCrossed & (1 << plane)) == 0)
+		{
+			continue;
+		}
+
+		const ShadedVertex* pIn = polygons[current];
+		ShadedVertex* pOut = polygons[1 - current];
+		int outCount = 0;
+
+		for (int v = 0; v < count; v++)
+		{
+			const ShadedVertex& a = pIn[v];
+			const ShadedVertex& b = pIn[(v + 1) % count];
+			float distanceA = PlaneDistance(a.clip, plane, guardX, guardY);
+			float distanceB = PlaneDistance(b.clip, plane, guardX, guardY);
+
+			if (distanceA >= 0)
+			{
+				pOut[outCount++] = a;
+			}
+			if ((distanceA >= 0) != (distanceB >= 0))
+			{
+				// where the edge crosses the plane, every attribute is linear in clip space
+				float t = distanceA / (distanceA - distanceB);
+				ShadedVertex& crossing = pOut[outCount++];
+				for (int c = 0; c < 4; c++) crossing.clip[c] = a.clip[c] + (b.clip[c] - a.clip[c]) * t;
+				for (int c = 0; c < 3; c++) crossing.world[c] = a.world[c] + (b.world[c] - a.world[c]) * t;
+				for (int c = 0; c < 3; c++) crossing.normal[c] = a.normal[c] + (b.normal[c] - a.normal[c]) * t;
+			}
+		}
+
+		count = outCount;
+		current = 1 - current;
+	}
+
+	if (count < 3)
+	{
+		chunk.culled++;
+		return;
+	}
+
+	// the clipped polygon is convex, so a fan covers it
+	const ShadedVertex* pPolygon = polygons[current];
+	for (int v = 1; v + 1 < count; v++)
+	{
+		SetupTriangle(chunk, pPolygon[0], pPolygon[v], pPolygon[v + 1], drawIndex);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Snap a triangle to the subpixel grid, work out its edges and depth, and bin it
+// ------------------------------------------------------------------------------------
+void SoftRasterizer::SetupTriangle(Chunk& chunk, const ShadedVertex& v0, const ShadedVertex& v1, const ShadedVertex& v2, uint32_t drawIndex)
+{
+	const ShadedVertex* pVertex[3] = { &v0, &v1, &v2 };
+
+	double x[3], y[3], z[3];
+	float invW[3];
+	for (int i = 0; i < 3; i++)
+	{
+		const float* clip = pVertex[i]->clip;
+		invW[i] = 1.0f / clip[3];
+
+		// Direct3D's viewport, y runs down the screen
+		float screenX = (clip[0] * invW[i] * 0.5f + 0.5f) * width;
+		float screenY = (0.5f - clip[1] * invW[i] * 0.5f) * height;
+		x[i] = floor(screenX * SUBPIXEL_STEPS + 0.5f) / SUBPIXEL_STEPS;
+		y[i] = floor(screenY * SUBPIXEL_STEPS + 0.5f) / SUBPIXEL_STEPS;
+		z[i] = clip[2] * invW[i];
+	}
+
+	// positive when the triangle runs clockwise on the screen
+	double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area == 0 || (area < 0 && cullMode == SoftCullBack))
+	{
+		chunk.culled++;
+		return;
+	}
+
+	// back faces that are kept get turned around so the inside is always positive
+	int order[3] = { 0, 1, 2 };
+	if (area < 0)
+	{
+		order[1] = 2;
+		order[2] = 1;
+		area = -area;
+	}
+
+	double sx[3], sy[3], sz[3];
+	for (int i = 0; i < 3; i++)
+	{
+		sx[i] = x[order[i]];
+		sy[i] = y[order[i]];
+		sz[i] = z[order[i]];
+	}
+
+	// pixel centres the triangle could cover
+	double minX = std::min(sx[0], std::min(sx[1], sx[2]));
+	double maxX = std::max(sx[0], std::max(sx[1], sx[2]));
+	double minY = std::min(sy[0], std::min(sy[1], sy[2]));
+	double maxY = std::max(sy[0], std::max(sy[1], sy[2]));
+
+	SoftTriangle triangle;
+	triangle.minX = std::max((int)ceil(minX - 0.5), 0);
+	triangle.minY = std::max((int)ceil(minY - 0.5), 0);
+	triangle.maxX = std::min((int)floor(maxX - 0.5) + 1, width);
+	triangle.maxY = std::min((int)floor(maxY - 0.5) + 1, height);
+	if (triangle.minX >= triangle.maxX || triangle.minY >= triangle.maxY)
+	{
+		chunk.culled++;
+		return;
+	}
+
+	// edge i faces vertex i, E = A x + B y + C is positive inside. The values are exact,
+	// so a shared edge comes out with opposite signs in its two triangles
+	double edgeA[3], edgeB[3];
+	triangle.topLeft = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		int a = (i + 1) % 3;
+		int b = (i + 2) % 3;
+		edgeA[i] = sy[a] - sy[b];
+		edgeB[i] = sx[b] - sx[a];
+		triangle.edgeA[i] = (float)edgeA[i];
+		triangle.edgeB[i] = (float)edgeB[i];
+		triangle.edgeC[i] = sx[a] * sy[b] - sx[b] * sy[a];
+
+		// pixels exactly on a top or left edge belong to this triangle, not its neighbour
+		if (edgeA[i] > 0 || (edgeA[i] == 0 && edgeB[i] > 0))
+		{
+			triangle.topLeft |= 1 << i;
+		}
+	}
+
+	// depth is linear over the screen
+	double dz1 = sz[1] - sz[0];
+	double dz2 = sz[2] - sz[0];
+	triangle.depthX = (float)((dz1 * edgeA[1] + dz2 * edgeA[2]) / area);
+	triangle.depthY = (float)((dz1 * edgeB[1] + dz2 * edgeB[2]) / area);
+	triangle.depthC = sz[0] + (dz1 * triangle.edgeC[1] + dz2 * triangle.edgeC[2]) / area;
+	triangle.area = area;
+
+	for (int i = 0; i < 3; i++)
+	{
+		const ShadedVertex& vertex = *pVertex[order[i]];
+		triangle.invW[i] = invW[order[i]];
+		for (int c = 0; c < 3; c++)
+		{
+			triangle.world[i][c] = vertex.world[c];
+			triangle.normal[i][c] = vertex.normal[c];
+		}
+	}
+	triangle.drawIndex = drawIndex;
+
+	uint16_t index = (uint16_t)chunk.triangles.size();
+	chunk.triangles.push_back(triangle);
+
+	// bin it into every tile its box touches, unless one of its edges misses the tile
+	int firstTileX = triangle.minX / TILE_SIZE;
+	int firstTileY = triangle.minY / TILE_SIZE;
+	int lastTileX = (triangle.maxX - 1) / TILE_SIZE;
+	int lastTileY = (triangle.maxY - 1) / TILE_SIZE;
+	bool oneTile = firstTileX == lastTileX && firstTileY == lastTileY;
+
+	for (int tileY = firstTileY; tileY <= lastTileY; tileY++)
+	{
+		for (int tileX = firstTileX; tileX <= lastTileX; tileX++)
+		{
+			if (!oneTile)
+			{
+				// the tile's pixel centre nearest each edge's inside
+				double left = tileX * TILE_SIZE + 0.5;
+				double right = std::min((tileX + 1) * TILE_SIZE, width) - 0.5;
+				double top = tileY * TILE_SIZE + 0.5;
+				double bottom = std::min((tileY + 1) * TILE_SIZE, height) - 0.5;
+
+				bool missed = false;
+				for (int i = 0; i < 3 && !missed; i++)
+				{
+					double best = edgeA[i] * (edgeA[i] > 0 ? right : left) + edgeB[i] * (edgeB[i] > 0 ? bottom : top) + triangle.edgeC[i];
+					missed = best < 0;
+				}
+				if (missed)
+				{
+					continue;
+				}
+			}
+
+			chunk.bins[tileY * tilesX + tileX].push_back(index);
+			chunk.binEntries++;
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Rasterize every triangle binned to a tile in order, then shade what is left in front
+// ------------------------------------------------------------------------------------
+void SoftRasterizer::RasterizeTile(size_t tileIndex)
+{
+	int originX = (int)(tileIndex % tilesX) * TILE_SIZE;
+	int originY = (int)(tileIndex / tilesX) * TILE_SIZE;
+	int tileWidth = std::min(TILE_SIZE, width - originX);
+	int tileHeight = std::min(TILE_SIZE, height - originY);
+
+	alignas(32) float tileDepth[TILE_SIZE * TILE_SIZE];
+	alignas(32) uint32_t tileIds[TILE_SIZE * TILE_SIZE];
+	for (int i = 0; i < TILE_SIZE * TILE_SIZE; i++)
+	{
+		tileDepth[i] = 1.0f;
+		tileIds[i] = NO_TRIANGLE;
+	}
+
+	for (size_t c = 0; c < numChunks; c++)
+	{
+		const Chunk& chunk = chunks[c];
+		const std::vector<uint16_t>& bin = chunk.bins[tileIndex];
+
+		for (size_t i = 0; i < bin.size(); i++)
+		{
+			const SoftTriangle& triangle = chunk.triangles[bin[i]];
+
+			TileStart start;
+			if (!GetTileStart(triangle, originX, originY, TILE_SIZE, start))
+			{
+				continue;
+			}
+
+			uint32_t id = (uint32_t)(c << 16) | bin[i];
+			switch (kernel)
+			{
+#if SOFT_X86
+				case SoftAVX2Kernel:
+					RasterizeAVX2(triangle, start, TILE_SIZE, tileDepth, tileIds, id);
+					break;
+				case SoftSSE2Kernel:
+					RasterizeSSE2(triangle, start, TILE_SIZE, tileDepth, tileIds, id);
+					break;
+#endif
+				default:
+					RasterizeScalar(triangle, start, TILE_SIZE, tileDepth, tileIds, id);
+					break;
+			}
+		}
+	}
+
+	// every pixel is shaded once, by the triangle that won the depth test
+	uint32_t clear = 0xFF000000;
+	for (int c = 0; c < 3; c++)
+	{
+		float value = std::min(std::max(clearColour[c], 0.0f), 1.0f);
+		clear |= (uint32_t)(value * 255.0f + 0.5f) << (c * 8);
+	}
+
+	uint64_t shaded = 0;
+	for (int y = 0; y < tileHeight; y++)
+	{
+		uint32_t* pRow = &pixels[(size_t)(originY + y) * width + originX];
+		float* pDepthRow = &depth[(size_t)(originY + y) * width + originX];
+
+		for (int x = 0; x < tileWidth; x++)
+		{
+			uint32_t id = tileIds[y * TILE_SIZE + x];
+			pDepthRow[x] = tileDepth[y * TILE_SIZE + x];
+
+			if (id == NO_TRIANGLE)
+			{
+				pRow[x] = clear;
+				continue;
+			}
+
+			const SoftTriangle& triangle = chunks[id >> 16].triangles[id & 0xFFFF];
+			pRow[x] = ShadePixel(triangle, originX + x + 0.5f, originY + y + 0.5f);
+			shaded++;
+		}
+	}
+	pixelsShaded += shaded;
+}
+
+// ------------------------------------------------------------------------------------
+// LitColourPS for one pixel
+// ------------------------------------------------------------------------------------
+uint32_t SoftRasterizer::ShadePixel(const SoftTriangle& triangle, float x, float y) const
+{
+	// perspective correct weights of the three vertices
+	float weight[3];
+	float total = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		double edge = triangle.edgeA[i] * (double)x + triangle.edgeB[i] * (double)y + triangle.edgeC[i];
+		weight[i] = (float)(edge / triangle.area) * triangle.invW[i];
+		total += weight[i];
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		weight[i] /= total;
+	}
+
+	float world[3], normal[3];
+	for (int c = 0; c < 3; c++)
+	{
+		world[c] = triangle.world[0][c] * weight[0] + triangle.world[1][c] * weight[1] + triangle.world[2][c] * weight[2];
+		normal[c] = triangle.normal[0][c] * weight[0] + triangle.normal[1][c] * weight[1] + triangle.normal[2][c] * weight[2];
+	}
+
+	float normalLength = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+	if (normalLength > 0)
+	{
+		for (int c = 0; c < 3; c++) normal[c] /= normalLength;
+	}
+
+	const float* lightVector = lights.directionalLightVector;
+	float diffuse = std::max(0.0f, normal[0] * lightVector[0] + normal[1] * lightVector[1] + normal[2] * lightVector[2]);
+
+	// Blinn-Phong, the half vector between the light and the camera
+	float view[3];
+	for (int c = 0; c < 3; c++) view[c] = cameraPosition[c] - world[c];
+	float viewLength = sqrtf(view[0] * view[0] + view[1] * view[1] + view[2] * view[2]);
+	if (viewLength > 0)
+	{
+		for (int c = 0; c < 3; c++) view[c] /= viewLength;
+	}
+
+	float half[3];
+	for (int c = 0; c < 3; c++) half[c] = lightVector[c] + view[c];
+	float halfLength = sqrtf(half[0] * half[0] + half[1] * half[1] + half[2] * half[2]);
+	if (halfLength > 0)
+	{
+		for (int c = 0; c < 3; c++) half[c] /= halfLength;
+	}
+
+	float specular = half[0] * normal[0] + half[1] * normal[1] + half[2] * normal[2];
+	specular = powf(std::min(std::max(specular, 0.0f), 1.0f), lights.specularLightColor[3]);
+
+	const float* instanceColour = draws[triangle.drawIndex].colour;
+
+	uint32_t colour = 0xFF000000;
+	for (int c = 0; c < 3; c++)
+	{
+		float value = textureColour[c] * lights.ambientColour[c] * instanceColour[c]
+			+ diffuse * lights.directionalLightColor[c] * textureColour[c]
+			+ specular * textureColour[c] * lights.specularLightColor[c];
+
+		value = std::min(std::max(value, 0.0f), 1.0f);
+		colour |= (uint32_t)(value * 255.0f + 0.5f) << (c * 8);
+	}
+	return colour;
+}
+
+// ------------------------------------------------------------------------------------
+// The pixels without their alpha
+// ------------------------------------------------------------------------------------
+void SoftRasterizer::GetRGB(std::vector<uint8_t>& rgb) const
+{
+	rgb.resize((size_t)width * height * 3);
+	for (size_t i = 0; i < pixels.size(); i++)
+	{
+		rgb[i * 3 + 0] = (uint8_t)(pixels[i]);
+		rgb[i * 3 + 1] = (uint8_t)(pixels[i] >> 8);
+		rgb[i * 3 + 2] = (uint8_t)(pixels[i] >> 16);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Binary PPM, about the simplest image there is
+// ------------------------------------------------------------------------------------
+bool SoftRasterizer::WritePPM(const char* filename) const
+{
+	FILE* pFile = fopen(filename, "wb");
+	if (!pFile)
+	{
+		return false;
+	}
+
+	std::vector<uint8_t> rgb;
+	GetRGB(rgb);
+
+	fprintf(pFile, "P6\n%d %d\n255\n", width, height);
+	bool written = fwrite(rgb.data(), 1, rgb.size(), pFile) == rgb.size();
+	return fclose(pFile) == 0 && written;
+}
+
+// ------------------------------------------------------------------------------------
+// PNG helpers, the image data is stored without compression so no zlib is needed
+// ------------------------------------------------------------------------------------
+static uint32_t Crc32(const uint8_t* pData, size_t size, uint32_t crc = 0)
+{
+	static uint32_t table[256];
+	static bool tableBuilt = false;
+	if (!tableBuilt)
+	{
+		for (uint32_t n = 0; n < 256; n++)
+		{
+			uint32_t c = n;
+			for (int k = 0; k < 8; k++)
+			{
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			table[n] = c;
+		}
+		tableBuilt = true;
+	}
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc = table[(crc ^ pData[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static void PutBigEndian(std::vector<uint8_t>& out, uint32_t value)
+{
+	out.push_back((uint8_t)(value >> 24));
+	out.push_back((uint8_t)(value >> 16));
+	out.push_back((uint8_t)(value >> 8));
+	out.push_back((uint8_t)value);
+}
+
+static void PutChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data)
+{
+	PutBigEndian(out, (uint32_t)data.size());
+	size_t typeStart = out.size();
+	out.insert(out.end(), type, type + 4);
+	out.insert(out.end(), data.begin(), data.end());
+	PutBigEndian(out, Crc32(&out[typeStart], out.size() - typeStart));
+}
+
+// ------------------------------------------------------------------------------------
+// An RGB PNG
+// ------------------------------------------------------------------------------------
+bool SoftRasterizer::WritePNG(const char* filename) const
+{
+	std::vector<uint8_t> rgb;
+	GetRGB(rgb);
+
+	// every row starts with filter type 0
+	size_t rowSize = (size_t)width * 3;
+	std::vector<uint8_t> raw;
+	raw.reserve((rowSize + 1) * height);
+	for (int y = 0; y < height; y++)
+	{
+		raw.push_back(0);
+		raw.insert(raw.end(), rgb.begin() + y * rowSize, rgb.begin() + (y + 1) * rowSize);
+	}
+
+	// a zlib stream of stored deflate blocks
+	std::vector<uint8_t> compressed;
+	compressed.push_back(0x78);
+	compressed.push_back(0x01);
+	for (size_t offset = 0; offset < raw.size() || offset == 0; )
+	{
+		size_t blockSize = std::min(raw.size() - offset, (size_t)65535);
+		bool final = offset + blockSize == raw.size();
+		compressed.push_back(final ? 1 : 0);
+		compressed.push_back((uint8_t)blockSize);
+		compressed.push_back((uint8_t)(blockSize >> 8));
+		compressed.push_back((uint8_t)~blockSize);
+		compressed.push_back((uint8_t)(~blockSize >> 8));
+		compressed.insert(compressed.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+		offset += blockSize;
+		if (final) break;
+	}
+
+	uint32_t adlerA = 1, adlerB = 0;
+	for (size_t i = 0; i < raw.size(); i++)
+	{
+		adlerA = (adlerA + raw[i]) % 65521;
+		adlerB = (adlerB + adlerA) % 65521;
+	}
+	PutBigEndian(compressed, (adlerB << 16) | adlerA);
+
+	std::vector<uint8_t> header;
+	PutBigEndian(header, width);
+	PutBigEndian(header, height);
+	header.push_back(8);	// bits per channel
+	header.push_back(2);	// RGB
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+
+	std::vector<uint8_t> png;
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	png.insert(png.end(), signature, signature + 8);
+	PutChunk(png, "IHDR", header);
+	PutChunk(png, "IDAT", compressed);
+	PutChunk(png, "IEND", std::vector<uint8_t>());
+
+	FILE* pFile = fopen(filename, "wb");
+	if (!pFile)
+	{
+		return false;
+	}
+	bool written = fwrite(png.data(), 1, png.size(), pFile) == png.size();
+	return fclose(pFile) == 0 && written;
+}
@@ -0,0 +1,235 @@
+//
+// BGTD 9201
+//	A CPU stand in for the LitColour pipeline, for machines without a GPU.
+//	Draws are transformed on every core, their triangles binned into screen
+//	tiles, and each tile is rasterized with half-space edge functions a SIMD
+//	register at a time (AVX2, SSE2 or plain C++ off x86). The nearest triangle
+//	of each pixel is kept in a tile-sized visibility buffer and shaded once
+//	with the same Blinn-Phong maths as LitColourPS.
+//
+//	Tiles always see their triangles in submission order and every kernel
+//	does the same float operations, so a frame comes out bit identical on
+//	any thread count and instruction set, which makes it usable as a golden image
+//
+
+#ifndef _SOFT_RASTERIZER_H
+#define _SOFT_RASTERIZER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <atomic>
+
+#include "JobPool.h"
+
+// same layout as VertexPositionNormalTexture
+struct SoftVertex
+{
+	float position[3];
+	float normal[3];
+	float textureCoordinate[2];
+};
+
+// the part of the LIGHT_BUFFER that LitColourPS reads
+struct SoftLights
+{
+	float ambientColour[4];
+	float directionalLightColor[4];
+	float directionalLightVector[4];	// points towards the light
+	float specularLightColor[4];		// alpha is the specular power
+};
+
+// which triangles are thrown away before rasterizing
+enum SoftCullMode
+{
+	SoftCullNone,
+	SoftCullBack	// the Direct3D default, clockwise triangles face the camera
+};
+
+// the inner loop used to rasterize a tile
+enum SoftKernel
+{
+	SoftScalarKernel,
+	SoftSSE2Kernel,
+	SoftAVX2Kernel
+};
+
+// what the last frame cost
+struct SoftStats
+{
+	double vertexMs;
+	double setupMs;
+	double rasterMs;
+	double totalMs;
+
+	uint64_t verticesShaded;
+	uint64_t trianglesIn;
+	uint64_t trianglesCulled;	// back facing, outside the frustum or too small to cover a sample
+	uint64_t trianglesClipped;	// crossed the near plane or the guard band
+	uint64_t trianglesSetUp;	// made it into the bins, clipping can add some
+	uint64_t binEntries;
+	uint64_t pixelsShaded;
+};
+
+// a triangle ready to rasterize, the edges and depth are planes over the screen in pixels
+struct SoftTriangle
+{
+	float edgeA[3];
+	float edgeB[3];
+	double edgeC[3];
+	uint32_t topLeft;	// bit per edge, pixels exactly on those edges are inside
+
+	float depthX;
+	float depthY;
+	double depthC;
+
+	double area;
+	int minX, minY, maxX, maxY;	// pixels whose centres might be covered, max is exclusive
+
+	// for perspective correct attributes
+	float invW[3];
+	float world[3][3];
+	float normal[3][3];
+	uint32_t drawIndex;
+};
+
+class SoftRasterizer
+{
+public:
+	// numThreads of 0 uses every core. Both sides are limited to MAX_SIZE
+	SoftRasterizer(int width, int height, int numThreads = 0);
+
+	static const int MAX_SIZE = 4096;
+
+	// copy a mesh in, returns the id to draw it with
+	uint32_t AddMesh(const SoftVertex* pVertices, size_t numVertices, const uint32_t* pIndices, size_t numIndices);
+
+	// the best kernel this CPU can run is picked up front
+	static SoftKernel GetBestKernel();
+	void SetKernel(SoftKernel inKernel);
+	SoftKernel GetKernel() const { return kernel; }
+
+	void SetCullMode(SoftCullMode mode) { cullMode = mode; }
+
+	// there is no image decoder, so MainTex samples as one colour
+	void SetTextureColour(const float* pColour);
+
+	// colour of pixels no triangle covers
+	void SetClearColour(const float* pColour);
+
+	// camera and lights of the next frame, throws away the last frame's draws.
+	// Matrices are 16 floats, row major with row vectors, the same as XMFLOAT4X4
+	void Begin(const float* pViewProjection, const float* pCameraPosition, const SoftLights& inLights);
+
+	// queue one instance of a mesh, the colour tints the ambient light like the instanced shader
+	void DrawInstance(uint32_t meshId, const float* pWorldMatrix, const float* pColour);
+
+	// draw everything queued since Begin
+	void Render();
+
+	// RGBA8 pixels, top row first
+	const uint32_t* GetPixels() const { return pixels.data(); }
+	const float* GetDepth() const { return depth.data(); }
+
+	int GetWidth() const { return width; }
+	int GetHeight() const { return height; }
+	int GetNumThreads() const { return jobPool.GetNumThreads(); }
+	const SoftStats& GetStats() const { return stats; }
+
+	// write the last frame out, alpha is dropped
+	bool WritePPM(const char* filename) const;
+	bool WritePNG(const char* filename) const;
+
+private:
+
+	// screen tiles are this many pixels on a side
+	static const int TILE_SIZE = 64;
+
+	// triangles are set up and binned in chunks of this many, so the bins come out
+	// in the same order however many threads there are
+	static const int CHUNK_SIZE = 512;
+
+	struct Mesh
+	{
+		std::vector<SoftVertex> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	struct Draw
+	{
+		uint32_t meshId;
+		float world[16];
+		float colour[4];
+		size_t firstVertex;		// into the shaded vertices
+		size_t firstTriangle;	// counting every draw's triangles in order
+	};
+
+	// a vertex after the vertex stage
+	struct ShadedVertex
+	{
+		float clip[4];
+		float world[3];
+		float normal[3];
+	};
+
+	// per chunk output of the setup stage
+	struct Chunk
+	{
+		std::vector<SoftTriangle> triangles;
+		std::vector<std::vector<uint16_t> > bins;	// triangle indices per tile
+
+		uint64_t culled;
+		uint64_t clipped;
+		uint64_t binEntries;
+	};
+
+	// the stages, each run across the threads
+	void ShadeVertices(size_t drawIndex);
+	void SetupChunk(size_t chunkIndex);
+	void RasterizeTile(size_t tileIndex);
+
+	// clip a triangle against the near plane and guard band if it needs it, then set up the pieces
+	void ClipAndSetup(Chunk& chunk, const ShadedVertex* pVertices[3], uint32_t drawIndex);
+	void SetupTriangle(Chunk& chunk, const ShadedVertex& v0, const ShadedVertex& v1, const ShadedVertex& v2, uint32_t drawIndex);
+
+	// colour of a covered pixel
+	uint32_t ShadePixel(const SoftTriangle& triangle, float x, float y) const;
+
+	// the image as tightly packed RGB rows
+	void GetRGB(std::vector<uint8_t>& rgb) const;
+
+	int width;
+	int height;
+	int tilesX;
+	int tilesY;
+
+	SoftKernel kernel;
+	SoftCullMode cullMode;
+
+	float textureColour[4];
+	float clearColour[4];
+
+	// frame state
+	float viewProjection[16];
+	float cameraPosition[3];
+	SoftLights lights;
+
+	std::vector<Mesh> meshes;
+	std::vector<Draw> draws;
+	std::vector<ShadedVertex> shadedVertices;
+	size_t numTriangles;
+
+	std::vector<Chunk> chunks;
+	size_t numChunks;
+
+	std::vector<uint32_t> pixels;
+	std::vector<float> depth;
+
+	SoftStats stats;
+	std::atomic<uint64_t> pixelsShaded;
+
+	// the frame's stages are spread over these, the calling thread works too
+	JobPool jobPool;
+};
+
+#endif
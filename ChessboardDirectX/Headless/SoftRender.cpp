@@ -0,0 +1,329 @@
+//
+// BGTD 9201
+//	Draws the starting position of the chessboard without a GPU and writes it
+//	to a PNG or PPM, or times a number of frames with the camera orbiting.
+//	Given a golden image it compares the two and fails if they differ
+//
+
+#include <DirectXMath.h>
+#include <DirectXColors.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "SoftRasterizer.h"
+#include "../TermAssignment/ChessSet.h"
+#include "../TermAssignment/Models.h"
+
+using namespace DirectX;
+
+// the same camera and lights MyProject starts with
+static const float CAMERA_RADIUS = 32.0f;
+static const float CAMERA_PITCH = XM_PI / 10.0f;
+static const float FIELD_OF_VIEW = 60.0f * XM_PI / 180.0f;
+static const float NEAR_PLANE = 1.0f;
+static const float FAR_PLANE = 128.0f;
+static const float SPECULAR_POWER = 64.0f;
+
+// what the command line asked for
+struct Options
+{
+	std::string output;
+	std::string compare;
+	int width;
+	int height;
+	int threads;
+	int frames;
+	int tolerance;
+	bool kernelGiven;
+	SoftKernel kernel;
+};
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+	printf("usage: softrender [options]\n"
+		"  --output FILE        write the last frame, .png or .ppm (default chessboard.png)\n"
+		"  --width N            image width (default 1280)\n"
+		"  --height N           image height (default 720)\n"
+		"  --threads N          worker threads, 0 for every core (default 0)\n"
+		"  --frames N           render N frames orbiting the camera and report the average\n"
+		"  --kernel NAME        scalar, sse2 or avx2 (default the best available)\n"
+		"  --compare FILE       compare the last frame to a binary PPM, exit 1 if it differs\n"
+		"  --tolerance N        largest per channel difference --compare accepts (default 0)\n");
+}
+
+// ------------------------------------------------------------------------------------
+// Read the options, false if any of them are wrong
+// ------------------------------------------------------------------------------------
+static bool ParseOptions(int argc, char** argv, Options& options)
+{
+	options.output = "chessboard.png";
+	options.width = 1280;
+	options.height = 720;
+	options.threads = 0;
+	options.frames = 1;
+	options.tolerance = 0;
+	options.kernelGiven = false;
+	options.kernel = SoftScalarKernel;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--help")
+		{
+			return false;
+		}
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "%s needs a value\n", option.c_str());
+			return false;
+		}
+		std::string value = argv[++i];
+
+		if (option == "--output") options.output = value;
+		else if (option == "--compare") options.compare = value;
+		else if (option == "--width") options.width = atoi(value.c_str());
+		else if (option == "--height") options.height = atoi(value.c_str());
+		else if (option == "--threads") options.threads = atoi(value.c_str());
+		else if (option == "--frames") options.frames = atoi(value.c_str());
+		else if (option == "--tolerance") options.tolerance = atoi(value.c_str());
+		else if (option == "--kernel")
+		{
+			options.kernelGiven = true;
+			if (value == "scalar") options.kernel = SoftScalarKernel;
+			else if (value == "sse2") options.kernel = SoftSSE2Kernel;
+			else if (value == "avx2") options.kernel = SoftAVX2Kernel;
+			else
+			{
+				fprintf(stderr, "unknown kernel %s\n", value.c_str());
+				return false;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", option.c_str());
+			return false;
+		}
+	}
+
+	if (options.width <= 0 || options.height <= 0 || options.frames <= 0 || options.threads < 0 || options.tolerance < 0)
+	{
+		fprintf(stderr, "sizes, frames, threads and tolerance can't be negative\n");
+		return false;
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// Hand the rasterizer a baked mesh, the material indices aren't needed
+// ------------------------------------------------------------------------------------
+static uint32_t AddMesh(SoftRasterizer& rasterizer, const BakedParts& baked)
+{
+	std::vector<SoftVertex> softVertices(baked.vertices.size());
+	for (size_t i = 0; i < baked.vertices.size(); i++)
+	{
+		const BakedVertex& vertex = baked.vertices[i];
+		SoftVertex& softVertex = softVertices[i];
+		softVertex.position[0] = vertex.position.x;
+		softVertex.position[1] = vertex.position.y;
+		softVertex.position[2] = vertex.position.z;
+		softVertex.normal[0] = vertex.normal.x;
+		softVertex.normal[1] = vertex.normal.y;
+		softVertex.normal[2] = vertex.normal.z;
+		softVertex.textureCoordinate[0] = vertex.textureCoordinate.x;
+		softVertex.textureCoordinate[1] = vertex.textureCoordinate.y;
+	}
+	return rasterizer.AddMesh(softVertices.data(), softVertices.size(), baked.indices.data(), baked.indices.size());
+}
+
+// ------------------------------------------------------------------------------------
+// Queue a mesh with a world matrix and colour
+// ------------------------------------------------------------------------------------
+static void DrawInstance(SoftRasterizer& rasterizer, uint32_t meshId, FXMMATRIX world, const XMVECTORF32& colour)
+{
+	XMFLOAT4X4 worldMatrix;
+	XMStoreFloat4x4(&worldMatrix, world);
+	rasterizer.DrawInstance(meshId, &worldMatrix.m[0][0], colour.f);
+}
+
+// ------------------------------------------------------------------------------------
+// Compare the frame to a PPM, returns the largest channel difference or -1 if it can't
+// ------------------------------------------------------------------------------------
+static int CompareToPPM(const SoftRasterizer& rasterizer, const char* filename)
+{
+	FILE* pFile = fopen(filename, "rb");
+	if (!pFile)
+	{
+		fprintf(stderr, "couldn't open %s\n", filename);
+		return -1;
+	}
+
+	int width = 0, height = 0, maxValue = 0;
+	if (fscanf(pFile, "P6 %d %d %d", &width, &height, &maxValue) != 3 || fgetc(pFile) == EOF || maxValue != 255)
+	{
+		fprintf(stderr, "%s is not an 8 bit binary PPM\n", filename);
+		fclose(pFile);
+		return -1;
+	}
+	if (width != rasterizer.GetWidth() || height != rasterizer.GetHeight())
+	{
+		fprintf(stderr, "%s is %dx%d, the frame is %dx%d\n", filename, width, height, rasterizer.GetWidth(), rasterizer.GetHeight());
+		fclose(pFile);
+		return -1;
+	}
+
+	std::vector<uint8_t> golden((size_t)width * height * 3);
+	size_t read = fread(golden.data(), 1, golden.size(), pFile);
+	fclose(pFile);
+	if (read != golden.size())
+	{
+		fprintf(stderr, "%s is cut short\n", filename);
+		return -1;
+	}
+
+	const uint32_t* pPixels = rasterizer.GetPixels();
+	int largest = 0;
+	size_t pixelsDifferent = 0;
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		bool different = false;
+		for (int c = 0; c < 3; c++)
+		{
+			int difference = abs((int)((pPixels[i] >> (c * 8)) & 0xFF) - (int)golden[i * 3 + c]);
+			if (difference > largest) largest = difference;
+			if (difference != 0) different = true;
+		}
+		if (different) pixelsDifferent++;
+	}
+
+	printf("compare: %zu pixels differ, largest channel difference %d\n", pixelsDifferent, largest);
+	return largest;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	SoftRasterizer rasterizer(options.width, options.height, options.threads);
+	if (options.kernelGiven)
+	{
+		rasterizer.SetKernel(options.kernel);
+	}
+	rasterizer.SetClearColour(Colors::Black.f);
+
+	// the squares are unit cubes and every piece is baked into one mesh, the same as the Direct3D build
+	BakedParts square;
+	ChessSet::BakePart(Cube, 1.0f, Models::DEFAULT_TESSELLATION, XMMatrixIdentity(), 0, square);
+	uint32_t squareMesh = AddMesh(rasterizer, square);
+
+	uint32_t pieceMeshes[NUM_PIECE_TYPES];
+	for (int type = 0; type < NUM_PIECE_TYPES; type++)
+	{
+		std::vector<PiecePart> parts;
+		ChessSet::GetPieceParts((PieceType)type, parts);
+
+		BakedParts piece;
+		ChessSet::BakeParts(parts, piece);
+		pieceMeshes[type] = AddMesh(rasterizer, piece);
+	}
+
+	std::vector<PiecePlacement> placements;
+	ChessSet::GetStartingPlacements(placements);
+
+	SoftLights lights;
+	memcpy(lights.ambientColour, Colors::White.f, sizeof(lights.ambientColour));
+	memcpy(lights.directionalLightColor, Colors::Green.f, sizeof(lights.directionalLightColor));
+	memcpy(lights.specularLightColor, Colors::Yellow.f, sizeof(lights.specularLightColor));
+	lights.specularLightColor[3] = SPECULAR_POWER;
+
+	// the light shines straight down, the shader wants the way back to it
+	lights.directionalLightVector[0] = 0;
+	lights.directionalLightVector[1] = 1;
+	lights.directionalLightVector[2] = 0;
+	lights.directionalLightVector[3] = 0;
+
+	XMMATRIX boardMatrix = ChessSet::GetBoardMatrix();
+	XMMATRIX projection = XMMatrixPerspectiveFovRH(FIELD_OF_VIEW, (float)rasterizer.GetWidth() / (float)rasterizer.GetHeight(), NEAR_PLANE, FAR_PLANE);
+
+	double totalMs = 0;
+	double fastestMs = 0;
+	for (int frame = 0; frame < options.frames; frame++)
+	{
+		// a single frame is the view MyProject starts on, more go once around the board
+		float yaw = XM_2PI * frame / options.frames;
+		float r = CAMERA_RADIUS * cosf(CAMERA_PITCH);
+		XMFLOAT3 cameraPosition(sinf(yaw) * r, CAMERA_RADIUS * sinf(CAMERA_PITCH), cosf(yaw) * r);
+
+		XMMATRIX view = XMMatrixLookAtRH(XMLoadFloat3(&cameraPosition), XMVectorZero(), g_XMIdentityR1);
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+
+		rasterizer.Begin(&viewProjection.m[0][0], &cameraPosition.x, lights);
+
+		for (int y = 0; y < ChessSet::BOARD_SIZE; y++)
+		{
+			for (int x = 0; x < ChessSet::BOARD_SIZE; x++)
+			{
+				XMMATRIX world = XMMatrixMultiply(ChessSet::GetSquareMatrix(x, y), boardMatrix);
+				DrawInstance(rasterizer, squareMesh, world, ChessSet::IsFirstColour(x, y) ? Colors::Beige : Colors::Brown);
+			}
+		}
+
+		for (size_t i = 0; i < placements.size(); i++)
+		{
+			const PiecePlacement& placement = placements[i];
+			XMMATRIX world = ChessSet::GetPlacementMatrix(placement, ChessSet::PIECE_BASE_OFFSET);
+			DrawInstance(rasterizer, pieceMeshes[placement.type], world, placement.playerOne ? Colors::White : Colors::Black);
+		}
+
+		rasterizer.Render();
+
+		double frameMs = rasterizer.GetStats().totalMs;
+		totalMs += frameMs;
+		if (frame == 0 || frameMs < fastestMs) fastestMs = frameMs;
+	}
+
+	static const char* kernelNames[] = { "scalar", "sse2", "avx2" };
+	const SoftStats& stats = rasterizer.GetStats();
+	printf("%dx%d, %d threads, %s kernel\n", rasterizer.GetWidth(), rasterizer.GetHeight(), rasterizer.GetNumThreads(), kernelNames[rasterizer.GetKernel()]);
+	printf("%d frames: %.3f ms average, %.3f ms fastest\n", options.frames, totalMs / options.frames, fastestMs);
+	printf("last frame: vertex %.3f ms, setup %.3f ms, raster %.3f ms\n", stats.vertexMs, stats.setupMs, stats.rasterMs);
+	printf("%llu vertices, %llu triangles in, %llu culled, %llu clipped, %llu set up, %llu bin entries, %llu pixels shaded\n",
+		(unsigned long long)stats.verticesShaded, (unsigned long long)stats.trianglesIn, (unsigned long long)stats.trianglesCulled,
+		(unsigned long long)stats.trianglesClipped, (unsigned long long)stats.trianglesSetUp, (unsigned long long)stats.binEntries,
+		(unsigned long long)stats.pixelsShaded);
+
+	if (!options.output.empty())
+	{
+		bool ppm = options.output.size() >= 4 && options.output.compare(options.output.size() - 4, 4, ".ppm") == 0;
+		bool written = ppm ? rasterizer.WritePPM(options.output.c_str()) : rasterizer.WritePNG(options.output.c_str());
+		if (!written)
+		{
+			fprintf(stderr, "couldn't write %s\n", options.output.c_str());
+			return 1;
+		}
+	}
+
+	if (!options.compare.empty())
+	{
+		int difference = CompareToPPM(rasterizer, options.compare.c_str());
+		if (difference < 0 || difference > options.tolerance)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
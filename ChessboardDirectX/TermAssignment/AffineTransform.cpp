@@ -0,0 +1,161 @@
+//
+// BGTD 9201
+//	Closed form inverses for scale * rotation * translation matrices
+//
+
+#include "AffineTransform.h"
+#include <cmath>
+
+using namespace DirectX;
+
+// rotations built up from a few float multiplies are square to about 1e-6
+const float AffineTransform::ORTHOGONAL_TOLERANCE = 1e-4f;
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+AffineTransform::AffineTransform()
+{
+	XMStoreFloat4x4(&matrix, XMMatrixIdentity());
+	kind = RigidTransform;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+AffineTransform::AffineTransform(const XMFLOAT4X4& inMatrix, TransformKind inKind)
+{
+	matrix = inMatrix;
+	kind = inKind;
+}
+
+// ------------------------------------------------------------------------------------
+// The kind follows from the scale, the rotation is always square
+// ------------------------------------------------------------------------------------
+AffineTransform AffineTransform::Create(const XMFLOAT3& scale, const XMFLOAT4& rotation, const XMFLOAT3& translation)
+{
+	AffineTransform transform;
+	XMStoreFloat4x4(&transform.matrix, XMMatrixScaling(scale.x, scale.y, scale.z)
+		* XMMatrixRotationQuaternion(XMLoadFloat4(&rotation)) * XMMatrixTranslation(translation.x, translation.y, translation.z));
+
+	if (scale.x != scale.y || scale.x != scale.z)
+	{
+		transform.kind = AxisScaleTransform;
+	}
+	else if (scale.x != 1)
+	{
+		transform.kind = UniformScaleTransform;
+	}
+	else
+	{
+		transform.kind = RigidTransform;
+	}
+	return transform;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+AffineTransform AffineTransform::Classify(const XMFLOAT4X4& inMatrix)
+{
+	return AffineTransform(inMatrix, FindKind(inMatrix));
+}
+
+// ------------------------------------------------------------------------------------
+// Rows that are square to each other are a scale per axis followed by a rotation,
+// equal lengths make the scale uniform and lengths of one leave only the rotation
+// ------------------------------------------------------------------------------------
+TransformKind AffineTransform::FindKind(const XMFLOAT4X4& m)
+{
+	// anything that touches w is a projection
+	if (m._14 != 0 || m._24 != 0 || m._34 != 0 || m._44 != 1)
+	{
+		return GeneralTransform;
+	}
+
+	float length0 = m._11 * m._11 + m._12 * m._12 + m._13 * m._13;
+	float length1 = m._21 * m._21 + m._22 * m._22 + m._23 * m._23;
+	float length2 = m._31 * m._31 + m._32 * m._32 + m._33 * m._33;
+	if (length0 <= 0 || length1 <= 0 || length2 <= 0)
+	{
+		return GeneralTransform;
+	}
+
+	// |a.b| <= tolerance * |a| * |b|, squared to stay clear of square roots
+	const float tolerance = ORTHOGONAL_TOLERANCE * ORTHOGONAL_TOLERANCE;
+	float dot01 = m._11 * m._21 + m._12 * m._22 + m._13 * m._23;
+	float dot02 = m._11 * m._31 + m._12 * m._32 + m._13 * m._33;
+	float dot12 = m._21 * m._31 + m._22 * m._32 + m._23 * m._33;
+	if (dot01 * dot01 > tolerance * length0 * length1 || dot02 * dot02 > tolerance * length0 * length2
+		|| dot12 * dot12 > tolerance * length1 * length2)
+	{
+		return GeneralTransform;
+	}
+
+	if (fabsf(length1 - length0) > ORTHOGONAL_TOLERANCE * length0 || fabsf(length2 - length0) > ORTHOGONAL_TOLERANCE * length0)
+	{
+		return AxisScaleTransform;
+	}
+	if (fabsf(length0 - 1) > ORTHOGONAL_TOLERANCE)
+	{
+		return UniformScaleTransform;
+	}
+	return RigidTransform;
+}
+
+// ------------------------------------------------------------------------------------
+// A uniform scale commutes with any rotation, so rigid and uniform parents keep the
+// child's kind. A scale per axis only survives when it comes first, and the child's
+// rotation would have to be known to say more
+// ------------------------------------------------------------------------------------
+TransformKind AffineTransform::CombineKinds(TransformKind localKind, TransformKind parentKind)
+{
+	if (parentKind <= UniformScaleTransform)
+	{
+		return localKind > parentKind ? localKind : parentKind;
+	}
+	return GeneralTransform;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+AffineTransform AffineTransform::Multiply(const AffineTransform& local, const AffineTransform& parent)
+{
+	AffineTransform transform;
+	XMStoreFloat4x4(&transform.matrix, XMMatrixMultiply(XMLoadFloat4x4(&local.matrix), XMLoadFloat4x4(&parent.matrix)));
+	transform.kind = CombineKinds(local.kind, parent.kind);
+	return transform;
+}
+
+// ------------------------------------------------------------------------------------
+// For rows r = s * u, with u square and of unit length, the inverse of the 3x3 is the
+// transpose with each row first divided by s squared. The translation then goes back
+// through that
+// ------------------------------------------------------------------------------------
+XMMATRIX AffineTransform::Invert() const
+{
+	XMMATRIX m = XMLoadFloat4x4(&matrix);
+	if (kind == GeneralTransform)
+	{
+		return XMMatrixInverse(nullptr, m);
+	}
+
+	XMVECTOR row0 = m.r[0];
+	XMVECTOR row1 = m.r[1];
+	XMVECTOR row2 = m.r[2];
+	if (kind == UniformScaleTransform)
+	{
+		XMVECTOR scale = XMVectorReciprocal(XMVector3LengthSq(row0));
+		row0 = XMVectorMultiply(row0, scale);
+		row1 = XMVectorMultiply(row1, scale);
+		row2 = XMVectorMultiply(row2, scale);
+	}
+	else if (kind == AxisScaleTransform)
+	{
+		row0 = XMVectorDivide(row0, XMVector3LengthSq(row0));
+		row1 = XMVectorDivide(row1, XMVector3LengthSq(row1));
+		row2 = XMVectorDivide(row2, XMVector3LengthSq(row2));
+	}
+
+	// the rows' w are 0, so the transpose leaves 0, 0, 0, 1 along the bottom
+	XMMATRIX inverse = XMMatrixTranspose(XMMATRIX(row0, row1, row2, g_XMIdentityR3));
+	inverse.r[3] = XMVectorSelect(g_XMIdentityR3, XMVectorNegate(XMVector3TransformNormal(m.r[3], inverse)), g_XMSelect1110);
+	return inverse;
+}
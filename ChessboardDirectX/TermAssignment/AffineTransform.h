@@ -0,0 +1,59 @@
+//
+// BGTD 9201
+//	A world matrix together with what is known about how it was built.
+//	Scale * rotation * translation matrices have closed form inverses and
+//	normal matrices, the general 4x4 inverse is only needed for the rest
+//
+
+#ifndef _AFFINE_TRANSFORM_H
+#define _AFFINE_TRANSFORM_H
+
+#include <DirectXMath.h>
+
+// what the upper 3x3 of a matrix is, cheapest to invert first
+enum TransformKind
+{
+	RigidTransform,				// rotation only, the inverse is the transpose
+	UniformScaleTransform,		// one scale then a rotation, the transpose over the scale squared
+	AxisScaleTransform,			// a scale per axis then a rotation, each row over its length squared
+	GeneralTransform			// shear, a projection or nothing known, the full inverse
+};
+
+class AffineTransform
+{
+public:
+	// the identity
+	AffineTransform();
+
+	// a matrix the caller knows the kind of, a kind that is too cheap gives a wrong inverse
+	AffineTransform(const DirectX::XMFLOAT4X4& inMatrix, TransformKind inKind);
+
+	// scale, then the rotation quaternion, then the translation
+	static AffineTransform Create(const DirectX::XMFLOAT3& scale, const DirectX::XMFLOAT4& rotation, const DirectX::XMFLOAT3& translation);
+
+	// work the kind out from the matrix, rows have to be square to within ORTHOGONAL_TOLERANCE
+	static AffineTransform Classify(const DirectX::XMFLOAT4X4& inMatrix);
+	static TransformKind FindKind(const DirectX::XMFLOAT4X4& inMatrix);
+
+	// the kind of local * parent, as the store and the scene multiply them
+	static TransformKind CombineKinds(TransformKind localKind, TransformKind parentKind);
+
+	// local * parent
+	static AffineTransform Multiply(const AffineTransform& local, const AffineTransform& parent);
+
+	const DirectX::XMFLOAT4X4& GetMatrix() const { return matrix; }
+	TransformKind GetKind() const { return kind; }
+
+	// the whole inverse, translation included
+	DirectX::XMMATRIX Invert() const;
+
+	// how far from square and equal rows can be and still be taken as rigid or scaled
+	static const float ORTHOGONAL_TOLERANCE;
+
+private:
+
+	DirectX::XMFLOAT4X4 matrix;
+	TransformKind kind;
+};
+
+#endif
@@ -0,0 +1,155 @@
+//
+// BGTD 9201
+//	A mesh built from several primitives that are transformed into place ahead of time
+//
+
+#include "BakedMesh.h"
+#include "MeshRegistry.h"
+#include "StateCache.h"
+#include "Models.h"
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+BakedMesh::BakedMesh()
+{
+	pVertexBuffer = nullptr;
+	pIndexBuffer = nullptr;
+	pInputLayout = nullptr;
+
+	numVerts = 0;
+	numIndices = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+BakedMesh::~BakedMesh()
+{
+	if (pVertexBuffer) pVertexBuffer->Release();
+	if (pIndexBuffer) pIndexBuffer->Release();
+	if (pInputLayout) pInputLayout->Release();
+}
+
+// ------------------------------------------------------------------------------------
+// Add a part at the default size and tessellation used by IndexedPrimitive
+// ------------------------------------------------------------------------------------
+void BakedMesh::AddPart(ModelType type, const Matrix& partMatrix, uint32_t materialIndex)
+{
+	AddPart(type, 1.0f, IndexedPrimitive::DEFAULT_TESSELLATION, partMatrix, materialIndex);
+}
+
+// ------------------------------------------------------------------------------------
+// Generate a primitive and transform it into place
+// ------------------------------------------------------------------------------------
+void BakedMesh::AddPart(ModelType type, float size, size_t tessellation, const Matrix& partMatrix, uint32_t materialIndex)
+{
+	ChessSet::BakePart(type, size, tessellation, partMatrix, materialIndex, baked);
+}
+
+// ------------------------------------------------------------------------------------
+// Add every part of a piece
+// ------------------------------------------------------------------------------------
+void BakedMesh::AddParts(const std::vector<PiecePart>& parts)
+{
+	ChessSet::BakeParts(parts, baked);
+}
+
+// ------------------------------------------------------------------------------------
+// Upload the merged parts
+// ------------------------------------------------------------------------------------
+bool BakedMesh::Build(ID3D11Device* pDevice, const D3D11_INPUT_ELEMENT_DESC* pElements, UINT numElements, const void* pBinary, size_t binarySize)
+{
+	if (baked.vertices.empty() || baked.indices.empty())
+	{
+		OutputDebugString(L"Baked mesh has no parts");
+		assert(0);
+		return false;
+	}
+
+	numVerts = baked.vertices.size();
+	numIndices = baked.indices.size();
+
+	// parts added one at a time haven't had their sphere fitted yet
+	ChessSet::FitSphere(baked);
+
+	// describe the vertex buffer we are trying to create
+	D3D11_BUFFER_DESC desc;
+	desc.ByteWidth = numVerts * sizeof(BakedVertex);
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = 0;
+	desc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA data;
+	data.pSysMem = baked.vertices.data();
+	data.SysMemPitch = 0;
+	data.SysMemSlicePitch = 0;
+
+	HRESULT hr = pDevice->CreateBuffer(&desc, &data, &pVertexBuffer);
+	if (FAILED(hr))
+	{
+		OutputDebugString(L"FAILED TO CREATE VERTEX BUFFER");
+		assert(false);
+		return false;
+	}
+
+	// merged parts can pass 65535 vertices, so the indices are 32 bit
+	D3D11_BUFFER_DESC indexBufferDesc;
+	indexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	indexBufferDesc.ByteWidth = numIndices * sizeof(uint32_t);
+	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	indexBufferDesc.CPUAccessFlags = 0;
+	indexBufferDesc.MiscFlags = 0;
+	indexBufferDesc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA indexData;
+	indexData.pSysMem = baked.indices.data();
+	indexData.SysMemPitch = 0;
+	indexData.SysMemSlicePitch = 0;
+
+	hr = pDevice->CreateBuffer(&indexBufferDesc, &indexData, &pIndexBuffer);
+	if (FAILED(hr))
+	{
+		OutputDebugString(L"FAILED TO CREATE INDEX BUFFER");
+		assert(false);
+		return false;
+	}
+
+	// every baked mesh drawn with the same shader shares one layout
+	pInputLayout = MeshRegistry::Get().AcquireInputLayout(pDevice, pElements, numElements, pBinary, binarySize);
+
+	// the GPU has its copy now
+	std::vector<BakedVertex>().swap(baked.vertices);
+	std::vector<uint32_t>().swap(baked.indices);
+
+	return pInputLayout != nullptr;
+}
+
+// ------------------------------------------------------------------------------------
+// Draw several copies of the mesh
+// ------------------------------------------------------------------------------------
+void BakedMesh::DrawInstanced(RenderDevice* pRenderDevice, DeviceBuffer* pInstanceBuffer, UINT instanceStride, UINT numInstances, UINT startInstance)
+{
+	if (pVertexBuffer == nullptr || numInstances == 0)
+	{
+		return;
+	}
+
+	// Set up our input layout
+	StateCache::Get().IASetInputLayout(pRenderDevice, pInputLayout);
+
+	//  tell D3D we are drawing a triangle list
+	StateCache::Get().IASetPrimitiveTopology(pRenderDevice, TriangleListTopology);
+
+	//  the mesh goes in slot 0, the per-instance data in slot 1
+	ID3D11Buffer* buffers[2] = { pVertexBuffer, pInstanceBuffer };
+	UINT strides[2] = { sizeof(BakedVertex), instanceStride };
+	UINT offsets[2] = { 0, 0 };
+	StateCache::Get().IASetVertexBuffers(pRenderDevice, 0, 2, buffers, strides, offsets);
+
+	// Set the index buffer
+	StateCache::Get().IASetIndexBuffer(pRenderDevice, pIndexBuffer, Index32Format, 0);
+
+	//	tell it to draw all the instances
+	pRenderDevice->DrawIndexedInstanced(numIndices, numInstances, 0, 0, startInstance);
+}
@@ -0,0 +1,60 @@
+//
+// BGTD 9201
+//	A mesh built from several primitives that are transformed into place
+//	ahead of time, so a multi-part model draws with a single call
+//
+
+#ifndef _BAKED_MESH_H
+#define _BAKED_MESH_H
+
+#include <d3d11_1.h>
+#include <SimpleMath.h>
+#include <vector>
+#include <stdint.h>
+
+#include "IndexedPrimitive.h"
+#include "Models.h"
+#include "ChessSet.h"
+
+using DirectX::SimpleMath::Matrix;
+
+class BakedMesh
+{
+public:
+	BakedMesh();
+	~BakedMesh();
+
+	// generate a primitive, transform it by its local matrix and add it to the mesh
+	void AddPart(ModelType type, const Matrix& partMatrix, uint32_t materialIndex);
+	void AddPart(ModelType type, float size, size_t tessellation, const Matrix& partMatrix, uint32_t materialIndex);
+
+	// add every part of a piece at the default size
+	void AddParts(const std::vector<PiecePart>& parts);
+
+	// upload the merged parts and set up the input layout, the CPU copy is freed afterwards
+	bool Build(ID3D11Device* pDevice, const D3D11_INPUT_ELEMENT_DESC* pElements, UINT numElements, const void* pBinary, size_t binarySize);
+
+	// draw several copies of the mesh, the instance buffer is bound to slot 1
+	void DrawInstanced(RenderDevice* pRenderDevice, DeviceBuffer* pInstanceBuffer, UINT instanceStride, UINT numInstances, UINT startInstance);
+
+	int GetNumParts() const { return baked.numParts; }
+	int GetNumVerts() const { return numVerts; }
+	int GetNumIndices() const { return numIndices; }
+
+	// box and sphere around every part, in the mesh's own space
+	const MeshBounds& GetBounds() const { return baked.bounds; }
+
+private:
+
+	// parts waiting to be uploaded, baked the same way as the headless renderer's
+	BakedParts baked;
+
+	ID3D11Buffer* pVertexBuffer;
+	ID3D11Buffer* pIndexBuffer;
+	ID3D11InputLayout* pInputLayout;
+
+	int numVerts;
+	int numIndices;
+};
+
+#endif
@@ -0,0 +1,231 @@
+//
+// BGTD 9201
+//	The attack tables, filled once. The magics are found here rather than
+//	pasted in, searching from a fixed seed so every run builds the same tables
+//
+
+#include "Bitboard.h"
+#include <mutex>
+#include <vector>
+
+namespace Bitboards
+{
+	Bitboard knightAttacks[NUM_SQUARES];
+	Bitboard kingAttacks[NUM_SQUARES];
+	Bitboard pawnAttacks[2][NUM_SQUARES];
+	Bitboard between[NUM_SQUARES][NUM_SQUARES];
+	Bitboard lines[NUM_SQUARES][NUM_SQUARES];
+	SliderMagic bishopMagics[NUM_SQUARES];
+	SliderMagic rookMagics[NUM_SQUARES];
+
+	// every square's table one after the other, the sizes are the sums of 2^(bits in the mask)
+	static Bitboard bishopTable[5248];
+	static Bitboard rookTable[102400];
+
+	static std::once_flag initialized;
+
+	// file and rank steps of the pieces
+	static const int BISHOP_STEPS[4][2] = { { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } };
+	static const int ROOK_STEPS[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+	static const int KNIGHT_STEPS[8][2] = { { 1, 2 }, { 2, 1 }, { 2, -1 }, { 1, -2 }, { -1, -2 }, { -2, -1 }, { -2, 1 }, { -1, 2 } };
+	static const int KING_STEPS[8][2] = { { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 } };
+
+	// ------------------------------------------------------------------------------------
+	// ------------------------------------------------------------------------------------
+	static bool OnBoard(int file, int rank)
+	{
+		return file >= 0 && file < 8 && rank >= 0 && rank < 8;
+	}
+
+	// ------------------------------------------------------------------------------------
+	// The squares one step away, for knights and kings
+	// ------------------------------------------------------------------------------------
+	static Bitboard GetStepAttacks(int square, const int steps[][2], int numSteps)
+	{
+		Bitboard attacks = 0;
+		for (int i = 0; i < numSteps; i++)
+		{
+			int file = GetFile(square) + steps[i][0];
+			int rank = GetRank(square) + steps[i][1];
+			if (OnBoard(file, rank))
+			{
+				attacks |= SquareBit(GetSquare(file, rank));
+			}
+		}
+		return attacks;
+	}
+
+	// ------------------------------------------------------------------------------------
+	// Walk each line until it leaves the board or reaches a blocker, the slow way the
+	// magic tables are filled from
+	// ------------------------------------------------------------------------------------
+	static Bitboard GetSlidingAttacks(int square, Bitboard occupied, const int steps[4][2])
+	{
+		Bitboard attacks = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			int file = GetFile(square) + steps[i][0];
+			int rank = GetRank(square) + steps[i][1];
+			while (OnBoard(file, rank))
+			{
+				Bitboard bit = SquareBit(GetSquare(file, rank));
+				attacks |= bit;
+				if (occupied & bit)
+				{
+					break;
+				}
+				file += steps[i][0];
+				rank += steps[i][1];
+			}
+		}
+		return attacks;
+	}
+
+	// ------------------------------------------------------------------------------------
+	// The lines on an empty board without their last square, a blocker there changes nothing
+	// ------------------------------------------------------------------------------------
+	static Bitboard GetSliderMask(int square, const int steps[4][2])
+	{
+		Bitboard mask = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			int file = GetFile(square) + steps[i][0];
+			int rank = GetRank(square) + steps[i][1];
+			while (OnBoard(file + steps[i][0], rank + steps[i][1]))
+			{
+				mask |= SquareBit(GetSquare(file, rank));
+				file += steps[i][0];
+				rank += steps[i][1];
+			}
+		}
+		return mask;
+	}
+
+	// ------------------------------------------------------------------------------------
+	// xorshift, ANDed three times over so the candidates have few bits set
+	// ------------------------------------------------------------------------------------
+	static Bitboard NextSparse(uint64_t& seed)
+	{
+		Bitboard sparse = ~(Bitboard)0;
+		for (int i = 0; i < 3; i++)
+		{
+			seed ^= seed >> 12;
+			seed ^= seed << 25;
+			seed ^= seed >> 27;
+			sparse &= seed * 2685821657736338717ull;
+		}
+		return sparse;
+	}
+
+	// ------------------------------------------------------------------------------------
+	// Try magics until every set of blockers lands on an entry that holds its attacks,
+	// two sets may share an entry only if they attack the same squares
+	// ------------------------------------------------------------------------------------
+	static Bitboard* FindMagic(int square, const int steps[4][2], SliderMagic& magic, Bitboard* pTable, uint64_t& seed)
+	{
+		magic.mask = GetSliderMask(square, steps);
+		int bits = PopCount(magic.mask);
+		magic.shift = 64 - bits;
+		magic.pAttacks = pTable;
+
+		// every subset of the mask, counted up through the mask's bits
+		int numSubsets = 1 << bits;
+		std::vector<Bitboard> subsets(numSubsets), attacks(numSubsets);
+		Bitboard subset = 0;
+		for (int i = 0; i < numSubsets; i++)
+		{
+			subsets[i] = subset;
+			attacks[i] = GetSlidingAttacks(square, subset, steps);
+			subset = (subset - magic.mask) & magic.mask;
+		}
+
+		// which try last wrote each entry, so the table needn't be cleared between tries
+		std::vector<int> tried(numSubsets, 0);
+		for (int attempt = 1; ; attempt++)
+		{
+			magic.magic = NextSparse(seed);
+			if (PopCount((magic.mask * magic.magic) >> 56) < 6)
+			{
+				continue;
+			}
+
+			bool fits = true;
+			for (int i = 0; i < numSubsets && fits; i++)
+			{
+				int index = (int)((subsets[i] * magic.magic) >> magic.shift);
+				if (tried[index] != attempt)
+				{
+					tried[index] = attempt;
+					pTable[index] = attacks[i];
+				}
+				else if (pTable[index] != attacks[i])
+				{
+					fits = false;
+				}
+			}
+			if (fits)
+			{
+				return pTable + numSubsets;
+			}
+		}
+	}
+
+	// ------------------------------------------------------------------------------------
+	// ------------------------------------------------------------------------------------
+	static void FillTables()
+	{
+		for (int square = 0; square < NUM_SQUARES; square++)
+		{
+			knightAttacks[square] = GetStepAttacks(square, KNIGHT_STEPS, 8);
+			kingAttacks[square] = GetStepAttacks(square, KING_STEPS, 8);
+
+			int file = GetFile(square);
+			int rank = GetRank(square);
+			pawnAttacks[0][square] = pawnAttacks[1][square] = 0;
+			for (int side = -1; side <= 1; side += 2)
+			{
+				if (OnBoard(file + side, rank + 1)) pawnAttacks[0][square] |= SquareBit(GetSquare(file + side, rank + 1));
+				if (OnBoard(file + side, rank - 1)) pawnAttacks[1][square] |= SquareBit(GetSquare(file + side, rank - 1));
+			}
+		}
+
+		uint64_t seed = 0x9201;
+		Bitboard* pBishop = bishopTable;
+		Bitboard* pRook = rookTable;
+		for (int square = 0; square < NUM_SQUARES; square++)
+		{
+			pBishop = FindMagic(square, BISHOP_STEPS, bishopMagics[square], pBishop, seed);
+			pRook = FindMagic(square, ROOK_STEPS, rookMagics[square], pRook, seed);
+		}
+
+		// two squares share a line if one slider on the other's square reaches it on an empty board
+		for (int a = 0; a < NUM_SQUARES; a++)
+		{
+			for (int b = 0; b < NUM_SQUARES; b++)
+			{
+				between[a][b] = lines[a][b] = 0;
+				if (a == b)
+				{
+					continue;
+				}
+				if (GetBishopAttacks(a, 0) & SquareBit(b))
+				{
+					between[a][b] = GetBishopAttacks(a, SquareBit(b)) & GetBishopAttacks(b, SquareBit(a));
+					lines[a][b] = (GetBishopAttacks(a, 0) & GetBishopAttacks(b, 0)) | SquareBit(a) | SquareBit(b);
+				}
+				else if (GetRookAttacks(a, 0) & SquareBit(b))
+				{
+					between[a][b] = GetRookAttacks(a, SquareBit(b)) & GetRookAttacks(b, SquareBit(a));
+					lines[a][b] = (GetRookAttacks(a, 0) & GetRookAttacks(b, 0)) | SquareBit(a) | SquareBit(b);
+				}
+			}
+		}
+	}
+
+	// ------------------------------------------------------------------------------------
+	// ------------------------------------------------------------------------------------
+	void Initialize()
+	{
+		std::call_once(initialized, FillTables);
+	}
+}
@@ -0,0 +1,101 @@
+//
+// BGTD 9201
+//	A set of squares as the 64 bits of one integer, a1 in bit 0 and h8 in
+//	bit 63, with the attack tables the move generator reads. Sliding
+//	attacks come from magic bitboards, the blockers on a piece's lines are
+//	multiplied into an index into that square's table
+//
+
+#ifndef _BITBOARD_H
+#define _BITBOARD_H
+
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+typedef uint64_t Bitboard;
+
+// squares run along the ranks, a1 to h1 first
+const int NUM_SQUARES = 64;
+const int NO_SQUARE = 64;
+
+inline int GetSquare(int file, int rank) { return rank * 8 + file; }
+inline int GetFile(int square) { return square & 7; }
+inline int GetRank(int square) { return square >> 3; }
+inline Bitboard SquareBit(int square) { return (Bitboard)1 << square; }
+
+// ------------------------------------------------------------------------------------
+// Bit counts and scans, one instruction each on anything that runs the game
+// ------------------------------------------------------------------------------------
+inline int PopCount(Bitboard bits)
+{
+#ifdef _MSC_VER
+	return (int)__popcnt64(bits);
+#else
+	return __builtin_popcountll(bits);
+#endif
+}
+
+// the lowest set square, bits must not be empty
+inline int LowestSquare(Bitboard bits)
+{
+#ifdef _MSC_VER
+	unsigned long square;
+	_BitScanForward64(&square, bits);
+	return (int)square;
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
+
+// take the lowest set square out of bits and return it
+inline int PopLowest(Bitboard& bits)
+{
+	int square = LowestSquare(bits);
+	bits &= bits - 1;
+	return square;
+}
+
+// where a slider's blockers index its table
+struct SliderMagic
+{
+	Bitboard mask;				// the squares whose blockers change the attacks, edges left off
+	Bitboard magic;
+	const Bitboard* pAttacks;
+	int shift;
+};
+
+namespace Bitboards
+{
+	// fill the tables, only the first call does anything and every other function needs it done
+	void Initialize();
+
+	extern Bitboard knightAttacks[NUM_SQUARES];
+	extern Bitboard kingAttacks[NUM_SQUARES];
+	extern Bitboard pawnAttacks[2][NUM_SQUARES];		// by the side capturing, white first
+	extern Bitboard between[NUM_SQUARES][NUM_SQUARES];	// squares strictly between two on a line
+	extern Bitboard lines[NUM_SQUARES][NUM_SQUARES];		// the whole line through two squares, edge to edge
+	extern SliderMagic bishopMagics[NUM_SQUARES];
+	extern SliderMagic rookMagics[NUM_SQUARES];
+
+	inline Bitboard GetBishopAttacks(int square, Bitboard occupied)
+	{
+		const SliderMagic& m = bishopMagics[square];
+		return m.pAttacks[((occupied & m.mask) * m.magic) >> m.shift];
+	}
+
+	inline Bitboard GetRookAttacks(int square, Bitboard occupied)
+	{
+		const SliderMagic& m = rookMagics[square];
+		return m.pAttacks[((occupied & m.mask) * m.magic) >> m.shift];
+	}
+
+	inline Bitboard GetQueenAttacks(int square, Bitboard occupied)
+	{
+		return GetBishopAttacks(square, occupied) | GetRookAttacks(square, occupied);
+	}
+}
+
+#endif
@@ -0,0 +1,930 @@
+//
+// BGTD 9201
+//	The search threads, the search and the evaluation it scores leaves with
+//
+
+#include "ChessEngine.h"
+#include "Platform.h"
+#include <chrono>
+#include <cstring>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace Bitboards;
+
+// deeper than any search finishes in a game, the PV and killer tables are this long
+static const int MAX_PLY = 64;
+
+// above every real score
+static const int INFINITE_SCORE = ChessEngine::MATE_SCORE + 1;
+
+// how many nodes pass between looks at the clock and the stop flag
+static const uint64_t CHECK_INTERVAL = 1024;
+
+// the table's size until SetHashSize says otherwise
+static const size_t DEFAULT_HASH_MEGABYTES = 16;
+
+// how far below the render loop the search threads run on Linux, as a nice value
+static const int SEARCH_NICENESS = 10;
+
+// ------------------------------------------------------------------------------------
+// The search threads give way to the render loop when they share a core with it, so a
+// frame isn't held up waiting for its turn
+// ------------------------------------------------------------------------------------
+static void LowerThreadPriority()
+{
+#if defined(_WIN32)
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__)
+	// batch threads don't preempt the thread that woke them either
+	sched_param param = {};
+	pthread_setschedparam(pthread_self(), SCHED_BATCH, &param);
+	setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), SEARCH_NICENESS);
+#endif
+}
+
+// ------------------------------------------------------------------------------------
+// Mates are stored by their distance from the stored position rather than the root,
+// so the score holds wherever in the tree it's found again
+// ------------------------------------------------------------------------------------
+static int ScoreToTable(int score, int ply)
+{
+	return score > ChessEngine::MATE_SCORE - 1000 ? score + ply : score < -(ChessEngine::MATE_SCORE - 1000) ? score - ply : score;
+}
+
+static int ScoreFromTable(int score, int ply)
+{
+	return score > ChessEngine::MATE_SCORE - 1000 ? score - ply : score < -(ChessEngine::MATE_SCORE - 1000) ? score + ply : score;
+}
+
+// material by piece type, in the order of PieceType
+static const int PIECE_VALUES[NUM_PIECE_TYPES] = { 100, 500, 320, 330, 900, 0 };
+
+// how much each piece type counts towards the middle game, 24 with every piece on
+static const int PHASE_WEIGHTS[NUM_PIECE_TYPES] = { 0, 2, 1, 1, 4, 0 };
+static const int FULL_PHASE = 24;
+
+// bonuses by square for white, written with rank 8 on top as a board is drawn. Black
+// reads them flipped. From the simplified evaluation function on the chess programming wiki
+static const int PAWN_SQUARES[NUM_SQUARES] =
+{
+	  0,  0,  0,  0,  0,  0,  0,  0,
+	 50, 50, 50, 50, 50, 50, 50, 50,
+	 10, 10, 20, 30, 30, 20, 10, 10,
+	  5,  5, 10, 25, 25, 10,  5,  5,
+	  0,  0,  0, 20, 20,  0,  0,  0,
+	  5, -5,-10,  0,  0,-10, -5,  5,
+	  5, 10, 10,-20,-20, 10, 10,  5,
+	  0,  0,  0,  0,  0,  0,  0,  0
+};
+
+static const int ROOK_SQUARES[NUM_SQUARES] =
+{
+	  0,  0,  0,  0,  0,  0,  0,  0,
+	  5, 10, 10, 10, 10, 10, 10,  5,
+	 -5,  0,  0,  0,  0,  0,  0, -5,
+	 -5,  0,  0,  0,  0,  0,  0, -5,
+	 -5,  0,  0,  0,  0,  0,  0, -5,
+	 -5,  0,  0,  0,  0,  0,  0, -5,
+	 -5,  0,  0,  0,  0,  0,  0, -5,
+	  0,  0,  0,  5,  5,  0,  0,  0
+};
+
+static const int KNIGHT_SQUARES[NUM_SQUARES] =
+{
+	-50,-40,-30,-30,-30,-30,-40,-50,
+	-40,-20,  0,  0,  0,  0,-20,-40,
+	-30,  0, 10, 15, 15, 10,  0,-30,
+	-30,  5, 15, 20, 20, 15,  5,-30,
+	-30,  0, 15, 20, 20, 15,  0,-30,
+	-30,  5, 10, 15, 15, 10,  5,-30,
+	-40,-20,  0,  5,  5,  0,-20,-40,
+	-50,-40,-30,-30,-30,-30,-40,-50
+};
+
+static const int BISHOP_SQUARES[NUM_SQUARES] =
+{
+	-20,-10,-10,-10,-10,-10,-10,-20,
+	-10,  0,  0,  0,  0,  0,  0,-10,
+	-10,  0,  5, 10, 10,  5,  0,-10,
+	-10,  5,  5, 10, 10,  5,  5,-10,
+	-10,  0, 10, 10, 10, 10,  0,-10,
+	-10, 10, 10, 10, 10, 10, 10,-10,
+	-10,  5,  0,  0,  0,  0,  5,-10,
+	-20,-10,-10,-10,-10,-10,-10,-20
+};
+
+static const int QUEEN_SQUARES[NUM_SQUARES] =
+{
+	-20,-10,-10, -5, -5,-10,-10,-20,
+	-10,  0,  0,  0,  0,  0,  0,-10,
+	-10,  0,  5,  5,  5,  5,  0,-10,
+	 -5,  0,  5,  5,  5,  5,  0, -5,
+	  0,  0,  5,  5,  5,  5,  0, -5,
+	-10,  5,  5,  5,  5,  5,  0,-10,
+	-10,  0,  5,  0,  0,  0,  0,-10,
+	-20,-10,-10, -5, -5,-10,-10,-20
+};
+
+// the king hides while there are pieces about and comes out once they're gone
+static const int KING_SQUARES[NUM_SQUARES] =
+{
+	-30,-40,-40,-50,-50,-40,-40,-30,
+	-30,-40,-40,-50,-50,-40,-40,-30,
+	-30,-40,-40,-50,-50,-40,-40,-30,
+	-30,-40,-40,-50,-50,-40,-40,-30,
+	-20,-30,-30,-40,-40,-30,-30,-20,
+	-10,-20,-20,-20,-20,-20,-20,-10,
+	 20, 20,  0,  0,  0,  0, 20, 20,
+	 20, 30, 10,  0,  0, 10, 30, 20
+};
+
+static const int KING_ENDGAME_SQUARES[NUM_SQUARES] =
+{
+	-50,-40,-30,-20,-20,-30,-40,-50,
+	-30,-20,-10,  0,  0,-10,-20,-30,
+	-30,-10, 20, 30, 30, 20,-10,-30,
+	-30,-10, 30, 40, 40, 30,-10,-30,
+	-30,-10, 30, 40, 40, 30,-10,-30,
+	-30,-10, 20, 30, 30, 20,-10,-30,
+	-30,-30,  0,  0,  0,  0,-30,-30,
+	-50,-30,-30,-30,-30,-30,-30,-50
+};
+
+static const int* const PIECE_SQUARES[NUM_PIECE_TYPES] =
+{
+	PAWN_SQUARES, ROOK_SQUARES, KNIGHT_SQUARES, BISHOP_SQUARES, QUEEN_SQUARES, KING_SQUARES
+};
+
+// ------------------------------------------------------------------------------------
+// Material and where it stands, for the side to move
+// ------------------------------------------------------------------------------------
+static int Evaluate(const ChessPosition& position)
+{
+	int score[2] = { 0, 0 };
+	int kingEndgame[2] = { 0, 0 };
+	int phase = 0;
+
+	for (int side = WhiteSide; side <= BlackSide; side++)
+	{
+		// the tables have rank 8 first, so white's squares are flipped to find their row
+		int flip = side == WhiteSide ? 56 : 0;
+		for (int type = PawnPiece; type < NUM_PIECE_TYPES; type++)
+		{
+			Bitboard pieces = position.GetPieces((ChessSide)side, (PieceType)type);
+			phase += PopCount(pieces) * PHASE_WEIGHTS[type];
+			while (pieces)
+			{
+				int square = PopLowest(pieces) ^ flip;
+				score[side] += PIECE_VALUES[type] + PIECE_SQUARES[type][square];
+				if (type == KingPiece)
+				{
+					kingEndgame[side] = KING_ENDGAME_SQUARES[square] - KING_SQUARES[square];
+				}
+			}
+		}
+	}
+
+	// the king's table slides towards its endgame one as the pieces come off
+	if (phase > FULL_PHASE)
+	{
+		phase = FULL_PHASE;
+	}
+	int white = score[WhiteSide] + kingEndgame[WhiteSide] * (FULL_PHASE - phase) / FULL_PHASE;
+	int black = score[BlackSide] + kingEndgame[BlackSide] * (FULL_PHASE - phase) / FULL_PHASE;
+	return position.GetSideToMove() == WhiteSide ? white - black : black - white;
+}
+
+// ------------------------------------------------------------------------------------
+// One search at a time over its own copy of the position. The first worker is the main
+// search, the others help it
+// ------------------------------------------------------------------------------------
+class SearchWorker
+{
+public:
+	SearchWorker(ChessEngine* pEngine, int index);
+
+	// iterative deepening until a limit is reached or the engine says stop. The main
+	// search publishes a snapshot after every depth and a last one when it ends, helpers
+	// keep going until they're stopped and publish nothing
+	void Search(const ChessPosition& position, const SearchLimits& limits, uint32_t searchId);
+
+	// as of the last look at the clock
+	uint64_t GetNodes() const { return sharedNodes.load(std::memory_order_relaxed); }
+
+private:
+
+	int SearchNode(int alpha, int beta, int depth, int ply);
+
+	// captures and promotions only, until the position is quiet
+	int Quiesce(int alpha, int beta, int ply);
+
+	// a sort key per move, the best first
+	void ScoreMoves(const MoveList& list, int* pScores, int ply, ChessMove hashMove);
+
+	// swap the best scored move left into index
+	static void PickMove(MoveList& list, int* pScores, int index);
+
+	// true once the search has to stop, looked at every CHECK_INTERVAL nodes
+	bool ShouldStop();
+
+	void Publish(SearchSnapshot& snapshot);
+
+	ChessEngine* pEngine;
+	int index;
+
+	ChessPosition position;
+	SearchLimits limits;
+	std::chrono::steady_clock::time_point startTime;
+	uint64_t nodes;
+	std::atomic<uint64_t> sharedNodes;
+	bool stopped;
+
+	// each ply's best line, row ply starting at that ply
+	ChessMove pvTable[MAX_PLY][MAX_PLY];
+	int pvLength[MAX_PLY];
+
+	// the last depth's line is tried first while the search is still on it
+	ChessMove previousPv[MAX_PLY];
+	int previousPvLength;
+	bool followingPv;
+
+	// quiet moves that caused a cutoff, by ply, and by side, from and to square
+	ChessMove killers[MAX_PLY][2];
+	int history[2][NUM_SQUARES][NUM_SQUARES];
+};
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+SearchWorker::SearchWorker(ChessEngine* pInEngine, int inIndex) : sharedNodes(0)
+{
+	pEngine = pInEngine;
+	index = inIndex;
+	nodes = 0;
+	stopped = false;
+	previousPvLength = 0;
+	followingPv = false;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void SearchWorker::Search(const ChessPosition& inPosition, const SearchLimits& inLimits, uint32_t searchId)
+{
+	position = inPosition;
+	limits = inLimits;
+	startTime = std::chrono::steady_clock::now();
+	nodes = 0;
+	sharedNodes.store(0, std::memory_order_relaxed);
+	stopped = false;
+	previousPvLength = 0;
+	memset(killers, 0, sizeof(killers));
+	memset(history, 0, sizeof(history));
+
+	SearchSnapshot snapshot;
+	memset(&snapshot, 0, sizeof(snapshot));
+	snapshot.searchId = searchId;
+	snapshot.thinking = true;
+
+	// a move to play even if the first depth doesn't finish
+	MoveList rootMoves;
+	position.GenerateMoves(rootMoves);
+	if (rootMoves.count == 0)
+	{
+		snapshot.score = position.IsInCheck() ? -ChessEngine::MATE_SCORE : 0;
+	}
+	else
+	{
+		snapshot.bestMove = snapshot.pv[0] = rootMoves.moves[0];
+		snapshot.pvLength = 1;
+	}
+
+	// every other helper starts a depth ahead, so the threads aren't all on the same depth
+	bool helper = index > 0;
+	int firstDepth = helper ? 1 + (index & 1) : 1;
+	int maxDepth = limits.depth > 0 && limits.depth < MAX_PLY / 2 ? limits.depth : MAX_PLY / 2;
+	for (int depth = firstDepth; depth <= maxDepth && rootMoves.count > 0; depth++)
+	{
+		followingPv = true;
+		int score = SearchNode(-INFINITE_SCORE, INFINITE_SCORE, depth, 0);
+
+		// a depth cut short is thrown away, its best move may not have been looked at properly
+		if (stopped)
+		{
+			break;
+		}
+
+		previousPvLength = pvLength[0];
+		memcpy(previousPv, pvTable[0], previousPvLength * sizeof(ChessMove));
+		if (helper)
+		{
+			continue;
+		}
+
+		snapshot.depth = depth;
+		snapshot.score = score;
+		snapshot.pvLength = pvLength[0] < SearchSnapshot::MAX_PV ? pvLength[0] : SearchSnapshot::MAX_PV;
+		memcpy(snapshot.pv, pvTable[0], snapshot.pvLength * sizeof(ChessMove));
+		snapshot.bestMove = snapshot.pv[0];
+		Publish(snapshot);
+
+		// a forced mate is found, deeper can't do better
+		if (ChessEngine::IsMateScore(score) && ChessEngine::MATE_SCORE - (score < 0 ? -score : score) <= depth)
+		{
+			break;
+		}
+	}
+
+	sharedNodes.store(nodes, std::memory_order_relaxed);
+	if (!helper)
+	{
+		snapshot.thinking = false;
+		Publish(snapshot);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void SearchWorker::Publish(SearchSnapshot& snapshot)
+{
+	sharedNodes.store(nodes, std::memory_order_relaxed);
+	snapshot.nodes = pEngine->GetNodes();
+	snapshot.milliseconds = (int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+	pEngine->Publish(snapshot);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+bool SearchWorker::ShouldStop()
+{
+	sharedNodes.store(nodes, std::memory_order_relaxed);
+	if (pEngine->stopping.load(std::memory_order_relaxed))
+	{
+		return true;
+	}
+	if (index > 0)
+	{
+		return pEngine->helpersStopping.load(std::memory_order_relaxed);
+	}
+	if (limits.nodes > 0 && pEngine->GetNodes() >= limits.nodes)
+	{
+		return true;
+	}
+	if (limits.milliseconds > 0)
+	{
+		std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - startTime;
+		return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() >= limits.milliseconds;
+	}
+	return false;
+}
+
+// ------------------------------------------------------------------------------------
+// Principal variation search. The first move gets the full window, the rest are only
+// proved no better with a null window and searched again if one is
+// ------------------------------------------------------------------------------------
+int SearchWorker::SearchNode(int alpha, int beta, int depth, int ply)
+{
+	pvLength[ply] = ply;
+	if (depth <= 0)
+	{
+		return Quiesce(alpha, beta, ply);
+	}
+
+	nodes++;
+	if ((nodes & (CHECK_INTERVAL - 1)) == 0 && ShouldStop())
+	{
+		stopped = true;
+	}
+	if (stopped)
+	{
+		return 0;
+	}
+
+	// fifty moves without a capture or a pawn moving is a draw, and so is coming back to a
+	// position, the side that could avoid it would have if it were winning
+	if (ply > 0 && (position.GetHalfmoveClock() >= 100 || position.GetRepetitions() > 0))
+	{
+		return 0;
+	}
+	if (ply >= MAX_PLY - 1)
+	{
+		return Evaluate(position);
+	}
+
+	// a score from the table ends the node if it's from deep enough and its bound settles
+	// it, only away from the principal variation so its line stays whole
+	TranspositionTable& table = pEngine->table;
+	uint64_t key = position.GetKey();
+	bool pvNode = beta - alpha > 1;
+	ChessMove hashMove = NO_MOVE;
+	TableEntry entry;
+	if (table.Probe(key, entry))
+	{
+		hashMove = entry.move;
+		int score = ScoreFromTable(entry.score, ply);
+		if (ply > 0 && !pvNode && entry.depth >= depth
+			&& (entry.bound == ExactBound || (entry.bound == LowerBound && score >= beta) || (entry.bound == UpperBound && score <= alpha)))
+		{
+			return score;
+		}
+	}
+
+	MoveList list;
+	position.GenerateMoves(list);
+	bool inCheck = position.IsInCheck();
+	if (list.count == 0)
+	{
+		return inCheck ? -ChessEngine::MATE_SCORE + ply : 0;
+	}
+
+	// checks are looked at a ply further, so a mate behind one isn't missed
+	if (inCheck)
+	{
+		depth++;
+	}
+
+	int scores[MoveList::MAX_MOVES];
+	ScoreMoves(list, scores, ply, hashMove);
+
+	int originalAlpha = alpha;
+	int bestScore = -INFINITE_SCORE;
+	ChessMove bestMove = NO_MOVE;
+	MoveUndo undo;
+	for (int i = 0; i < list.count; i++)
+	{
+		PickMove(list, scores, i);
+		ChessMove move = list.moves[i];
+
+		position.MakeMove(move, undo);
+		int score;
+		if (i == 0)
+		{
+			score = -SearchNode(-beta, -alpha, depth - 1, ply + 1);
+		}
+		else
+		{
+			score = -SearchNode(-alpha - 1, -alpha, depth - 1, ply + 1);
+			if (score > alpha && score < beta)
+			{
+				score = -SearchNode(-beta, -alpha, depth - 1, ply + 1);
+			}
+		}
+		position.UnmakeMove(move, undo);
+
+		// only the first move of a node can still be on last depth's line
+		followingPv = false;
+
+		if (stopped)
+		{
+			return 0;
+		}
+
+		if (score > bestScore)
+		{
+			bestScore = score;
+			bestMove = move;
+		}
+		if (score > alpha)
+		{
+			alpha = score;
+
+			pvTable[ply][ply] = move;
+			for (int next = ply + 1; next < pvLength[ply + 1]; next++)
+			{
+				pvTable[ply][next] = pvTable[ply + 1][next];
+			}
+			pvLength[ply] = pvLength[ply + 1];
+
+			if (alpha >= beta)
+			{
+				if (!IsCapture(move) && !IsPromotion(move))
+				{
+					if (killers[ply][0] != move)
+					{
+						killers[ply][1] = killers[ply][0];
+						killers[ply][0] = move;
+					}
+					history[position.GetSideToMove()][GetMoveFrom(move)][GetMoveTo(move)] += depth * depth;
+				}
+				break;
+			}
+		}
+	}
+
+	TableBound bound = bestScore >= beta ? LowerBound : bestScore > originalAlpha ? ExactBound : UpperBound;
+	table.Store(key, bestMove, ScoreToTable(bestScore, ply), depth, bound);
+	return bestScore;
+}
+
+// ------------------------------------------------------------------------------------
+// Standing pat on the evaluation, then only the captures and promotions that could raise it
+// ------------------------------------------------------------------------------------
+int SearchWorker::Quiesce(int alpha, int beta, int ply)
+{
+	nodes++;
+	if ((nodes & (CHECK_INTERVAL - 1)) == 0 && ShouldStop())
+	{
+		stopped = true;
+	}
+	if (stopped)
+	{
+		return 0;
+	}
+
+	int standPat = Evaluate(position);
+	if (standPat >= beta || ply >= MAX_PLY - 1)
+	{
+		return standPat;
+	}
+	if (standPat > alpha)
+	{
+		alpha = standPat;
+	}
+
+	MoveList list;
+	position.GenerateMoves(list);
+
+	// keep just the captures and promotions
+	int count = 0;
+	for (int i = 0; i < list.count; i++)
+	{
+		if (IsCapture(list.moves[i]) || IsPromotion(list.moves[i]))
+		{
+			list.moves[count++] = list.moves[i];
+		}
+	}
+	list.count = count;
+
+	int scores[MoveList::MAX_MOVES];
+	ScoreMoves(list, scores, ply, NO_MOVE);
+
+	MoveUndo undo;
+	for (int i = 0; i < list.count; i++)
+	{
+		PickMove(list, scores, i);
+		position.MakeMove(list.moves[i], undo);
+		int score = -Quiesce(-beta, -alpha, ply + 1);
+		position.UnmakeMove(list.moves[i], undo);
+
+		if (stopped)
+		{
+			return 0;
+		}
+		if (score >= beta)
+		{
+			return score;
+		}
+		if (score > alpha)
+		{
+			alpha = score;
+		}
+	}
+	return alpha;
+}
+
+// ------------------------------------------------------------------------------------
+// Last depth's move first, then the table's, then captures of the most valuable piece by the least, then
+// promotions, killers, and the other quiet moves by how often they've cut off
+// ------------------------------------------------------------------------------------
+void SearchWorker::ScoreMoves(const MoveList& list, int* pScores, int ply, ChessMove hashMove)
+{
+	ChessMove pvMove = followingPv && ply < previousPvLength ? previousPv[ply] : NO_MOVE;
+	ChessSide side = position.GetSideToMove();
+
+	for (int i = 0; i < list.count; i++)
+	{
+		ChessMove move = list.moves[i];
+		int from = GetMoveFrom(move);
+		int to = GetMoveTo(move);
+
+		if (move == pvMove)
+		{
+			pScores[i] = 1 << 30;
+		}
+		else if (move == hashMove)
+		{
+			pScores[i] = (1 << 30) - 1;
+		}
+		else if (IsCapture(move))
+		{
+			PieceType victim = GetMoveFlag(move) == EnPassantCapture ? PawnPiece : ChessPosition::GetPieceType(position.GetPiece(to));
+			PieceType attacker = ChessPosition::GetPieceType(position.GetPiece(from));
+			pScores[i] = (1 << 24) + PIECE_VALUES[victim] * 16 - PIECE_VALUES[attacker] / 16;
+		}
+		else if (IsPromotion(move))
+		{
+			pScores[i] = (1 << 23) + (GetMoveFlag(move) & 3);
+		}
+		else if (move == killers[ply][0])
+		{
+			pScores[i] = (1 << 22) + 1;
+		}
+		else if (move == killers[ply][1])
+		{
+			pScores[i] = 1 << 22;
+		}
+		else
+		{
+			pScores[i] = history[side][from][to] < (1 << 22) ? history[side][from][to] : (1 << 22) - 1;
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// A selection sort a step at a time, a cutoff usually comes before the list is sorted
+// ------------------------------------------------------------------------------------
+void SearchWorker::PickMove(MoveList& list, int* pScores, int index)
+{
+	int best = index;
+	for (int i = index + 1; i < list.count; i++)
+	{
+		if (pScores[i] > pScores[best])
+		{
+			best = i;
+		}
+	}
+	if (best != index)
+	{
+		ChessMove move = list.moves[index];
+		list.moves[index] = list.moves[best];
+		list.moves[best] = move;
+
+		int score = pScores[index];
+		pScores[index] = pScores[best];
+		pScores[best] = score;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+ChessEngine::ChessEngine() : newest(1), writing(2), reading(0), stopping(false), helpersStopping(false)
+{
+	memset(snapshots, 0, sizeof(snapshots));
+	jobLimits.depth = 0;
+	jobLimits.nodes = 0;
+	jobLimits.milliseconds = 0;
+	jobId = 0;
+	lastId = 0;
+	searching = false;
+	quitting = false;
+	helperGeneration = 0;
+	helpersBusy = 0;
+	helpersQuitting = false;
+
+	table.Resize(DEFAULT_HASH_MEGABYTES);
+
+	workers.push_back(new SearchWorker(this, 0));
+	thread = std::thread(&ChessEngine::ThreadLoop, this);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+ChessEngine::~ChessEngine()
+{
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		quitting = true;
+	}
+	stopping = true;
+	jobReady.notify_all();
+	thread.join();
+
+	SetThreads(1);
+	delete workers[0];
+}
+
+// ------------------------------------------------------------------------------------
+// The helpers are only changed while nothing is searching
+// ------------------------------------------------------------------------------------
+void ChessEngine::SetThreads(int count)
+{
+	if (count <= 0)
+	{
+		count = (int)std::thread::hardware_concurrency();
+		count = count > 0 ? count : 1;
+	}
+
+	Stop();
+	Wait();
+
+	{
+		std::lock_guard<std::mutex> lock(helperMutex);
+		helpersQuitting = true;
+	}
+	helperReady.notify_all();
+	for (size_t i = 0; i < helperThreads.size(); i++)
+	{
+		helperThreads[i].join();
+	}
+	helperThreads.clear();
+	for (size_t i = 1; i < workers.size(); i++)
+	{
+		delete workers[i];
+	}
+	workers.resize(1);
+
+	helpersQuitting = false;
+	for (int i = 1; i < count; i++)
+	{
+		workers.push_back(new SearchWorker(this, i));
+		helperThreads.push_back(std::thread(&ChessEngine::HelperLoop, this, i));
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+bool ChessEngine::SetHashSize(size_t megabytes)
+{
+	Stop();
+	Wait();
+	return table.Resize(megabytes);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void ChessEngine::ClearHash()
+{
+	Stop();
+	Wait();
+	table.Clear();
+}
+
+// ------------------------------------------------------------------------------------
+// A search running now is told to stop and stops within a few thousand nodes, so this
+// waits microseconds at most
+// ------------------------------------------------------------------------------------
+uint32_t ChessEngine::Start(const ChessPosition& position, const SearchLimits& limits)
+{
+	stopping = true;
+
+	std::unique_lock<std::mutex> lock(jobMutex);
+	jobDone.wait(lock, [this] { return !searching; });
+
+	jobPosition = position;
+	jobLimits = limits;
+	jobId = ++lastId;
+	searching = true;
+	stopping = false;
+	lock.unlock();
+
+	jobReady.notify_one();
+	return jobId;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void ChessEngine::Stop()
+{
+	stopping = true;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void ChessEngine::Wait()
+{
+	std::unique_lock<std::mutex> lock(jobMutex);
+	jobDone.wait(lock, [this] { return !searching; });
+}
+
+// ------------------------------------------------------------------------------------
+// Wait for a search, run it, repeat
+// ------------------------------------------------------------------------------------
+void ChessEngine::ThreadLoop()
+{
+	uint32_t seenId = 0;
+	LowerThreadPriority();
+
+	for (;;)
+	{
+		ChessPosition position;
+		SearchLimits limits;
+		uint32_t searchId;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobReady.wait(lock, [&] { return quitting || (searching && jobId != seenId); });
+			if (quitting)
+			{
+				// a search started but never picked up mustn't leave Wait waiting for it
+				searching = false;
+				jobDone.notify_all();
+				return;
+			}
+			seenId = searchId = jobId;
+			position = jobPosition;
+			limits = jobLimits;
+		}
+
+		// the helpers only fill the table, so they're stopped as soon as the main search ends
+		table.NewSearch();
+		StartHelpers(position);
+		workers[0]->Search(position, limits, searchId);
+		StopHelpers();
+
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			searching = false;
+		}
+		jobDone.notify_all();
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void ChessEngine::StartHelpers(const ChessPosition& position)
+{
+	if (helperThreads.empty())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(helperMutex);
+		helperPosition = position;
+		helpersBusy = (int)helperThreads.size();
+		helpersStopping = false;
+		helperGeneration++;
+	}
+	helperReady.notify_all();
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void ChessEngine::StopHelpers()
+{
+	helpersStopping = true;
+
+	std::unique_lock<std::mutex> lock(helperMutex);
+	helperDone.wait(lock, [this] { return helpersBusy == 0; });
+}
+
+// ------------------------------------------------------------------------------------
+// Wait for the main search to start, search alongside it until stopped, repeat
+// ------------------------------------------------------------------------------------
+void ChessEngine::HelperLoop(int helper)
+{
+	uint64_t seenGeneration = helperGeneration;
+	SearchLimits noLimits = { 0, 0, 0 };
+	LowerThreadPriority();
+
+	for (;;)
+	{
+		ChessPosition position;
+		{
+			std::unique_lock<std::mutex> lock(helperMutex);
+			helperReady.wait(lock, [&] { return helpersQuitting || helperGeneration != seenGeneration; });
+			if (helpersQuitting)
+			{
+				return;
+			}
+			seenGeneration = helperGeneration;
+			position = helperPosition;
+		}
+
+		workers[helper]->Search(position, noLimits, 0);
+
+		{
+			std::lock_guard<std::mutex> lock(helperMutex);
+			if (--helpersBusy == 0)
+			{
+				helperDone.notify_all();
+			}
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+uint64_t ChessEngine::GetNodes() const
+{
+	uint64_t nodes = 0;
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		nodes += workers[i]->GetNodes();
+	}
+	return nodes;
+}
+
+// ------------------------------------------------------------------------------------
+// The search's snapshot becomes the newest, and the old newest is the next one written
+// ------------------------------------------------------------------------------------
+void ChessEngine::Publish(const SearchSnapshot& snapshot)
+{
+	snapshots[writing] = snapshot;
+	writing = newest.exchange(writing | NEW_SNAPSHOT, std::memory_order_acq_rel) & 3;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+const SearchSnapshot& ChessEngine::Poll()
+{
+	if (newest.load(std::memory_order_acquire) & NEW_SNAPSHOT)
+	{
+		reading = newest.exchange(reading, std::memory_order_acq_rel) & 3;
+	}
+	return snapshots[reading];
+}
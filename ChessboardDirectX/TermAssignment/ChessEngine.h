@@ -0,0 +1,136 @@
+//
+// BGTD 9201
+//	Searches a position for the best move on threads of its own, so the
+//	render loop can keep drawing while it thinks. Iterative deepening with a
+//	principal variation search, and the result so far is published after
+//	every depth through a snapshot the game polls each frame without locking.
+//	With more than one thread it's Lazy SMP: helpers search the same root a
+//	depth apart from each other and only share what they find through the
+//	transposition table, which steers the main search's move ordering
+//
+
+#ifndef _CHESS_ENGINE_H
+#define _CHESS_ENGINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ChessPosition.h"
+#include "TranspositionTable.h"
+
+// when a search stops, 0 for no limit. With no limits at all it runs until Stop
+struct SearchLimits
+{
+	int depth;
+	uint64_t nodes;
+	int milliseconds;
+};
+
+// what a search has found so far
+struct SearchSnapshot
+{
+	static const int MAX_PV = 64;
+
+	uint32_t searchId;			// from the Start that began it, 0 before the first
+	bool thinking;				// false once the search has stopped and this is its answer
+	int depth;					// the deepest search finished
+	int score;					// in centipawns for the side to move, see ChessEngine::IsMateScore
+	uint64_t nodes;				// by every thread
+	int milliseconds;
+	ChessMove bestMove;			// NO_MOVE if the position has no legal moves
+	ChessMove pv[MAX_PV];		// the line the search expects, from bestMove on
+	int pvLength;
+};
+
+class SearchWorker;
+
+class ChessEngine
+{
+public:
+	ChessEngine();
+	~ChessEngine();
+
+	// mates are scored MATE_SCORE less the plies to them
+	static const int MATE_SCORE = 32000;
+	static bool IsMateScore(int score) { return score > MATE_SCORE - 1000 || score < -(MATE_SCORE - 1000); }
+
+	// threads searching, 0 for every core, and the table's size. These stop any search
+	// running. False if the table couldn't be had
+	void SetThreads(int count);
+	bool SetHashSize(size_t megabytes);
+	void ClearHash();
+	int GetThreads() const { return (int)workers.size(); }
+	const TranspositionTable& GetTable() const { return table; }
+
+	// search a copy of position, stopping any search already running. Returns the id its
+	// snapshots will carry
+	uint32_t Start(const ChessPosition& position, const SearchLimits& limits);
+
+	// ask the search to stop, its last snapshot comes through a moment later
+	void Stop();
+
+	// block until the search has stopped, for the benchmarks rather than the game
+	void Wait();
+
+	// the newest snapshot, one thread may poll. Never waits for the search
+	const SearchSnapshot& Poll();
+
+private:
+
+	void ThreadLoop();
+	void HelperLoop(int helper);
+
+	// start and stop the helper threads around the main search
+	void StartHelpers(const ChessPosition& position);
+	void StopHelpers();
+
+	// nodes searched by every worker so far
+	uint64_t GetNodes() const;
+
+	// hand a snapshot over to Poll
+	void Publish(const SearchSnapshot& snapshot);
+
+	// the main search first, the helpers after it, each helper with a thread of its own
+	std::vector<SearchWorker*> workers;
+	std::vector<std::thread> helperThreads;
+	TranspositionTable table;
+
+	// three snapshots, the search writes one, Poll reads another and the third is the newest
+	// finished. Publishing and polling swap their own with it, the top bit marking it unread
+	static const int NEW_SNAPSHOT = 4;
+	SearchSnapshot snapshots[3];
+	std::atomic<int> newest;
+	int writing;
+	int reading;
+
+	// the next search, handed over under the mutex
+	std::thread thread;
+	std::mutex jobMutex;
+	std::condition_variable jobReady;
+	std::condition_variable jobDone;
+	ChessPosition jobPosition;
+	SearchLimits jobLimits;
+	uint32_t jobId;
+	uint32_t lastId;
+	bool searching;
+	bool quitting;
+
+	std::atomic<bool> stopping;
+
+	// the helpers' search, started and waited for by the main thread
+	std::mutex helperMutex;
+	std::condition_variable helperReady;
+	std::condition_variable helperDone;
+	ChessPosition helperPosition;
+	uint64_t helperGeneration;
+	int helpersBusy;
+	bool helpersQuitting;
+	std::atomic<bool> helpersStopping;
+
+	friend class SearchWorker;
+};
+
+#endif
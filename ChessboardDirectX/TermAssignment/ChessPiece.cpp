@@ -0,0 +1,89 @@
+//
+// ChessPieceModel
+//
+//  BGTD 9201
+//
+
+#include "ChessPiece.h"
+#include "StateCache.h"
+
+// called to initialize the object
+void ChessPiece::Initialize(ID3D11Device* pDevice, LitColourShader* pLitShader, float baseOffset)
+{
+	pShader = pLitShader;
+
+	// every part is transformed into place here and merged into one mesh
+	std::vector<PiecePart> parts;
+	ChessSet::GetPieceParts(type, parts);
+	mesh.AddParts(parts);
+
+	mesh.Build(pDevice, LitColourShader::InstancedInputElements, LitColourShader::InstancedInputElementCount, pShader->GetInstancedVertexShaderBinary(), pShader->GetInstancedVertexShaderBinarySize());
+
+	// the parts pick their material from this table, every piece with the same values shares it
+	MaterialBuffer materials;
+	materials.SetMaterial(BaseMaterial, Colors::DarkGreen.v, Colors::DarkGreen.v, Colors::Black.v, 2);
+	materials.SetMaterial(MiddleMaterial, Colors::DarkGoldenrod.v, Colors::Goldenrod.v, Colors::DarkGoldenrod.v, 8);
+	materials.SetMaterial(TopMaterial, Colors::Black.v, Colors::DarkGray.v, Colors::Silver.v, 128);
+	materialId = MaterialRegistry::Get().AcquireMaterials(pDevice, materials);
+
+	SetBaseOffset(baseOffset);
+}
+
+// called to draw every instance of the piece
+// Each instance in the buffer carries the matrix that places it on the board and the player's colour
+void ChessPiece::DrawInstanced(RenderDevice* pRenderDevice, DeviceBuffer* pInstanceBuffer, UINT startInstance, UINT numInstances)
+{
+	if (numInstances == 0)
+	{
+		return;
+	}
+
+	// diffuse in the first two slots, the spec in the last
+	StateCache::Get().PSSetShaderResource(pRenderDevice, 0, pDiffuse);
+	StateCache::Get().PSSetShaderResource(pRenderDevice, 1, pDiffuse);
+	StateCache::Get().PSSetShaderResource(pRenderDevice, 2, pSpec);
+
+	// the parts are already in place, so the whole piece is a single draw
+	pShader->SetMaterials(pRenderDevice, materialId);
+	pShader->SetInstancedShaders(pRenderDevice, AffineTransform());
+	mesh.DrawInstanced(pRenderDevice, pInstanceBuffer, sizeof(InstanceData), numInstances, startInstance);
+}
+
+// called to queue every instance of the piece
+// The key groups the draw with others using the same shader, materials and mesh
+void ChessPiece::Submit(RenderQueue& queue, ID3D11Buffer* pInstanceBuffer, UINT startInstance, UINT numInstances, float viewDepth)
+{
+	if (numInstances == 0)
+	{
+		return;
+	}
+
+	RenderPacket packet;
+	packet.key = queue.MakeKey(OpaquePass, pShader, materialId, &mesh, viewDepth);
+	packet.pOwner = this;
+	packet.pInstanceBuffer = pInstanceBuffer;
+	packet.startInstance = startInstance;
+	packet.numInstances = numInstances;
+	queue.Submit(packet);
+}
+
+// called by the render queue once the packets are sorted
+void ChessPiece::DrawPacket(RenderDevice* pRenderDevice, const RenderPacket& packet)
+{
+	DrawInstanced(pRenderDevice, packet.pInstanceBuffer, packet.startInstance, packet.numInstances);
+}
+
+// constructor
+ChessPiece::ChessPiece(PieceType inType)
+{
+	type = inType;
+	pShader = nullptr;
+	materialId = 0;
+	pDiffuse = nullptr;
+	pSpec = nullptr;
+}
+
+// destructo
+ChessPiece::~ChessPiece()
+{
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+//
+// Model of a chess piece, one per piece type
+//
+//  BGTD 9201
+//
+
+
+
+#ifndef _CHESS_PIECE_H
+#define _CHESS_PIECE_H
+
+#include "DirectX.h"
+#include "BakedMesh.h"
+#include "LitColourShader.h"
+#include "RenderQueue.h"
+#include <d3d11_1.h>
+#include <SimpleMath.h>
+
+using namespace DirectX;
+
+class ChessPiece : public Renderable
+{
+public:
+
+	// the type picks the parts the mesh is baked from
+	explicit ChessPiece(PieceType inType);
+	~ChessPiece();
+
+	// called to initialize the object
+	void Initialize(ID3D11Device* pDevice, LitColourShader* pLitShader, float baseOffset);
+
+	// called to draw numInstances copies of the object from the instance buffer
+	void DrawInstanced(RenderDevice* pRenderDevice, DeviceBuffer* pInstanceBuffer, UINT startInstance, UINT numInstances);
+
+	// queue the instances to be drawn, viewDepth is how far the nearest one is from the camera
+	void Submit(RenderQueue& queue, ID3D11Buffer* pInstanceBuffer, UINT startInstance, UINT numInstances, float viewDepth);
+
+	// called by the queue to draw a submitted packet
+	void DrawPacket(RenderDevice* pRenderDevice, const RenderPacket& packet);
+
+	void SetTextures(ID3D11ShaderResourceView* diffuse, ID3D11ShaderResourceView* spec) {
+		pDiffuse = diffuse;
+		pSpec = spec;
+	}
+
+	// bounds of the baked mesh, for culling
+	const MeshBounds& GetBounds() const { return mesh.GetBounds(); }
+
+	void SetBaseOffset(const float inOffset) { baseOffset = inOffset; }
+	float GetBaseOffset() { return baseOffset; }
+
+	PieceType GetType() const { return type; }
+
+private:
+
+	PieceType type;
+
+	ID3D11ShaderResourceView* pDiffuse;
+	ID3D11ShaderResourceView* pSpec;
+
+	// store a copy of the shader
+	LitColourShader* pShader;
+
+	// every part of the piece baked into one mesh
+	BakedMesh mesh;
+
+	// the base, middle and top materials, shared through the material registry
+	UINT materialId;
+
+	float baseOffset;
+};
+
+#endif
\ No newline at end of file
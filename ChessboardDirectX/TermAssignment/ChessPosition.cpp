@@ -0,0 +1,814 @@
+//
+// BGTD 9201
+//	FEN, legal move generation and make/unmake for a bitboard position
+//
+
+#include "ChessPosition.h"
+#include <mutex>
+#include <sstream>
+
+using namespace Bitboards;
+
+const char* ChessPosition::START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// FEN letters of the piece types, white's in upper case
+static const char PIECE_LETTERS[NUM_PIECE_TYPES + 1] = "prnbqk";
+
+// promotions in the order of the flags' low two bits
+static const PieceType PROMOTION_TYPES[4] = { KnightPiece, BishopPiece, RookPiece, QueenPiece };
+
+// the ranks a pawn promotes on and double pushes from, by side
+static const Bitboard LAST_RANK[2] = { 0xFF00000000000000ull, 0x00000000000000FFull };
+static const Bitboard PUSH_RANK[2] = { 0x0000000000FF0000ull, 0x0000FF0000000000ull };
+
+// the squares the castling king and rook start on
+static const int E1 = 4, A1 = 0, H1 = 7, E8 = 60, A8 = 56, H8 = 63;
+
+// random numbers XORed together into a position's key, pieces are indexed by their
+// type and side as the board stores them
+static uint64_t pieceKeys[16][NUM_SQUARES];
+static uint64_t castlingKeys[16];
+static uint64_t enPassantKeys[8];
+static uint64_t sideKey;
+static std::once_flag keysFilled;
+
+// ------------------------------------------------------------------------------------
+// splitmix64, from a fixed seed so keys are the same every run
+// ------------------------------------------------------------------------------------
+static uint64_t NextKey(uint64_t& seed)
+{
+	uint64_t key = (seed += 0x9E3779B97F4A7C15ull);
+	key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+	key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+	return key ^ (key >> 31);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static void FillKeys()
+{
+	uint64_t seed = 0x9201;
+	for (int piece = 0; piece < 16; piece++)
+	{
+		for (int square = 0; square < NUM_SQUARES; square++)
+		{
+			pieceKeys[piece][square] = NextKey(seed);
+		}
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		castlingKeys[i] = NextKey(seed);
+	}
+	for (int i = 0; i < 8; i++)
+	{
+		enPassantKeys[i] = NextKey(seed);
+	}
+	sideKey = NextKey(seed);
+}
+
+// ------------------------------------------------------------------------------------
+// The rights still held after a move from or to a square, a king or rook leaving home
+// or a rook being taken there drops them
+// ------------------------------------------------------------------------------------
+static int GetCastlingKept(int square)
+{
+	switch (square)
+	{
+	case A1:	return ~WhiteQueenSide;
+	case H1:	return ~WhiteKingSide;
+	case E1:	return ~(WhiteKingSide | WhiteQueenSide);
+	case A8:	return ~BlackQueenSide;
+	case H8:	return ~BlackKingSide;
+	case E8:	return ~(BlackKingSide | BlackQueenSide);
+	default:	return ~0;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+ChessPosition::ChessPosition()
+{
+	Bitboards::Initialize();
+	std::call_once(keysFilled, FillKeys);
+	Clear();
+	SetFen(START_FEN);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void ChessPosition::Clear()
+{
+	for (int side = 0; side < 2; side++)
+	{
+		for (int type = 0; type < NUM_PIECE_TYPES; type++)
+		{
+			pieces[side][type] = 0;
+		}
+		occupied[side] = 0;
+	}
+	for (int square = 0; square < NUM_SQUARES; square++)
+	{
+		board[square] = NO_PIECE;
+	}
+	sideToMove = WhiteSide;
+	castling = 0;
+	enPassant = NO_SQUARE;
+	halfmoveClock = 0;
+	fullmoveNumber = 1;
+	key = castlingKeys[0];
+	pawnKey = 0;
+	history.clear();
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void ChessPosition::AddPiece(int square, uint8_t piece)
+{
+	Bitboard bit = SquareBit(square);
+	pieces[GetPieceSide(piece)][GetPieceType(piece)] |= bit;
+	occupied[GetPieceSide(piece)] |= bit;
+	board[square] = piece;
+
+	key ^= pieceKeys[piece][square];
+	if (GetPieceType(piece) == PawnPiece)
+	{
+		pawnKey ^= pieceKeys[piece][square];
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void ChessPosition::RemovePiece(int square)
+{
+	uint8_t piece = board[square];
+	Bitboard bit = SquareBit(square);
+	pieces[GetPieceSide(piece)][GetPieceType(piece)] ^= bit;
+	occupied[GetPieceSide(piece)] ^= bit;
+	board[square] = NO_PIECE;
+
+	key ^= pieceKeys[piece][square];
+	if (GetPieceType(piece) == PawnPiece)
+	{
+		pawnKey ^= pieceKeys[piece][square];
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void ChessPosition::MovePiece(int from, int to)
+{
+	uint8_t piece = board[from];
+	Bitboard bits = SquareBit(from) | SquareBit(to);
+	pieces[GetPieceSide(piece)][GetPieceType(piece)] ^= bits;
+	occupied[GetPieceSide(piece)] ^= bits;
+	board[from] = NO_PIECE;
+	board[to] = piece;
+
+	uint64_t change = pieceKeys[piece][from] ^ pieceKeys[piece][to];
+	key ^= change;
+	if (GetPieceType(piece) == PawnPiece)
+	{
+		pawnKey ^= change;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Placement, side, castling, en passant and the two clocks, the clocks may be left off
+// ------------------------------------------------------------------------------------
+bool ChessPosition::SetFen(const std::string& fen)
+{
+	Bitboards::Initialize();
+
+	std::istringstream fields(fen);
+	std::string placement, side, rights, passant;
+	if (!(fields >> placement >> side >> rights >> passant))
+	{
+		return false;
+	}
+	int halfmove = 0, fullmove = 1;
+	if (fields >> halfmove)
+	{
+		fields >> fullmove;
+	}
+
+	// read into a copy so a bad FEN leaves this position alone
+	ChessPosition read(*this);
+	read.Clear();
+
+	// ranks from 8 down to 1, files from a to h
+	int file = 0, rank = 7;
+	for (size_t i = 0; i < placement.size(); i++)
+	{
+		char c = placement[i];
+		if (c == '/')
+		{
+			if (file != 8 || rank == 0)
+			{
+				return false;
+			}
+			file = 0;
+			rank--;
+		}
+		else if (c >= '1' && c <= '8')
+		{
+			file += c - '0';
+		}
+		else
+		{
+			char lower = (char)(c | 0x20);
+			int type = 0;
+			while (type < NUM_PIECE_TYPES && PIECE_LETTERS[type] != lower)
+			{
+				type++;
+			}
+			if (type == NUM_PIECE_TYPES || file >= 8)
+			{
+				return false;
+			}
+			read.AddPiece(GetSquare(file, rank), MakePiece((PieceType)type, c == lower ? BlackSide : WhiteSide));
+			file++;
+		}
+		if (file > 8)
+		{
+			return false;
+		}
+	}
+	if (file != 8 || rank != 0)
+	{
+		return false;
+	}
+	if (PopCount(read.pieces[WhiteSide][KingPiece]) != 1 || PopCount(read.pieces[BlackSide][KingPiece]) != 1)
+	{
+		return false;
+	}
+
+	if (side == "w") read.sideToMove = WhiteSide;
+	else if (side == "b") read.sideToMove = BlackSide;
+	else return false;
+
+	// rights whose king or rook isn't at home are dropped
+	for (size_t i = 0; i < rights.size() && rights != "-"; i++)
+	{
+		switch (rights[i])
+		{
+		case 'K':	read.castling |= WhiteKingSide; break;
+		case 'Q':	read.castling |= WhiteQueenSide; break;
+		case 'k':	read.castling |= BlackKingSide; break;
+		case 'q':	read.castling |= BlackQueenSide; break;
+		default:	return false;
+		}
+	}
+	const int kingSquares[4] = { E1, E1, E8, E8 };
+	const int rookSquares[4] = { H1, A1, H8, A8 };
+	for (int i = 0; i < 4; i++)
+	{
+		ChessSide rightSide = i < 2 ? WhiteSide : BlackSide;
+		if (read.board[kingSquares[i]] != MakePiece(KingPiece, rightSide) || read.board[rookSquares[i]] != MakePiece(RookPiece, rightSide))
+		{
+			read.castling &= ~(1 << i);
+		}
+	}
+
+	if (passant != "-")
+	{
+		if (passant.size() != 2 || passant[0] < 'a' || passant[0] > 'h' || (passant[1] != '3' && passant[1] != '6'))
+		{
+			return false;
+		}
+		read.enPassant = GetSquare(passant[0] - 'a', passant[1] - '1');
+	}
+
+	read.halfmoveClock = halfmove < 0 ? 0 : halfmove;
+	read.fullmoveNumber = fullmove < 1 ? 1 : fullmove;
+
+	// the rights and square were set after the pieces, so the keys start from scratch
+	read.key = read.ComputeKey();
+	read.pawnKey = read.ComputePawnKey();
+
+	*this = read;
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+std::string ChessPosition::GetFen() const
+{
+	std::string fen;
+	for (int rank = 7; rank >= 0; rank--)
+	{
+		int empty = 0;
+		for (int file = 0; file < 8; file++)
+		{
+			uint8_t piece = board[GetSquare(file, rank)];
+			if (piece == NO_PIECE)
+			{
+				empty++;
+				continue;
+			}
+			if (empty > 0)
+			{
+				fen += (char)('0' + empty);
+				empty = 0;
+			}
+			char letter = PIECE_LETTERS[GetPieceType(piece)];
+			fen += GetPieceSide(piece) == WhiteSide ? (char)(letter - 0x20) : letter;
+		}
+		if (empty > 0)
+		{
+			fen += (char)('0' + empty);
+		}
+		if (rank > 0)
+		{
+			fen += '/';
+		}
+	}
+
+	fen += sideToMove == WhiteSide ? " w " : " b ";
+	if (castling == 0) fen += '-';
+	if (castling & WhiteKingSide) fen += 'K';
+	if (castling & WhiteQueenSide) fen += 'Q';
+	if (castling & BlackKingSide) fen += 'k';
+	if (castling & BlackQueenSide) fen += 'q';
+
+	if (enPassant == NO_SQUARE)
+	{
+		fen += " -";
+	}
+	else
+	{
+		fen += ' ';
+		fen += (char)('a' + GetFile(enPassant));
+		fen += (char)('1' + GetRank(enPassant));
+	}
+
+	std::ostringstream clocks;
+	clocks << ' ' << halfmoveClock << ' ' << fullmoveNumber;
+	return fen + clocks.str();
+}
+
+// ------------------------------------------------------------------------------------
+// Looking out from the square as each kind of piece finds the pieces that attack it
+// ------------------------------------------------------------------------------------
+Bitboard ChessPosition::GetAttackers(int square, ChessSide bySide, Bitboard occupiedSquares) const
+{
+	const Bitboard* theirs = pieces[bySide];
+	return (pawnAttacks[bySide ^ 1][square] & theirs[PawnPiece])
+		| (knightAttacks[square] & theirs[KnightPiece])
+		| (kingAttacks[square] & theirs[KingPiece])
+		| (GetBishopAttacks(square, occupiedSquares) & (theirs[BishopPiece] | theirs[QueenPiece]))
+		| (GetRookAttacks(square, occupiedSquares) & (theirs[RookPiece] | theirs[QueenPiece]));
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+bool ChessPosition::IsAttacked(int square, ChessSide bySide, Bitboard occupiedSquares) const
+{
+	const Bitboard* theirs = pieces[bySide];
+	return (pawnAttacks[bySide ^ 1][square] & theirs[PawnPiece])
+		|| (knightAttacks[square] & theirs[KnightPiece])
+		|| (kingAttacks[square] & theirs[KingPiece])
+		|| (GetBishopAttacks(square, occupiedSquares) & (theirs[BishopPiece] | theirs[QueenPiece]))
+		|| (GetRookAttacks(square, occupiedSquares) & (theirs[RookPiece] | theirs[QueenPiece]));
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+bool ChessPosition::IsInCheck() const
+{
+	return IsAttacked(LowestSquare(pieces[sideToMove][KingPiece]), (ChessSide)(sideToMove ^ 1), GetOccupied());
+}
+
+// ------------------------------------------------------------------------------------
+// A pawn move, as four moves when it reaches the last rank
+// ------------------------------------------------------------------------------------
+static void AddPawnMove(MoveList& list, int from, int to, int flag, Bitboard lastRank)
+{
+	if (SquareBit(to) & lastRank)
+	{
+		for (int promotion = KnightPromotion; promotion <= QueenPromotion; promotion++)
+		{
+			list.moves[list.count++] = EncodeMove(from, to, promotion | flag);
+		}
+	}
+	else
+	{
+		list.moves[list.count++] = EncodeMove(from, to, flag);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Every move is legal as it is added. In check only moves onto the checker or the
+// squares between it and the king count, and a pinned piece stays on its pin's line
+// ------------------------------------------------------------------------------------
+void ChessPosition::GenerateMoves(MoveList& list) const
+{
+	list.count = 0;
+
+	ChessSide us = sideToMove;
+	ChessSide them = (ChessSide)(us ^ 1);
+	Bitboard own = occupied[us];
+	Bitboard enemy = occupied[them];
+	Bitboard all = own | enemy;
+	int king = LowestSquare(pieces[us][KingPiece]);
+
+	// the king may not step along a slider's line away from it, so it is taken off the board
+	Bitboard withoutKing = all ^ SquareBit(king);
+	Bitboard kingTargets = kingAttacks[king] & ~own;
+	while (kingTargets)
+	{
+		int to = PopLowest(kingTargets);
+		if (!IsAttacked(to, them, withoutKing))
+		{
+			list.moves[list.count++] = EncodeMove(king, to, (enemy & SquareBit(to)) ? PieceCapture : QuietMove);
+		}
+	}
+
+	Bitboard checkers = GetAttackers(king, them, all);
+	if (PopCount(checkers) > 1)
+	{
+		return;
+	}
+	Bitboard checkMask = checkers ? (between[king][LowestSquare(checkers)] | checkers) : ~(Bitboard)0;
+
+	// an enemy slider with exactly one of our pieces between it and the king pins that piece
+	Bitboard pinned = 0;
+	Bitboard snipers = (GetRookAttacks(king, enemy) & (pieces[them][RookPiece] | pieces[them][QueenPiece]))
+		| (GetBishopAttacks(king, enemy) & (pieces[them][BishopPiece] | pieces[them][QueenPiece]));
+	while (snipers)
+	{
+		Bitboard blockers = between[king][PopLowest(snipers)] & all;
+		if ((blockers & own) && (blockers & (blockers - 1)) == 0)
+		{
+			pinned |= blockers;
+		}
+	}
+
+	// a pinned knight can never stay on its line
+	Bitboard knights = pieces[us][KnightPiece] & ~pinned;
+	while (knights)
+	{
+		int from = PopLowest(knights);
+		Bitboard targets = knightAttacks[from] & ~own & checkMask;
+		while (targets)
+		{
+			int to = PopLowest(targets);
+			list.moves[list.count++] = EncodeMove(from, to, (enemy & SquareBit(to)) ? PieceCapture : QuietMove);
+		}
+	}
+
+	Bitboard diagonals = pieces[us][BishopPiece] | pieces[us][QueenPiece];
+	Bitboard straights = pieces[us][RookPiece] | pieces[us][QueenPiece];
+	Bitboard sliders = diagonals | straights;
+	while (sliders)
+	{
+		int from = PopLowest(sliders);
+		Bitboard targets = 0;
+		if (diagonals & SquareBit(from)) targets |= GetBishopAttacks(from, all);
+		if (straights & SquareBit(from)) targets |= GetRookAttacks(from, all);
+		targets &= ~own & checkMask;
+		if (pinned & SquareBit(from))
+		{
+			targets &= lines[king][from];
+		}
+		while (targets)
+		{
+			int to = PopLowest(targets);
+			list.moves[list.count++] = EncodeMove(from, to, (enemy & SquareBit(to)) ? PieceCapture : QuietMove);
+		}
+	}
+
+	int forward = us == WhiteSide ? 8 : -8;
+	Bitboard pawns = pieces[us][PawnPiece];
+	while (pawns)
+	{
+		int from = PopLowest(pawns);
+		Bitboard allowed = checkMask;
+		if (pinned & SquareBit(from))
+		{
+			allowed &= lines[king][from];
+		}
+
+		int to = from + forward;
+		if (!(all & SquareBit(to)))
+		{
+			if (allowed & SquareBit(to))
+			{
+				AddPawnMove(list, from, to, QuietMove, LAST_RANK[us]);
+			}
+			int twoSquares = to + forward;
+			if ((SquareBit(to) & PUSH_RANK[us]) && !(all & SquareBit(twoSquares)) && (allowed & SquareBit(twoSquares)))
+			{
+				list.moves[list.count++] = EncodeMove(from, twoSquares, DoublePawnPush);
+			}
+		}
+
+		Bitboard captures = pawnAttacks[us][from] & enemy & allowed;
+		while (captures)
+		{
+			AddPawnMove(list, from, PopLowest(captures), PieceCapture, LAST_RANK[us]);
+		}
+
+		// taking en passant empties two squares on the king's lines at once, so the sliders
+		// are looked for again with both pawns gone rather than trusting the pin lines
+		if (enPassant != NO_SQUARE && (pawnAttacks[us][from] & SquareBit(enPassant)))
+		{
+			int taken = enPassant - forward;
+			Bitboard after = (all ^ SquareBit(from) ^ SquareBit(taken)) | SquareBit(enPassant);
+			bool resolvesCheck = (checkMask & (SquareBit(enPassant) | SquareBit(taken))) != 0;
+			bool exposesKing = (GetRookAttacks(king, after) & (pieces[them][RookPiece] | pieces[them][QueenPiece]))
+				|| (GetBishopAttacks(king, after) & (pieces[them][BishopPiece] | pieces[them][QueenPiece]));
+			if (resolvesCheck && !exposesKing)
+			{
+				list.moves[list.count++] = EncodeMove(from, enPassant, EnPassantCapture);
+			}
+		}
+	}
+
+	// castling, never out of check, through check or into it
+	if (checkers == 0)
+	{
+		int kingSide = us == WhiteSide ? WhiteKingSide : BlackKingSide;
+		int queenSide = us == WhiteSide ? WhiteQueenSide : BlackQueenSide;
+		int home = us == WhiteSide ? E1 : E8;
+		if ((castling & kingSide) && !(all & (SquareBit(home + 1) | SquareBit(home + 2)))
+			&& !IsAttacked(home + 1, them, all) && !IsAttacked(home + 2, them, all))
+		{
+			list.moves[list.count++] = EncodeMove(home, home + 2, KingCastle);
+		}
+		if ((castling & queenSide) && !(all & (SquareBit(home - 1) | SquareBit(home - 2) | SquareBit(home - 3)))
+			&& !IsAttacked(home - 1, them, all) && !IsAttacked(home - 2, them, all))
+		{
+			list.moves[list.count++] = EncodeMove(home, home - 2, QueenCastle);
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void ChessPosition::MakeMove(ChessMove move, MoveUndo& undo)
+{
+	int from = GetMoveFrom(move);
+	int to = GetMoveTo(move);
+	int flag = GetMoveFlag(move);
+	ChessSide us = sideToMove;
+
+	undo.captured = NO_PIECE;
+	undo.castling = (uint8_t)castling;
+	undo.enPassant = (uint8_t)enPassant;
+	undo.halfmoveClock = (uint16_t)halfmoveClock;
+	undo.key = key;
+	undo.pawnKey = pawnKey;
+
+	history.push_back(key);
+
+	halfmoveClock++;
+	if (enPassant != NO_SQUARE)
+	{
+		key ^= enPassantKeys[GetFile(enPassant)];
+	}
+	enPassant = NO_SQUARE;
+
+	// the pawn taken en passant is beside the square moved to, a rank back towards us
+	if (flag == EnPassantCapture)
+	{
+		undo.captured = board[to ^ 8];
+		RemovePiece(to ^ 8);
+	}
+	else if (flag & PieceCapture)
+	{
+		undo.captured = board[to];
+		RemovePiece(to);
+	}
+
+	if (GetPieceType(board[from]) == PawnPiece || undo.captured != NO_PIECE)
+	{
+		halfmoveClock = 0;
+	}
+	MovePiece(from, to);
+
+	if (flag & 8)
+	{
+		RemovePiece(to);
+		AddPiece(to, MakePiece(PROMOTION_TYPES[flag & 3], us));
+	}
+	else if (flag == DoublePawnPush)
+	{
+		enPassant = to ^ 8;
+		key ^= enPassantKeys[GetFile(enPassant)];
+	}
+	else if (flag == KingCastle)
+	{
+		MovePiece(to + 1, to - 1);
+	}
+	else if (flag == QueenCastle)
+	{
+		MovePiece(to - 2, to + 1);
+	}
+
+	key ^= castlingKeys[castling];
+	castling &= GetCastlingKept(from) & GetCastlingKept(to);
+	key ^= castlingKeys[castling] ^ sideKey;
+	if (us == BlackSide)
+	{
+		fullmoveNumber++;
+	}
+	sideToMove = (ChessSide)(us ^ 1);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void ChessPosition::UnmakeMove(ChessMove move, const MoveUndo& undo)
+{
+	int from = GetMoveFrom(move);
+	int to = GetMoveTo(move);
+	int flag = GetMoveFlag(move);
+	ChessSide us = (ChessSide)(sideToMove ^ 1);
+	sideToMove = us;
+	if (us == BlackSide)
+	{
+		fullmoveNumber--;
+	}
+
+	if (flag & 8)
+	{
+		RemovePiece(to);
+		AddPiece(to, MakePiece(PawnPiece, us));
+	}
+	else if (flag == KingCastle)
+	{
+		MovePiece(to - 1, to + 1);
+	}
+	else if (flag == QueenCastle)
+	{
+		MovePiece(to + 1, to - 2);
+	}
+	MovePiece(to, from);
+
+	if (flag == EnPassantCapture)
+	{
+		AddPiece(to ^ 8, undo.captured);
+	}
+	else if (undo.captured != NO_PIECE)
+	{
+		AddPiece(to, undo.captured);
+	}
+
+	castling = undo.castling;
+	enPassant = undo.enPassant;
+	halfmoveClock = undo.halfmoveClock;
+
+	// the pieces put back moved the keys too, but the ones from before are to hand
+	key = undo.key;
+	pawnKey = undo.pawnKey;
+	history.pop_back();
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+uint64_t ChessPosition::ComputeKey() const
+{
+	uint64_t computed = castlingKeys[castling];
+	if (enPassant != NO_SQUARE)
+	{
+		computed ^= enPassantKeys[GetFile(enPassant)];
+	}
+	if (sideToMove == BlackSide)
+	{
+		computed ^= sideKey;
+	}
+
+	Bitboard remaining = GetOccupied();
+	while (remaining)
+	{
+		int square = PopLowest(remaining);
+		computed ^= pieceKeys[board[square]][square];
+	}
+	return computed;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+uint64_t ChessPosition::ComputePawnKey() const
+{
+	uint64_t computed = 0;
+	Bitboard remaining = pieces[WhiteSide][PawnPiece] | pieces[BlackSide][PawnPiece];
+	while (remaining)
+	{
+		int square = PopLowest(remaining);
+		computed ^= pieceKeys[board[square]][square];
+	}
+	return computed;
+}
+
+// ------------------------------------------------------------------------------------
+// Only positions with the same side to move can match, so every other key back is
+// compared, as far as the last capture or pawn move or the start of the history
+// ------------------------------------------------------------------------------------
+int ChessPosition::GetRepetitions() const
+{
+	int historyLength = (int)history.size();
+	int window = halfmoveClock < historyLength ? halfmoveClock : historyLength;
+	window = window < REPETITION_WINDOW ? window : REPETITION_WINDOW;
+
+	int repetitions = 0;
+	for (int back = 4; back <= window; back += 2)
+	{
+		if (history[historyLength - back] == key)
+		{
+			repetitions++;
+		}
+	}
+	return repetitions;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+uint64_t ChessPosition::Perft(int depth)
+{
+	if (depth <= 0)
+	{
+		return 1;
+	}
+
+	MoveList list;
+	GenerateMoves(list);
+	if (depth == 1)
+	{
+		return (uint64_t)list.count;
+	}
+
+	uint64_t nodes = 0;
+	MoveUndo undo;
+	for (int i = 0; i < list.count; i++)
+	{
+		MakeMove(list.moves[i], undo);
+		nodes += Perft(depth - 1);
+		UnmakeMove(list.moves[i], undo);
+	}
+	return nodes;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+std::string ChessPosition::GetMoveText(ChessMove move)
+{
+	std::string text;
+	text += (char)('a' + GetFile(GetMoveFrom(move)));
+	text += (char)('1' + GetRank(GetMoveFrom(move)));
+	text += (char)('a' + GetFile(GetMoveTo(move)));
+	text += (char)('1' + GetRank(GetMoveTo(move)));
+	if (IsPromotion(move))
+	{
+		text += PIECE_LETTERS[PROMOTION_TYPES[GetMoveFlag(move) & 3]];
+	}
+	return text;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+ChessMove ChessPosition::FindMove(const std::string& text) const
+{
+	MoveList list;
+	GenerateMoves(list);
+	for (int i = 0; i < list.count; i++)
+	{
+		if (GetMoveText(list.moves[i]) == text)
+		{
+			return list.moves[i];
+		}
+	}
+	return NO_MOVE;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+bool ChessPosition::IsLegal(ChessMove move) const
+{
+	MoveList list;
+	GenerateMoves(list);
+	for (int i = 0; i < list.count; i++)
+	{
+		if (list.moves[i] == move)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+ChessMove ChessPosition::FindMove(int from, int to) const
+{
+	MoveList list;
+	GenerateMoves(list);
+	for (int i = 0; i < list.count; i++)
+	{
+		ChessMove move = list.moves[i];
+		if (GetMoveFrom(move) == from && GetMoveTo(move) == to && (!IsPromotion(move) || (GetMoveFlag(move) & 3) == 3))
+		{
+			return move;
+		}
+	}
+	return NO_MOVE;
+}
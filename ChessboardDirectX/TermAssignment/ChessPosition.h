@@ -0,0 +1,199 @@
+//
+// BGTD 9201
+//	The state of a game of chess: a bitboard per side and piece type, the
+//	side to move, castling rights, the en passant square and the clocks.
+//	Reads and writes FEN, generates only legal moves, using the squares
+//	between the king and its checker and the lines of pinned pieces, and
+//	makes and unmakes moves in place. Its Zobrist key and a key of just the
+//	pawns are kept up to date as pieces move, and the keys of the positions
+//	since the last capture or pawn move are kept for finding repetitions
+//
+
+#ifndef _CHESS_POSITION_H
+#define _CHESS_POSITION_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Bitboard.h"
+
+// the kinds of pieces
+enum PieceType
+{
+	PawnPiece,
+	RookPiece,
+	KnightPiece,
+	BishopPiece,
+	QueenPiece,
+	KingPiece,
+
+	NUM_PIECE_TYPES
+};
+
+enum ChessSide
+{
+	WhiteSide,
+	BlackSide
+};
+
+// bits of the castling rights
+enum CastlingRight
+{
+	WhiteKingSide = 1,
+	WhiteQueenSide = 2,
+	BlackKingSide = 4,
+	BlackQueenSide = 8
+};
+
+// a move is its from square, its to square and one of these in the top four bits
+enum MoveFlag
+{
+	QuietMove = 0,
+	DoublePawnPush = 1,
+	KingCastle = 2,
+	QueenCastle = 3,
+	PieceCapture = 4,
+	EnPassantCapture = 5,
+	KnightPromotion = 8,
+	BishopPromotion = 9,
+	RookPromotion = 10,
+	QueenPromotion = 11,
+
+	// a promotion that captures is one of the four above with this added
+	PromotionCapture = 4
+};
+
+typedef uint16_t ChessMove;
+const ChessMove NO_MOVE = 0;
+
+inline ChessMove EncodeMove(int from, int to, int flag) { return (ChessMove)(from | (to << 6) | (flag << 12)); }
+inline int GetMoveFrom(ChessMove move) { return move & 63; }
+inline int GetMoveTo(ChessMove move) { return (move >> 6) & 63; }
+inline int GetMoveFlag(ChessMove move) { return move >> 12; }
+inline bool IsCapture(ChessMove move) { return (GetMoveFlag(move) & 4) != 0; }
+inline bool IsPromotion(ChessMove move) { return (GetMoveFlag(move) & 8) != 0; }
+
+// the longest list of legal moves any position has is 218
+struct MoveList
+{
+	static const int MAX_MOVES = 256;
+
+	ChessMove moves[MAX_MOVES];
+	int count;
+};
+
+// what MakeMove can't work out backwards
+struct MoveUndo
+{
+	uint8_t captured;			// the piece taken, NO_PIECE if none
+	uint8_t castling;
+	uint8_t enPassant;
+	uint16_t halfmoveClock;
+	uint64_t key;
+	uint64_t pawnKey;
+};
+
+class ChessPosition
+{
+public:
+	// the starting position
+	ChessPosition();
+
+	static const char* START_FEN;
+
+	// a piece on the board is its type and its side in bit 3, NO_PIECE for an empty square
+	static const uint8_t NO_PIECE = 0xFF;
+	static uint8_t MakePiece(PieceType type, ChessSide side) { return (uint8_t)(type | (side << 3)); }
+	static PieceType GetPieceType(uint8_t piece) { return (PieceType)(piece & 7); }
+	static ChessSide GetPieceSide(uint8_t piece) { return (ChessSide)(piece >> 3); }
+
+	// false, leaving the position as it was, if the FEN can't be read
+	bool SetFen(const std::string& fen);
+	std::string GetFen() const;
+
+	uint8_t GetPiece(int square) const { return board[square]; }
+	Bitboard GetPieces(ChessSide side, PieceType type) const { return pieces[side][type]; }
+	Bitboard GetOccupied(ChessSide side) const { return occupied[side]; }
+	Bitboard GetOccupied() const { return occupied[WhiteSide] | occupied[BlackSide]; }
+
+	ChessSide GetSideToMove() const { return sideToMove; }
+	int GetCastlingRights() const { return castling; }
+	int GetEnPassantSquare() const { return enPassant; }
+	int GetHalfmoveClock() const { return halfmoveClock; }
+	int GetFullmoveNumber() const { return fullmoveNumber; }
+
+	bool IsInCheck() const;
+
+	// a 64 bit hash of the pieces, side to move, castling rights and en passant square,
+	// and one of only the pawns of both sides. Kept as moves are made, so free to read
+	uint64_t GetKey() const { return key; }
+	uint64_t GetPawnKey() const { return pawnKey; }
+
+	// the same worked out from scratch with a pass over the pieces, to check them against
+	uint64_t ComputeKey() const;
+	uint64_t ComputePawnKey() const;
+
+	// times this position has been seen before, looking back no further than the last
+	// capture or pawn move since nothing before it can come round again
+	int GetRepetitions() const;
+
+	// threefold repetition, or a hundred plies without a capture or pawn move. Mate on
+	// the hundredth ply still wins, the caller checks for it first
+	bool IsDraw() const { return halfmoveClock >= 100 || GetRepetitions() >= 2; }
+
+	// every legal move of the side to move
+	void GenerateMoves(MoveList& list) const;
+
+	// play a legal move and take it back, undo keeps what is needed to take it back
+	void MakeMove(ChessMove move, MoveUndo& undo);
+	void UnmakeMove(ChessMove move, const MoveUndo& undo);
+
+	// whether move is one GenerateMoves would list
+	bool IsLegal(ChessMove move) const;
+
+	// leaf nodes of the legal move tree depth plies deep, the last ply is counted, not played
+	uint64_t Perft(int depth);
+
+	// long algebraic, e2e4 or e7e8q, and the legal move it names or NO_MOVE
+	static std::string GetMoveText(ChessMove move);
+	ChessMove FindMove(const std::string& text) const;
+
+	// the legal move from one square to another, promoting to a queen, NO_MOVE if there isn't one
+	ChessMove FindMove(int from, int to) const;
+
+private:
+
+	// whether side attacks square, with the board's pieces in occupiedSquares
+	bool IsAttacked(int square, ChessSide bySide, Bitboard occupiedSquares) const;
+
+	// the pieces of bySide that attack square
+	Bitboard GetAttackers(int square, ChessSide bySide, Bitboard occupiedSquares) const;
+
+	void AddPiece(int square, uint8_t piece);
+	void RemovePiece(int square);
+	void MovePiece(int from, int to);
+
+	void Clear();
+
+	Bitboard pieces[2][NUM_PIECE_TYPES];
+	Bitboard occupied[2];
+	uint8_t board[NUM_SQUARES];
+
+	ChessSide sideToMove;
+	int castling;
+	int enPassant;
+	int halfmoveClock;
+	int fullmoveNumber;
+
+	uint64_t key;
+	uint64_t pawnKey;
+
+	// keys of the positions before this one, the latest last. It grows with every move made,
+	// but a hundred plies without a capture or pawn move is a draw anyway, so the repetition
+	// scan never looks further back than this
+	static const int REPETITION_WINDOW = 128;
+	std::vector<uint64_t> history;
+};
+
+#endif
@@ -0,0 +1,326 @@
+//
+// BGTD 9201
+//	The orbiting camera, the animated pawn and the pieces on the board
+//
+
+#include "ChessScene.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+const float ChessScene::NEAR_PLANE = 1;
+const float ChessScene::FAR_PLANE = 128;
+
+const float ChessScene::PIECE_MOVE_TIME = 0.6f;
+
+// how long one movement takes
+static const float MOVEMENT_TIME_IN_SECONDS = 3.0f;
+
+// every piece and every piece it can capture moving at once
+static const UINT MAX_MOVES = 64;
+
+// the square a captured piece is put on while it fades
+static const int CAPTURED_SQUARE = -1;
+
+// how high a knight jumps, in squares
+static const float KNIGHT_JUMP_HEIGHT = 1.5f;
+
+//----------------------------------------------------------------------------------------------
+// Where a piece on a square stands
+//----------------------------------------------------------------------------------------------
+static XMFLOAT3 GetSquarePosition(int x, int y)
+{
+	XMFLOAT3 position;
+	XMStoreFloat3(&position, ChessSet::GetBoardPosition(x, y, ChessSet::PIECE_BASE_OFFSET).r[3]);
+	return position;
+}
+
+//----------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------
+ChessScene::ChessScene() : moves(MAX_MOVES)
+{
+	cameraPos = XMFLOAT3(0, 0, 6);
+
+	cameraRadius = 32;
+	cameraRadiusSpeed = 0;
+
+	cameraRotation = XMFLOAT2(0, XM_PI / 10.0f);
+	cameraRotationSpeed = XMFLOAT2(0, 0);
+
+	// the pawn's slide, decomposed once here instead of every frame
+	XMFLOAT4X4 startMatrix, endMatrix;
+	XMStoreFloat4x4(&startMatrix, XMMatrixRotationZ(45.0f * XM_PI / 180.0f) * XMMatrixTranslation(-12.0f, 0, 0));
+	XMStoreFloat4x4(&endMatrix, XMMatrixRotationZ(-45.0f * XM_PI / 180.0f) * XMMatrixTranslation(12.0f, 0, 0));
+
+	AnimationClip slide;
+	slide.AddKey(0, startMatrix);
+	slide.AddKey(MOVEMENT_TIME_IN_SECONDS, endMatrix);
+	pawnClip = animator.AddClip(slide);
+
+	Reset();
+}
+
+//----------------------------------------------------------------------------------------------
+// Every piece on its starting square and the pawn back at the start of its slide
+//----------------------------------------------------------------------------------------------
+void ChessScene::Reset()
+{
+	runTime = 0;
+
+	// back and forth between the ends of the slide
+	animator.Clear();
+	pawnTrack = animator.Play(pawnClip, PieceAnimator::NO_TRANSFORM, 0, PlayPingPong);
+	animator.Evaluate(0);
+
+	moves.Clear();
+	capturedPieces.reserve(MAX_MOVES);
+	position.SetFen(ChessPosition::START_FEN);
+	ChessSet::GetPlacements(position, placements);
+	selectedPiece = NO_PIECE;
+}
+
+//----------------------------------------------------------------------------------------------
+//	deltaTime: how much time in seconds has elapsed since the last frame
+//----------------------------------------------------------------------------------------------
+void ChessScene::Update(float deltaTime)
+{
+	runTime += deltaTime;
+
+	// pose the pawn, and anything else playing, for the new time
+	animator.Evaluate(runTime);
+
+	// captured pieces go once they have faded, from the back so the indices still hold
+	moves.Update(runTime);
+	capturedPieces.clear();
+	for (UINT i = 0; i < moves.GetFinishedCount(); i++)
+	{
+		if (moves.GetFinished(i).style == CaptureMove)
+		{
+			capturedPieces.push_back(moves.GetFinished(i).target);
+		}
+	}
+	std::sort(capturedPieces.begin(), capturedPieces.end());
+	for (size_t i = capturedPieces.size(); i-- > 0;)
+	{
+		placements.erase(placements.begin() + capturedPieces[i]);
+		moves.RemoveTarget(capturedPieces[i]);
+		if (selectedPiece != NO_PIECE && selectedPiece > capturedPieces[i])
+		{
+			selectedPiece--;
+		}
+	}
+
+	// update the camera movement
+	UpdateCamera(deltaTime);
+}
+
+//----------------------------------------------------------------------------------------------
+// The move from a piece's square to another, if the rules allow it
+//----------------------------------------------------------------------------------------------
+bool ChessScene::MovePiece(size_t piece, int x, int y)
+{
+	if (piece >= placements.size() || placements[piece].x == CAPTURED_SQUARE)
+	{
+		OutputDebugString(L"Moving a piece that isn't on the board");
+		assert(0);
+		return false;
+	}
+
+	int from = ChessSet::GetPositionSquare(placements[piece].x, placements[piece].y);
+	int to = ChessSet::GetPositionSquare(x, y);
+	ChessMove move = position.FindMove(from, to);
+	if (move == NO_MOVE)
+	{
+		return false;
+	}
+	return PlayMove(move);
+}
+
+//----------------------------------------------------------------------------------------------
+// Animate the move's pieces and play it on the position
+//----------------------------------------------------------------------------------------------
+bool ChessScene::PlayMove(ChessMove move)
+{
+	if (!position.IsLegal(move))
+	{
+		return false;
+	}
+
+	int fromX, fromY, toX, toY;
+	ChessSet::GetBoardSquare(GetMoveFrom(move), fromX, fromY);
+	ChessSet::GetBoardSquare(GetMoveTo(move), toX, toY);
+	size_t piece = FindPlacement(fromX, fromY);
+	if (piece == NO_PIECE)
+	{
+		OutputDebugString(L"The placements don't match the position");
+		assert(0);
+		return false;
+	}
+
+	// en passant takes the pawn beside the one moving, not the one on its square
+	int flag = GetMoveFlag(move);
+	if (IsCapture(move))
+	{
+		size_t captured = flag == EnPassantCapture ? FindPlacement(toX, fromY) : FindPlacement(toX, toY);
+		if (captured != NO_PIECE)
+		{
+			CapturePiece(captured);
+		}
+	}
+
+	// the rook comes round the king
+	if (flag == KingCastle || flag == QueenCastle)
+	{
+		int rookX = flag == KingCastle ? ChessSet::BOARD_SIZE - 1 : 0;
+		size_t rook = FindPlacement(rookX, fromY);
+		if (rook != NO_PIECE)
+		{
+			SendPiece(rook, flag == KingCastle ? toX - 1 : toX + 1, fromY);
+		}
+	}
+
+	SendPiece(piece, toX, toY);
+
+	// knight, bishop, rook and queen promotions are 8 to 11
+	static const PieceType PROMOTIONS[] = { KnightPiece, BishopPiece, RookPiece, QueenPiece };
+	if (IsPromotion(move))
+	{
+		placements[piece].type = PROMOTIONS[flag & 3];
+	}
+
+	MoveUndo undo;
+	position.MakeMove(move, undo);
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------
+size_t ChessScene::FindPlacement(int x, int y) const
+{
+	for (size_t i = 0; i < placements.size(); i++)
+	{
+		if (placements[i].x == x && placements[i].y == y)
+		{
+			return i;
+		}
+	}
+	return NO_PIECE;
+}
+
+//----------------------------------------------------------------------------------------------
+// A taken piece sinks out of the way, it leaves the placements when it's gone
+//----------------------------------------------------------------------------------------------
+void ChessScene::CapturePiece(size_t piece)
+{
+	PiecePlacement& placement = placements[piece];
+
+	PieceMove move;
+	move.style = CaptureMove;
+	move.target = (UINT)piece;
+	move.from = move.to = GetSquarePosition(placement.x, placement.y);
+	move.to.y -= ChessSet::PIECE_BASE_OFFSET;
+	move.fromYaw = move.toYaw = placement.rotationY;
+	move.startTime = runTime;
+	move.duration = PIECE_MOVE_TIME;
+	move.easing = EaseInEasing;
+	move.arcHeight = 0;
+	moves.Start(move);
+
+	placement.x = placement.y = CAPTURED_SQUARE;
+	if (selectedPiece == piece)
+	{
+		selectedPiece = NO_PIECE;
+	}
+}
+
+//----------------------------------------------------------------------------------------------
+// Slide a piece to a square, knights jump. The placement moves straight away, the move
+// only shows it getting there
+//----------------------------------------------------------------------------------------------
+void ChessScene::SendPiece(size_t piece, int x, int y)
+{
+	PiecePlacement& placement = placements[piece];
+
+	// a piece still on its way starts again from where it was headed
+	moves.CancelTarget((UINT)piece);
+
+	// longer moves take longer, up to PIECE_MOVE_TIME for the whole board
+	float dx = (float)(x - placement.x);
+	float dy = (float)(y - placement.y);
+	float squares = sqrtf(dx * dx + dy * dy);
+
+	PieceMove move;
+	move.style = placement.type == KnightPiece ? ArcMove : SlideMove;
+	move.target = (UINT)piece;
+	move.from = GetSquarePosition(placement.x, placement.y);
+	move.to = GetSquarePosition(x, y);
+	move.fromYaw = move.toYaw = placement.rotationY;
+	move.startTime = runTime;
+	move.duration = PIECE_MOVE_TIME * (0.5f + 0.5f * squares / ChessSet::BOARD_SIZE);
+	move.easing = EaseInOutEasing;
+	move.arcHeight = KNIGHT_JUMP_HEIGHT * ChessSet::GRID_SCALE;
+	moves.Start(move);
+
+	placement.x = x;
+	placement.y = y;
+}
+
+//----------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------
+void ChessScene::SelectPiece(size_t piece)
+{
+	if (piece < placements.size() && placements[piece].x != CAPTURED_SQUARE)
+	{
+		selectedPiece = piece;
+	}
+	else
+	{
+		selectedPiece = NO_PIECE;
+	}
+}
+
+//----------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------
+void ChessScene::ResetCamera()
+{
+	cameraRotation = XMFLOAT2(0, 0);
+	cameraRadius = 6;
+}
+
+//----------------------------------------------------------------------------------------------
+// Computes the view and camera matrix
+//----------------------------------------------------------------------------------------------
+void ChessScene::ComputeViewProjection(float aspectRatio, XMFLOAT4X4& view, XMFLOAT4X4& projection) const
+{
+	XMStoreFloat4x4(&view, XMMatrixLookAtRH(XMLoadFloat3(&cameraPos), XMVectorZero(), XMVectorSet(0, 1, 0, 0)));
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovRH(60.0f * XM_PI / 180.0f, aspectRatio, NEAR_PLANE, FAR_PLANE));
+}
+
+//----------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------
+void ChessScene::UpdateCamera(float deltaTime)
+{
+	const float VERT_LIMIT = XM_PI * 0.35f;
+
+	// update the radius
+	cameraRadius += cameraRadiusSpeed * deltaTime;
+	if (cameraRadius < 1) cameraRadius = 1;
+
+	// update the rotation amounts
+	cameraRotation.x += cameraRotationSpeed.x * deltaTime;
+	cameraRotation.y += cameraRotationSpeed.y * deltaTime;
+
+	// clamp the vertical rotation
+	if (cameraRotation.y < -VERT_LIMIT) cameraRotation.y = -VERT_LIMIT;
+	else if (cameraRotation.y > VERT_LIMIT) cameraRotation.y = VERT_LIMIT;
+
+	// calculate the height
+	cameraPos.y = cameraRadius * sinf(cameraRotation.y);
+	float r = cameraRadius * cosf(cameraRotation.y);
+
+	// calculate the orbit
+	cameraPos.x = sinf(cameraRotation.x) * r;
+	cameraPos.z = cosf(cameraRotation.x) * r;
+}
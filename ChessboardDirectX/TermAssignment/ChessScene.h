@@ -0,0 +1,112 @@
+//
+// BGTD 9201
+//	The orbiting camera, the animated pawn and the pieces on the board,
+//	kept to DirectXMath so the scene can be updated without a window or a
+//	device
+//
+
+#ifndef _CHESS_SCENE_H
+#define _CHESS_SCENE_H
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "ChessSet.h"
+#include "PieceAnimator.h"
+#include "MoveScheduler.h"
+
+class ChessScene
+{
+public:
+	ChessScene();
+
+	// the projection's planes, draw depths are sorted over the same range
+	static const float NEAR_PLANE;
+	static const float FAR_PLANE;
+
+	// put every piece back where it starts a game
+	void Reset();
+
+	// move the camera and the pawn on by deltaTime seconds
+	void Update(float deltaTime);
+
+	// how fast the camera orbits, tilts and zooms, per second
+	void SetOrbitSpeed(float speed) { cameraRotationSpeed.x = speed; }
+	void SetTiltSpeed(float speed) { cameraRotationSpeed.y = speed; }
+	void SetZoomSpeed(float speed) { cameraRadiusSpeed = speed; }
+
+	// looking straight at the board from up close
+	void ResetCamera();
+
+	// camera matrices for a viewport of this width / height
+	void ComputeViewProjection(float aspectRatio, DirectX::XMFLOAT4X4& view, DirectX::XMFLOAT4X4& projection) const;
+
+	const DirectX::XMFLOAT3& GetCameraPosition() const { return cameraPos; }
+	const DirectX::XMFLOAT2& GetCameraRotation() const { return cameraRotation; }
+	float GetCameraRadius() const { return cameraRadius; }
+	float GetRunTime() const { return runTime; }
+
+	// the pawn sliding between its two end matrices
+	const DirectX::XMFLOAT4X4& GetPawnMatrix() const { return animator.GetMatrix(pawnTrack); }
+
+	// the piece on every occupied square
+	const std::vector<PiecePlacement>& GetPlacements() const { return placements; }
+
+	// the game the placements show
+	const ChessPosition& GetPosition() const { return position; }
+
+	// send a piece to a square if that's a legal move, knights jump and pawns reaching the
+	// last rank become queens. A piece taken fades out and leaves the placements when its
+	// move ends. False, moving nothing, if the move isn't legal
+	bool MovePiece(size_t piece, int x, int y);
+
+	// play a legal move of the position's side to move, false if it isn't one
+	bool PlayMove(ChessMove move);
+
+	// the piece clicked on to be moved next, NO_PIECE for none. Captured pieces can't be
+	// picked and the selection follows a piece as captures leave the placements
+	static const size_t NO_PIECE = (size_t)-1;
+	void SelectPiece(size_t piece);
+	size_t GetSelectedPiece() const { return selectedPiece; }
+
+	// moves still playing, their poses go over the placements' matrices
+	const MoveScheduler& GetMoves() const { return moves; }
+
+	// how long a piece takes to cross the board
+	static const float PIECE_MOVE_TIME;
+
+private:
+
+	void UpdateCamera(float deltaTime);
+
+	// the placement on a board square, NO_PIECE if it's empty
+	size_t FindPlacement(int x, int y) const;
+
+	// start a piece towards a square, or sinking out of the board
+	void SendPiece(size_t piece, int x, int y);
+	void CapturePiece(size_t piece);
+
+	float runTime;
+
+	ChessPosition position;
+	std::vector<PiecePlacement> placements;
+	size_t selectedPiece;
+
+	// a captured piece stays until it has faded, off the board so nothing lands on it
+	MoveScheduler moves;
+	std::vector<UINT> capturedPieces;
+
+	// the pawn's slide
+	PieceAnimator animator;
+	UINT pawnClip;
+	UINT pawnTrack;
+
+	// for camera controls
+	DirectX::XMFLOAT3 cameraPos;
+	DirectX::XMFLOAT2 cameraRotationSpeed;
+	DirectX::XMFLOAT2 cameraRotation;
+	float cameraRadius;
+	float cameraRadiusSpeed;
+};
+
+#endif
@@ -0,0 +1,360 @@
+//
+// BGTD 9201
+//	The parts of every piece, the board squares and the starting layout
+//
+
+#include "ChessSet.h"
+#include <cmath>
+
+using namespace DirectX;
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+BakedParts::BakedParts()
+{
+	numParts = 0;
+	bounds.boxMin = bounds.boxMax = bounds.sphereCenter = XMFLOAT3(0, 0, 0);
+	bounds.sphereRadius = 0;
+}
+
+namespace ChessSet
+{
+	// ------------------------------------------------------------------------------------
+	// Add a part at the default size and tessellation
+	// ------------------------------------------------------------------------------------
+	static void AddPart(std::vector<PiecePart>& parts, ModelType type, FXMMATRIX partMatrix, PieceMaterial material)
+	{
+		PiecePart part;
+		part.type = type;
+		XMStoreFloat4x4(&part.partMatrix, partMatrix);
+		part.material = material;
+		parts.push_back(part);
+	}
+
+	// ------------------------------------------------------------------------------------
+	// The primitives a piece is built from
+	// ------------------------------------------------------------------------------------
+	void GetPieceParts(PieceType type, std::vector<PiecePart>& parts)
+	{
+		parts.clear();
+
+		switch (type)
+		{
+			case PawnPiece:
+				AddPart(parts, Cylinder, XMMatrixScaling(2.5f, 0.5f, 2.5f) * XMMatrixTranslation(0, -1.5f, 0), BaseMaterial);
+				AddPart(parts, Cylinder, XMMatrixScaling(1, 2.5f, 1), MiddleMaterial);
+				AddPart(parts, Sphere, XMMatrixScaling(1.5f, 1.5f, 1.5f) * XMMatrixTranslation(0, 1.75f, 0), TopMaterial);
+				break;
+
+			case RookPiece:
+				// this is all taken from my assignment 5
+				AddPart(parts, Cylinder, XMMatrixScaling(2.15f, 0.25f, 1.75f) * XMMatrixTranslation(0, -1, 0), BaseMaterial);
+				AddPart(parts, Cylinder, XMMatrixScaling(1.85f, 0.25f, 1.65f) * XMMatrixTranslation(0, -1.25f, 0), BaseMaterial);
+				AddPart(parts, Cylinder, XMMatrixScaling(2.0f, 0.25f, 1.75f) * XMMatrixTranslation(0, -1.5f, 0), BaseMaterial);
+
+				AddPart(parts, Cylinder, XMMatrixScaling(1.5f, 4.0f, 1.5f) * XMMatrixTranslation(0, 1, 0), MiddleMaterial);
+
+				AddPart(parts, Cylinder, XMMatrixScaling(1.75f, 0.25f, 1.75f) * XMMatrixTranslation(0, 2.60f, 0), TopMaterial);
+				AddPart(parts, Cylinder, XMMatrixScaling(1.65f, 0.25f, 1.65f) * XMMatrixTranslation(0, 2.75f, 0), TopMaterial);
+				AddPart(parts, Cylinder, XMMatrixScaling(1.75f, 0.25f, 1.75f) * XMMatrixTranslation(0, 3, 0), TopMaterial);
+
+				// crown part
+				AddPart(parts, Cylinder, XMMatrixScaling(0.6f, 0.25f, 0.25f) * XMMatrixRotationY(90 * XM_PI / 180) * XMMatrixTranslation(0.75f, 3.25f, 0.0f), TopMaterial); // right
+				AddPart(parts, Cylinder, XMMatrixScaling(0.6f, 0.25f, 0.25f) * XMMatrixTranslation(0, 3.25f, -0.75f), TopMaterial); // top
+				AddPart(parts, Cylinder, XMMatrixScaling(0.6f, 0.25f, 0.25f) * XMMatrixTranslation(0, 3.25f, 0.75f), TopMaterial); // bottom
+				AddPart(parts, Cylinder, XMMatrixScaling(0.6f, 0.25f, 0.25f) * XMMatrixRotationY(90 * XM_PI / 180) * XMMatrixTranslation(-0.75f, 3.25f, 0), TopMaterial); // left
+				break;
+
+			case KnightPiece:
+				// base
+				AddPart(parts, Cylinder, XMMatrixScaling(2.5f, 0.5f, 2.5f) * XMMatrixTranslation(0, -1.5f, 0), BaseMaterial);
+
+				// middle
+				AddPart(parts, Cube, XMMatrixScaling(1.2f, 2.5f, 1.2f) * XMMatrixRotationX(35) * XMMatrixTranslation(0, 0, 0.5f), MiddleMaterial);
+				AddPart(parts, Cube, XMMatrixScaling(1, 2, 1) * XMMatrixTranslation(0, 2, 1), MiddleMaterial);
+				AddPart(parts, Cube, XMMatrixScaling(1, 1, 1.25f) * XMMatrixTranslation(0, 2.5f, 0), MiddleMaterial);
+
+				// top part for ears of knight piece
+				AddPart(parts, Cube, XMMatrixScaling(0.25f, 1, 0.25f) * XMMatrixTranslation(0.5f, 3.4f, 1), TopMaterial); // left ear
+				AddPart(parts, Cube, XMMatrixScaling(0.25f, 1, 0.25f) * XMMatrixTranslation(-0.5f, 3.4f, 1), TopMaterial); // right ear
+				break;
+
+			case BishopPiece:
+				AddPart(parts, Cylinder, XMMatrixScaling(2.5f, 0.5f, 2.5f) * XMMatrixTranslation(0, -1.5f, 0), BaseMaterial);
+
+				AddPart(parts, Cylinder, XMMatrixScaling(1, 3, 1), MiddleMaterial);
+				AddPart(parts, Cylinder, XMMatrixScaling(2, 0.2f, 2) * XMMatrixTranslation(0, 1.5f, 0), MiddleMaterial);
+				AddPart(parts, Cylinder, XMMatrixScaling(1, 0.3f, 1) * XMMatrixTranslation(0, 1.75f, 0), MiddleMaterial);
+
+				AddPart(parts, Sphere, XMMatrixScaling(1.5f, 2.5f, 1.5f) * XMMatrixTranslation(0, 2.75f, 0), TopMaterial);
+				AddPart(parts, Sphere, XMMatrixScaling(0.75f, 0.75f, 0.75f) * XMMatrixTranslation(0, 4, 0), TopMaterial);
+				break;
+
+			case QueenPiece:
+			{
+				// base of the queen
+				AddPart(parts, Cylinder, XMMatrixScaling(2.5f, 0.5f, 2.5f) * XMMatrixTranslation(0, -1.5f, 0), BaseMaterial);
+
+				// middle parts
+				AddPart(parts, Cylinder, XMMatrixScaling(1, 3, 1), MiddleMaterial);
+				AddPart(parts, Cylinder, XMMatrixScaling(2, 0.2f, 2) * XMMatrixTranslation(0, 1.5f, 0), MiddleMaterial);
+				AddPart(parts, Cylinder, XMMatrixScaling(1, 0.3f, 1) * XMMatrixTranslation(0, 1.75f, 0), MiddleMaterial);
+				AddPart(parts, Cylinder, XMMatrixScaling(1.8f, 2, 1.8f) * XMMatrixTranslation(0, 2.5f, 0), MiddleMaterial);
+
+				// crown for the top of the head
+				const float radius = 0.9f; // radius for the crown to fit on the piece's head
+				const int crownParts = 12;
+
+				// loop for the spheres to become a perfect circle
+				for (int i = 0; i < crownParts; i++)
+				{
+					float angle = i / static_cast<float>(crownParts) * 2 * XM_PI; // calculate angle in radians
+					float x = radius * cos(angle);
+					float z = radius * sin(angle);
+
+					AddPart(parts, Sphere, XMMatrixScaling(0.4f, 0.4f, 0.4f) * XMMatrixTranslation(x, 3.5f, z), TopMaterial);
+				}
+				// top of the head piece
+				AddPart(parts, Sphere, XMMatrixScaling(0.75f, 0.75f, 0.75f) * XMMatrixTranslation(0, 3.75f, 0), TopMaterial);
+				break;
+			}
+
+			case KingPiece:
+				// base
+				AddPart(parts, Cylinder, XMMatrixScaling(2.5f, 0.5f, 2.5f) * XMMatrixTranslation(0, -1.5f, 0), BaseMaterial);
+
+				// middle parts
+				AddPart(parts, Cylinder, XMMatrixScaling(1, 3.5f, 1), MiddleMaterial);
+				AddPart(parts, Cylinder, XMMatrixScaling(2, 0.2f, 2) * XMMatrixTranslation(0, 1.7f, 0), MiddleMaterial);
+				AddPart(parts, Cylinder, XMMatrixScaling(1, 0.3f, 1) * XMMatrixTranslation(0, 2.5f, 0), MiddleMaterial);
+
+				// crown pieces
+				AddPart(parts, Cube, XMMatrixScaling(0.25f, 1, 0.25f) * XMMatrixRotationZ(90 - 22.5f) * XMMatrixTranslation(0, 5, 0), TopMaterial);
+				AddPart(parts, Cube, XMMatrixScaling(0.25f, 1, 0.25f) * XMMatrixTranslation(0, 5, 0), TopMaterial);
+				AddPart(parts, Cube, XMMatrixTranslation(0, 4, 0), TopMaterial);
+
+				// head piece
+				AddPart(parts, Cylinder, XMMatrixScaling(1.5f, 1.5f, 1.5f) * XMMatrixTranslation(0, 2.75f, 0), TopMaterial);
+				AddPart(parts, Cylinder, XMMatrixScaling(1, 2.25f, 1) * XMMatrixTranslation(0, 2.75f, 0), TopMaterial);
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	// ------------------------------------------------------------------------------------
+	// Generate a primitive and transform it into place
+	// ------------------------------------------------------------------------------------
+	void BakePart(ModelType type, float size, size_t tessellation, FXMMATRIX partMatrix, uint32_t materialIndex, BakedParts& baked)
+	{
+		VertexCollection partVertices;
+		IndexCollection partIndices;
+		MeshBounds partBounds;
+
+		// create the model
+		Models::CreateModel(type, size, tessellation, partVertices, partIndices, &partBounds);
+
+		// move the part's box into place, its corners bound the transformed part
+		for (int corner = 0; corner < 8; corner++)
+		{
+			XMVECTOR point = XMVectorSet((corner & 1) ? partBounds.boxMax.x : partBounds.boxMin.x,
+				(corner & 2) ? partBounds.boxMax.y : partBounds.boxMin.y,
+				(corner & 4) ? partBounds.boxMax.z : partBounds.boxMin.z, 1);
+			point = XMVector3Transform(point, partMatrix);
+
+			if (baked.numParts == 0 && corner == 0)
+			{
+				XMStoreFloat3(&baked.bounds.boxMin, point);
+				XMStoreFloat3(&baked.bounds.boxMax, point);
+			}
+			else
+			{
+				XMStoreFloat3(&baked.bounds.boxMin, XMVectorMin(XMLoadFloat3(&baked.bounds.boxMin), point));
+				XMStoreFloat3(&baked.bounds.boxMax, XMVectorMax(XMLoadFloat3(&baked.bounds.boxMax), point));
+			}
+		}
+
+		// a mirroring matrix turns the triangles inside out, so their winding is swapped back
+		bool flipWinding = Models::TransformVertices(partVertices, 0, partMatrix);
+
+		uint32_t baseVertex = (uint32_t)baked.vertices.size();
+		for (size_t i = 0; i < partVertices.size(); i++)
+		{
+			BakedVertex vertex;
+			vertex.position = partVertices[i].position;
+			vertex.normal = partVertices[i].normal;
+			vertex.textureCoordinate = partVertices[i].textureCoordinate;
+			vertex.materialIndex = materialIndex;
+			baked.vertices.push_back(vertex);
+		}
+
+		for (size_t i = 0; i + 2 < partIndices.size(); i += 3)
+		{
+			baked.indices.push_back(baseVertex + partIndices[i]);
+			if (flipWinding)
+			{
+				baked.indices.push_back(baseVertex + partIndices[i + 2]);
+				baked.indices.push_back(baseVertex + partIndices[i + 1]);
+			}
+			else
+			{
+				baked.indices.push_back(baseVertex + partIndices[i + 1]);
+				baked.indices.push_back(baseVertex + partIndices[i + 2]);
+			}
+		}
+
+		baked.numParts++;
+	}
+
+	// ------------------------------------------------------------------------------------
+	// Add every part of a piece
+	// ------------------------------------------------------------------------------------
+	void BakeParts(const std::vector<PiecePart>& parts, BakedParts& baked)
+	{
+		for (size_t i = 0; i < parts.size(); i++)
+		{
+			BakePart(parts[i].type, 1.0f, Models::DEFAULT_TESSELLATION, XMLoadFloat4x4(&parts[i].partMatrix), parts[i].material, baked);
+		}
+		FitSphere(baked);
+	}
+
+	// ------------------------------------------------------------------------------------
+	// Fit the sphere while the baked positions are still around
+	// ------------------------------------------------------------------------------------
+	void FitSphere(BakedParts& baked)
+	{
+		XMVECTOR center = (XMLoadFloat3(&baked.bounds.boxMin) + XMLoadFloat3(&baked.bounds.boxMax)) * 0.5f;
+		float radius = 0;
+		for (size_t i = 0; i < baked.vertices.size(); i++)
+		{
+			float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&baked.vertices[i].position) - center));
+			if (distance > radius)
+			{
+				radius = distance;
+			}
+		}
+		XMStoreFloat3(&baked.bounds.sphereCenter, center);
+		baked.bounds.sphereRadius = radius;
+	}
+
+	// ------------------------------------------------------------------------------------
+	// The board is squashed to half height
+	// ------------------------------------------------------------------------------------
+	XMMATRIX GetBoardMatrix()
+	{
+		return XMMatrixScaling(1, 0.5f, 1);
+	}
+
+	// ------------------------------------------------------------------------------------
+	// One square's cube, scaled up to the grid and centred on the board
+	// ------------------------------------------------------------------------------------
+	XMMATRIX GetSquareMatrix(int x, int y)
+	{
+		float xOffset = BOARD_SIZE / 2.0f - 0.5f;
+		float yOffset = BOARD_SIZE / 2.0f - 0.5f;
+
+		return XMMatrixScaling(GRID_SCALE, GRID_SCALE, GRID_SCALE) * XMMatrixTranslation((x - xOffset) * GRID_SCALE, -1, (y - yOffset) * GRID_SCALE);
+	}
+
+	// ------------------------------------------------------------------------------------
+	// The squares alternate colours
+	// ------------------------------------------------------------------------------------
+	bool IsFirstColour(int x, int y)
+	{
+		return (x + y) % 2 == 0;
+	}
+
+	// ------------------------------------------------------------------------------------
+	// Centre of a square, raised by the piece's base offset
+	// ------------------------------------------------------------------------------------
+	XMMATRIX GetBoardPosition(int x, int y, float pieceBaseOffset)
+	{
+		float xOffset = BOARD_SIZE / 2.0f - 0.5f;
+		float yOffset = BOARD_SIZE / 2.0f - 0.5f;
+
+		return XMMatrixTranslation((x - xOffset) * GRID_SCALE, pieceBaseOffset, (y - yOffset) * GRID_SCALE);
+	}
+
+	// ------------------------------------------------------------------------------------
+	// A placed piece, turned before it is moved onto its square
+	// ------------------------------------------------------------------------------------
+	XMMATRIX GetPlacementMatrix(const PiecePlacement& placement, float pieceBaseOffset)
+	{
+		XMMATRIX position = GetBoardPosition(placement.x, placement.y, pieceBaseOffset);
+		if (placement.rotationY == 0)
+		{
+			return position;
+		}
+		return XMMatrixRotationY(placement.rotationY) * position;
+	}
+
+	// ------------------------------------------------------------------------------------
+	// The top face of a square's unit cube, once it is on the board
+	// ------------------------------------------------------------------------------------
+	float GetBoardTop()
+	{
+		return XMVectorGetY(XMVector3Transform(XMVectorSet(0, 0.5f, 0, 1), GetSquareMatrix(0, 0) * GetBoardMatrix()));
+	}
+
+	// ------------------------------------------------------------------------------------
+	// GetBoardPosition run backwards, each square reaches half a grid either side of its centre
+	// ------------------------------------------------------------------------------------
+	bool GetSquareAt(float x, float z, int& squareX, int& squareY)
+	{
+		float gridX = floorf(x / GRID_SCALE + BOARD_SIZE / 2.0f);
+		float gridY = floorf(z / GRID_SCALE + BOARD_SIZE / 2.0f);
+		if (gridX < 0 || gridX >= BOARD_SIZE || gridY < 0 || gridY >= BOARD_SIZE)
+		{
+			return false;
+		}
+		squareX = (int)gridX;
+		squareY = (int)gridY;
+		return true;
+	}
+
+	// ------------------------------------------------------------------------------------
+	// White's first rank is drawn along row 7 and the a file along column 0
+	// ------------------------------------------------------------------------------------
+	int GetPositionSquare(int x, int y)
+	{
+		return GetSquare(x, BOARD_SIZE - 1 - y);
+	}
+
+	// ------------------------------------------------------------------------------------
+	// ------------------------------------------------------------------------------------
+	void GetBoardSquare(int square, int& x, int& y)
+	{
+		x = GetFile(square);
+		y = BOARD_SIZE - 1 - GetRank(square);
+	}
+
+	// ------------------------------------------------------------------------------------
+	// Every piece on the board, black's knights turned to face white
+	// ------------------------------------------------------------------------------------
+	void GetPlacements(const ChessPosition& position, std::vector<PiecePlacement>& placements)
+	{
+		placements.clear();
+
+		Bitboard occupied = position.GetOccupied();
+		while (occupied)
+		{
+			int square = PopLowest(occupied);
+			uint8_t piece = position.GetPiece(square);
+
+			PiecePlacement placement;
+			placement.type = ChessPosition::GetPieceType(piece);
+			GetBoardSquare(square, placement.x, placement.y);
+			placement.playerOne = ChessPosition::GetPieceSide(piece) == WhiteSide;
+			placement.rotationY = placement.type == KnightPiece && !placement.playerOne ? XM_PI : 0;
+			placements.push_back(placement);
+		}
+	}
+
+	// ------------------------------------------------------------------------------------
+	// ------------------------------------------------------------------------------------
+	void GetStartingPlacements(std::vector<PiecePlacement>& placements)
+	{
+		GetPlacements(ChessPosition(), placements);
+	}
+}
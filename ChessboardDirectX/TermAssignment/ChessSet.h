@@ -0,0 +1,112 @@
+//
+// BGTD 9201
+//	The parts of every piece, the board squares and the starting layout,
+//	kept free of any device so the Direct3D renderer and the headless
+//	renderer build exactly the same scene
+//
+
+#ifndef _CHESS_SET_H
+#define _CHESS_SET_H
+
+#include <DirectXMath.h>
+#include <vector>
+#include <stdint.h>
+
+#include "Models.h"
+#include "ChessPosition.h"
+
+// material slots used by the chess pieces
+enum PieceMaterial
+{
+	BaseMaterial,
+	MiddleMaterial,
+	TopMaterial
+};
+
+// one primitive of a piece, placed relative to the piece's origin
+struct PiecePart
+{
+	ModelType type;
+	DirectX::XMFLOAT4X4 partMatrix;
+	PieceMaterial material;
+};
+
+// a vertex of a baked mesh, a VertexPositionNormalTexture plus the entry of the material
+// table it uses
+struct BakedVertex
+{
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT3 normal;
+	DirectX::XMFLOAT2 textureCoordinate;
+	uint32_t materialIndex;
+};
+
+// parts transformed into place and merged, ready for any renderer to upload. the indices
+// are 32 bit as a piece can pass 65535 vertices
+struct BakedParts
+{
+	BakedParts();
+
+	std::vector<BakedVertex> vertices;
+	std::vector<uint32_t> indices;
+	int numParts;
+
+	// the box grows with every part, the sphere is only fitted by FitSphere
+	MeshBounds bounds;
+};
+
+// a piece on a square
+struct PiecePlacement
+{
+	PieceType type;
+	int x;
+	int y;
+	bool playerOne;
+	float rotationY;	// turns the piece to face the other player
+};
+
+namespace ChessSet
+{
+	// squares along each side and the width of one
+	const int BOARD_SIZE = 8;
+	const float GRID_SCALE = 4.0f;
+
+	// how far above its square a piece's origin sits
+	const float PIECE_BASE_OFFSET = 2.25f;
+
+	// the primitives a piece is built from
+	void GetPieceParts(PieceType type, std::vector<PiecePart>& parts);
+
+	// generate a primitive, transform it by its local matrix and add it to the baked parts
+	void BakePart(ModelType type, float size, size_t tessellation, DirectX::FXMMATRIX partMatrix, uint32_t materialIndex, BakedParts& baked);
+
+	// add every part of a piece at the default size and fit the sphere around them
+	void BakeParts(const std::vector<PiecePart>& parts, BakedParts& baked);
+
+	// fit the sphere around the box's centre once every part is in
+	void FitSphere(BakedParts& baked);
+
+	// the board as a whole and one square's cube within it
+	DirectX::XMMATRIX GetBoardMatrix();
+	DirectX::XMMATRIX GetSquareMatrix(int x, int y);
+	bool IsFirstColour(int x, int y);
+
+	// where a piece standing on a square goes, relative to the board's parent
+	DirectX::XMMATRIX GetBoardPosition(int x, int y, float pieceBaseOffset);
+	DirectX::XMMATRIX GetPlacementMatrix(const PiecePlacement& placement, float pieceBaseOffset);
+
+	// the height of the squares' tops and the square under a point on them, both relative to
+	// the board's parent. false when the point is off the board
+	float GetBoardTop();
+	bool GetSquareAt(float x, float z, int& squareX, int& squareY);
+
+	// every piece of a position on its square, white as player one along rows 6 and 7
+	void GetPlacements(const ChessPosition& position, std::vector<PiecePlacement>& placements);
+	void GetStartingPlacements(std::vector<PiecePlacement>& placements);
+
+	// a position's square and the board square it is drawn on
+	int GetPositionSquare(int x, int y);
+	void GetBoardSquare(int square, int& x, int& y);
+}
+
+#endif
@@ -5,14 +5,7 @@
 //
 
 #include "Chessboard.h"
-
-struct MaterialBuffer
-{
-	Color ambient;
-	Color diffuse;
-	Color spec; // alpha in w component
-
-};
+#include "StateCache.h"
 
 // called to initialize the object
 void Chessboard::Initialize(ID3D11Device* pDevice, LitColourShader* pLitShader, Matrix inWorldMatrix, Color colour1, Color colour2)
@@ -22,65 +15,185 @@ void Chessboard::Initialize(ID3D11Device* pDevice, LitColourShader* pLitShader,
 
 	pShader = pLitShader;
 
-	gridScale = 4;
+	// one cube drawn once per square
+	square.AddPart(Cube, Matrix::Identity, 0);
+	square.Build(pDevice, LitColourShader::InstancedInputElements, LitColourShader::InstancedInputElementCount,
+		pShader->GetInstancedVertexShaderBinary(), pShader->GetInstancedVertexShaderBinarySize());
+
+	// the squares all use the first entry of the table
+	MaterialBuffer squareMaterials;
+	squareMaterials.SetMaterial(0, Colors::DarkGreen.v, Colors::DarkGreen.v, Colors::Black.v, 2);
+	materialId = MaterialRegistry::Get().AcquireMaterials(pDevice, squareMaterials);
 
-	float xOffset = X_LENGTH / 2.0f - 0.5f;
-	float yOffset = Y_LENGTH / 2.0f - 0.5f;
+	worldPositionMatrix = inWorldMatrix;
+	instanceParentMatrix = Matrix::Identity;
 
 	for (int x = 0; x < X_LENGTH; x++) {
 		for (int y = 0; y < Y_LENGTH; y++) {
-			chessGrid[x][y].InitializeGeometry(pDevice, Cube);
-			chessGrid[x][y].InitializeInputLayout(pDevice, pShader->GetVertexShaderBinary(), pShader->GetVertexShaderBinarySize());
-			chessGridMatrix[x][y] = Matrix::CreateScale(gridScale) * Matrix::CreateTranslation((x - xOffset) * gridScale, -1, (y - yOffset) * gridScale);
+			chessGridMatrix[x][y] = ChessSet::GetSquareMatrix(x, y);
+
+			InstanceData& instance = squareInstances[x * Y_LENGTH + y];
+			instance.worldMatrix = chessGridMatrix[x][y] * worldPositionMatrix * instanceParentMatrix;
+			instance.colour = ChessSet::IsFirstColour(x, y) ? gridColour1 : gridColour2;
 		}
 	}
 
-	worldPositionMatrix = inWorldMatrix;
+	// the squares only change when the board is moved, so the buffer is rarely written
+	D3D11_BUFFER_DESC instanceDesc;
+	instanceDesc.ByteWidth = sizeof(squareInstances);
+	instanceDesc.Usage = D3D11_USAGE_DYNAMIC;
+	instanceDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	instanceDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	instanceDesc.MiscFlags = 0;
+	instanceDesc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA instanceData;
+	instanceData.pSysMem = squareInstances;
+	instanceData.SysMemPitch = 0;
+	instanceData.SysMemSlicePitch = 0;
+
+	HRESULT hr = pDevice->CreateBuffer(&instanceDesc, &instanceData, &pInstanceBuffer);
+	if (FAILED(hr))
+	{
+		OutputDebugString(L"Couldn't create chessboard instance buffer");
+		assert(0);
+		return;
+	}
 
 	base.InitializeGeometry(pDevice, Cylinder);
 	base.InitializeInputLayout(pDevice, pShader->GetVertexShaderBinary(), pShader->GetVertexShaderBinarySize());
 	baseMatrix = Matrix::CreateScale(2.5, 0.5, 2.5) * Matrix::CreateTranslation(0, -1.5, 0);
-	pBaseBuffer = MakeMaterialBuffer(pDevice, Colors::DarkGreen.v, Colors::DarkGreen.v, Colors::Black.v, 2);
 
 	middle.InitializeGeometry(pDevice, Cylinder);
 	middle.InitializeInputLayout(pDevice, pShader->GetVertexShaderBinary(), pShader->GetVertexShaderBinarySize());
 	middleMatrix = Matrix::CreateScale(1, 2.5, 1);
-	pMiddleBuffer = MakeMaterialBuffer(pDevice, Colors::DarkGoldenrod.v, Colors::Goldenrod.v, Colors::DarkGoldenrod.v, 8);
 
 	top.InitializeGeometry(pDevice, Sphere);
 	top.InitializeInputLayout(pDevice, pShader->GetVertexShaderBinary(), pShader->GetVertexShaderBinarySize());
 	topMatrix = Matrix::CreateScale(2.0f, 2.0f, 2.0f) * Matrix::CreateTranslation(0, 1.75, 0);
-	pTopBuffer = MakeMaterialBuffer(pDevice, Colors::Black.v, Colors::DarkGray.v, Colors::Silver.v, 128);
 
 }
 
-// called to draw the object
-// The parent matrix allows the user to pass in a matrix to transform the entire piece
-void Chessboard::Draw(ID3D11DeviceContext* pDeviceContext, const Matrix& parentMatrix, const Matrix& viewMatrix, const Matrix& projMatrix)
+// called to add the squares to the frame's transforms
+// Each square is its grid matrix and the board's position under the parent transform
+void Chessboard::AddTransforms(TransformStore& store, UINT parent)
 {
-	// set all 3 to the diffuse
-	pDeviceContext->PSSetShaderResources(0, 1, &pDiffuse);
-	pDeviceContext->PSSetShaderResources(1, 1, &pDiffuse);
-	pDeviceContext->PSSetShaderResources(2, 1, &pDiffuse);
+	pTransforms = &store;
+	parentTransform = parent;
+	firstSquareTransform = store.GetCount();
 
-	pDeviceContext->PSSetConstantBuffers(2, 1, &pBaseBuffer);
-	
-	// chess
 	for (int x = 0; x < X_LENGTH; x++) {
 		for (int y = 0; y < Y_LENGTH; y++) {
-			if ((x + y) % 2 == 0) {
-				pShader->SetAmbientLight(gridColour1);
-			}
-			else {
-				pShader->SetAmbientLight(gridColour2);
-			}
+			Matrix local = chessGridMatrix[x][y] * worldPositionMatrix;
+			store.Add(local, parent, AffineTransform::FindKind(local));
+		}
+	}
+}
+
+// called to draw the object
+// The parent transform moves the entire board
+void Chessboard::Draw(RenderDevice* pRenderDevice)
+{
+	// set all 3 to the diffuse
+	StateCache::Get().PSSetShaderResource(pRenderDevice, 0, pDiffuse);
+	StateCache::Get().PSSetShaderResource(pRenderDevice, 1, pDiffuse);
+	StateCache::Get().PSSetShaderResource(pRenderDevice, 2, pDiffuse);
+
+	pShader->SetMaterials(pRenderDevice, materialId);
+
+	// only re-upload the squares if the board moved, different squares are in view or one changed colour
+	if (Matrix(pTransforms->GetWorld(parentTransform)) != instanceParentMatrix || visibleSquaresChanged || coloursChanged)
+	{
+		UpdateInstances(pRenderDevice);
+	}
+
+	// the square colours come from the instances, so one draw covers the board
+	pShader->SetInstancedShaders(pRenderDevice, AffineTransform());
+	square.DrawInstanced(pRenderDevice, pInstanceBuffer, sizeof(InstanceData), numVisibleSquares, 0);
+}
+
+// called to queue a sphere around every square
+void Chessboard::AddToCuller(FrustumCuller& culler)
+{
+	firstCullIndex = culler.GetNumSpheres();
+
+	for (int i = 0; i < X_LENGTH * Y_LENGTH; i++)
+	{
+		culler.AddBounds(square.GetBounds(), pTransforms->GetWorld(firstSquareTransform + i));
+	}
+}
 
-			pShader->SetShaders(pDeviceContext, chessGridMatrix[x][y] * worldPositionMatrix, viewMatrix, projMatrix);
-			chessGrid[x][y].Draw(pDeviceContext);
+// called once the culler has run, the instance buffer is rebuilt if the set changed
+void Chessboard::ApplyCulling(const FrustumCuller& culler)
+{
+	numVisibleSquares = 0;
+	for (int i = 0; i < X_LENGTH * Y_LENGTH; i++)
+	{
+		bool visible = culler.IsVisible(firstCullIndex + i);
+		if (visible != squareVisible[i])
+		{
+			squareVisible[i] = visible;
+			visibleSquaresChanged = true;
+		}
+		if (visible)
+		{
+			numVisibleSquares++;
 		}
 	}
 }
 
+// called to queue the board
+// All 64 squares are one packet, grouped with anything else sharing the shader and material
+void Chessboard::Submit(RenderQueue& queue, float viewDepth)
+{
+	if (numVisibleSquares == 0)
+	{
+		return;
+	}
+
+	RenderPacket packet;
+	packet.key = queue.MakeKey(OpaquePass, pShader, materialId, &square, viewDepth);
+	packet.pOwner = this;
+	packet.pInstanceBuffer = pInstanceBuffer;
+	packet.startInstance = 0;
+	packet.numInstances = numVisibleSquares;
+	queue.Submit(packet);
+}
+
+// called by the render queue once the packets are sorted
+void Chessboard::DrawPacket(RenderDevice* pRenderDevice, const RenderPacket& packet)
+{
+	Draw(pRenderDevice);
+}
+
+// rebuilds the square instances for a new parent matrix
+// The world matrices were already worked out by the transform store
+void Chessboard::UpdateInstances(RenderDevice* pRenderDevice)
+{
+	instanceParentMatrix = pTransforms->GetWorld(parentTransform);
+	visibleSquaresChanged = false;
+	coloursChanged = false;
+
+	for (int i = 0; i < X_LENGTH * Y_LENGTH; i++)
+	{
+		squareInstances[i].worldMatrix = pTransforms->GetWorld(firstSquareTransform + i);
+	}
+
+	InstanceData* pInstances = (InstanceData*)pRenderDevice->Map(pInstanceBuffer, MapWriteDiscard, 0, sizeof(squareInstances));
+	if (pInstances != nullptr)
+	{
+		// the visible squares are packed together at the front
+		for (int i = 0; i < X_LENGTH * Y_LENGTH; i++)
+		{
+			if (squareVisible[i])
+			{
+				*pInstances++ = squareInstances[i];
+			}
+		}
+		pRenderDevice->Unmap(pInstanceBuffer);
+	}
+}
+
 // update the object
 void Chessboard::Update(float deltaTime)
 {
@@ -88,56 +201,59 @@ void Chessboard::Update(float deltaTime)
 
 Matrix Chessboard::GetBoardPosition(int x, int y, float pieceBaseOffset)
 {
-	float xOffset = X_LENGTH / 2.0f - 0.5f;
-	float yOffset = Y_LENGTH / 2.0f - 0.5f;
-
-	return Matrix::CreateTranslation((x - xOffset) * gridScale, pieceBaseOffset, (y - yOffset) * gridScale);
+	return ChessSet::GetBoardPosition(x, y, pieceBaseOffset);
 }
 
-// Helper to make a buffer from the given materials
-//
-ID3D11Buffer* Chessboard::MakeMaterialBuffer(ID3D11Device* pDevice, Color ambient, Color diffuse, Color spec, float specPower)
+// called to colour the square under the mouse
+// The old square gets its own colour back and the buffer is rebuilt on the next draw
+void Chessboard::SetHighlight(int x, int y, const Color& colour)
 {
-	MaterialBuffer mat;
-	mat.ambient = ambient;
-	mat.diffuse = diffuse;
-	mat.spec = spec;
-	mat.spec.w = specPower;
-
-	// Create the constant buffer
-	D3D11_BUFFER_DESC bufferDesc;
-	bufferDesc.ByteWidth = sizeof(MaterialBuffer);
-	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	bufferDesc.MiscFlags = 0;
-	bufferDesc.StructureByteStride = 0;
-
-	D3D11_SUBRESOURCE_DATA data;
-	data.pSysMem = &mat;
-	data.SysMemPitch = 0;
-	data.SysMemSlicePitch = 0;
-
-	ID3D11Buffer* pConstantBuffer;
-	pDevice->CreateBuffer(&bufferDesc, &data, &pConstantBuffer);
-	return pConstantBuffer;
+	int square = x >= 0 && x < X_LENGTH && y >= 0 && y < Y_LENGTH ? x * Y_LENGTH + y : -1;
+	if (square == highlightSquare && (square < 0 || squareInstances[square].colour == colour))
+	{
+		return;
+	}
+
+	if (highlightSquare >= 0)
+	{
+		int oldX = highlightSquare / Y_LENGTH;
+		int oldY = highlightSquare % Y_LENGTH;
+		squareInstances[highlightSquare].colour = ChessSet::IsFirstColour(oldX, oldY) ? gridColour1 : gridColour2;
+	}
+	if (square >= 0)
+	{
+		squareInstances[square].colour = colour;
+	}
+	highlightSquare = square;
+	coloursChanged = true;
 }
 
 // constructor
 Chessboard::Chessboard()
 {
 	pShader = nullptr;
-	pBaseBuffer = nullptr;
-	pMiddleBuffer = nullptr;
-	pTopBuffer = nullptr;
+	materialId = 0;
+	pInstanceBuffer = nullptr;
+	pTransforms = nullptr;
+	firstSquareTransform = 0;
+	parentTransform = 0;
 	pDiffuse = nullptr;
 	pSpec = nullptr;
+
+	// everything is drawn until the culler says otherwise
+	for (int i = 0; i < X_LENGTH * Y_LENGTH; i++)
+	{
+		squareVisible[i] = true;
+	}
+	numVisibleSquares = X_LENGTH * Y_LENGTH;
+	visibleSquaresChanged = false;
+	firstCullIndex = 0;
+	highlightSquare = -1;
+	coloursChanged = false;
 }
 
 // destructo
 Chessboard::~Chessboard()
 {
-	if (pBaseBuffer) pBaseBuffer->Release();
-	if (pMiddleBuffer) pMiddleBuffer->Release();
-	if (pTopBuffer) pTopBuffer->Release();
+	if (pInstanceBuffer) pInstanceBuffer->Release();
 }
\ No newline at end of file
@@ -11,13 +11,18 @@
 
 #include "DirectX.h"
 #include "IndexedPrimitive.h"
+#include "BakedMesh.h"
 #include "LitColourShader.h"
+#include "RenderQueue.h"
+#include "FrustumCuller.h"
+#include "ChessSet.h"
+#include "TransformStore.h"
 #include <d3d11_1.h>
 #include <SimpleMath.h>
 
 using namespace DirectX;
 
-class Chessboard
+class Chessboard : public Renderable
 {
 public:
 
@@ -27,8 +32,23 @@ public:
 	// called to initialize the object
 	void Initialize(ID3D11Device* pDevice, LitColourShader* pLitShader, Matrix inWorldMatrix, Color colour1, Color colour2);
 
+	// add a transform for every square under parent, call once after Initialize
+	void AddTransforms(TransformStore& store, UINT parent);
+
 	// called to draw the object
-	void Draw(ID3D11DeviceContext* pDeviceContext, const Matrix& parentMatrix, const Matrix& viewMatrix, const Matrix& projMatrix);
+	void Draw(RenderDevice* pRenderDevice);
+
+	// queue a sphere for every square
+	void AddToCuller(FrustumCuller& culler);
+
+	// keep only the squares the culler saw
+	void ApplyCulling(const FrustumCuller& culler);
+
+	// queue the board to be drawn, viewDepth is how far it is from the camera
+	void Submit(RenderQueue& queue, float viewDepth);
+
+	// called by the queue to draw a submitted packet
+	void DrawPacket(RenderDevice* pRenderDevice, const RenderPacket& packet);
 
 	// update the object
 	void Update(float deltaTime);
@@ -40,9 +60,10 @@ public:
 
 	Matrix GetBoardPosition(int x, int y, float pieceBaseOffset);
 
-private:
+	// draw one square in another colour, x below 0 puts the last one back
+	void SetHighlight(int x, int y, const Color& colour);
 
-	ID3D11Buffer* MakeMaterialBuffer(ID3D11Device* pDevice, Color ambient, Color diffuse, Color spec, float specPower);
+private:
 
 	ID3D11ShaderResourceView* pDiffuse;
 	ID3D11ShaderResourceView* pSpec;
@@ -52,13 +73,38 @@ private:
 
 	// Chessboard
 	const static int BOARDHEIHT_MODIFIER = 1;
-	const static int X_LENGTH = 8;
-	const static int Y_LENGTH = 8;
-	float gridScale;
+	const static int X_LENGTH = ChessSet::BOARD_SIZE;
+	const static int Y_LENGTH = ChessSet::BOARD_SIZE;
 
-	IndexedPrimitive chessGrid[X_LENGTH][Y_LENGTH];
+	// every square is an instance of the same cube, drawn in a single call
+	BakedMesh square;
 	Matrix chessGridMatrix[X_LENGTH][Y_LENGTH];
 
+	// world matrix and colour of every square
+	ID3D11Buffer* pInstanceBuffer;
+	InstanceData squareInstances[X_LENGTH * Y_LENGTH];
+
+	// where the squares' world matrices come from, the first square's and the parent's
+	const TransformStore* pTransforms;
+	UINT firstSquareTransform;
+	UINT parentTransform;
+
+	// parent matrix the instance buffer was last built with
+	Matrix instanceParentMatrix;
+
+	// squares that survived culling, only these are in the instance buffer
+	bool squareVisible[X_LENGTH * Y_LENGTH];
+	UINT numVisibleSquares;
+	bool visibleSquaresChanged;
+
+	// the square drawn in the highlight colour, -1 for none
+	int highlightSquare;
+	bool coloursChanged;
+	UINT firstCullIndex;
+
+	// rebuilds the square instances for a new parent matrix and copies the visible ones
+	void UpdateInstances(RenderDevice* pRenderDevice);
+
 	Color gridColour1;
 	Color gridColour2;
 
@@ -73,9 +119,8 @@ private:
 	Matrix middleMatrix;
 	Matrix topMatrix;
 
-	ID3D11Buffer* pBaseBuffer;
-	ID3D11Buffer* pMiddleBuffer;
-	ID3D11Buffer* pTopBuffer;
+	// material of the squares, shared through the material registry
+	UINT materialId;
 
 
 };
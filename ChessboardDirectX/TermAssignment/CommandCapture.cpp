@@ -0,0 +1,308 @@
+//
+// BGTD 9201
+//	Frames of recorded device calls saved to a file and played back
+//
+
+#include "CommandCapture.h"
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+
+// file header, then per frame the camera, the stream size and the stream.
+// Everything is little endian
+static const char CAPTURE_MAGIC[8] = { 'C', 'H', 'E', 'S', 'S', 'C', 'A', 'P' };
+static const uint32_t CAPTURE_VERSION = 1;
+
+// frames, object counts and maps bigger than these are taken as a damaged file rather than allocated
+static const uint32_t MAX_STREAM_SIZE = 64 * 1024 * 1024;
+static const uint32_t MAX_OBJECTS = 1024 * 1024;
+static const uint32_t MAX_MAP_SIZE = 64 * 1024 * 1024;
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static void WriteUint(std::vector<unsigned char>& out, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		out.push_back((unsigned char)(value >> (i * 8)));
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static void WriteFloat(std::vector<unsigned char>& out, float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	WriteUint(out, bits);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static bool ReadUint(FILE* pFile, uint32_t& value)
+{
+	unsigned char bytes[4];
+	if (fread(bytes, 1, 4, pFile) != 4)
+	{
+		return false;
+	}
+	value = (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static bool ReadFloat(FILE* pFile, float& value)
+{
+	uint32_t bits;
+	if (!ReadUint(pFile, bits))
+	{
+		return false;
+	}
+	memcpy(&value, &bits, sizeof(value));
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// Decode every command of a frame, false if one is damaged, names an object the header
+// didn't count or maps more than a replay should allocate
+// ------------------------------------------------------------------------------------
+static bool CheckStream(const std::vector<unsigned char>& stream, uint32_t objects)
+{
+	DeviceCommand command;
+	size_t offset = 0;
+	while (offset < stream.size())
+	{
+		offset = RecordingRenderDevice::ReadCommand(stream.data(), stream.size(), offset, command);
+		if (offset == 0 || command.object > objects)
+		{
+			return false;
+		}
+		if (command.type == MapCommand && command.args[2] > MAX_MAP_SIZE)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+CommandCapture::CommandCapture()
+{
+	numObjects = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void CommandCapture::Clear()
+{
+	frames.clear();
+	numObjects = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void CommandCapture::AddFrame(const CaptureCamera& camera, const std::vector<unsigned char>& stream, UINT frameObjects)
+{
+	frames.push_back(CaptureFrame());
+	frames.back().camera = camera;
+	frames.back().stream = stream;
+
+	if (frameObjects > numObjects)
+	{
+		numObjects = frameObjects;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Build the whole file in memory and write it in one go
+// ------------------------------------------------------------------------------------
+bool CommandCapture::Save(const char* fileName) const
+{
+	std::vector<unsigned char> out(CAPTURE_MAGIC, CAPTURE_MAGIC + sizeof(CAPTURE_MAGIC));
+	WriteUint(out, CAPTURE_VERSION);
+	WriteUint(out, (uint32_t)frames.size());
+	WriteUint(out, numObjects);
+
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		const CaptureCamera& camera = frames[i].camera;
+		WriteFloat(out, camera.deltaTime);
+		WriteFloat(out, camera.rotation[0]);
+		WriteFloat(out, camera.rotation[1]);
+		WriteFloat(out, camera.radius);
+		for (int j = 0; j < 3; j++)
+		{
+			WriteFloat(out, camera.position[j]);
+		}
+
+		WriteUint(out, (uint32_t)frames[i].stream.size());
+		out.insert(out.end(), frames[i].stream.begin(), frames[i].stream.end());
+	}
+
+	FILE* pFile = fopen(fileName, "wb");
+	if (!pFile)
+	{
+		OutputDebugString(L"CommandCapture: couldn't open the capture for writing\n");
+		return false;
+	}
+	bool written = fwrite(out.data(), 1, out.size(), pFile) == out.size();
+	written = fclose(pFile) == 0 && written;
+	return written;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+bool CommandCapture::Load(const char* fileName)
+{
+	Clear();
+
+	FILE* pFile = fopen(fileName, "rb");
+	if (!pFile)
+	{
+		return false;
+	}
+
+	char magic[sizeof(CAPTURE_MAGIC)];
+	uint32_t version = 0, numFrames = 0, objects = 0;
+	bool valid = fread(magic, 1, sizeof(magic), pFile) == sizeof(magic) && memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) == 0
+		&& ReadUint(pFile, version) && version == CAPTURE_VERSION
+		&& ReadUint(pFile, numFrames) && ReadUint(pFile, objects) && objects <= MAX_OBJECTS;
+
+	for (uint32_t i = 0; valid && i < numFrames; i++)
+	{
+		CaptureFrame frame;
+		CaptureCamera& camera = frame.camera;
+		valid = ReadFloat(pFile, camera.deltaTime) && ReadFloat(pFile, camera.rotation[0]) && ReadFloat(pFile, camera.rotation[1])
+			&& ReadFloat(pFile, camera.radius) && ReadFloat(pFile, camera.position[0]) && ReadFloat(pFile, camera.position[1])
+			&& ReadFloat(pFile, camera.position[2]);
+
+		uint32_t streamSize = 0;
+		valid = valid && ReadUint(pFile, streamSize) && streamSize <= MAX_STREAM_SIZE;
+		if (valid)
+		{
+			frame.stream.resize(streamSize);
+			valid = fread(frame.stream.data(), 1, streamSize, pFile) == streamSize && CheckStream(frame.stream, objects);
+		}
+		if (valid)
+		{
+			frames.push_back(frame);
+		}
+	}
+	fclose(pFile);
+
+	if (!valid)
+	{
+		Clear();
+		return false;
+	}
+	numObjects = objects;
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+CommandReplayer::CommandReplayer(UINT numObjects)
+{
+	handles.resize((size_t)numObjects + 1);
+	numCommands = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// Decode each command and make the same call, the maps get as many bytes written as
+// the recorded frame wrote so the copy cost is replayed too
+// ------------------------------------------------------------------------------------
+bool CommandReplayer::ReplayFrame(RenderDevice* pRenderDevice, const std::vector<unsigned char>& stream)
+{
+	numCommands = 0;
+
+	DeviceCommand command;
+	size_t offset = 0;
+	while (offset < stream.size())
+	{
+		offset = RecordingRenderDevice::ReadCommand(stream.data(), stream.size(), offset, command);
+		if (offset == 0 || command.object >= handles.size())
+		{
+			return false;
+		}
+		numCommands++;
+
+		void* pObject = command.object != 0 ? &handles[command.object] : nullptr;
+		const UINT* args = command.args;
+		switch (command.type)
+		{
+			case MapCommand:
+			{
+				if (args[2] > MAX_MAP_SIZE)
+				{
+					return false;
+				}
+				void* pMapped = pRenderDevice->Map((DeviceBuffer*)pObject, (DeviceMapMode)args[0], args[1], args[2]);
+				if (pMapped != nullptr)
+				{
+					if (payload.size() < args[2])
+					{
+						payload.resize(args[2]);
+					}
+					memcpy(pMapped, payload.data(), args[2]);
+				}
+				break;
+			}
+			case UnmapCommand:
+				pRenderDevice->Unmap((DeviceBuffer*)pObject);
+				break;
+			case InputLayoutCommand:
+				pRenderDevice->IASetInputLayout((DeviceInputLayout*)pObject);
+				break;
+			case TopologyCommand:
+				pRenderDevice->IASetPrimitiveTopology((DeviceTopology)args[0]);
+				break;
+			case VertexBuffersCommand:
+			{
+				DeviceBuffer* pBuffer = (DeviceBuffer*)pObject;
+				pRenderDevice->IASetVertexBuffers(args[0], 1, &pBuffer, &args[1], &args[2]);
+				break;
+			}
+			case IndexBufferCommand:
+				pRenderDevice->IASetIndexBuffer((DeviceBuffer*)pObject, (DeviceIndexFormat)args[0], args[1]);
+				break;
+			case VertexShaderCommand:
+				pRenderDevice->VSSetShader((DeviceVertexShader*)pObject);
+				break;
+			case PixelShaderCommand:
+				pRenderDevice->PSSetShader((DevicePixelShader*)pObject);
+				break;
+			case VSConstantBufferCommand:
+				pRenderDevice->VSSetConstantBuffer(args[0], (DeviceBuffer*)pObject, args[1], args[2]);
+				break;
+			case PSConstantBufferCommand:
+				pRenderDevice->PSSetConstantBuffer(args[0], (DeviceBuffer*)pObject, args[1], args[2]);
+				break;
+			case SamplerCommand:
+				pRenderDevice->PSSetSampler(args[0], (DeviceSampler*)pObject);
+				break;
+			case TextureCommand:
+				pRenderDevice->PSSetShaderResource(args[0], (DeviceTexture*)pObject);
+				break;
+			case RasterizerCommand:
+				pRenderDevice->RSSetState((DeviceRasterizerState*)pObject);
+				break;
+			case DepthStencilCommand:
+				pRenderDevice->OMSetDepthStencilState((DeviceDepthStencilState*)pObject, args[0]);
+				break;
+			case DrawCommand:
+				pRenderDevice->Draw(args[0], args[1]);
+				break;
+			case DrawIndexedCommand:
+				pRenderDevice->DrawIndexed(args[0], args[1], (int)args[2]);
+				break;
+			case DrawIndexedInstancedCommand:
+				pRenderDevice->DrawIndexedInstanced(args[0], args[1], args[2], (int)args[3], args[4]);
+				break;
+			default:
+				return false;
+		}
+	}
+	return true;
+}
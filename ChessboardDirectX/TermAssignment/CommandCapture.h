@@ -0,0 +1,81 @@
+//
+// BGTD 9201
+//	Frames of recorded device calls with the camera they were drawn from,
+//	saved to a file so they can be played back through any render device
+//	without the window, input or timer
+//
+
+#ifndef _COMMAND_CAPTURE_H
+#define _COMMAND_CAPTURE_H
+
+#include <vector>
+
+#include "RecordingRenderDevice.h"
+
+// where the camera was for a frame and how much time the frame stepped
+struct CaptureCamera
+{
+	float deltaTime;
+	float rotation[2];
+	float radius;
+	float position[3];
+};
+
+// one frame of calls, in the recording device's stream format
+struct CaptureFrame
+{
+	CaptureCamera camera;
+	std::vector<unsigned char> stream;
+};
+
+class CommandCapture
+{
+public:
+	CommandCapture();
+
+	// throw away every frame
+	void Clear();
+
+	// add a recorded frame, numObjects is how many ids the recording device has handed out
+	void AddFrame(const CaptureCamera& camera, const std::vector<unsigned char>& stream, UINT numObjects);
+
+	// false if the file couldn't be written or isn't a capture
+	bool Save(const char* fileName) const;
+	bool Load(const char* fileName);
+
+	int GetNumFrames() const { return (int)frames.size(); }
+	const CaptureFrame& GetFrame(int index) const { return frames[index]; }
+
+	// the highest object id any frame uses
+	UINT GetNumObjects() const { return numObjects; }
+
+private:
+	std::vector<CaptureFrame> frames;
+	UINT numObjects;
+};
+
+// plays captured frames through a render device, every object id becomes a handle of
+// its own and maps are filled in as the frame filled them
+class CommandReplayer
+{
+public:
+	CommandReplayer(UINT numObjects);
+
+	// issue every call of a frame, false if the stream is damaged
+	bool ReplayFrame(RenderDevice* pRenderDevice, const std::vector<unsigned char>& stream);
+
+	// commands issued by the last frame
+	int GetNumCommands() const { return numCommands; }
+
+private:
+
+	// a unique address for each id, nothing is ever read through them
+	std::vector<unsigned char> handles;
+
+	// what the maps are filled with
+	std::vector<unsigned char> payload;
+
+	int numCommands;
+};
+
+#endif
@@ -0,0 +1,249 @@
+//
+// BGTD 9201
+//	Hands out per-frame blocks of one large dynamic constant buffer
+//
+
+#include "ConstantRing.h"
+#include "StateCache.h"
+#include <cstring>
+#include <sstream>
+
+// offsets must be a multiple of 16 constants, 256 bytes
+static const UINT CONSTANT_ALIGNMENT = 256;
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+ConstantRing& ConstantRing::Get()
+{
+	static ConstantRing ring;
+	return ring;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+ConstantRing::ConstantRing()
+{
+	pRingBuffer = nullptr;
+	pRingDevice = nullptr;
+
+	ringSize = 0;
+	cursor = 0;
+	discardNext = true;
+	generation = 0;
+
+	ResetStats();
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+ConstantRing::~ConstantRing()
+{
+	Release();
+}
+
+// ------------------------------------------------------------------------------------
+// Create the ring if the device can bind constant buffers at an offset
+// ------------------------------------------------------------------------------------
+bool ConstantRing::Initialize(RenderDevice* pRenderDevice, UINT sizeInBytes)
+{
+	Release();
+
+	if (!pRenderDevice->SupportsConstantOffsets())
+	{
+		OutputDebugString(L"ConstantRing: no constant buffer offsets, using per-object buffers\n");
+		return false;
+	}
+
+	ringSize = AlignedSize(sizeInBytes);
+
+	pRingBuffer = pRenderDevice->CreateConstantBuffer(ringSize);
+	if (pRingBuffer == nullptr)
+	{
+		OutputDebugString(L"Couldn't create constant ring buffer");
+		assert(0);
+		Release();
+		return false;
+	}
+	pRingDevice = pRenderDevice;
+
+	cursor = 0;
+	discardNext = true;
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// Let go of the ring
+// ------------------------------------------------------------------------------------
+void ConstantRing::Release()
+{
+	if (pRingBuffer)
+	{
+		pRingDevice->ReleaseBuffer(pRingBuffer);
+		pRingBuffer = nullptr;
+	}
+	pRingDevice = nullptr;
+
+	ringSize = 0;
+	cursor = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// Start a new frame, the first upload hands the driver a fresh copy of the ring
+// ------------------------------------------------------------------------------------
+void ConstantRing::BeginFrame()
+{
+	cursor = 0;
+	discardNext = true;
+	generation++;
+}
+
+// ------------------------------------------------------------------------------------
+// Padded size of an upload
+// ------------------------------------------------------------------------------------
+UINT ConstantRing::AlignedSize(UINT size)
+{
+	return (size + CONSTANT_ALIGNMENT - 1) & ~(CONSTANT_ALIGNMENT - 1);
+}
+
+// ------------------------------------------------------------------------------------
+// Wrap now if the next uploads would not fit
+// ------------------------------------------------------------------------------------
+void ConstantRing::Reserve(UINT size)
+{
+	if (pRingBuffer != nullptr && cursor + size > ringSize)
+	{
+		cursor = 0;
+		discardNext = true;
+		generation++;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Copy constants to the GPU
+// ------------------------------------------------------------------------------------
+bool ConstantRing::Upload(RenderDevice* pRenderDevice, DeviceBuffer* pFallbackBuffer, const void* pData, UINT size, ConstantAllocation& outAllocation)
+{
+	// 11.0 devices, rewrite the caller's own buffer like before
+	if (pRingBuffer == nullptr)
+	{
+		void* pMapped = pRenderDevice->Map(pFallbackBuffer, MapWriteDiscard, 0, size);
+		if (pMapped == nullptr)
+		{
+			return false;
+		}
+		memcpy(pMapped, pData, size);
+		pRenderDevice->Unmap(pFallbackBuffer);
+
+		outAllocation.pBuffer = pFallbackBuffer;
+		outAllocation.firstConstant = 0;
+		outAllocation.numConstants = 0;
+		outAllocation.generation = 0;
+
+		fallbackUploads++;
+		return true;
+	}
+
+	UINT alignedSize = AlignedSize(size);
+	if (alignedSize > ringSize)
+	{
+		OutputDebugString(L"Constants are larger than the constant ring");
+		assert(0);
+		return false;
+	}
+
+	// out of room, start again from the top with a fresh copy
+	if (cursor + alignedSize > ringSize)
+	{
+		cursor = 0;
+		discardNext = true;
+		generation++;
+	}
+
+	// no overwrite promises we won't touch anything the GPU may still be reading
+	DeviceMapMode mapMode = discardNext ? MapWriteDiscard : MapWriteNoOverwrite;
+	void* pMapped = pRenderDevice->Map(pRingBuffer, mapMode, cursor, size);
+	if (pMapped == nullptr)
+	{
+		return false;
+	}
+	memcpy(pMapped, pData, size);
+	pRenderDevice->Unmap(pRingBuffer);
+
+	if (discardNext)
+	{
+		discards++;
+		discardNext = false;
+	}
+
+	outAllocation.pBuffer = pRingBuffer;
+	outAllocation.firstConstant = cursor / 16;
+	outAllocation.numConstants = alignedSize / 16;
+	outAllocation.generation = generation;
+
+	cursor += alignedSize;
+	uploads++;
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// Ring allocations only live until the ring is discarded, fallback buffers keep their contents
+// ------------------------------------------------------------------------------------
+bool ConstantRing::IsCurrent(const ConstantAllocation& allocation) const
+{
+	if (allocation.pBuffer == nullptr)
+	{
+		return false;
+	}
+	return allocation.pBuffer != pRingBuffer || allocation.generation == generation;
+}
+
+// ------------------------------------------------------------------------------------
+// Bind an allocation to a vertex shader slot
+// ------------------------------------------------------------------------------------
+void ConstantRing::BindVS(RenderDevice* pRenderDevice, UINT slot, const ConstantAllocation& allocation)
+{
+	// the same slice bound twice in a row is dropped
+	if (!StateCache::Get().VSChangeConstantBuffer(slot, allocation.pBuffer, allocation.firstConstant, allocation.numConstants))
+	{
+		return;
+	}
+
+	// fallback allocations have no slice, so the whole buffer is bound
+	pRenderDevice->VSSetConstantBuffer(slot, allocation.pBuffer, allocation.firstConstant, allocation.numConstants);
+}
+
+// ------------------------------------------------------------------------------------
+// Bind an allocation to a pixel shader slot
+// ------------------------------------------------------------------------------------
+void ConstantRing::BindPS(RenderDevice* pRenderDevice, UINT slot, const ConstantAllocation& allocation)
+{
+	if (!StateCache::Get().PSChangeConstantBuffer(slot, allocation.pBuffer, allocation.firstConstant, allocation.numConstants))
+	{
+		return;
+	}
+
+	// fallback allocations have no slice, so the whole buffer is bound
+	pRenderDevice->PSSetConstantBuffer(slot, allocation.pBuffer, allocation.firstConstant, allocation.numConstants);
+}
+
+// ------------------------------------------------------------------------------------
+// Clear the counters
+// ------------------------------------------------------------------------------------
+void ConstantRing::ResetStats()
+{
+	uploads = 0;
+	discards = 0;
+	fallbackUploads = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// Write the counts to the debug output
+// ------------------------------------------------------------------------------------
+void ConstantRing::ReportStats() const
+{
+	std::wostringstream message;
+	message << L"ConstantRing: " << uploads << L" ring uploads, " << discards << L" discards, "
+		<< fallbackUploads << L" fallback uploads, " << cursor << L" of " << ringSize << L" bytes used\n";
+
+	OutputDebugString(message.str().c_str());
+}
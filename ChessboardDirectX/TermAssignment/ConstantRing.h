@@ -0,0 +1,92 @@
+//
+// BGTD 9201
+//	Hands out per-frame blocks of one large dynamic constant buffer and binds
+//	them with D3D11.1 constant buffer offsets, so draws no longer rename a
+//	small buffer each time. On devices without offsets it falls back to
+//	writing each caller's own buffer
+//
+
+#ifndef _CONSTANT_RING_H
+#define _CONSTANT_RING_H
+
+#include "RenderDevice.h"
+
+// where a block of constants was written
+struct ConstantAllocation
+{
+	DeviceBuffer* pBuffer;
+	UINT firstConstant;	// in 16 byte shader constants
+	UINT numConstants;	// always a multiple of 16
+	UINT generation;	// which pass through the ring it was written in
+};
+
+class ConstantRing
+{
+public:
+	// the one ring used by every shader
+	static ConstantRing& Get();
+
+	// create the ring if the device can bind at an offset
+	bool Initialize(RenderDevice* pRenderDevice, UINT sizeInBytes);
+
+	// give the ring back to the device it came from
+	void Release();
+
+	// true when allocations are bound with offsets, false on 11.0 devices
+	bool IsOffsetting() const { return pRingBuffer != nullptr; }
+
+	// start a new frame, allocations from the last frame may no longer be bound
+	void BeginFrame();
+
+	// make sure the next uploads totalling size bytes fit without wrapping, so none of them
+	// can leave an earlier one of the same draw behind
+	void Reserve(UINT size);
+
+	// size of an upload once padded to the offset alignment
+	static UINT AlignedSize(UINT size);
+
+	// copy constants to the GPU. With offsets they land in the ring, otherwise pFallbackBuffer is rewritten
+	bool Upload(RenderDevice* pRenderDevice, DeviceBuffer* pFallbackBuffer, const void* pData, UINT size, ConstantAllocation& outAllocation);
+
+	// false once the ring has wrapped or a new frame started, the constants must be uploaded again
+	bool IsCurrent(const ConstantAllocation& allocation) const;
+
+	// bind an allocation to a vertex or pixel shader slot
+	void BindVS(RenderDevice* pRenderDevice, UINT slot, const ConstantAllocation& allocation);
+	void BindPS(RenderDevice* pRenderDevice, UINT slot, const ConstantAllocation& allocation);
+
+	// how the uploads reached the GPU since the last reset
+	int GetUploads() const { return uploads; }
+	int GetDiscards() const { return discards; }
+	int GetFallbackUploads() const { return fallbackUploads; }
+	void ResetStats();
+
+	// writes the counts to the debug output
+	void ReportStats() const;
+
+private:
+	ConstantRing();
+	~ConstantRing();
+
+	// ring is shared, never copied
+	ConstantRing(const ConstantRing&);
+	ConstantRing& operator=(const ConstantRing&);
+
+	DeviceBuffer* pRingBuffer;
+
+	// the device that made the ring
+	RenderDevice* pRingDevice;
+
+	UINT ringSize;
+	UINT cursor;
+
+	// the next map must discard, either a new frame started or the ring wrapped
+	bool discardNext;
+	UINT generation;
+
+	int uploads;
+	int discards;
+	int fallbackUploads;
+};
+
+#endif
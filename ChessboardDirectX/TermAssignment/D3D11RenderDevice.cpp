@@ -0,0 +1,232 @@
+//
+// BGTD 9201
+//	The render device on the Direct3D 11 immediate context
+//
+
+#include "D3D11RenderDevice.h"
+#include <cstring>
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+D3D11RenderDevice::D3D11RenderDevice()
+{
+	pDevice = nullptr;
+	pDeviceContext = nullptr;
+	pContext1 = nullptr;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+D3D11RenderDevice::~D3D11RenderDevice()
+{
+	Release();
+}
+
+// ------------------------------------------------------------------------------------
+// The device and context belong to the DirectX class, only the 11.1 interface is ours
+// ------------------------------------------------------------------------------------
+bool D3D11RenderDevice::Initialize(ID3D11Device* pInDevice, ID3D11DeviceContext* pInDeviceContext)
+{
+	Release();
+
+	pDevice = pInDevice;
+	pDeviceContext = pInDeviceContext;
+
+	// offsets need the 11.1 runtime and a driver that supports them, no overwrite maps let
+	// several draws write into one constant buffer without renaming it
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+	memset(&options, 0, sizeof(options));
+	pDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+
+	if (options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer)
+	{
+		if (FAILED(pDeviceContext->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&pContext1)))
+		{
+			pContext1 = nullptr;
+		}
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::Release()
+{
+	if (pContext1)
+	{
+		pContext1->Release();
+		pContext1 = nullptr;
+	}
+	pDevice = nullptr;
+	pDeviceContext = nullptr;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+DeviceBuffer* D3D11RenderDevice::CreateConstantBuffer(UINT sizeInBytes)
+{
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.ByteWidth = sizeInBytes;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+
+	ID3D11Buffer* pBuffer = nullptr;
+	if (FAILED(pDevice->CreateBuffer(&bufferDesc, NULL, &pBuffer)))
+	{
+		return nullptr;
+	}
+	return pBuffer;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::ReleaseBuffer(DeviceBuffer* pBuffer)
+{
+	if (pBuffer)
+	{
+		pBuffer->Release();
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Direct3D always maps the whole buffer, hand back the part asked for
+// ------------------------------------------------------------------------------------
+void* D3D11RenderDevice::Map(DeviceBuffer* pBuffer, DeviceMapMode mode, UINT offset, UINT size)
+{
+	D3D11_MAPPED_SUBRESOURCE resource;
+	if (FAILED(pDeviceContext->Map(pBuffer, 0, (D3D11_MAP)mode, 0, &resource)))
+	{
+		return nullptr;
+	}
+	return (unsigned char*)resource.pData + offset;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::Unmap(DeviceBuffer* pBuffer)
+{
+	pDeviceContext->Unmap(pBuffer, 0);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::IASetInputLayout(DeviceInputLayout* pInputLayout)
+{
+	pDeviceContext->IASetInputLayout(pInputLayout);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::IASetPrimitiveTopology(DeviceTopology topology)
+{
+	pDeviceContext->IASetPrimitiveTopology((D3D11_PRIMITIVE_TOPOLOGY)topology);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::IASetVertexBuffers(UINT startSlot, UINT numBuffers, DeviceBuffer* const* ppBuffers, const UINT* pStrides, const UINT* pOffsets)
+{
+	pDeviceContext->IASetVertexBuffers(startSlot, numBuffers, ppBuffers, pStrides, pOffsets);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::IASetIndexBuffer(DeviceBuffer* pIndexBuffer, DeviceIndexFormat format, UINT offset)
+{
+	pDeviceContext->IASetIndexBuffer(pIndexBuffer, (DXGI_FORMAT)format, offset);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::VSSetShader(DeviceVertexShader* pShader)
+{
+	pDeviceContext->VSSetShader(pShader, NULL, 0);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::PSSetShader(DevicePixelShader* pShader)
+{
+	pDeviceContext->PSSetShader(pShader, NULL, 0);
+}
+
+// ------------------------------------------------------------------------------------
+// Slices need the 11.1 context, whole buffers go through the plain one
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::VSSetConstantBuffer(UINT slot, DeviceBuffer* pBuffer, UINT firstConstant, UINT numConstants)
+{
+	if (numConstants != 0 && pContext1 != nullptr)
+	{
+		pContext1->VSSetConstantBuffers1(slot, 1, &pBuffer, &firstConstant, &numConstants);
+	}
+	else
+	{
+		pDeviceContext->VSSetConstantBuffers(slot, 1, &pBuffer);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::PSSetConstantBuffer(UINT slot, DeviceBuffer* pBuffer, UINT firstConstant, UINT numConstants)
+{
+	if (numConstants != 0 && pContext1 != nullptr)
+	{
+		pContext1->PSSetConstantBuffers1(slot, 1, &pBuffer, &firstConstant, &numConstants);
+	}
+	else
+	{
+		pDeviceContext->PSSetConstantBuffers(slot, 1, &pBuffer);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::PSSetSampler(UINT slot, DeviceSampler* pSampler)
+{
+	pDeviceContext->PSSetSamplers(slot, 1, &pSampler);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::PSSetShaderResource(UINT slot, DeviceTexture* pView)
+{
+	pDeviceContext->PSSetShaderResources(slot, 1, &pView);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::RSSetState(DeviceRasterizerState* pState)
+{
+	pDeviceContext->RSSetState(pState);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::OMSetDepthStencilState(DeviceDepthStencilState* pState, UINT stencilRef)
+{
+	pDeviceContext->OMSetDepthStencilState(pState, stencilRef);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::Draw(UINT vertexCount, UINT startVertex)
+{
+	pDeviceContext->Draw(vertexCount, startVertex);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::DrawIndexed(UINT indexCount, UINT startIndex, int baseVertex)
+{
+	pDeviceContext->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void D3D11RenderDevice::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, int baseVertex, UINT startInstance)
+{
+	pDeviceContext->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
@@ -0,0 +1,68 @@
+//
+// BGTD 9201
+//	The render device on the Direct3D 11 immediate context
+//
+
+#ifndef _D3D11_RENDER_DEVICE_H
+#define _D3D11_RENDER_DEVICE_H
+
+#include <d3d11_1.h>
+
+#include "RenderDevice.h"
+
+class D3D11RenderDevice : public RenderDevice
+{
+public:
+	D3D11RenderDevice();
+	~D3D11RenderDevice();
+
+	// hold on to the context, and look for the 11.1 interface used for constant buffer offsets
+	bool Initialize(ID3D11Device* pDevice, ID3D11DeviceContext* pDeviceContext);
+	void Release();
+
+	void BeginFrame() {}
+	void EndFrame() {}
+
+	bool SupportsConstantOffsets() const { return pContext1 != nullptr; }
+
+	DeviceBuffer* CreateConstantBuffer(UINT sizeInBytes);
+	void ReleaseBuffer(DeviceBuffer* pBuffer);
+
+	void* Map(DeviceBuffer* pBuffer, DeviceMapMode mode, UINT offset, UINT size);
+	void Unmap(DeviceBuffer* pBuffer);
+
+	void IASetInputLayout(DeviceInputLayout* pInputLayout);
+	void IASetPrimitiveTopology(DeviceTopology topology);
+	void IASetVertexBuffers(UINT startSlot, UINT numBuffers, DeviceBuffer* const* ppBuffers, const UINT* pStrides, const UINT* pOffsets);
+	void IASetIndexBuffer(DeviceBuffer* pIndexBuffer, DeviceIndexFormat format, UINT offset);
+
+	void VSSetShader(DeviceVertexShader* pShader);
+	void PSSetShader(DevicePixelShader* pShader);
+
+	void VSSetConstantBuffer(UINT slot, DeviceBuffer* pBuffer, UINT firstConstant, UINT numConstants);
+	void PSSetConstantBuffer(UINT slot, DeviceBuffer* pBuffer, UINT firstConstant, UINT numConstants);
+
+	void PSSetSampler(UINT slot, DeviceSampler* pSampler);
+	void PSSetShaderResource(UINT slot, DeviceTexture* pView);
+
+	void RSSetState(DeviceRasterizerState* pState);
+	void OMSetDepthStencilState(DeviceDepthStencilState* pState, UINT stencilRef);
+
+	void Draw(UINT vertexCount, UINT startVertex);
+	void DrawIndexed(UINT indexCount, UINT startIndex, int baseVertex);
+	void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, int baseVertex, UINT startInstance);
+
+private:
+
+	// device is shared, never copied
+	D3D11RenderDevice(const D3D11RenderDevice&);
+	D3D11RenderDevice& operator=(const D3D11RenderDevice&);
+
+	ID3D11Device* pDevice;
+	ID3D11DeviceContext* pDeviceContext;
+
+	// only set when the driver supports constant buffer offsets
+	ID3D11DeviceContext1* pContext1;
+};
+
+#endif
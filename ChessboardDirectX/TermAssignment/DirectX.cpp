@@ -101,7 +101,9 @@ void DirectXClass::RenderScene(void)
 		DeviceContext->ClearDepthStencilView(DepthStencilView, D3D11_CLEAR_DEPTH, 1.0f, 0);
 	}
 
+	pRenderDevice->BeginFrame();
 	Render();
+	pRenderDevice->EndFrame();
 
 	if( displayFPS )
 		DisplayFramesPerSecond(5, 5);
@@ -147,6 +149,9 @@ bool DirectXClass::InitializeDirect3D(void)
 	InitializeViewPorts();
 	font.InitializeFont(D3DDevice, DeviceContext, L"..\\Font\\Arial16.spritefont");
 
+	d3dRenderDevice.Initialize(D3DDevice, DeviceContext);
+	pRenderDevice = &d3dRenderDevice;
+
 	return true;
 }
 
@@ -265,6 +270,7 @@ DirectXClass::DirectXClass(HINSTANCE hInstance)
 	DepthStencilView = NULL;
 	DepthStencilBuffer = NULL;
 	RasterState = NULL;
+	pRenderDevice = nullptr;
 
 	depthStencilUsed = true;
 	displayFPS = true;
@@ -295,6 +301,7 @@ DirectXClass::~DirectXClass()
 	SAFE_RELEASE( RenderTargetView );
 	SAFE_RELEASE( BackBuffer );
 	SAFE_RELEASE( SwapChain );
+	d3dRenderDevice.Release();
 	SAFE_RELEASE( DeviceContext );
 	SAFE_RELEASE( D3DDevice );
 	SAFE_RELEASE( RasterState );
@@ -4,6 +4,7 @@
 
 #include "Timer.h"
 #include "Font.h"
+#include "D3D11RenderDevice.h"
 
 using namespace std;
 
@@ -41,6 +42,10 @@ class DirectXClass
 
 	ID3D11DepthStencilState* DepthStencilState;
 
+	// the frame's draws go through a render device rather than the context itself
+	D3D11RenderDevice d3dRenderDevice;
+	RenderDevice* pRenderDevice;
+
     TimerType timer;
     FontType  font;
 	int PresentInterval;							// controls VSync locking
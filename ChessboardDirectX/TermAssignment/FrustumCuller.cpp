@@ -0,0 +1,174 @@
+//
+// BGTD 9201
+//	Tests bounding spheres against the camera frustum four at a time
+//
+
+#include "FrustumCuller.h"
+#include <sstream>
+#include <cmath>
+
+using namespace DirectX;
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+FrustumCuller::FrustumCuller()
+{
+	for (int i = 0; i < NUM_PLANES; i++)
+	{
+		planes[i] = XMFLOAT4(0, 0, 0, 0);
+	}
+	numSpheres = 0;
+
+	ResetStats();
+}
+
+// ------------------------------------------------------------------------------------
+// Pull the planes out of the matrix's columns. Points go in as rows, so clip x is the
+// dot with column 0 and D3D keeps 0 <= z <= w
+// ------------------------------------------------------------------------------------
+void FrustumCuller::SetFrustum(const XMFLOAT4X4& viewProjection)
+{
+	const XMFLOAT4X4& m = viewProjection;
+	XMFLOAT3 columnX(m._11, m._21, m._31);
+	XMFLOAT3 columnY(m._12, m._22, m._32);
+	XMFLOAT3 columnZ(m._13, m._23, m._33);
+	XMFLOAT3 columnW(m._14, m._24, m._34);
+
+	// left, right, bottom, top, near, far
+	XMVECTOR extracted[NUM_PLANES] =
+	{
+		XMVectorSet(columnW.x + columnX.x, columnW.y + columnX.y, columnW.z + columnX.z, m._44 + m._41),
+		XMVectorSet(columnW.x - columnX.x, columnW.y - columnX.y, columnW.z - columnX.z, m._44 - m._41),
+		XMVectorSet(columnW.x + columnY.x, columnW.y + columnY.y, columnW.z + columnY.z, m._44 + m._42),
+		XMVectorSet(columnW.x - columnY.x, columnW.y - columnY.y, columnW.z - columnY.z, m._44 - m._42),
+		XMVectorSet(columnZ.x, columnZ.y, columnZ.z, m._43),
+		XMVectorSet(columnW.x - columnZ.x, columnW.y - columnZ.y, columnW.z - columnZ.z, m._44 - m._43),
+	};
+
+	// normalized so the distances can be compared with radii
+	for (int i = 0; i < NUM_PLANES; i++)
+	{
+		XMStoreFloat4(&planes[i], XMPlaneNormalize(extracted[i]));
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Start a new frame
+// ------------------------------------------------------------------------------------
+void FrustumCuller::Begin()
+{
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	radius.clear();
+	numSpheres = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// Queue a sphere
+// ------------------------------------------------------------------------------------
+UINT FrustumCuller::AddSphere(const XMFLOAT3& center, float sphereRadius)
+{
+	centerX.push_back(center.x);
+	centerY.push_back(center.y);
+	centerZ.push_back(center.z);
+	radius.push_back(sphereRadius);
+
+	return numSpheres++;
+}
+
+// ------------------------------------------------------------------------------------
+// Queue a mesh's sphere, the radius grows with the largest scale in the matrix
+// ------------------------------------------------------------------------------------
+UINT FrustumCuller::AddBounds(const MeshBounds& bounds, const XMFLOAT4X4& worldMatrix)
+{
+	XMFLOAT3 center;
+	XMStoreFloat3(&center, XMVector3Transform(XMLoadFloat3(&bounds.sphereCenter), XMLoadFloat4x4(&worldMatrix)));
+
+	const XMFLOAT4X4& m = worldMatrix;
+	float scaleX = m._11 * m._11 + m._12 * m._12 + m._13 * m._13;
+	float scaleY = m._21 * m._21 + m._22 * m._22 + m._23 * m._23;
+	float scaleZ = m._31 * m._31 + m._32 * m._32 + m._33 * m._33;
+	float scale = scaleX;
+	if (scaleY > scale) scale = scaleY;
+	if (scaleZ > scale) scale = scaleZ;
+	scale = sqrtf(scale);
+
+	return AddSphere(center, bounds.sphereRadius * scale);
+}
+
+// ------------------------------------------------------------------------------------
+// A sphere is out once its centre is more than its radius behind any plane
+// ------------------------------------------------------------------------------------
+void FrustumCuller::Cull()
+{
+	// pad to whole groups of four, the padding is never asked about
+	size_t padded = (numSpheres + 3) & ~(size_t)3;
+	centerX.resize(padded, 0.0f);
+	centerY.resize(padded, 0.0f);
+	centerZ.resize(padded, 0.0f);
+	radius.resize(padded, 0.0f);
+	culled.resize(padded);
+
+	// every plane component spread across a register, ready for four spheres at a time
+	XMVECTOR planeX[NUM_PLANES];
+	XMVECTOR planeY[NUM_PLANES];
+	XMVECTOR planeZ[NUM_PLANES];
+	XMVECTOR planeW[NUM_PLANES];
+	for (int i = 0; i < NUM_PLANES; i++)
+	{
+		XMVECTOR plane = XMLoadFloat4(&planes[i]);
+		planeX[i] = XMVectorSplatX(plane);
+		planeY[i] = XMVectorSplatY(plane);
+		planeZ[i] = XMVectorSplatZ(plane);
+		planeW[i] = XMVectorSplatW(plane);
+	}
+
+	for (size_t group = 0; group < padded; group += 4)
+	{
+		XMVECTOR x = XMLoadFloat4((const XMFLOAT4*)&centerX[group]);
+		XMVECTOR y = XMLoadFloat4((const XMFLOAT4*)&centerY[group]);
+		XMVECTOR z = XMLoadFloat4((const XMFLOAT4*)&centerZ[group]);
+		XMVECTOR negativeRadius = XMVectorNegate(XMLoadFloat4((const XMFLOAT4*)&radius[group]));
+
+		XMVECTOR outside = XMVectorZero();
+		for (int i = 0; i < NUM_PLANES; i++)
+		{
+			XMVECTOR distance = XMVectorMultiplyAdd(x, planeX[i], XMVectorMultiplyAdd(y, planeY[i], XMVectorMultiplyAdd(z, planeZ[i], planeW[i])));
+			outside = XMVectorOrInt(outside, XMVectorLess(distance, negativeRadius));
+		}
+		XMStoreInt4(&culled[group], outside);
+	}
+
+	for (UINT i = 0; i < numSpheres; i++)
+	{
+		if (culled[i])
+		{
+			numCulled++;
+		}
+		else
+		{
+			numVisible++;
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Clear the counters
+// ------------------------------------------------------------------------------------
+void FrustumCuller::ResetStats()
+{
+	numVisible = 0;
+	numCulled = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// Write the counts to the debug output
+// ------------------------------------------------------------------------------------
+void FrustumCuller::ReportStats() const
+{
+	std::wostringstream message;
+	message << L"FrustumCuller: " << numVisible << L" visible, " << numCulled << L" culled\n";
+
+	OutputDebugString(message.str().c_str());
+}
@@ -0,0 +1,72 @@
+//
+// BGTD 9201
+//	Tests bounding spheres against the camera frustum four at a time, so
+//	whatever is off screen never reaches the render queue
+//
+
+#ifndef _FRUSTUM_CULLER_H
+#define _FRUSTUM_CULLER_H
+
+#include <DirectXMath.h>
+#include <vector>
+#include <stdint.h>
+
+#include "Platform.h"
+#include "Models.h"
+
+class FrustumCuller
+{
+public:
+	FrustumCuller();
+
+	// pull the six planes out of the camera's view * projection
+	void SetFrustum(const DirectX::XMFLOAT4X4& viewProjection);
+
+	// throw away last frame's spheres
+	void Begin();
+
+	// queue a sphere to test, returns the index to ask IsVisible about
+	UINT AddSphere(const DirectX::XMFLOAT3& center, float radius);
+
+	// queue a mesh's sphere moved into place by its world matrix
+	UINT AddBounds(const MeshBounds& bounds, const DirectX::XMFLOAT4X4& worldMatrix);
+
+	// test every queued sphere against every plane
+	void Cull();
+
+	// whether a sphere is at least partly inside the frustum, only valid after Cull
+	bool IsVisible(UINT index) const { return culled[index] == 0; }
+
+	UINT GetNumSpheres() const { return numSpheres; }
+
+	// how much was tested and thrown away since the last reset
+	int GetNumVisible() const { return numVisible; }
+	int GetNumCulled() const { return numCulled; }
+	void ResetStats();
+
+	// writes the counts to the debug output
+	void ReportStats() const;
+
+private:
+
+	static const int NUM_PLANES = 6;
+
+	// normalized planes, xyz points into the frustum and w is the distance
+	DirectX::XMFLOAT4 planes[NUM_PLANES];
+
+	// the spheres as separate arrays, padded to a multiple of 4 so each plane
+	// test loads four spheres at once
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radius;
+	UINT numSpheres;
+
+	// all bits set for spheres outside any plane
+	std::vector<uint32_t> culled;
+
+	int numVisible;
+	int numCulled;
+};
+
+#endif
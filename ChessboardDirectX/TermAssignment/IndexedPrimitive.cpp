@@ -8,6 +8,8 @@
 #include <VertexTypes.h>
 #include <vector>
 #include "Models.h"
+#include "MeshRegistry.h"
+#include "StateCache.h"
 
 static bool faceNormals = false;
 
@@ -54,75 +56,37 @@ IndexedPrimitive::~IndexedPrimitive()
 // ------------------------------------------------------------------------------------
 void IndexedPrimitive::InitializeGeometry(ID3D11Device* pDevice, ModelType type)
 {
-	// build the icosahedron
-	VertexCollection vertices;
-	IndexCollection indices;
-		
-	// create the model
-	switch (type)
+	InitializeGeometry(pDevice, type, 1.0f, DEFAULT_TESSELLATION);
+}
+
+// ------------------------------------------------------------------------------------
+// Initialize the vertex buffer with a given size and tessellation
+// ------------------------------------------------------------------------------------
+void IndexedPrimitive::InitializeGeometry(ID3D11Device* pDevice, ModelType type, float size, size_t tessellation)
+{
+	// let go of any previous geometry
+	if (pVertexBuffer != nullptr)
 	{
-		case Cube: 
-			Models::CreateCube(vertices, indices, 1.0f);
-			break;
-		case Torus:
-			Models::CreateTorus(vertices, indices, 1.0f, 0.5f, 24);
-			break;
-		case Cone:
-			Models::CreateCone(vertices, indices, 1, 1, 24);
-			break;
-		case Cylinder:
-			Models::CreateCylinder(vertices, indices, 1, 1, 24);
-			break;
-		case Sphere:
-			Models::CreateSphere(vertices, indices, 1, 24);
-			break;
+		pVertexBuffer->Release();
+		pVertexBuffer = nullptr;
 	}
-
-	//
-	numVerts = vertices.size();
-	numIndices = indices.size();
-
-
-	// describe the vertex buffer we are trying to create
-	D3D11_BUFFER_DESC desc;
-	desc.ByteWidth = numVerts * sizeof(VertexPositionNormalTexture);
-	desc.Usage = D3D11_USAGE_IMMUTABLE;
-	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	desc.CPUAccessFlags = 0;
-	desc.MiscFlags = 0;
-
-	// setup the subresource data - tells D3D what data to use to initialize
-	// the vertexbuffer with
-	D3D11_SUBRESOURCE_DATA data;
-	data.pSysMem = vertices.data();
-
-	// create the vertex buffer
-	HRESULT hr = pDevice->CreateBuffer(&desc, &data, &pVertexBuffer);
-	if (FAILED(hr))
+	if (pIndexBuffer != nullptr)
 	{
-		OutputDebugString(L"FAILED TO CREATE VERTEX BUFFER");
-		assert(false);
+		pIndexBuffer->Release();
+		pIndexBuffer = nullptr;
 	}
 
-
-	// set up  the index buffer
-	D3D11_BUFFER_DESC indexBufferDesc;
-	indexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	indexBufferDesc.ByteWidth = numIndices * sizeof(uint16_t);
-	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	indexBufferDesc.CPUAccessFlags = 0;
-	indexBufferDesc.MiscFlags = 0;
-	indexBufferDesc.StructureByteStride = 0;
-
-	D3D11_SUBRESOURCE_DATA indexData;
-	indexData.pSysMem = indices.data();
-
-	hr = pDevice->CreateBuffer(&indexBufferDesc, &indexData, &pIndexBuffer);
-	if (FAILED(hr))
+	// the registry only builds the buffers the first time this mesh is asked for
+	SharedMesh mesh;
+	if (!MeshRegistry::Get().AcquireMesh(pDevice, type, size, tessellation, mesh))
 	{
-		OutputDebugString(L"FAILED TO CREATE INDEX BUFFER");
-		assert(false);
+		return;
 	}
+
+	pVertexBuffer = mesh.pVertexBuffer;
+	pIndexBuffer = mesh.pIndexBuffer;
+	numVerts = mesh.numVerts;
+	numIndices = mesh.numIndices;
 }
 
 // ------------------------------------------------------------------------------------
@@ -130,39 +94,82 @@ void IndexedPrimitive::InitializeGeometry(ID3D11Device* pDevice, ModelType type)
 // ------------------------------------------------------------------------------------
 void IndexedPrimitive::InitializeInputLayout(ID3D11Device* pDevice, const void* pBinary, size_t binarySize)
 {
-	// create the input layout
-	HRESULT hr = pDevice->CreateInputLayout(VertexPositionNormalTexture::InputElements,
+	if (pInputLayout != nullptr)
+	{
+		pInputLayout->Release();
+		pInputLayout = nullptr;
+	}
+
+	// create the input layout, or share the one already made for this shader
+	pInputLayout = MeshRegistry::Get().AcquireInputLayout(pDevice,
+		VertexPositionNormalTexture::InputElements,
 		VertexPositionNormalTexture::InputElementCount,
-		pBinary, binarySize,
-		&pInputLayout);
-	if (FAILED(hr))
+		pBinary, binarySize);
+}
+
+// ------------------------------------------------------------------------------------
+// Initialzes the shaders with a custom vertex layout
+// ------------------------------------------------------------------------------------
+void IndexedPrimitive::InitializeInputLayout(ID3D11Device* pDevice, const D3D11_INPUT_ELEMENT_DESC* pElements, UINT numElements, const void* pBinary, size_t binarySize)
+{
+	if (pInputLayout != nullptr)
 	{
-		OutputDebugString(L"Failed to create input layout");
-		assert(0);
+		pInputLayout->Release();
+		pInputLayout = nullptr;
 	}
+
+	pInputLayout = MeshRegistry::Get().AcquireInputLayout(pDevice, pElements, numElements, pBinary, binarySize);
 }
 
 // ------------------------------------------------------------------------------------
 // Draw the IndexedPrimitive
 // ------------------------------------------------------------------------------------
-void IndexedPrimitive::Draw(ID3D11DeviceContext* pDeviceContext)
+void IndexedPrimitive::Draw(RenderDevice* pRenderDevice)
 {
 	// Set up our input layout
-	pDeviceContext->IASetInputLayout(pInputLayout);
+	StateCache::Get().IASetInputLayout(pRenderDevice, pInputLayout);
 
 	//  tell D3D we are drawing a triangle list
-	pDeviceContext->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	StateCache::Get().IASetPrimitiveTopology(pRenderDevice, TriangleListTopology);
 
 	//  Tell the device which vertex buffer we are using
 	UINT stride = sizeof(VertexPositionNormalTexture);
 	UINT offset = 0;
-	pDeviceContext->IASetVertexBuffers(0, 1, &pVertexBuffer, &stride, &offset);
+	StateCache::Get().IASetVertexBuffers(pRenderDevice, 0, 1, &pVertexBuffer, &stride, &offset);
 
 	// Set the index buffer
-	pDeviceContext->IASetIndexBuffer(pIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
+	StateCache::Get().IASetIndexBuffer(pRenderDevice, pIndexBuffer, Index16Format, 0);
 
 	//	tell it to draw the primitive
-	pDeviceContext->DrawIndexed(numIndices, 0, 0);
+	pRenderDevice->DrawIndexed(numIndices, 0, 0);
 }
 
+// ------------------------------------------------------------------------------------
+// Draw several instances of the IndexedPrimitive in one call
+// ------------------------------------------------------------------------------------
+void IndexedPrimitive::DrawInstanced(RenderDevice* pRenderDevice, DeviceBuffer* pInstanceBuffer, UINT instanceStride, UINT numInstances, UINT startInstance)
+{
+	// nothing to submit for parts that were never given geometry
+	if (pVertexBuffer == nullptr || numInstances == 0)
+	{
+		return;
+	}
+
+	// Set up our input layout
+	StateCache::Get().IASetInputLayout(pRenderDevice, pInputLayout);
+
+	//  tell D3D we are drawing a triangle list
+	StateCache::Get().IASetPrimitiveTopology(pRenderDevice, TriangleListTopology);
+
+	//  the mesh goes in slot 0, the per-instance data in slot 1
+	ID3D11Buffer* buffers[2] = { pVertexBuffer, pInstanceBuffer };
+	UINT strides[2] = { sizeof(VertexPositionNormalTexture), instanceStride };
+	UINT offsets[2] = { 0, 0 };
+	StateCache::Get().IASetVertexBuffers(pRenderDevice, 0, 2, buffers, strides, offsets);
 
+	// Set the index buffer
+	StateCache::Get().IASetIndexBuffer(pRenderDevice, pIndexBuffer, Index16Format, 0);
+
+	//	tell it to draw all the instances
+	pRenderDevice->DrawIndexedInstanced(numIndices, numInstances, 0, 0, startInstance);
+}
@@ -9,34 +9,35 @@
 #include <SimpleMath.h>
 #include <Effects.h>
 
+#include "Models.h"
+#include "RenderDevice.h"
+
 using namespace DirectX;
 using namespace DirectX::SimpleMath;
 
 
-enum ModelType
-{
-	Cube,
-	Torus,
-	Cone,
-	Cylinder,
-	Sphere
-};
-
-
 class IndexedPrimitive
 {
 public:
 	IndexedPrimitive();
 	~IndexedPrimitive();
 
-	// initialze the geometry
+	// tessellation used by the curved primitives unless asked otherwise
+	static const size_t DEFAULT_TESSELLATION = Models::DEFAULT_TESSELLATION;
+
+	// initialze the geometry, identical primitives share their buffers through the MeshRegistry
 	void InitializeGeometry(ID3D11Device* pDevice, ModelType type );
+	void InitializeGeometry(ID3D11Device* pDevice, ModelType type, float size, size_t tessellation);
 
-	// set up the input layout
+	// set up the input layout, shared by every primitive using the same vertex shader
 	void InitializeInputLayout(ID3D11Device* pDevice, const void* pBinary, size_t binarySize);
+	void InitializeInputLayout(ID3D11Device* pDevice, const D3D11_INPUT_ELEMENT_DESC* pElements, UINT numElements, const void* pBinary, size_t binarySize);
 
 	// draw the primitive
-	void Draw(ID3D11DeviceContext* pDeviceContext);
+	void Draw(RenderDevice* pRenderDevice);
+
+	// draw several copies of the primitive, the instance buffer is bound to slot 1
+	void DrawInstanced(RenderDevice* pRenderDevice, DeviceBuffer* pInstanceBuffer, UINT instanceStride, UINT numInstances, UINT startInstance);
 
 
 private:
@@ -0,0 +1,124 @@
+//
+// BGTD 9201
+//	The worker threads behind ParallelFor
+//
+
+#include "JobPool.h"
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+JobPool::JobPool(int inNumThreads)
+{
+	numThreads = inNumThreads;
+	if (numThreads <= 0)
+	{
+		numThreads = (int)std::thread::hardware_concurrency();
+		if (numThreads <= 0) numThreads = 1;
+	}
+
+	pJob = nullptr;
+	jobCount = 0;
+	nextJob = 0;
+	workersBusy = 0;
+	jobGeneration = 0;
+	quitting = false;
+
+	for (int i = 1; i < numThreads; i++)
+	{
+		workers.push_back(std::thread(&JobPool::WorkerLoop, this));
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+JobPool::~JobPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		quitting = true;
+	}
+	jobReady.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Hand out jobs to the workers and take some on this thread
+// ------------------------------------------------------------------------------------
+void JobPool::ParallelFor(size_t count, const std::function<void(size_t)>& job)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	if (workers.empty() || count == 1)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			job(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		pJob = &job;
+		jobCount = count;
+		nextJob = 0;
+		workersBusy = (int)workers.size();
+		jobGeneration++;
+	}
+	jobReady.notify_all();
+
+	for (size_t i = nextJob++; i < count; i = nextJob++)
+	{
+		job(i);
+	}
+
+	// the job lives on the caller's stack, so every worker has to be finished with it
+	std::unique_lock<std::mutex> lock(jobMutex);
+	jobDone.wait(lock, [this] { return workersBusy == 0; });
+	pJob = nullptr;
+}
+
+// ------------------------------------------------------------------------------------
+// Wait for a job, help with it, repeat
+// ------------------------------------------------------------------------------------
+void JobPool::WorkerLoop()
+{
+	uint64_t seenGeneration = 0;
+
+	for (;;)
+	{
+		const std::function<void(size_t)>* pCurrentJob;
+		size_t count;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobReady.wait(lock, [&] { return quitting || jobGeneration != seenGeneration; });
+			if (quitting)
+			{
+				return;
+			}
+			seenGeneration = jobGeneration;
+			pCurrentJob = pJob;
+			count = jobCount;
+		}
+
+		for (size_t i = nextJob++; i < count; i = nextJob++)
+		{
+			(*pCurrentJob)(i);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			if (--workersBusy == 0)
+			{
+				jobDone.notify_one();
+			}
+		}
+	}
+}
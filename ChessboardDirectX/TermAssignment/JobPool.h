@@ -0,0 +1,56 @@
+//
+// BGTD 9201
+//	A fixed set of worker threads that split a loop of independent jobs with
+//	the calling thread. Jobs are handed out one index at a time from an atomic
+//	counter, and the call returns once every one is done, so the job can live
+//	on the caller's stack. Shared by the transform store and the software
+//	rasterizer
+//
+
+#ifndef _JOB_POOL_H
+#define _JOB_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+class JobPool
+{
+public:
+	// 0 threads uses every core, 1 keeps the work on the calling thread
+	JobPool(int numThreads = 1);
+	~JobPool();
+
+	// run job(i) for every i below count on every thread, returns once they are all done
+	void ParallelFor(size_t count, const std::function<void(size_t)>& job);
+
+	int GetNumThreads() const { return numThreads; }
+
+private:
+
+	// the workers point back at the pool, so it's never copied
+	JobPool(const JobPool&);
+	JobPool& operator=(const JobPool&);
+
+	void WorkerLoop();
+
+	// the calling thread works too, so there's one worker less than numThreads
+	int numThreads;
+	std::vector<std::thread> workers;
+	std::mutex jobMutex;
+	std::condition_variable jobReady;
+	std::condition_variable jobDone;
+	const std::function<void(size_t)>* pJob;
+	size_t jobCount;
+	std::atomic<size_t> nextJob;
+	int workersBusy;
+	uint64_t jobGeneration;
+	bool quitting;
+};
+
+#endif
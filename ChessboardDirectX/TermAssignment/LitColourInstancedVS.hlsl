@@ -0,0 +1,39 @@
+// Instanced vertex shader for the lit colour shader
+//	Each instance supplies its own world matrix and colour
+//
+
+#include "VertexPositionNormalTexture.hlsli"
+
+PS_INPUT main( VS_INSTANCED_INPUT input )
+{
+	PS_INPUT output;
+
+	// rebuild the instance matrix from its rows
+	float4x4 instanceWorld = float4x4(input.InstanceWorld0, input.InstanceWorld1, input.InstanceWorld2, input.InstanceWorld3);
+
+	// the constant world matrix is applied first, then the instance's
+	float4 worldPosition = mul(mul(input.Pos, worldMatrix), instanceWorld);
+	output.Pos = mul(worldPosition, viewProjectionMatrix);
+
+	// the instance colour is interpolated through to the pixel shader
+	output.Color = input.InstanceColour;
+
+	// this is the instance matrix, not its inverse-transpose. Once normalized in the pixel
+	// shader that is only right for rigid or uniformly scaled instances, or for faces that
+	// are themselves axis aligned under an axis scale. The squares are cubes squashed along
+	// y and the pieces are placed rigidly, so both hold, but a sloped face under a
+	// non-uniform instance scale would get the wrong normal
+	float4 normal = mul(float4(input.Normal, 0), worldMatrixIT);
+	output.WorldNormal = mul(normal, instanceWorld).xyz;
+
+	// we need the position in world space to do specular lighting
+	output.WorldPosition = worldPosition.xyz;
+
+	// copy the UVa
+	output.UV = input.UV;
+
+	// every vertex of a baked part shares its material
+	output.MaterialIndex = input.MaterialIndex;
+
+	return output;
+}
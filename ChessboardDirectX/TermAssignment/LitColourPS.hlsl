@@ -16,7 +16,7 @@ float4 main(PS_INPUT input) : SV_TARGET
 	float4 texColor = MainTex.Sample(Sampler, input.UV);
 
 	float4 finalColor =
-		AmbientLighting(texColor, ambientColour)
+		AmbientLighting(texColor, ambientColour * input.Color)
 		+ DiffuseLighting(directionalLightVector.xyz, normal, directionalLightColor, texColor)
 		+ SpecularLightingBlinnPhong(directionalLightVector.xyz, normal, worldCameraPos.xyz, input.WorldPosition.xyz, specularLightColor, texColor, specularLightColor.a);
 	//	+ DiffuseLighting(directionalLightVector2.xyz, normal, directionalLightColor2, texColor)
@@ -6,25 +6,45 @@
 
 #include <D3Dcompiler.h>
 #include "LitColourShader.h"
+#include "StateCache.h"
 #include <DirectXColors.h>
+#include <sstream>
 
 using namespace DirectX;
 
 //
-// Aligns with the constants inside the shader
+// Aligns with the per-object constants inside the shader
 //
 struct ShaderConstants
 {
 	Matrix	worldMatrix;
-	Matrix  viewMatrix;
-	Matrix  projectionMatrix;
 	Matrix  worldViewProjectionMatrix;
 	Matrix  worldMatrixIT;
-	Vector4 worldCameraPosition;
 };
 
+// every draw used to upload all five matrices and the camera, and invert both world and view.
+// the old path is gone, so this is only what it would have cost
+static const int SINGLE_BUFFER_SIZE = 5 * sizeof(Matrix) + sizeof(Vector4);
+static const int SINGLE_BUFFER_INVERTS = 2;
 
 
+//
+// BakedVertex in slot 0, InstanceData in slot 1
+//
+const D3D11_INPUT_ELEMENT_DESC LitColourShader::InstancedInputElements[] =
+{
+	{ "SV_Position",    0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA,   0 },
+	{ "NORMAL",         0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA,   0 },
+	{ "TEXCOORD",       0, DXGI_FORMAT_R32G32_FLOAT,       0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA,   0 },
+	{ "MATERIALINDEX",  0, DXGI_FORMAT_R32_UINT,           0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA,   0 },
+	{ "INSTANCEWORLD",  0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0,                            D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "INSTANCEWORLD",  1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "INSTANCEWORLD",  2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "INSTANCEWORLD",  3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "INSTANCECOLOUR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+};
+const UINT LitColourShader::InstancedInputElementCount = sizeof(InstancedInputElements) / sizeof(InstancedInputElements[0]);
+
 //-----------------------------------------------------
 //-----------------------------------------------------
 LitColourShader::LitColourShader()
@@ -33,8 +53,19 @@ LitColourShader::LitColourShader()
 	pVertexShader = nullptr;
 	pPixelShaderBlob = nullptr;
 	pPixelShader = nullptr;
+	pInstancedVertexShaderBlob = nullptr;
+	pInstancedVertexShader = nullptr;
 	pConstantBuffer = nullptr;
+	pFrameBuffer = nullptr;
+	pLightsBuffer = nullptr;
 	pSampler = nullptr;
+	lightsDirty = true;
+
+	frameAllocation.pBuffer = nullptr;
+	lightsAllocation.pBuffer = nullptr;
+	objectAllocation.pBuffer = nullptr;
+
+	ResetStats();
 
 
 	lightingValues.ambientLight = Color(0.2f, 0.2f, 0.2f, 1.0f);
@@ -61,7 +92,11 @@ LitColourShader::~LitColourShader()
 	if (pVertexShader) pVertexShader->Release();
 	if (pPixelShaderBlob) pPixelShaderBlob->Release();
 	if (pPixelShader) pPixelShader->Release();
+	if (pInstancedVertexShaderBlob) pInstancedVertexShaderBlob->Release();
+	if (pInstancedVertexShader) pInstancedVertexShader->Release();
 	if (pConstantBuffer) pConstantBuffer->Release();
+	if (pFrameBuffer) pFrameBuffer->Release();
+	if (pLightsBuffer) pLightsBuffer->Release();
 	if (pSampler) pSampler->Release();
 }
 
@@ -88,6 +123,15 @@ void LitColourShader::LoadShader(ID3D11Device* pDevice)
 		return;
 	}
 
+	// load the instanced vertex shader
+	hr = D3DReadFileToBlob(L"LitColourInstancedVS.cso", &pInstancedVertexShaderBlob);
+	if (FAILED(hr))
+	{
+		OutputDebugString(L"Couldn't load instanced vertex shader");
+		assert(0);
+		return;
+	}
+
 	// Create the shaders
 	hr = pDevice->CreateVertexShader(pVertexShaderBlob->GetBufferPointer(), pVertexShaderBlob->GetBufferSize(), NULL, &pVertexShader);
 	if (FAILED(hr))
@@ -97,6 +141,14 @@ void LitColourShader::LoadShader(ID3D11Device* pDevice)
 		return;
 	}
 
+	hr = pDevice->CreateVertexShader(pInstancedVertexShaderBlob->GetBufferPointer(), pInstancedVertexShaderBlob->GetBufferSize(), NULL, &pInstancedVertexShader);
+	if (FAILED(hr))
+	{
+		OutputDebugString(L"Couldn't create instanced vertex shader");
+		assert(0);
+		return;
+	}
+
 	hr = pDevice->CreatePixelShader(pPixelShaderBlob->GetBufferPointer(), pPixelShaderBlob->GetBufferSize(), NULL, &pPixelShader);
 	if (FAILED(hr))
 	{
@@ -132,6 +184,20 @@ void LitColourShader::LoadShader(ID3D11Device* pDevice)
 		return;
 	}
 
+	// create the per-frame buffer
+	FrameConstants frameConstants;
+
+	bufferDesc.ByteWidth = sizeof(FrameConstants);
+	data.pSysMem = &frameConstants;
+
+	hr = pDevice->CreateBuffer(&bufferDesc, &data, &pFrameBuffer);
+	if (FAILED(hr))
+	{
+		OutputDebugString(L"Couldn't create frame constant buffer");
+		assert(0);
+		return;
+	}
+
 	// create the lights buffer
 	LightConstants lightConstants;
 	lightConstants.ambientLight = DirectX::Colors::LightYellow.v;
@@ -195,55 +261,173 @@ size_t	LitColourShader::GetVertexShaderBinarySize()
 }
 
 //-----------------------------------------------------
-// set the shaders
+// get the information for the instanced shader
 //-----------------------------------------------------
-void LitColourShader::SetShaders(ID3D11DeviceContext* pContext, const Matrix& world, const Matrix& view, const Matrix& projection)
+const void * LitColourShader::GetInstancedVertexShaderBinary()
 {
-	// tell direct x to update the constants inside the shader
-	D3D11_MAPPED_SUBRESOURCE constantResource;
+	if (pInstancedVertexShaderBlob != nullptr)
+	{
+		return pInstancedVertexShaderBlob->GetBufferPointer();
+	}
+	return nullptr;
+}
+size_t	LitColourShader::GetInstancedVertexShaderBinarySize()
+{
+	if (pInstancedVertexShaderBlob != nullptr)
+	{
+		return pInstancedVertexShaderBlob->GetBufferSize();
+	}
+	return 0;
+}
 
-	// gets a pointer to write constants to
-	pContext->Map(pConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &constantResource);
-	ShaderConstants* pConstants = (ShaderConstants*) constantResource.pData;
+//-----------------------------------------------------
+// upload the constants that stay the same for the whole frame
+//-----------------------------------------------------
+void LitColourShader::SetFrameConstants(RenderDevice* pRenderDevice, const Matrix& view, const Matrix& projection)
+{
+	viewProjection = view * projection;
 
 	// when setting the matrices we need to transpose them because the expected order is different in shaders than on CPU
-	pConstants->worldMatrix = world.Transpose();
-	pConstants->viewMatrix = view.Transpose();
-	pConstants->projectionMatrix = projection.Transpose();
-	pConstants->worldViewProjectionMatrix = (world*view*projection).Transpose();
-	pConstants->worldMatrixIT = world.Invert(); // .Transpose().Transpose() cancels out
-	Vector3 cam = Vector3::Transform(Vector3::Zero, view.Invert());
-	pConstants->worldCameraPosition = Vector4(cam.x, cam.y, cam.z, 1);
+	frameValues.viewMatrix = view.Transpose();
+	frameValues.projectionMatrix = projection.Transpose();
+	frameValues.viewProjectionMatrix = viewProjection.Transpose();
+	// the view is a rotation and a translation, so its inverse is a transpose
+	Vector3 cam = Vector3::Transform(Vector3::Zero, Matrix(AffineTransform(view, RigidTransform).Invert()));
+	frameValues.worldCameraPosition = Vector4(cam.x, cam.y, cam.z, 1);
+
+	// last frame's ring space is gone, the lights follow with the first draw as their allocation is stale
+	ConstantRing::Get().Upload(pRenderDevice, pFrameBuffer, &frameValues, sizeof(FrameConstants), frameAllocation);
+
+	stats.frameUploads++;
+	stats.bytesUploaded += sizeof(FrameConstants);
+	stats.fastInverts++;
+}
 
-	// commit the changes
-	pContext->Unmap(pConstantBuffer, 0);
+//-----------------------------------------------------
+// set the shaders
+//-----------------------------------------------------
+void LitColourShader::SetShaders(RenderDevice* pRenderDevice, const Matrix& world)
+{
+	TransformMatrices matrices;
+	ComputeMatrices(AffineTransform(world, GeneralTransform), matrices);
+	BindShaders(pRenderDevice, pVertexShader, matrices);
+}
 
+//-----------------------------------------------------
+// set the shaders for a world matrix of a known kind
+//-----------------------------------------------------
+void LitColourShader::SetShaders(RenderDevice* pRenderDevice, const AffineTransform& world)
+{
+	TransformMatrices matrices;
+	ComputeMatrices(world, matrices);
+	BindShaders(pRenderDevice, pVertexShader, matrices);
+}
 
-	// if the lights have change, up load them as well
-	if (lightsDirty)
-	{
-		pContext->Map(pLightsBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &constantResource);
+//-----------------------------------------------------
+// set the shaders, nothing left to multiply or invert
+//-----------------------------------------------------
+void LitColourShader::SetShaders(RenderDevice* pRenderDevice, const TransformMatrices& matrices)
+{
+	BindShaders(pRenderDevice, pVertexShader, matrices);
+}
 
-		LightConstants* pLightConstants = (LightConstants*)constantResource.pData;
-		*pLightConstants = lightingValues;
+//-----------------------------------------------------
+// set the instanced shaders
+//-----------------------------------------------------
+void LitColourShader::SetInstancedShaders(RenderDevice* pRenderDevice, const AffineTransform& world)
+{
+	TransformMatrices matrices;
+	ComputeMatrices(world, matrices);
+	BindShaders(pRenderDevice, pInstancedVertexShader, matrices);
+}
 
-		pContext->Unmap(pLightsBuffer, 0);
-		lightsDirty = false;
+//-----------------------------------------------------
+// bind a shared material table
+//-----------------------------------------------------
+void LitColourShader::SetMaterials(RenderDevice* pRenderDevice, UINT materialId)
+{
+	// the tables never change, so they are bound as they are instead of going through the ring
+	ConstantAllocation allocation;
+	allocation.pBuffer = MaterialRegistry::Get().GetConstantBuffer(materialId);
+	allocation.firstConstant = 0;
+	allocation.numConstants = 0;
+	allocation.generation = 0;
+	ConstantRing::Get().BindPS(pRenderDevice, 2, allocation);
+}
+
+//-----------------------------------------------------
+// the object's matrices for the current camera
+//-----------------------------------------------------
+void LitColourShader::ComputeMatrices(const AffineTransform& transform, TransformMatrices& matrices)
+{
+	Matrix world = transform.GetMatrix();
+
+	// when setting the matrices we need to transpose them because the expected order is different in shaders than on CPU
+	matrices.worldMatrix = world.Transpose();
+	matrices.worldViewProjectionMatrix = (world*viewProjection).Transpose();
+	XMStoreFloat4x4(&matrices.worldMatrixIT, transform.Invert()); // .Transpose().Transpose() cancels out
+
+	if (transform.GetKind() == GeneralTransform)
+	{
+		stats.matrixInverts++;
 	}
+	else
+	{
+		stats.fastInverts++;
+	}
+}
 
+//-----------------------------------------------------
+// upload the constants and bind the shaders
+//-----------------------------------------------------
+void LitColourShader::BindShaders(RenderDevice* pRenderDevice, ID3D11VertexShader* pVS, const TransformMatrices& matrices)
+{
+	ConstantRing& ring = ConstantRing::Get();
 
+	// worst case everything goes up for this draw, wrap first rather than part way through
+	ring.Reserve(ConstantRing::AlignedSize(sizeof(ShaderConstants)) + ConstantRing::AlignedSize(sizeof(FrameConstants))
+		+ ConstantRing::AlignedSize(sizeof(LightConstants)));
 
-	// set the shader
-	pContext->VSSetShader(pVertexShader, NULL, 0);
-	pContext->PSSetShader(pPixelShader, NULL, 0);
+	// the camera half was uploaded once for the frame, only the object's matrices change here
+	ShaderConstants constants;
+	constants.worldMatrix = matrices.worldMatrix;
+	constants.worldViewProjectionMatrix = matrices.worldViewProjectionMatrix;
+	constants.worldMatrixIT = matrices.worldMatrixIT;
 
-	// set the shader constants - matrices at 0, lights at 1
-	pContext->VSSetConstantBuffers(0, 1, &pConstantBuffer);
-	pContext->VSSetConstantBuffers(1, 1, &pLightsBuffer);
-	pContext->PSSetConstantBuffers(0, 1, &pConstantBuffer);
-	pContext->PSSetConstantBuffers(1, 1, &pLightsBuffer);
+	// each draw gets its own slice of the ring instead of renaming one small buffer
+	ring.Upload(pRenderDevice, pConstantBuffer, &constants, sizeof(ShaderConstants), objectAllocation);
+
+	stats.objectUploads++;
+	stats.bytesUploaded += sizeof(ShaderConstants);
+	stats.estimatedSingleBufferBytes += SINGLE_BUFFER_SIZE;
+	stats.estimatedSingleBufferInverts += SINGLE_BUFFER_INVERTS;
+
+	// the frame constants only go up again if the ring wrapped since they were written
+	if (!ring.IsCurrent(frameAllocation))
+	{
+		ring.Upload(pRenderDevice, pFrameBuffer, &frameValues, sizeof(FrameConstants), frameAllocation);
+	}
+
+	// if the lights have change, up load them as well
+	if (lightsDirty || !ring.IsCurrent(lightsAllocation))
+	{
+		ring.Upload(pRenderDevice, pLightsBuffer, &lightingValues, sizeof(LightConstants), lightsAllocation);
+		lightsDirty = false;
+	}
 
-	pContext->PSSetSamplers(0, 1, &pSampler);
+	// set the shader
+	StateCache::Get().VSSetShader(pRenderDevice, pVS);
+	StateCache::Get().PSSetShader(pRenderDevice, pPixelShader);
+
+	// set the shader constants - object matrices at 0, lights at 1, frame at 3
+	ring.BindVS(pRenderDevice, 0, objectAllocation);
+	ring.BindVS(pRenderDevice, 1, lightsAllocation);
+	ring.BindVS(pRenderDevice, 3, frameAllocation);
+	ring.BindPS(pRenderDevice, 0, objectAllocation);
+	ring.BindPS(pRenderDevice, 1, lightsAllocation);
+	ring.BindPS(pRenderDevice, 3, frameAllocation);
+
+	StateCache::Get().PSSetSampler(pRenderDevice, 0, pSampler);
 }
 
 //-----------------------------------------------------
@@ -280,5 +464,30 @@ void LitColourShader::SetSpecularLight(Color clr, float power)
 	lightingValues.specularLightColor.A(power);
 }
 
+//-----------------------------------------------------
+// clear the upload counters
+//-----------------------------------------------------
+void LitColourShader::ResetStats()
+{
+	stats.frameUploads = 0;
+	stats.objectUploads = 0;
+	stats.bytesUploaded = 0;
+	stats.matrixInverts = 0;
+	stats.fastInverts = 0;
+	stats.estimatedSingleBufferBytes = 0;
+	stats.estimatedSingleBufferInverts = 0;
+}
 
+//-----------------------------------------------------
+// write the upload counters to the debug output
+//-----------------------------------------------------
+void LitColourShader::ReportStats() const
+{
+	std::wostringstream message;
+	message << L"LitColourShader: " << stats.objectUploads << L" object + " << stats.frameUploads
+		<< L" frame uploads, " << stats.bytesUploaded << L" bytes, " << stats.matrixInverts
+		<< L" general + " << stats.fastInverts << L" closed form inverts (single buffer estimate: " << stats.estimatedSingleBufferBytes << L" bytes, "
+		<< stats.estimatedSingleBufferInverts << L" inverts)\n";
 
+	OutputDebugString(message.str().c_str());
+}
@@ -10,6 +10,10 @@
 #include <d3d11_1.h>
 #include <SimpleMath.h>
 
+#include "ConstantRing.h"
+#include "MaterialRegistry.h"
+#include "TransformStore.h"
+
 
 
 using DirectX::SimpleMath::Matrix;
@@ -35,6 +39,36 @@ struct LightConstants
 
 };
 
+// aligns with the per-frame constants
+struct FrameConstants
+{
+	Matrix  viewMatrix;
+	Matrix  projectionMatrix;
+	Matrix  viewProjectionMatrix;
+	Vector4 worldCameraPosition;
+};
+
+// per-instance data for the instanced vertex shader
+struct InstanceData
+{
+	Matrix worldMatrix;
+	Color  colour;
+};
+
+// how much constant data the shader has sent to the GPU since the last reset
+struct ShaderStats
+{
+	int frameUploads;		// writes to the per-frame buffer
+	int objectUploads;		// writes to the per-object buffer, one per draw
+	int bytesUploaded;		// bytes written to both buffers
+	int matrixInverts;		// general matrix inverses computed for the constants
+	int fastInverts;		// inverses of rigid and scaled matrices, done as a transpose
+
+	// estimates, not measured: the old single buffer's size and inverts times the draws
+	int estimatedSingleBufferBytes;
+	int estimatedSingleBufferInverts;
+};
+
 class LitColourShader
 {
 public:
@@ -49,8 +83,38 @@ public:
 	const void* GetVertexShaderBinary();
 	size_t		GetVertexShaderBinarySize();
 
-	// set the shaders
-	void SetShaders(ID3D11DeviceContext* pContext, const Matrix& world, const Matrix& view, const Matrix& projection);
+	// get the information for the instanced shader
+	const void* GetInstancedVertexShaderBinary();
+	size_t		GetInstancedVertexShaderBinarySize();
+
+	// layout of a BakedVertex stream followed by an InstanceData stream
+	static const D3D11_INPUT_ELEMENT_DESC InstancedInputElements[];
+	static const UINT InstancedInputElementCount;
+
+	// upload the camera constants, call once a frame before drawing anything
+	void SetFrameConstants(RenderDevice* pRenderDevice, const Matrix& view, const Matrix& projection);
+
+	// set the shaders, nothing is known about world so the normals need the full inverse
+	void SetShaders(RenderDevice* pRenderDevice, const Matrix& world);
+
+	// set the shaders, the kind picks the cheapest inverse for the normals
+	void SetShaders(RenderDevice* pRenderDevice, const AffineTransform& world);
+
+	// set the shaders with matrices a TransformStore already worked out for this camera
+	void SetShaders(RenderDevice* pRenderDevice, const TransformMatrices& matrices);
+
+	// set the instanced shaders, world is applied before each instance's matrix
+	void SetInstancedShaders(RenderDevice* pRenderDevice, const AffineTransform& world);
+
+	// bind a table from the material registry for the following draws
+	void SetMaterials(RenderDevice* pRenderDevice, UINT materialId);
+
+	// constant upload counters
+	const ShaderStats& GetStats() const { return stats; }
+	void ResetStats();
+
+	// writes the upload counters to the debug output
+	void ReportStats() const;
 
 	// set the ambient light color
 	void SetAmbientLight(Color clr); 
@@ -63,18 +127,38 @@ public:
 
 private:
 
+	// works out the object's matrices the way TransformStore does, one draw at a time
+	void ComputeMatrices(const AffineTransform& world, TransformMatrices& matrices);
+
+	// uploads the object constants and binds everything with the given vertex shader
+	void BindShaders(RenderDevice* pRenderDevice, ID3D11VertexShader* pVS, const TransformMatrices& matrices);
+
 	// data read from files
 	ID3DBlob*			pVertexShaderBlob;
 	ID3DBlob*			pPixelShaderBlob;
+	ID3DBlob*			pInstancedVertexShaderBlob;
 
 	// shaders
 	ID3D11VertexShader* pVertexShader;
 	ID3D11PixelShader*  pPixelShader;
+	ID3D11VertexShader* pInstancedVertexShader;
 
 	// constants
 	ID3D11Buffer*		pConstantBuffer;
+	ID3D11Buffer*		pFrameBuffer;
 	ID3D11Buffer*		pLightsBuffer;
 
+	// combined camera matrix from the last SetFrameConstants
+	Matrix				viewProjection;
+
+	// where the constants were last uploaded, the frame copy is kept in case the ring wraps
+	FrameConstants		frameValues;
+	ConstantAllocation	frameAllocation;
+	ConstantAllocation	lightsAllocation;
+	ConstantAllocation	objectAllocation;
+
+	ShaderStats			stats;
+
 	ID3D11SamplerState*  pSampler;
 
 	// lights
@@ -24,5 +24,8 @@ PS_INPUT main( VS_INPUT input )
 	// copy the UVa
 	output.UV = input.UV;
 
+	// unbaked primitives use the first material
+	output.MaterialIndex = 0;
+
 	return output;
 }
\ No newline at end of file
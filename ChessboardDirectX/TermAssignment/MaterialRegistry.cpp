@@ -0,0 +1,133 @@
+//
+// BGTD 9201
+//	Shares material tables between everything that uses the same values
+//
+
+#include "MaterialRegistry.h"
+#include <cstring>
+#include <sstream>
+
+// ------------------------------------------------------------------------------------
+// FNV-1a hash of a table's values
+// ------------------------------------------------------------------------------------
+static uint64_t HashMaterials(const MaterialBuffer& materials)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	const unsigned char* pBytes = (const unsigned char*)&materials;
+	for (size_t i = 0; i < sizeof(MaterialBuffer); i++)
+	{
+		hash ^= pBytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+MaterialRegistry& MaterialRegistry::Get()
+{
+	static MaterialRegistry registry;
+	return registry;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+MaterialRegistry::MaterialRegistry()
+{
+	hits = 0;
+	misses = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+MaterialRegistry::~MaterialRegistry()
+{
+	Clear();
+}
+
+// ------------------------------------------------------------------------------------
+// Release every buffer and forget the tables
+// ------------------------------------------------------------------------------------
+void MaterialRegistry::Clear()
+{
+	for (size_t i = 0; i < constantBuffers.size(); i++)
+	{
+		if (constantBuffers[i]) constantBuffers[i]->Release();
+	}
+	constantBuffers.clear();
+
+	tables.clear();
+	tableIds.clear();
+}
+
+// ------------------------------------------------------------------------------------
+// Find a table with the same values, or make a new one
+// ------------------------------------------------------------------------------------
+UINT MaterialRegistry::AcquireMaterials(ID3D11Device* pDevice, const MaterialBuffer& materials)
+{
+	uint64_t hash = HashMaterials(materials);
+
+	// a hash match still has to compare equal
+	std::pair<std::multimap<uint64_t, UINT>::iterator, std::multimap<uint64_t, UINT>::iterator> range = tableIds.equal_range(hash);
+	for (std::multimap<uint64_t, UINT>::iterator it = range.first; it != range.second; ++it)
+	{
+		if (memcmp(&tables[it->second], &materials, sizeof(MaterialBuffer)) == 0)
+		{
+			hits++;
+			return it->second;
+		}
+	}
+
+	misses++;
+	UINT materialId = (UINT)tables.size();
+	tables.push_back(materials);
+	tableIds.insert(std::make_pair(hash, materialId));
+
+	// the values never change, so the buffer can be immutable
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.ByteWidth = sizeof(MaterialBuffer);
+	bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = 0;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA data;
+	data.pSysMem = &materials;
+	data.SysMemPitch = 0;
+	data.SysMemSlicePitch = 0;
+
+	ID3D11Buffer* pConstantBuffer = nullptr;
+	HRESULT hr = pDevice->CreateBuffer(&bufferDesc, &data, &pConstantBuffer);
+	if (FAILED(hr))
+	{
+		OutputDebugString(L"Couldn't create material buffer");
+		assert(0);
+	}
+	constantBuffers.push_back(pConstantBuffer);
+
+	return materialId;
+}
+
+// ------------------------------------------------------------------------------------
+// The constant buffer of a table
+// ------------------------------------------------------------------------------------
+ID3D11Buffer* MaterialRegistry::GetConstantBuffer(UINT materialId) const
+{
+	if (materialId >= constantBuffers.size())
+	{
+		return nullptr;
+	}
+	return constantBuffers[materialId];
+}
+
+// ------------------------------------------------------------------------------------
+// Write the counts to the debug output
+// ------------------------------------------------------------------------------------
+void MaterialRegistry::ReportStats() const
+{
+	std::wostringstream message;
+	message << L"MaterialRegistry: " << tables.size() << L" unique tables, " << hits << L" shared, " << misses << L" created\n";
+
+	OutputDebugString(message.str().c_str());
+}
@@ -0,0 +1,81 @@
+//
+// BGTD 9201
+//	Shares material tables between everything that uses the same values, so
+//	each unique table lives on the GPU once, as its own immutable constant
+//	buffer
+//
+
+#ifndef _MATERIAL_REGISTRY_H
+#define _MATERIAL_REGISTRY_H
+
+#include <d3d11_1.h>
+#include <SimpleMath.h>
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+using DirectX::SimpleMath::Color;
+
+// number of entries in the material table, matches MAX_MATERIALS in the shader
+static const int MAX_MATERIALS = 4;
+
+// aligns with the material constants, each vertex picks an entry by its material index
+struct MaterialBuffer
+{
+	Color ambient[MAX_MATERIALS];
+	Color diffuse[MAX_MATERIALS];
+	Color spec[MAX_MATERIALS]; // alpha in w component
+
+	void SetMaterial(int index, Color inAmbient, Color inDiffuse, Color inSpec, float specPower)
+	{
+		ambient[index] = inAmbient;
+		diffuse[index] = inDiffuse;
+		spec[index] = inSpec;
+		spec[index].w = specPower;
+	}
+};
+
+class MaterialRegistry
+{
+public:
+	// the one registry used by every object
+	static MaterialRegistry& Get();
+
+	// finds or creates a table with these values and returns its id. The id is
+	// small and stable, so it can go straight into a sort key
+	UINT AcquireMaterials(ID3D11Device* pDevice, const MaterialBuffer& materials);
+
+	// constant buffer holding a table, bound to b2
+	ID3D11Buffer* GetConstantBuffer(UINT materialId) const;
+
+	// releases every buffer
+	void Clear();
+
+	// how many requests were served from the registry vs created
+	int GetHits() const { return hits; }
+	int GetMisses() const { return misses; }
+	int GetNumTables() const { return (int)tables.size(); }
+
+	// writes the counts to the debug output
+	void ReportStats() const;
+
+private:
+	MaterialRegistry();
+	~MaterialRegistry();
+
+	// registry is shared, never copied
+	MaterialRegistry(const MaterialRegistry&);
+	MaterialRegistry& operator=(const MaterialRegistry&);
+
+	// tables by id, and the ids of tables by the hash of their values
+	std::vector<MaterialBuffer> tables;
+	std::multimap<uint64_t, UINT> tableIds;
+
+	// one per table, by id
+	std::vector<ID3D11Buffer*> constantBuffers;
+
+	int hits;
+	int misses;
+};
+
+#endif
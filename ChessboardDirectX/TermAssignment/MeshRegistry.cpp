@@ -0,0 +1,304 @@
+//
+// BGTD 9201
+//	Shares the vertex/index buffers and input layouts of identical primitives
+//
+
+#include "MeshRegistry.h"
+#include <VertexTypes.h>
+#include <sstream>
+#include <string.h>
+#include "Models.h"
+
+// ------------------------------------------------------------------------------------
+// FNV-1a hash helpers, used to key the input layouts
+// ------------------------------------------------------------------------------------
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+static uint64_t HashBytes(uint64_t hash, const void* pData, size_t size)
+{
+	const unsigned char* pBytes = (const unsigned char*)pData;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= pBytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+static uint64_t HashString(uint64_t hash, const char* pString)
+{
+	while (*pString)
+	{
+		hash ^= (unsigned char)*pString++;
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+// ------------------------------------------------------------------------------------
+// Whether a stored layout was created from this signature
+// ------------------------------------------------------------------------------------
+static bool SameLayout(const SharedLayout& layout, const D3D11_INPUT_ELEMENT_DESC* pElements, UINT numElements, const void* pBinary, size_t binarySize)
+{
+	if (layout.binary.size() != binarySize || layout.elements.size() != numElements)
+	{
+		return false;
+	}
+	if (memcmp(layout.binary.data(), pBinary, binarySize) != 0)
+	{
+		return false;
+	}
+
+	for (UINT i = 0; i < numElements; i++)
+	{
+		const D3D11_INPUT_ELEMENT_DESC& element = layout.elements[i];
+		if (layout.semanticNames[i] != pElements[i].SemanticName
+			|| element.SemanticIndex != pElements[i].SemanticIndex
+			|| element.Format != pElements[i].Format
+			|| element.InputSlot != pElements[i].InputSlot
+			|| element.AlignedByteOffset != pElements[i].AlignedByteOffset
+			|| element.InputSlotClass != pElements[i].InputSlotClass
+			|| element.InstanceDataStepRate != pElements[i].InstanceDataStepRate)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// ordering for the mesh map
+// ------------------------------------------------------------------------------------
+bool MeshKey::operator<(const MeshKey& other) const
+{
+	if (type != other.type) return type < other.type;
+	if (size != other.size) return size < other.size;
+	return tessellation < other.tessellation;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+MeshRegistry& MeshRegistry::Get()
+{
+	static MeshRegistry registry;
+	return registry;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+MeshRegistry::MeshRegistry()
+{
+	pOwnerDevice = nullptr;
+
+	meshHits = 0;
+	meshMisses = 0;
+	layoutHits = 0;
+	layoutMisses = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+MeshRegistry::~MeshRegistry()
+{
+	Clear();
+}
+
+// ------------------------------------------------------------------------------------
+// Release the registry's references
+// ------------------------------------------------------------------------------------
+void MeshRegistry::Clear()
+{
+	for (std::map<MeshKey, SharedMesh>::iterator it = meshes.begin(); it != meshes.end(); ++it)
+	{
+		it->second.pVertexBuffer->Release();
+		it->second.pIndexBuffer->Release();
+	}
+	meshes.clear();
+
+	for (size_t i = 0; i < layouts.size(); i++)
+	{
+		layouts[i].pInputLayout->Release();
+	}
+	layouts.clear();
+	layoutIds.clear();
+
+	pOwnerDevice = nullptr;
+}
+
+// ------------------------------------------------------------------------------------
+// Buffers belong to a device, start over if we are handed a new one
+// ------------------------------------------------------------------------------------
+void MeshRegistry::CheckDevice(ID3D11Device* pDevice)
+{
+	if (pOwnerDevice != pDevice)
+	{
+		Clear();
+		pOwnerDevice = pDevice;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Find or create the vertex and index buffer for a primitive
+// ------------------------------------------------------------------------------------
+bool MeshRegistry::AcquireMesh(ID3D11Device* pDevice, ModelType type, float size, size_t tessellation, SharedMesh& outMesh)
+{
+	CheckDevice(pDevice);
+
+	MeshKey key;
+	key.type = type;
+	key.size = size;
+	key.tessellation = (type == Cube) ? 0 : tessellation; // cubes have no tessellation
+
+	std::map<MeshKey, SharedMesh>::iterator found = meshes.find(key);
+	if (found != meshes.end())
+	{
+		meshHits++;
+
+		outMesh = found->second;
+		outMesh.pVertexBuffer->AddRef();
+		outMesh.pIndexBuffer->AddRef();
+		return true;
+	}
+
+	meshMisses++;
+
+	VertexCollection vertices;
+	IndexCollection indices;
+
+	// create the model
+	Models::CreateModel(type, size, tessellation, vertices, indices);
+
+	SharedMesh mesh;
+	mesh.numVerts = vertices.size();
+	mesh.numIndices = indices.size();
+	mesh.pVertexBuffer = nullptr;
+	mesh.pIndexBuffer = nullptr;
+
+	// describe the vertex buffer we are trying to create
+	D3D11_BUFFER_DESC desc;
+	desc.ByteWidth = mesh.numVerts * sizeof(VertexPositionNormalTexture);
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = 0;
+	desc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA data;
+	data.pSysMem = vertices.data();
+	data.SysMemPitch = 0;
+	data.SysMemSlicePitch = 0;
+
+	HRESULT hr = pDevice->CreateBuffer(&desc, &data, &mesh.pVertexBuffer);
+	if (FAILED(hr))
+	{
+		OutputDebugString(L"FAILED TO CREATE VERTEX BUFFER");
+		assert(false);
+		return false;
+	}
+
+	// set up the index buffer
+	D3D11_BUFFER_DESC indexBufferDesc;
+	indexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	indexBufferDesc.ByteWidth = mesh.numIndices * sizeof(uint16_t);
+	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	indexBufferDesc.CPUAccessFlags = 0;
+	indexBufferDesc.MiscFlags = 0;
+	indexBufferDesc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA indexData;
+	indexData.pSysMem = indices.data();
+	indexData.SysMemPitch = 0;
+	indexData.SysMemSlicePitch = 0;
+
+	hr = pDevice->CreateBuffer(&indexBufferDesc, &indexData, &mesh.pIndexBuffer);
+	if (FAILED(hr))
+	{
+		OutputDebugString(L"FAILED TO CREATE INDEX BUFFER");
+		assert(false);
+		mesh.pVertexBuffer->Release();
+		return false;
+	}
+
+	// the registry keeps the creation reference, the caller gets its own
+	meshes[key] = mesh;
+
+	outMesh = mesh;
+	outMesh.pVertexBuffer->AddRef();
+	outMesh.pIndexBuffer->AddRef();
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// Find or create the input layout for a vertex shader signature
+// ------------------------------------------------------------------------------------
+ID3D11InputLayout* MeshRegistry::AcquireInputLayout(ID3D11Device* pDevice, const D3D11_INPUT_ELEMENT_DESC* pElements, UINT numElements, const void* pBinary, size_t binarySize)
+{
+	CheckDevice(pDevice);
+
+	// the key is the shader bytecode plus the elements fed to it
+	uint64_t key = HashBytes(FNV_OFFSET, pBinary, binarySize);
+	for (UINT i = 0; i < numElements; i++)
+	{
+		key = HashString(key, pElements[i].SemanticName);
+		key = HashBytes(key, &pElements[i].SemanticIndex, sizeof(UINT));
+		key = HashBytes(key, &pElements[i].Format, sizeof(DXGI_FORMAT));
+		key = HashBytes(key, &pElements[i].InputSlot, sizeof(UINT));
+		key = HashBytes(key, &pElements[i].AlignedByteOffset, sizeof(UINT));
+		key = HashBytes(key, &pElements[i].InputSlotClass, sizeof(D3D11_INPUT_CLASSIFICATION));
+		key = HashBytes(key, &pElements[i].InstanceDataStepRate, sizeof(UINT));
+	}
+
+	// a hash match still has to compare equal
+	std::pair<std::multimap<uint64_t, size_t>::iterator, std::multimap<uint64_t, size_t>::iterator> range = layoutIds.equal_range(key);
+	for (std::multimap<uint64_t, size_t>::iterator it = range.first; it != range.second; ++it)
+	{
+		if (SameLayout(layouts[it->second], pElements, numElements, pBinary, binarySize))
+		{
+			layoutHits++;
+
+			layouts[it->second].pInputLayout->AddRef();
+			return layouts[it->second].pInputLayout;
+		}
+	}
+
+	layoutMisses++;
+
+	ID3D11InputLayout* pInputLayout = nullptr;
+	HRESULT hr = pDevice->CreateInputLayout(pElements, numElements, pBinary, binarySize, &pInputLayout);
+	if (FAILED(hr))
+	{
+		OutputDebugString(L"Failed to create input layout");
+		assert(0);
+		return nullptr;
+	}
+
+	SharedLayout layout;
+	layout.binary.assign((const unsigned char*)pBinary, (const unsigned char*)pBinary + binarySize);
+	for (UINT i = 0; i < numElements; i++)
+	{
+		layout.elements.push_back(pElements[i]);
+		layout.elements.back().SemanticName = nullptr;
+		layout.semanticNames.push_back(pElements[i].SemanticName);
+	}
+	layout.pInputLayout = pInputLayout;
+
+	layoutIds.insert(std::make_pair(key, layouts.size()));
+	layouts.push_back(layout);
+
+	pInputLayout->AddRef();
+	return pInputLayout;
+}
+
+// ------------------------------------------------------------------------------------
+// Write the hit/miss counts to the debug output
+// ------------------------------------------------------------------------------------
+void MeshRegistry::ReportStats() const
+{
+	std::wostringstream message;
+	message << L"MeshRegistry: meshes " << meshes.size() << L" unique, "
+		<< meshHits << L" hits, " << meshMisses << L" misses; input layouts "
+		<< layouts.size() << L" unique, " << layoutHits << L" hits, " << layoutMisses << L" misses\n";
+
+	OutputDebugString(message.str().c_str());
+}
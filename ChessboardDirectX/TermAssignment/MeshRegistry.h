@@ -0,0 +1,95 @@
+//
+// BGTD 9201
+//	Shares the vertex/index buffers and input layouts of identical primitives
+//	so each unique mesh is only generated and uploaded to the GPU once
+//
+
+#ifndef _MESH_REGISTRY_H
+#define _MESH_REGISTRY_H
+
+#include <d3d11_1.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "IndexedPrimitive.h"
+
+// what makes two primitives identical
+struct MeshKey
+{
+	ModelType type;
+	float size;
+	size_t tessellation;
+
+	bool operator<(const MeshKey& other) const;
+};
+
+// the shared GPU data for one mesh
+struct SharedMesh
+{
+	ID3D11Buffer* pVertexBuffer;
+	ID3D11Buffer* pIndexBuffer;
+	int numVerts;
+	int numIndices;
+};
+
+// an input layout and what it was created from, kept to tell apart signatures whose hashes collide
+struct SharedLayout
+{
+	std::vector<unsigned char> binary;
+	std::vector<D3D11_INPUT_ELEMENT_DESC> elements;	// SemanticName is left null, the names are kept below
+	std::vector<std::string> semanticNames;
+	ID3D11InputLayout* pInputLayout;
+};
+
+class MeshRegistry
+{
+public:
+	// the one registry used by every primitive
+	static MeshRegistry& Get();
+
+	// finds or creates the buffers for a primitive. The buffers in outMesh have
+	// a reference added for the caller, which must Release them when done
+	bool AcquireMesh(ID3D11Device* pDevice, ModelType type, float size, size_t tessellation, SharedMesh& outMesh);
+
+	// finds or creates the input layout for a vertex shader signature. A reference
+	// is added for the caller, which must Release it when done
+	ID3D11InputLayout* AcquireInputLayout(ID3D11Device* pDevice, const D3D11_INPUT_ELEMENT_DESC* pElements, UINT numElements, const void* pBinary, size_t binarySize);
+
+	// drops the registry's own references, GPU objects die once the last primitive lets go
+	void Clear();
+
+	// how many requests were served from the registry vs created
+	int GetMeshHits() const { return meshHits; }
+	int GetMeshMisses() const { return meshMisses; }
+	int GetLayoutHits() const { return layoutHits; }
+	int GetLayoutMisses() const { return layoutMisses; }
+
+	// writes the hit/miss counts to the debug output
+	void ReportStats() const;
+
+private:
+	MeshRegistry();
+	~MeshRegistry();
+
+	// registry is shared, never copied
+	MeshRegistry(const MeshRegistry&);
+	MeshRegistry& operator=(const MeshRegistry&);
+
+	// forgets everything if a different device is used
+	void CheckDevice(ID3D11Device* pDevice);
+
+	ID3D11Device* pOwnerDevice;
+
+	std::map<MeshKey, SharedMesh> meshes;
+	std::vector<SharedLayout> layouts;
+	std::multimap<uint64_t, size_t> layoutIds;
+
+	int meshHits;
+	int meshMisses;
+	int layoutHits;
+	int layoutMisses;
+};
+
+#endif
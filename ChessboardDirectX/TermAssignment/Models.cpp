@@ -12,8 +12,10 @@ namespace Models
 
 
 	// create a cube primitive
-	void CreateCube(VertexCollection& vertices, IndexCollection& indices, float size)
+	void CreateCube(VertexCollection& vertices, IndexCollection& indices, float size, MeshBounds* pBounds)
 	{
+		size_t firstVertex = vertices.size();
+
 		// A cube has six faces, each one pointing in a different direction.
 		const int FaceCount = 6;
 
@@ -64,14 +66,21 @@ namespace Models
 			vertices.push_back(VertexPositionNormalTexture((normal + side1 + side2) * size, normal, textureCoordinates[2]));
 			vertices.push_back(VertexPositionNormalTexture((normal + side1 - side2) * size, normal, textureCoordinates[3]));
 		}
+
+		if (pBounds)
+		{
+			ComputeBounds(vertices, firstVertex, *pBounds);
+		}
 	}
 
 	// Create a sphere primitive
-	void CreateSphere(VertexCollection& vertices, IndexCollection& indices, float diameter, size_t tessellation)
+	void CreateSphere(VertexCollection& vertices, IndexCollection& indices, float diameter, size_t tessellation, MeshBounds* pBounds)
 	{
 		if (tessellation < 3)
 			throw std::out_of_range("tesselation parameter out of range");
 
+		size_t firstVertex = vertices.size();
+
 		size_t verticalSegments = tessellation;
 		size_t horizontalSegments = tessellation * 2;
 
@@ -126,6 +135,11 @@ namespace Models
 				indices.push_back(nextI * stride + nextJ);
 			}
 		}
+
+		if (pBounds)
+		{
+			ComputeBounds(vertices, firstVertex, *pBounds);
+		}
 	}
 
 	// Helper computes a point on a unit circle, aligned to the x/z plane and centered on the origin.
@@ -197,11 +211,13 @@ namespace Models
 
 
 	// Creates a cylinder primitive.
-	void CreateCylinder(VertexCollection& vertices, IndexCollection& indices, float height, float diameter, size_t tessellation)
+	void CreateCylinder(VertexCollection& vertices, IndexCollection& indices, float height, float diameter, size_t tessellation, MeshBounds* pBounds)
 	{
 		if (tessellation < 3)
 			throw std::out_of_range("tesselation parameter out of range");
 
+		size_t firstVertex = vertices.size();
+
 		height /= 2;
 
 		XMVECTOR topOffset = g_XMIdentityR1 * height;
@@ -235,17 +251,24 @@ namespace Models
 		// Create flat triangle fan caps to seal the top and bottom.
 		CreateCylinderCap(vertices, indices, tessellation, height, radius, true);
 		CreateCylinderCap(vertices, indices, tessellation, height, radius, false);
+
+		if (pBounds)
+		{
+			ComputeBounds(vertices, firstVertex, *pBounds);
+		}
 	}
 
 
 
 	// Creates a cone primitive.
-	void CreateCone(VertexCollection& vertices, IndexCollection& indices, float diameter, float height, size_t tessellation)
+	void CreateCone(VertexCollection& vertices, IndexCollection& indices, float diameter, float height, size_t tessellation, MeshBounds* pBounds)
 	{
 
 		if (tessellation < 3)
 			throw std::out_of_range("tesselation parameter out of range");
 
+		size_t firstVertex = vertices.size();
+
 		height /= 2;
 
 		XMVECTOR topOffset = g_XMIdentityR1 * height;
@@ -280,6 +303,11 @@ namespace Models
 
 		// Create flat triangle fan caps to seal the bottom.
 		CreateCylinderCap(vertices, indices, tessellation, height, radius, false);
+
+		if (pBounds)
+		{
+			ComputeBounds(vertices, firstVertex, *pBounds);
+		}
 	}
 
 
@@ -288,11 +316,13 @@ namespace Models
 	//--------------------------------------------------------------------------------------
 
 	// Creates a torus primitive.
-	void CreateTorus(VertexCollection& vertices, IndexCollection& indices, float diameter, float thickness, size_t tessellation)
+	void CreateTorus(VertexCollection& vertices, IndexCollection& indices, float diameter, float thickness, size_t tessellation, MeshBounds* pBounds)
 	{
 		if (tessellation < 3)
 			throw std::out_of_range("tesselation parameter out of range");
 
+		size_t firstVertex = vertices.size();
+
 		size_t stride = tessellation + 1;
 
 		// First we loop around the main ring of the torus.
@@ -339,6 +369,90 @@ namespace Models
 				indices.push_back(nextI * stride + j);
 			}
 		}
+
+		if (pBounds)
+		{
+			ComputeBounds(vertices, firstVertex, *pBounds);
+		}
+	}
+
+	// Bounds of the vertices from firstVertex on
+	void ComputeBounds(const VertexCollection& vertices, size_t firstVertex, MeshBounds& bounds)
+	{
+		if (firstVertex >= vertices.size())
+		{
+			bounds.boxMin = bounds.boxMax = bounds.sphereCenter = XMFLOAT3(0, 0, 0);
+			bounds.sphereRadius = 0;
+			return;
+		}
+
+		XMVECTOR boxMin = XMLoadFloat3(&vertices[firstVertex].position);
+		XMVECTOR boxMax = boxMin;
+		for (size_t i = firstVertex + 1; i < vertices.size(); i++)
+		{
+			XMVECTOR position = XMLoadFloat3(&vertices[i].position);
+			boxMin = XMVectorMin(boxMin, position);
+			boxMax = XMVectorMax(boxMax, position);
+		}
+
+		// the box centre is close enough for these shapes, the radius reaches the farthest vertex
+		XMVECTOR center = (boxMin + boxMax) * 0.5f;
+		float radius = 0;
+		for (size_t i = firstVertex; i < vertices.size(); i++)
+		{
+			float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&vertices[i].position) - center));
+			if (distance > radius)
+			{
+				radius = distance;
+			}
+		}
+
+		XMStoreFloat3(&bounds.boxMin, boxMin);
+		XMStoreFloat3(&bounds.boxMax, boxMax);
+		XMStoreFloat3(&bounds.sphereCenter, center);
+		bounds.sphereRadius = radius;
+	}
+
+	// Build a primitive of the given size
+	void CreateModel(ModelType type, float size, size_t tessellation, VertexCollection& vertices, IndexCollection& indices, MeshBounds* pBounds)
+	{
+		switch (type)
+		{
+			case Cube:
+				CreateCube(vertices, indices, size, pBounds);
+				break;
+			case Torus:
+				CreateTorus(vertices, indices, size, size * 0.5f, tessellation, pBounds);
+				break;
+			case Cone:
+				CreateCone(vertices, indices, size, size, tessellation, pBounds);
+				break;
+			case Cylinder:
+				CreateCylinder(vertices, indices, size, size, tessellation, pBounds);
+				break;
+			case Sphere:
+				CreateSphere(vertices, indices, size, tessellation, pBounds);
+				break;
+		}
+	}
+
+	// Move vertices into place
+	bool TransformVertices(VertexCollection& vertices, size_t firstVertex, FXMMATRIX matrix)
+	{
+		// normals need the inverse transpose to survive the non-uniform scales
+		XMMATRIX normalMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, matrix));
+
+		for (size_t i = firstVertex; i < vertices.size(); i++)
+		{
+			XMVECTOR position = XMVector3Transform(XMLoadFloat3(&vertices[i].position), matrix);
+			XMVECTOR normal = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertices[i].normal), normalMatrix));
+
+			XMStoreFloat3(&vertices[i].position, position);
+			XMStoreFloat3(&vertices[i].normal, normal);
+		}
+
+		// a mirroring matrix turns the triangles inside out
+		return XMVectorGetX(XMMatrixDeterminant(matrix)) < 0;
 	}
 
 }
\ No newline at end of file
@@ -8,20 +8,84 @@
 #define _MODELS_H
 
 #include <vector>
+#include <stdint.h>
+
+#ifdef _WIN32
 #include <VertexTypes.h>
+#else
+#include <DirectXMath.h>
+
+namespace DirectX
+{
+	// the DirectXTK vertex without its input layout, for builds that have no Direct3D
+	struct VertexPositionNormalTexture
+	{
+		VertexPositionNormalTexture() {}
+
+		VertexPositionNormalTexture(XMFLOAT3 const& inPosition, XMFLOAT3 const& inNormal, XMFLOAT2 const& inTextureCoordinate)
+			: position(inPosition), normal(inNormal), textureCoordinate(inTextureCoordinate)
+		{
+		}
+
+		VertexPositionNormalTexture(FXMVECTOR inPosition, FXMVECTOR inNormal, FXMVECTOR inTextureCoordinate)
+		{
+			XMStoreFloat3(&position, inPosition);
+			XMStoreFloat3(&normal, inNormal);
+			XMStoreFloat2(&textureCoordinate, inTextureCoordinate);
+		}
+
+		XMFLOAT3 position;
+		XMFLOAT3 normal;
+		XMFLOAT2 textureCoordinate;
+	};
+}
+#endif
 
 using namespace DirectX;
 
+// the primitives the models can build
+enum ModelType
+{
+	Cube,
+	Torus,
+	Cone,
+	Cylinder,
+	Sphere
+};
+
 typedef std::vector<VertexPositionNormalTexture> VertexCollection;
 typedef std::vector<uint16_t> IndexCollection;
 
+// box and sphere around a mesh, in the mesh's own space
+struct MeshBounds
+{
+	XMFLOAT3 boxMin;
+	XMFLOAT3 boxMax;
+	XMFLOAT3 sphereCenter;
+	float sphereRadius;
+};
+
 namespace Models
 {
-	void CreateCube(VertexCollection& vertices, IndexCollection& indices, float size);
-	void CreateSphere(VertexCollection& vertices, IndexCollection& indices, float diameter, size_t tessellation);
-	void CreateCylinder(VertexCollection& vertices, IndexCollection& indices, float height, float diameter, size_t tessellation);
-	void CreateCone(VertexCollection& vertices, IndexCollection& indices, float diameter, float height, size_t tessellation);
-	void CreateTorus(VertexCollection& vertices, IndexCollection& indices, float diameter, float thickness, size_t tessellation);
+	// tessellation used by the curved primitives unless asked otherwise
+	const size_t DEFAULT_TESSELLATION = 24;
+
+	// build a primitive of the given size, tori are half as thick as they are wide
+	void CreateModel(ModelType type, float size, size_t tessellation, VertexCollection& vertices, IndexCollection& indices, MeshBounds* pBounds = nullptr);
+
+	// each one fills pBounds, if given, with the bounds of the vertices it added
+	void CreateCube(VertexCollection& vertices, IndexCollection& indices, float size, MeshBounds* pBounds = nullptr);
+	void CreateSphere(VertexCollection& vertices, IndexCollection& indices, float diameter, size_t tessellation, MeshBounds* pBounds = nullptr);
+	void CreateCylinder(VertexCollection& vertices, IndexCollection& indices, float height, float diameter, size_t tessellation, MeshBounds* pBounds = nullptr);
+	void CreateCone(VertexCollection& vertices, IndexCollection& indices, float diameter, float height, size_t tessellation, MeshBounds* pBounds = nullptr);
+	void CreateTorus(VertexCollection& vertices, IndexCollection& indices, float diameter, float thickness, size_t tessellation, MeshBounds* pBounds = nullptr);
+
+	// bounds of the vertices from firstVertex on, the sphere is centred on the box
+	void ComputeBounds(const VertexCollection& vertices, size_t firstVertex, MeshBounds& bounds);
+
+	// move the vertices from firstVertex on by a matrix, the normals by its inverse transpose.
+	// Returns true if the matrix mirrors, when the triangles' winding has to be swapped back
+	bool TransformVertices(VertexCollection& vertices, size_t firstVertex, FXMMATRIX matrix);
 }
 
 #endif
@@ -0,0 +1,260 @@
+//
+// BGTD 9201
+//	A fixed pool of piece moves, posed in one pass and retired by a swap
+//
+
+#include "MoveScheduler.h"
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+// the slot part of a handle
+static const UINT SLOT_MASK = (1u << MoveScheduler::MOVE_SLOT_BITS) - 1;
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+MoveScheduler::MoveScheduler(UINT inCapacity)
+{
+	capacity = inCapacity;
+	if (capacity > SLOT_MASK + 1)
+	{
+		OutputDebugString(L"Too many moves for a handle's slot bits");
+		assert(0);
+		capacity = SLOT_MASK + 1;
+	}
+
+	slotActive.resize(capacity);
+	slotGenerations.resize(capacity, 0);
+	freeSlots.resize(capacity);
+
+	activeSlots.resize(capacity);
+	styles.resize(capacity);
+	easings.resize(capacity);
+	targets.resize(capacity);
+	fromX.resize(capacity);
+	fromY.resize(capacity);
+	fromZ.resize(capacity);
+	toX.resize(capacity);
+	toY.resize(capacity);
+	toZ.resize(capacity);
+	fromYaws.resize(capacity);
+	toYaws.resize(capacity);
+	startTimes.resize(capacity);
+	inverseDurations.resize(capacity);
+	arcHeights.resize(capacity);
+	matrices.resize(capacity);
+	finished.resize(capacity);
+
+	Clear();
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void MoveScheduler::Clear()
+{
+	// slots are handed out from the bottom of the stack first
+	for (UINT i = 0; i < capacity; i++)
+	{
+		freeSlots[i] = capacity - 1 - i;
+		slotActive[i] = INVALID_MOVE;
+		slotGenerations[i]++;
+	}
+	freeCount = capacity;
+	activeCount = 0;
+	finishedCount = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+UINT MoveScheduler::Start(const PieceMove& move)
+{
+	if (freeCount == 0)
+	{
+		OutputDebugString(L"Out of room for piece moves");
+		return INVALID_MOVE;
+	}
+
+	UINT slot = freeSlots[--freeCount];
+	UINT active = activeCount++;
+	slotActive[slot] = active;
+	activeSlots[active] = slot;
+
+	styles[active] = (unsigned char)move.style;
+	easings[active] = (unsigned char)move.easing;
+	targets[active] = move.target;
+	fromX[active] = move.from.x;
+	fromY[active] = move.from.y;
+	fromZ[active] = move.from.z;
+	toX[active] = move.to.x;
+	toY[active] = move.to.y;
+	toZ[active] = move.to.z;
+	fromYaws[active] = move.fromYaw;
+	toYaws[active] = move.toYaw;
+	startTimes[active] = move.startTime;
+	inverseDurations[active] = move.duration > 0 ? 1.0f / move.duration : 0;
+	arcHeights[active] = move.arcHeight;
+
+	// held at its start until the first Update
+	XMStoreFloat4x4(&matrices[active], XMMatrixRotationY(move.fromYaw) * XMMatrixTranslation(move.from.x, move.from.y, move.from.z));
+
+	return slot | ((slotGenerations[slot] & (0xFFFFFFFF >> MOVE_SLOT_BITS)) << MOVE_SLOT_BITS);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+bool MoveScheduler::IsActive(UINT handle) const
+{
+	if (handle == INVALID_MOVE)
+	{
+		return false;
+	}
+	UINT slot = handle & SLOT_MASK;
+	UINT generation = handle >> MOVE_SLOT_BITS;
+	return slot < capacity && slotActive[slot] != INVALID_MOVE
+		&& (slotGenerations[slot] & (0xFFFFFFFF >> MOVE_SLOT_BITS)) == generation;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void MoveScheduler::Cancel(UINT handle)
+{
+	if (IsActive(handle))
+	{
+		Retire(slotActive[handle & SLOT_MASK]);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void MoveScheduler::CancelTarget(UINT target)
+{
+	UINT i = 0;
+	while (i < activeCount)
+	{
+		if (targets[i] == target)
+		{
+			Retire(i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void MoveScheduler::RemoveTarget(UINT removed)
+{
+	for (UINT i = 0; i < activeCount; i++)
+	{
+		if (targets[i] > removed)
+		{
+			targets[i]--;
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// The last playing move fills the hole, the order of the packed arrays doesn't matter
+// ------------------------------------------------------------------------------------
+void MoveScheduler::Retire(UINT active)
+{
+	UINT slot = activeSlots[active];
+	slotActive[slot] = INVALID_MOVE;
+	slotGenerations[slot]++;
+	freeSlots[freeCount++] = slot;
+
+	UINT last = --activeCount;
+	if (active != last)
+	{
+		activeSlots[active] = activeSlots[last];
+		slotActive[activeSlots[active]] = active;
+		styles[active] = styles[last];
+		easings[active] = easings[last];
+		targets[active] = targets[last];
+		fromX[active] = fromX[last];
+		fromY[active] = fromY[last];
+		fromZ[active] = fromZ[last];
+		toX[active] = toX[last];
+		toY[active] = toY[last];
+		toZ[active] = toZ[last];
+		fromYaws[active] = fromYaws[last];
+		toYaws[active] = toYaws[last];
+		startTimes[active] = startTimes[last];
+		inverseDurations[active] = inverseDurations[last];
+		arcHeights[active] = arcHeights[last];
+		matrices[active] = matrices[last];
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void MoveScheduler::Update(float time)
+{
+	finishedCount = 0;
+
+	UINT i = 0;
+	while (i < activeCount)
+	{
+		float u = (time - startTimes[i]) * inverseDurations[i];
+		if (u >= 1 || inverseDurations[i] == 0)
+		{
+			finished[finishedCount].style = (MoveStyle)styles[i];
+			finished[finishedCount].target = targets[i];
+			finishedCount++;
+
+			// the last move is now at i and still needs its pose
+			Retire(i);
+			continue;
+		}
+
+		// moves that start later wait at their first square
+		if (u < 0)
+		{
+			u = 0;
+		}
+		float e = ApplyEasing((EasingCurve)easings[i], u);
+
+		float x = fromX[i] + (toX[i] - fromX[i]) * e;
+		float y = fromY[i] + (toY[i] - fromY[i]) * e;
+		float z = fromZ[i] + (toZ[i] - fromZ[i]) * e;
+		float scale = 1;
+		if (styles[i] == ArcMove)
+		{
+			y += arcHeights[i] * 4 * e * (1 - e);
+		}
+		else if (styles[i] == CaptureMove)
+		{
+			scale = 1 - e;
+		}
+
+		// a turn about y, only worked out when the ends face different ways
+		float yaw = fromYaws[i];
+		if (toYaws[i] != yaw)
+		{
+			yaw += (toYaws[i] - yaw) * e;
+		}
+		float c = yaw == 0 ? 1 : cosf(yaw);
+		float s = yaw == 0 ? 0 : sinf(yaw);
+
+		XMFLOAT4X4& m = matrices[i];
+		m._11 = c * scale;	m._12 = 0;		m._13 = -s * scale;	m._14 = 0;
+		m._21 = 0;			m._22 = scale;	m._23 = 0;			m._24 = 0;
+		m._31 = s * scale;	m._32 = 0;		m._33 = c * scale;	m._34 = 0;
+		m._41 = x;			m._42 = y;		m._43 = z;			m._44 = 1;
+
+		i++;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void MoveScheduler::Apply(TransformStore& store, UINT firstTransform) const
+{
+	for (UINT i = 0; i < activeCount; i++)
+	{
+		store.SetLocal(firstTransform + targets[i], matrices[i], styles[i] == CaptureMove ? UniformScaleTransform : RigidTransform);
+	}
+}
@@ -0,0 +1,131 @@
+//
+// BGTD 9201
+//	Piece moves playing at the same time, each with its own start and length.
+//	Every move lives in a pool sized once up front, kept packed as arrays of
+//	its fields so a frame walks them in one pass. A move that finishes is
+//	swapped with the last one, so nothing is allocated or shuffled per frame
+//
+
+#ifndef _MOVE_SCHEDULER_H
+#define _MOVE_SCHEDULER_H
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "Platform.h"
+#include "PieceAnimator.h"
+#include "TransformStore.h"
+
+// how a piece gets from one square to the next
+enum MoveStyle
+{
+	SlideMove,		// along the board
+	ArcMove,		// up and over the pieces in between, for knights
+	CaptureMove		// shrinks and sinks into its square
+};
+
+// what to play, positions are the piece's translation on the board
+struct PieceMove
+{
+	MoveStyle style;
+	UINT target;					// the piece, Apply adds it to the first transform
+	DirectX::XMFLOAT3 from;
+	DirectX::XMFLOAT3 to;
+	float fromYaw;					// turn about y at either end
+	float toYaw;
+	float startTime;				// in the clock Update is given
+	float duration;
+	EasingCurve easing;
+	float arcHeight;				// how high an ArcMove goes at its middle
+};
+
+// a move that ran to its end in the last Update
+struct FinishedMove
+{
+	MoveStyle style;
+	UINT target;
+};
+
+class MoveScheduler
+{
+public:
+	// room for capacity moves at once, allocated here and never again
+	MoveScheduler(UINT capacity = 4096);
+
+	static const UINT INVALID_MOVE = 0xFFFFFFFF;
+
+	// most moves there can be, a handle's slot takes MOVE_SLOT_BITS
+	static const UINT MOVE_SLOT_BITS = 20;
+
+	// start a move, returns a handle or INVALID_MOVE when the pool is full
+	UINT Start(const PieceMove& move);
+
+	// stop a move where it is, handles of finished moves are ignored
+	void Cancel(UINT handle);
+	bool IsActive(UINT handle) const;
+
+	// stop every move
+	void Clear();
+
+	// stop every move of one target, it has somewhere new to go
+	void CancelTarget(UINT target);
+
+	// targets above removed go down one, for a piece taken out of the middle of a list
+	void RemoveTarget(UINT removed);
+
+	// pose every move for this time, moves that reach their end are retired without a
+	// pose, the caller's own state already has the piece where it ended up
+	void Update(float time);
+
+	// set the pose of every playing move as the local matrix of firstTransform + target
+	void Apply(TransformStore& store, UINT firstTransform) const;
+
+	UINT GetCapacity() const { return capacity; }
+	UINT GetActiveCount() const { return activeCount; }
+
+	// what the last Update retired
+	UINT GetFinishedCount() const { return finishedCount; }
+	const FinishedMove& GetFinished(UINT index) const { return finished[index]; }
+
+	// the pose of a playing move by its place in the packed arrays
+	UINT GetTarget(UINT active) const { return targets[active]; }
+	const DirectX::XMFLOAT4X4& GetMatrix(UINT active) const { return matrices[active]; }
+
+private:
+
+	// the pool is shared out by handle, never copied
+	MoveScheduler(const MoveScheduler&);
+	MoveScheduler& operator=(const MoveScheduler&);
+
+	// move the last playing move into active's place and free active's slot
+	void Retire(UINT active);
+
+	UINT capacity;
+
+	// handles are a slot and that slot's generation, so an old handle can't reach a new move
+	std::vector<UINT> slotActive;			// where each slot's move is in the packed arrays
+	std::vector<UINT> slotGenerations;
+	std::vector<UINT> freeSlots;
+	UINT freeCount;
+
+	// the playing moves, packed from 0 to activeCount - 1
+	UINT activeCount;
+	std::vector<UINT> activeSlots;
+	std::vector<unsigned char> styles;
+	std::vector<unsigned char> easings;
+	std::vector<UINT> targets;
+	std::vector<float> fromX, fromY, fromZ;
+	std::vector<float> toX, toY, toZ;
+	std::vector<float> fromYaws, toYaws;
+	std::vector<float> startTimes;
+	std::vector<float> inverseDurations;
+	std::vector<float> arcHeights;
+
+	// poses of the last Update
+	std::vector<DirectX::XMFLOAT4X4> matrices;
+
+	std::vector<FinishedMove> finished;
+	UINT finishedCount;
+};
+
+#endif
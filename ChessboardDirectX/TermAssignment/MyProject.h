@@ -6,14 +6,18 @@
 #include "TextureType.h"
 #include "IndexedPrimitive.h"
 #include "LitColourShader.h"
-#include "Pawn.h"
-#include "Bishop.h"
+#include "ChessPiece.h"
 #include "Chessboard.h"
-#include "King.h"
-#include "Knight.h"
-#include "Queen.h"
-#include "Rook.h"
 #include "SkyBox.h"
+#include "PieceBatcher.h"
+#include "RenderQueue.h"
+#include "FrustumCuller.h"
+#include "ChessScene.h"
+#include "RecordingRenderDevice.h"
+#include "CommandCapture.h"
+#include "TransformStore.h"
+#include "ScenePicker.h"
+#include "ChessEngine.h"
 
 // forward declare the sprite batch
 
@@ -53,38 +57,62 @@ private:
 	LitColourShader shader;
 	SkyBox skyBox;
 
-	float runTime;
+	// camera, animation and placements, everything the frame draws that isn't Direct3D
+	ChessScene scene;
+
+	// time since the shader's upload counters were last reported
+	float statsTime;
 
 	// chessboard
 	Chessboard chessboard;
 	
-	// player 1 chess pieces
+	// one model per piece type, both players draw through it
+	ChessPiece pawn;
+	ChessPiece bishop;
+	ChessPiece king;
+	ChessPiece knight;
+	ChessPiece queen;
+	ChessPiece rook;
+
+	// player colours, passed to the pieces per instance
 	Color playerOneColour;	// white
-	Pawn pawn;
-	Bishop bishop;
-	King king;
-	Knight knight;
-	Queen queen;
-	Rook rook;
-
-	// player 2 chess pieces
 	Color playerTwoColour;	// black
-	Pawn pawn2;
-	Bishop bishop2;
-	King king2;
-	Knight knight2;
-	Queen queen2;
-	Rook rook2;
-
-	// matrices
-	Matrix pawnMatrix;
-	Matrix rookMatrix;
-	Matrix knightMatrix;
-	Matrix bishopMatrix;
-	Matrix kingMatrix;
-	Matrix queenMatrix;
-	Matrix startMatrix;
-	Matrix endMatrix;
+
+	// gathers every piece of a type so each part is drawn once
+	PieceBatcher pieceBatcher;
+
+	// world matrix of the board, every square and every piece, worked out in one pass a frame
+	TransformStore transforms;
+	UINT boardTransform;
+	UINT firstPieceTransform;
+
+	// every draw of the frame, sorted by state before it is submitted
+	RenderQueue renderQueue;
+
+	// drops the squares and pieces outside the camera before they are queued
+	FrustumCuller culler;
+
+	// the board and pieces as drawn last, and what is under the mouse
+	ScenePicker picker;
+	PickResult hover;
+
+	// E has the computer play the side to move, A analyses the board on every core until
+	// pressed again, starting over after each move. The engine thinks on its own threads
+	// and Update polls it, the line it expects shown under the board
+	ChessEngine engine;
+	uint32_t engineSearch;
+	bool enginePlaying;
+	bool analysing;
+	uint64_t analysedKey;
+	std::wstring engineLine;
+
+	// sits in front of the Direct3D device while frames are recorded. R counts the
+	// calls of one frame, C saves the calls and camera of the next few to a capture
+	RecordingRenderDevice recordingDevice;
+	int framesToRecord;
+	bool capturing;
+	CommandCapture capture;
+	CaptureCamera recordedCamera;
 
 	TextureType diffuseTex;
 	TextureType specTex;
@@ -97,19 +125,13 @@ private:
 	Vector2 mouseDelta;
 	bool buttonDown;
 
-	// for camera controls
-	Vector3 cameraPos;
-	Vector2 cameraRotationSpeed;
-	Vector2 cameraRotation;
-	float cameraRadius;
-	float cameraRadiusSpeed;
-
-	void UpdateCamera(float deltaTime);
-
 	// call when the mouse is released
 	void OnMouseDown();
 	void OnMouseMove();
 
+	// pick whatever is under mousePos
+	void UpdateHover();
+
 };
 
 #endif
\ No newline at end of file
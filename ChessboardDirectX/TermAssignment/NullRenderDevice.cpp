@@ -0,0 +1,46 @@
+//
+// BGTD 9201
+//	A render device with no GPU behind it
+//
+
+#include "NullRenderDevice.h"
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+NullRenderDevice::NullRenderDevice()
+{
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+NullRenderDevice::~NullRenderDevice()
+{
+}
+
+// ------------------------------------------------------------------------------------
+// A byte of real memory makes a handle no other buffer can have
+// ------------------------------------------------------------------------------------
+DeviceBuffer* NullRenderDevice::CreateConstantBuffer(UINT sizeInBytes)
+{
+	return (DeviceBuffer*)new unsigned char;
+}
+
+// ------------------------------------------------------------------------------------
+// Only buffers this device created may be released through it
+// ------------------------------------------------------------------------------------
+void NullRenderDevice::ReleaseBuffer(DeviceBuffer* pBuffer)
+{
+	delete (unsigned char*)pBuffer;
+}
+
+// ------------------------------------------------------------------------------------
+// Hand out scratch memory big enough for the write
+// ------------------------------------------------------------------------------------
+void* NullRenderDevice::Map(DeviceBuffer* pBuffer, DeviceMapMode mode, UINT offset, UINT size)
+{
+	if (scratch.size() < size)
+	{
+		scratch.resize(size);
+	}
+	return scratch.data();
+}
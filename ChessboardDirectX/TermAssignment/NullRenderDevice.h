@@ -0,0 +1,65 @@
+//
+// BGTD 9201
+//	A render device with no GPU behind it. Every call is accepted and dropped,
+//	maps hand out scratch memory, so the frame's CPU work can run and be
+//	measured anywhere
+//
+
+#ifndef _NULL_RENDER_DEVICE_H
+#define _NULL_RENDER_DEVICE_H
+
+#include <vector>
+
+#include "RenderDevice.h"
+
+class NullRenderDevice : public RenderDevice
+{
+public:
+	NullRenderDevice();
+	~NullRenderDevice();
+
+	void BeginFrame() {}
+	void EndFrame() {}
+
+	// offsets are free when nothing is bound
+	bool SupportsConstantOffsets() const { return true; }
+
+	// the buffers are only addresses, nothing is ever read from them
+	DeviceBuffer* CreateConstantBuffer(UINT sizeInBytes);
+	void ReleaseBuffer(DeviceBuffer* pBuffer);
+
+	// every map writes into the same scratch memory
+	void* Map(DeviceBuffer* pBuffer, DeviceMapMode mode, UINT offset, UINT size);
+	void Unmap(DeviceBuffer* pBuffer) {}
+
+	void IASetInputLayout(DeviceInputLayout* pInputLayout) {}
+	void IASetPrimitiveTopology(DeviceTopology topology) {}
+	void IASetVertexBuffers(UINT startSlot, UINT numBuffers, DeviceBuffer* const* ppBuffers, const UINT* pStrides, const UINT* pOffsets) {}
+	void IASetIndexBuffer(DeviceBuffer* pIndexBuffer, DeviceIndexFormat format, UINT offset) {}
+
+	void VSSetShader(DeviceVertexShader* pShader) {}
+	void PSSetShader(DevicePixelShader* pShader) {}
+
+	void VSSetConstantBuffer(UINT slot, DeviceBuffer* pBuffer, UINT firstConstant, UINT numConstants) {}
+	void PSSetConstantBuffer(UINT slot, DeviceBuffer* pBuffer, UINT firstConstant, UINT numConstants) {}
+
+	void PSSetSampler(UINT slot, DeviceSampler* pSampler) {}
+	void PSSetShaderResource(UINT slot, DeviceTexture* pView) {}
+
+	void RSSetState(DeviceRasterizerState* pState) {}
+	void OMSetDepthStencilState(DeviceDepthStencilState* pState, UINT stencilRef) {}
+
+	void Draw(UINT vertexCount, UINT startVertex) {}
+	void DrawIndexed(UINT indexCount, UINT startIndex, int baseVertex) {}
+	void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, int baseVertex, UINT startInstance) {}
+
+private:
+
+	// device is never copied, the buffers it handed out would be freed twice
+	NullRenderDevice(const NullRenderDevice&);
+	NullRenderDevice& operator=(const NullRenderDevice&);
+
+	std::vector<unsigned char> scratch;
+};
+
+#endif
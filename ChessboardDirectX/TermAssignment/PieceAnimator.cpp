@@ -0,0 +1,405 @@
+//
+// BGTD 9201
+//	Pre-decomposed clips blended a whole array of tracks at a time
+//
+
+#include "PieceAnimator.h"
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+// rotations closer than this are blended straight, sin of the angle gets too small to divide by
+static const float SLERP_THRESHOLD = 0.9995f;
+
+// sine from 0 to pi, as cos(x - pi / 2) to the 12th power, good to the last bit of a float
+static inline float SineHalfTurn(float x)
+{
+	float y = x - XM_PIDIV2;
+	float y2 = y * y;
+	return 1 + y2 * (-1.0f / 2 + y2 * (1.0f / 24 + y2 * (-1.0f / 720 + y2 * (1.0f / 40320
+		+ y2 * (-1.0f / 3628800 + y2 * (1.0f / 479001600))))));
+}
+
+// the elements of a pose in its arrays
+enum PoseElement
+{
+	ScaleX, ScaleY, ScaleZ,
+	RotationX, RotationY, RotationZ, RotationW,
+	TranslationX, TranslationY, TranslationZ
+};
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+float ApplyEasing(EasingCurve easing, float t)
+{
+	switch (easing)
+	{
+		case EaseInEasing:
+			return t * t;
+		case EaseOutEasing:
+			return 1 - (1 - t) * (1 - t);
+		case EaseInOutEasing:
+			return t * t * (3 - 2 * t);
+		default:
+			return t;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+AnimationClip::AnimationClip()
+{
+	kind = RigidTransform;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void AnimationClip::AddKey(float time, const XMFLOAT4X4& matrix, EasingCurve easing)
+{
+	XMVECTOR scale, rotation, translation;
+	if (!XMMatrixDecompose(&scale, &rotation, &translation, XMLoadFloat4x4(&matrix)))
+	{
+		OutputDebugString(L"Couldn't decompose an animation key");
+		assert(0);
+		return;
+	}
+
+	XMFLOAT3 keyScale, keyTranslation;
+	XMFLOAT4 keyRotation;
+	XMStoreFloat3(&keyScale, scale);
+	XMStoreFloat4(&keyRotation, rotation);
+	XMStoreFloat3(&keyTranslation, translation);
+	AddKey(time, keyScale, keyRotation, keyTranslation, easing);
+}
+
+// ------------------------------------------------------------------------------------
+// The rotation is flipped onto the previous key's side here, so blends always take the
+// short way round without checking every frame
+// ------------------------------------------------------------------------------------
+void AnimationClip::AddKey(float time, const XMFLOAT3& scale, const XMFLOAT4& rotation, const XMFLOAT3& translation, EasingCurve easing)
+{
+	if (!keys.empty() && time < keys.back().time)
+	{
+		OutputDebugString(L"Animation keys have to be added in time order");
+		assert(0);
+		return;
+	}
+
+	TransformKey key;
+	key.time = time;
+	key.scale = scale;
+	key.translation = translation;
+	key.easing = easing;
+	key.angle = 0;
+	key.inverseSin = 0;
+	XMStoreFloat4(&key.rotation, XMQuaternionNormalize(XMLoadFloat4(&rotation)));
+
+	if (!keys.empty())
+	{
+		TransformKey& previous = keys.back();
+		float dot = previous.rotation.x * key.rotation.x + previous.rotation.y * key.rotation.y
+			+ previous.rotation.z * key.rotation.z + previous.rotation.w * key.rotation.w;
+		if (dot < 0)
+		{
+			key.rotation = XMFLOAT4(-key.rotation.x, -key.rotation.y, -key.rotation.z, -key.rotation.w);
+			dot = -dot;
+		}
+		if (dot < SLERP_THRESHOLD)
+		{
+			previous.angle = acosf(dot);
+			previous.inverseSin = 1.0f / sinf(previous.angle);
+		}
+	}
+
+	// a blend between two uniform scales stays uniform
+	const float tolerance = AffineTransform::ORTHOGONAL_TOLERANCE;
+	TransformKind keyKind = RigidTransform;
+	if (fabsf(scale.x - scale.y) > tolerance || fabsf(scale.x - scale.z) > tolerance)
+	{
+		keyKind = AxisScaleTransform;
+	}
+	else if (fabsf(scale.x - 1) > tolerance)
+	{
+		keyKind = UniformScaleTransform;
+	}
+	if (keyKind > kind)
+	{
+		kind = keyKind;
+	}
+
+	keys.push_back(key);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+PieceAnimator::PieceAnimator()
+{
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void PieceAnimator::Clear()
+{
+	trackClips.clear();
+	trackTransforms.clear();
+	trackStarts.clear();
+	trackModes.clear();
+	trackKeys.clear();
+	for (int e = 0; e < POSE_ELEMENTS; e++)
+	{
+		from[e].clear();
+		to[e].clear();
+		poses[e].clear();
+	}
+	blends.clear();
+	angles.clear();
+	inverseSins.clear();
+	matrices.clear();
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+UINT PieceAnimator::AddClip(const AnimationClip& clip)
+{
+	if (clip.GetKeyCount() == 0)
+	{
+		OutputDebugString(L"An animation clip needs at least one key");
+		assert(0);
+	}
+
+	ClipRange range;
+	range.firstKey = (UINT)keys.size();
+	range.numKeys = (UINT)clip.GetKeyCount();
+	range.duration = clip.GetDuration();
+	range.kind = clip.GetKind();
+	for (size_t i = 0; i < clip.GetKeyCount(); i++)
+	{
+		keys.push_back(clip.GetKey(i));
+	}
+	clips.push_back(range);
+	return (UINT)clips.size() - 1;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+UINT PieceAnimator::Play(UINT clip, UINT transform, float startTime, PlaybackMode mode)
+{
+	if (clip >= clips.size())
+	{
+		OutputDebugString(L"Playing a clip that was never added");
+		assert(0);
+		return 0;
+	}
+
+	trackClips.push_back(clip);
+	trackTransforms.push_back(transform);
+	trackStarts.push_back(startTime);
+	trackModes.push_back(mode);
+	trackKeys.push_back(0);
+
+	size_t count = trackClips.size();
+	for (int e = 0; e < POSE_ELEMENTS; e++)
+	{
+		from[e].resize(count);
+		to[e].resize(count);
+		poses[e].resize(count);
+	}
+	blends.resize(count);
+	angles.resize(count);
+	inverseSins.resize(count);
+	matrices.resize(count);
+	XMStoreFloat4x4(&matrices.back(), XMMatrixIdentity());
+
+	return (UINT)count - 1;
+}
+
+// ------------------------------------------------------------------------------------
+// Three passes down the arrays: find the keys, blend them, build the matrices
+// ------------------------------------------------------------------------------------
+void PieceAnimator::Evaluate(float time)
+{
+	FindKeys(time);
+	BlendPoses();
+	ComposeMatrices();
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void PieceAnimator::Apply(TransformStore& store) const
+{
+	for (size_t i = 0; i < trackClips.size(); i++)
+	{
+		if (trackTransforms[i] != NO_TRANSFORM)
+		{
+			store.SetLocal(trackTransforms[i], matrices[i], clips[trackClips[i]].kind);
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Tracks mostly stay on last frame's key or move one on, so the search walks from there
+// ------------------------------------------------------------------------------------
+void PieceAnimator::FindKeys(float time)
+{
+	for (size_t i = 0; i < trackClips.size(); i++)
+	{
+		const ClipRange& clip = clips[trackClips[i]];
+		const TransformKey* pKeys = &keys[clip.firstKey];
+		float duration = clip.duration;
+
+		// where the track is in its clip
+		float t = time - trackStarts[i];
+		if (t < 0 || duration <= 0)
+		{
+			t = 0;
+		}
+		else if (trackModes[i] == PlayLooped)
+		{
+			t = fmodf(t, duration);
+		}
+		else if (trackModes[i] == PlayPingPong)
+		{
+			t = fmodf(t, 2 * duration);
+			if (t > duration)
+			{
+				t = 2 * duration - t;
+			}
+		}
+		else if (t > duration)
+		{
+			t = duration;
+		}
+
+		// the key at or before t, never the last unless it is the only one
+		UINT key = trackKeys[i];
+		UINT numKeys = clip.numKeys;
+		while (key + 2 < numKeys && pKeys[key + 1].time <= t)
+		{
+			key++;
+		}
+		while (key > 0 && pKeys[key].time > t)
+		{
+			key--;
+		}
+		trackKeys[i] = key;
+
+		const TransformKey& start = pKeys[key];
+		const TransformKey& end = pKeys[key + 1 < numKeys ? key + 1 : key];
+
+		float blend = 0;
+		float span = end.time - start.time;
+		if (span > 0)
+		{
+			blend = (t - start.time) / span;
+			blend = blend < 0 ? 0 : blend > 1 ? 1 : blend;
+		}
+		blends[i] = ApplyEasing(start.easing, blend);
+		angles[i] = start.angle;
+		inverseSins[i] = key + 1 < numKeys ? start.inverseSin : 0;
+
+		const float startPose[POSE_ELEMENTS] = { start.scale.x, start.scale.y, start.scale.z, start.rotation.x, start.rotation.y,
+			start.rotation.z, start.rotation.w, start.translation.x, start.translation.y, start.translation.z };
+		const float endPose[POSE_ELEMENTS] = { end.scale.x, end.scale.y, end.scale.z, end.rotation.x, end.rotation.y,
+			end.rotation.z, end.rotation.w, end.translation.x, end.translation.y, end.translation.z };
+		for (int e = 0; e < POSE_ELEMENTS; e++)
+		{
+			from[e][i] = startPose[e];
+			to[e][i] = endPose[e];
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void PieceAnimator::BlendPoses()
+{
+	size_t count = blends.size();
+	const float* t = blends.data();
+
+	// scales and translations in straight lines
+	const int lerped[] = { ScaleX, ScaleY, ScaleZ, TranslationX, TranslationY, TranslationZ };
+	for (int l = 0; l < 6; l++)
+	{
+		const float* a = from[lerped[l]].data();
+		const float* b = to[lerped[l]].data();
+		float* out = poses[lerped[l]].data();
+		for (size_t i = 0; i < count; i++)
+		{
+			out[i] = a[i] + (b[i] - a[i]) * t[i];
+		}
+	}
+
+	// rotations at a steady angular speed, the keys are already on the same side and
+	// the angles between them known
+	const float* ax = from[RotationX].data();
+	const float* ay = from[RotationY].data();
+	const float* az = from[RotationZ].data();
+	const float* aw = from[RotationW].data();
+	const float* bx = to[RotationX].data();
+	const float* by = to[RotationY].data();
+	const float* bz = to[RotationZ].data();
+	const float* bw = to[RotationW].data();
+	float* qx = poses[RotationX].data();
+	float* qy = poses[RotationY].data();
+	float* qz = poses[RotationZ].data();
+	float* qw = poses[RotationW].data();
+	const float* angle = angles.data();
+	const float* inverseSin = inverseSins.data();
+	for (size_t i = 0; i < count; i++)
+	{
+		float weightA = 1 - t[i];
+		float weightB = t[i];
+		if (inverseSin[i] != 0)
+		{
+			float angleB = t[i] * angle[i];
+			weightA = SineHalfTurn(angle[i] - angleB) * inverseSin[i];
+			weightB = SineHalfTurn(angleB) * inverseSin[i];
+		}
+
+		float x = ax[i] * weightA + bx[i] * weightB;
+		float y = ay[i] * weightA + by[i] * weightB;
+		float z = az[i] * weightA + bz[i] * weightB;
+		float w = aw[i] * weightA + bw[i] * weightB;
+		float length = 1.0f / sqrtf(((x * x + y * y) + z * z) + w * w);
+		qx[i] = x * length;
+		qy[i] = y * length;
+		qz[i] = z * length;
+		qw[i] = w * length;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// scale * rotation * translation, the rotation rows as XMMatrixRotationQuaternion has them
+// ------------------------------------------------------------------------------------
+void PieceAnimator::ComposeMatrices()
+{
+	for (size_t i = 0; i < matrices.size(); i++)
+	{
+		float x = poses[RotationX][i];
+		float y = poses[RotationY][i];
+		float z = poses[RotationZ][i];
+		float w = poses[RotationW][i];
+		float sx = poses[ScaleX][i];
+		float sy = poses[ScaleY][i];
+		float sz = poses[ScaleZ][i];
+
+		XMFLOAT4X4& m = matrices[i];
+		m._11 = (1 - 2 * (y * y + z * z)) * sx;
+		m._12 = 2 * (x * y + z * w) * sx;
+		m._13 = 2 * (x * z - y * w) * sx;
+		m._14 = 0;
+		m._21 = 2 * (x * y - z * w) * sy;
+		m._22 = (1 - 2 * (x * x + z * z)) * sy;
+		m._23 = 2 * (y * z + x * w) * sy;
+		m._24 = 0;
+		m._31 = 2 * (x * z + y * w) * sz;
+		m._32 = 2 * (y * z - x * w) * sz;
+		m._33 = (1 - 2 * (x * x + y * y)) * sz;
+		m._34 = 0;
+		m._41 = poses[TranslationX][i];
+		m._42 = poses[TranslationY][i];
+		m._43 = poses[TranslationZ][i];
+		m._44 = 1;
+	}
+}
@@ -0,0 +1,149 @@
+//
+// BGTD 9201
+//	Clips of scale, rotation and translation keys, decomposed once when the
+//	clip is built, and a player that blends every playing clip at once. The
+//	tracks are kept as separate arrays of pose elements so the slerps and
+//	lerps run one after another down the arrays, then the poses go into a
+//	TransformStore as local matrices
+//
+
+#ifndef _PIECE_ANIMATOR_H
+#define _PIECE_ANIMATOR_H
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "Platform.h"
+#include "TransformStore.h"
+
+// how a blend from one key to the next speeds up and slows down
+enum EasingCurve
+{
+	LinearEasing,
+	EaseInEasing,			// starts slow
+	EaseOutEasing,			// ends slow
+	EaseInOutEasing			// starts and ends slow
+};
+
+// what a track does once it reaches the end of its clip
+enum PlaybackMode
+{
+	PlayOnce,				// holds the last key
+	PlayLooped,				// jumps back to the first key
+	PlayPingPong			// plays backwards to the first key, then forwards again
+};
+
+// one pose of a clip
+struct TransformKey
+{
+	float time;						// seconds from the start of the clip
+	DirectX::XMFLOAT3 scale;
+	DirectX::XMFLOAT4 rotation;		// unit quaternion, on the same side as the previous key's
+	DirectX::XMFLOAT3 translation;
+	EasingCurve easing;				// the blend from this key to the next
+
+	// between this rotation and the next key's, so a slerp needs no acos. The inverse
+	// sine is 0 when they are close enough to blend in a straight line
+	float angle;
+	float inverseSin;
+};
+
+class AnimationClip
+{
+public:
+	AnimationClip();
+
+	// keys go in time order. A matrix is decomposed here, once, and has to be a scale,
+	// a rotation and a translation
+	void AddKey(float time, const DirectX::XMFLOAT4X4& matrix, EasingCurve easing = LinearEasing);
+	void AddKey(float time, const DirectX::XMFLOAT3& scale, const DirectX::XMFLOAT4& rotation,
+		const DirectX::XMFLOAT3& translation, EasingCurve easing = LinearEasing);
+
+	float GetDuration() const { return keys.empty() ? 0 : keys.back().time; }
+	size_t GetKeyCount() const { return keys.size(); }
+	const TransformKey& GetKey(size_t index) const { return keys[index]; }
+
+	// the most any pose between the keys can be, rigid when no key scales
+	TransformKind GetKind() const { return kind; }
+
+private:
+
+	std::vector<TransformKey> keys;
+	TransformKind kind;
+};
+
+// eased = curve(t), for t from 0 to 1
+float ApplyEasing(EasingCurve easing, float t);
+
+class PieceAnimator
+{
+public:
+	PieceAnimator();
+
+	// a track that only poses and sets no transform
+	static const UINT NO_TRANSFORM = 0xFFFFFFFF;
+
+	// stop every track, the clips stay
+	void Clear();
+
+	// keep a clip to play, returns its index
+	UINT AddClip(const AnimationClip& clip);
+
+	// start a clip at startTime on a transform of the store given to Apply, returns the track
+	UINT Play(UINT clip, UINT transform, float startTime, PlaybackMode mode = PlayOnce);
+
+	size_t GetTrackCount() const { return trackClips.size(); }
+
+	// pose every track for this time, in the same clock as the start times
+	void Evaluate(float time);
+
+	// set each track's pose as the local matrix of its transform
+	void Apply(TransformStore& store) const;
+
+	// results of the last Evaluate
+	const DirectX::XMFLOAT4X4& GetMatrix(UINT track) const { return matrices[track]; }
+
+private:
+
+	// which key of its clip each track is past and how far on to the next it is
+	void FindKeys(float time);
+
+	// lerp the scales and translations and slerp the rotations of every track
+	void BlendPoses();
+
+	// build each track's matrix from its pose
+	void ComposeMatrices();
+
+	// every clip's keys one after another, so tracks don't chase a pointer per clip
+	struct ClipRange
+	{
+		UINT firstKey;
+		UINT numKeys;
+		float duration;
+		TransformKind kind;
+	};
+	std::vector<ClipRange> clips;
+	std::vector<TransformKey> keys;
+
+	// each track's clip, where it goes and when it started
+	std::vector<UINT> trackClips;
+	std::vector<UINT> trackTransforms;
+	std::vector<float> trackStarts;
+	std::vector<PlaybackMode> trackModes;
+	std::vector<UINT> trackKeys;		// last frame's key, the search starts from here
+
+	// the keys on either side of each track and how far between them it is. Scale x, y,
+	// z, rotation x, y, z, w, translation x, y, z, one array per element
+	static const int POSE_ELEMENTS = 10;
+	std::vector<float> from[POSE_ELEMENTS];
+	std::vector<float> to[POSE_ELEMENTS];
+	std::vector<float> blends;
+	std::vector<float> angles;
+	std::vector<float> inverseSins;
+
+	// the blended poses, then as matrices
+	std::vector<float> poses[POSE_ELEMENTS];
+	std::vector<DirectX::XMFLOAT4X4> matrices;
+};
+
+#endif
@@ -0,0 +1,198 @@
+//
+// BGTD 9201
+//	Gathers every chess piece drawn in a frame into one instance buffer
+//
+
+#include "PieceBatcher.h"
+#include <cstring>
+#include <cfloat>
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+PieceBatcher::PieceBatcher()
+{
+	pDevice = nullptr;
+	pInstanceBuffer = nullptr;
+	capacity = 0;
+
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		startInstance[i] = 0;
+		firstCullIndex[i] = 0;
+
+		pieceBounds[i].boxMin = pieceBounds[i].boxMax = pieceBounds[i].sphereCenter = DirectX::XMFLOAT3(0, 0, 0);
+		pieceBounds[i].sphereRadius = 0;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+PieceBatcher::~PieceBatcher()
+{
+	if (pInstanceBuffer) pInstanceBuffer->Release();
+}
+
+// ------------------------------------------------------------------------------------
+// Create the instance buffer
+// ------------------------------------------------------------------------------------
+void PieceBatcher::Initialize(ID3D11Device* pInDevice, UINT maxInstances)
+{
+	pDevice = pInDevice;
+	CreateInstanceBuffer(maxInstances);
+
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		instances[i].reserve(maxInstances);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// (Re)creates the dynamic instance buffer
+// ------------------------------------------------------------------------------------
+bool PieceBatcher::CreateInstanceBuffer(UINT maxInstances)
+{
+	if (pInstanceBuffer)
+	{
+		pInstanceBuffer->Release();
+		pInstanceBuffer = nullptr;
+	}
+	capacity = 0;
+
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.ByteWidth = maxInstances * sizeof(InstanceData);
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+
+	HRESULT hr = pDevice->CreateBuffer(&bufferDesc, NULL, &pInstanceBuffer);
+	if (FAILED(hr))
+	{
+		OutputDebugString(L"Couldn't create piece instance buffer");
+		assert(0);
+		return false;
+	}
+
+	capacity = maxInstances;
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// Clear out last frame's pieces
+// ------------------------------------------------------------------------------------
+void PieceBatcher::Begin()
+{
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		instances[i].clear();
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Queue up a piece to be drawn this frame
+// ------------------------------------------------------------------------------------
+void PieceBatcher::AddPiece(PieceType type, const Matrix& worldMatrix, const Color& colour)
+{
+	InstanceData instance;
+	instance.worldMatrix = worldMatrix;
+	instance.colour = colour;
+
+	instances[type].push_back(instance);
+}
+
+// ------------------------------------------------------------------------------------
+// Queue a sphere for every piece, each type's spheres are kept together
+// ------------------------------------------------------------------------------------
+void PieceBatcher::AddToCuller(FrustumCuller& culler)
+{
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		firstCullIndex[i] = culler.GetNumSpheres();
+		for (size_t j = 0; j < instances[i].size(); j++)
+		{
+			culler.AddBounds(pieceBounds[i], instances[i][j].worldMatrix);
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Pack the visible pieces of each type to the front and drop the rest
+// ------------------------------------------------------------------------------------
+void PieceBatcher::ApplyCulling(const FrustumCuller& culler)
+{
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		size_t kept = 0;
+		for (size_t j = 0; j < instances[i].size(); j++)
+		{
+			if (culler.IsVisible(firstCullIndex[i] + (UINT)j))
+			{
+				instances[i][kept++] = instances[i][j];
+			}
+		}
+		instances[i].resize(kept);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Copy every queued piece into the instance buffer, grouped by type
+// ------------------------------------------------------------------------------------
+void PieceBatcher::Upload(RenderDevice* pRenderDevice)
+{
+	// lay the groups out back to back
+	UINT total = 0;
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		startInstance[i] = total;
+		total += (UINT)instances[i].size();
+	}
+
+	if (total == 0)
+	{
+		return;
+	}
+
+	// make room if this frame has more pieces than ever before
+	if (total > capacity)
+	{
+		if (!CreateInstanceBuffer(total * 2))
+		{
+			return;
+		}
+	}
+
+	InstanceData* pInstances = (InstanceData*)pRenderDevice->Map(pInstanceBuffer, MapWriteDiscard, 0, total * sizeof(InstanceData));
+	if (pInstances == nullptr)
+	{
+		return;
+	}
+
+	for (int i = 0; i < NUM_PIECE_TYPES; i++)
+	{
+		if (!instances[i].empty())
+		{
+			memcpy(pInstances + startInstance[i], instances[i].data(), instances[i].size() * sizeof(InstanceData));
+		}
+	}
+
+	pRenderDevice->Unmap(pInstanceBuffer);
+}
+
+// ------------------------------------------------------------------------------------
+// How far the nearest instance of a type is from the camera
+// ------------------------------------------------------------------------------------
+float PieceBatcher::GetNearestDepth(PieceType type, const Matrix& viewMatrix) const
+{
+	float nearest = FLT_MAX;
+	for (size_t i = 0; i < instances[type].size(); i++)
+	{
+		// the camera looks down -z
+		float depth = -DirectX::SimpleMath::Vector3::Transform(instances[type][i].worldMatrix.Translation(), viewMatrix).z;
+		if (depth < nearest)
+		{
+			nearest = depth;
+		}
+	}
+	return nearest;
+}
@@ -0,0 +1,74 @@
+//
+// BGTD 9201
+//	Gathers every chess piece drawn in a frame into one instance buffer
+//	so each part of a piece type is drawn once for all of its instances
+//
+
+#ifndef _PIECE_BATCHER_H
+#define _PIECE_BATCHER_H
+
+#include <d3d11_1.h>
+#include <SimpleMath.h>
+#include <vector>
+
+#include "LitColourShader.h"
+#include "FrustumCuller.h"
+#include "ChessSet.h"
+
+using DirectX::SimpleMath::Matrix;
+using DirectX::SimpleMath::Color;
+
+class PieceBatcher
+{
+public:
+	PieceBatcher();
+	~PieceBatcher();
+
+	// create the instance buffer with room for the given number of pieces
+	void Initialize(ID3D11Device* pDevice, UINT maxInstances);
+
+	// clear out last frame's pieces
+	void Begin();
+
+	// queue up a piece to be drawn this frame, the colour is the player's
+	void AddPiece(PieceType type, const Matrix& worldMatrix, const Color& colour);
+
+	// the mesh bounds of a piece type, used to cull and pick its instances
+	void SetBounds(PieceType type, const MeshBounds& bounds) { pieceBounds[type] = bounds; }
+	const MeshBounds& GetBounds(PieceType type) const { return pieceBounds[type]; }
+
+	// queue a sphere for every piece added this frame
+	void AddToCuller(FrustumCuller& culler);
+
+	// drop the pieces the culler threw out, call before Upload
+	void ApplyCulling(const FrustumCuller& culler);
+
+	// copy every queued piece into the instance buffer with a single Map
+	void Upload(RenderDevice* pRenderDevice);
+
+	// where each piece type's instances ended up in the buffer
+	ID3D11Buffer* GetInstanceBuffer() const { return pInstanceBuffer; }
+	UINT GetStartInstance(PieceType type) const { return startInstance[type]; }
+	UINT GetInstanceCount(PieceType type) const { return (UINT)instances[type].size(); }
+
+	// distance in front of the camera of the nearest piece of a type, for sorting
+	float GetNearestDepth(PieceType type, const Matrix& viewMatrix) const;
+
+private:
+
+	// grows the GPU buffer if the frame holds more pieces than it can
+	bool CreateInstanceBuffer(UINT maxInstances);
+
+	ID3D11Device* pDevice;
+	ID3D11Buffer* pInstanceBuffer;
+	UINT capacity;
+
+	// pieces queued this frame, grouped by type
+	std::vector<InstanceData> instances[NUM_PIECE_TYPES];
+	UINT startInstance[NUM_PIECE_TYPES];
+
+	MeshBounds pieceBounds[NUM_PIECE_TYPES];
+	UINT firstCullIndex[NUM_PIECE_TYPES];
+};
+
+#endif
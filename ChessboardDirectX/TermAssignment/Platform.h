@@ -0,0 +1,26 @@
+//
+// BGTD 9201
+//	The few Windows names the portable code uses, filled in on platforms
+//	without windows.h so the scene and submission code builds with GCC and Clang
+//
+
+#ifndef _PLATFORM_H
+#define _PLATFORM_H
+
+#include <assert.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <stdio.h>
+
+typedef unsigned int UINT;
+
+// debug output goes to stderr
+inline void OutputDebugString(const wchar_t* pMessage)
+{
+	fprintf(stderr, "%ls", pMessage);
+}
+#endif
+
+#endif
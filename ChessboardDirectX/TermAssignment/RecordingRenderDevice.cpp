@@ -0,0 +1,469 @@
+//
+// BGTD 9201
+//	A null render device that writes every call of the current frame into a byte stream
+//
+
+#include "RecordingRenderDevice.h"
+#include <cstring>
+#include <sstream>
+
+// the arguments after the object id, in the order the calls take them
+static const int COMMAND_ARGS[NUM_DEVICE_COMMANDS] =
+{
+	3,	// map: mode, offset, size
+	0,	// unmap
+	0,	// input layout
+	1,	// topology
+	3,	// vertex buffer: slot, stride, offset
+	2,	// index buffer: format, offset
+	0,	// vertex shader
+	0,	// pixel shader
+	3,	// VS constants: slot, first constant, constant count
+	3,	// PS constants: slot, first constant, constant count
+	1,	// sampler: slot
+	1,	// texture: slot
+	0,	// rasterizer
+	1,	// depth stencil: stencil ref
+	2,	// draw: vertices, start
+	3,	// indexed: indices, start, base vertex
+	5	// instanced: indices, instances, start, base vertex, start instance
+};
+
+static const wchar_t* COMMAND_NAMES[NUM_DEVICE_COMMANDS] =
+{
+	L"map", L"unmap", L"input layout", L"topology", L"vertex buffer", L"index buffer",
+	L"vertex shader", L"pixel shader", L"VS constants", L"PS constants", L"sampler",
+	L"texture", L"rasterizer", L"depth stencil", L"draw", L"draw indexed", L"draw instanced"
+};
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+RecordingRenderDevice::RecordingRenderDevice()
+{
+	pTarget = nullptr;
+	pLastObject = nullptr;
+	lastObjectId = 0;
+
+	// id 0 is nothing bound
+	constantObjects.push_back(false);
+
+	memset(&current, 0, sizeof(current));
+	ResetStats();
+}
+
+// ------------------------------------------------------------------------------------
+// Start a new frame
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::BeginFrame()
+{
+	stream.clear();
+	frameMaps.clear();
+	memset(&current, 0, sizeof(current));
+
+	if (pTarget)
+	{
+		pTarget->BeginFrame();
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// A map only counts as constants once the buffer has been bound to a constant slot,
+// which is usually after the map, so the sorting waits for the end of the frame
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::EndFrame()
+{
+	for (size_t i = 0; i < frameMaps.size(); i++)
+	{
+		if (constantObjects[frameMaps[i].object])
+		{
+			current.constantBytes += frameMaps[i].size;
+		}
+		else
+		{
+			current.otherBytes += frameMaps[i].size;
+		}
+	}
+	current.streamBytes = (UINT)stream.size();
+
+	frameStats = current;
+	numFrames++;
+
+	if (pTarget)
+	{
+		pTarget->EndFrame();
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Buffers come from the target when there is one, so they can be passed on to it
+// ------------------------------------------------------------------------------------
+bool RecordingRenderDevice::SupportsConstantOffsets() const
+{
+	return pTarget ? pTarget->SupportsConstantOffsets() : NullRenderDevice::SupportsConstantOffsets();
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+DeviceBuffer* RecordingRenderDevice::CreateConstantBuffer(UINT sizeInBytes)
+{
+	return pTarget ? pTarget->CreateConstantBuffer(sizeInBytes) : NullRenderDevice::CreateConstantBuffer(sizeInBytes);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::ReleaseBuffer(DeviceBuffer* pBuffer)
+{
+	if (pTarget)
+	{
+		pTarget->ReleaseBuffer(pBuffer);
+	}
+	else
+	{
+		NullRenderDevice::ReleaseBuffer(pBuffer);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::ResetStats()
+{
+	memset(&frameStats, 0, sizeof(frameStats));
+	numFrames = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// Write out the last frame's counts
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::ReportStats() const
+{
+	std::wostringstream message;
+	message << L"RecordingRenderDevice: " << frameStats.draws << L" draws, " << frameStats.instances << L" instances, "
+		<< frameStats.constantBytes << L" constant bytes, " << frameStats.otherBytes << L" other bytes mapped, "
+		<< frameStats.streamBytes << L" stream bytes over " << numFrames << L" frames\n";
+	for (int i = 0; i < NUM_DEVICE_COMMANDS; i++)
+	{
+		if (frameStats.calls[i] != 0)
+		{
+			message << L"  " << COMMAND_NAMES[i] << L": " << frameStats.calls[i] << L"\n";
+		}
+	}
+
+	OutputDebugString(message.str().c_str());
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+int RecordingRenderDevice::GetNumArgs(DeviceCommandType type)
+{
+	return COMMAND_ARGS[type];
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+UINT RecordingRenderDevice::GetObjectId(const void* pObject)
+{
+	if (pObject == nullptr)
+	{
+		return 0;
+	}
+	if (pObject == pLastObject)
+	{
+		return lastObjectId;
+	}
+
+	std::unordered_map<const void*, UINT>::iterator found = objectIds.find(pObject);
+	UINT id;
+	if (found != objectIds.end())
+	{
+		id = found->second;
+	}
+	else
+	{
+		id = (UINT)objectIds.size() + 1;
+		objectIds[pObject] = id;
+		constantObjects.push_back(false);
+	}
+
+	pLastObject = pObject;
+	lastObjectId = id;
+	return id;
+}
+
+// ------------------------------------------------------------------------------------
+// Small numbers take one byte, the top bit says another byte follows
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::WriteVarint(UINT value)
+{
+	while (value >= 0x80)
+	{
+		stream.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	stream.push_back((unsigned char)value);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::Record(DeviceCommandType type, const void* pObject, UINT arg0, UINT arg1, UINT arg2, UINT arg3, UINT arg4)
+{
+	UINT args[5] = { arg0, arg1, arg2, arg3, arg4 };
+
+	stream.push_back((unsigned char)type);
+	WriteVarint(GetObjectId(pObject));
+	for (int i = 0; i < COMMAND_ARGS[type]; i++)
+	{
+		WriteVarint(args[i]);
+	}
+
+	current.calls[type]++;
+}
+
+// ------------------------------------------------------------------------------------
+// The inverse of Record
+// ------------------------------------------------------------------------------------
+size_t RecordingRenderDevice::ReadCommand(const unsigned char* pStream, size_t size, size_t offset, DeviceCommand& command)
+{
+	if (offset >= size || pStream[offset] >= NUM_DEVICE_COMMANDS)
+	{
+		return 0;
+	}
+	command.type = (DeviceCommandType)pStream[offset++];
+	memset(command.args, 0, sizeof(command.args));
+
+	int numValues = 1 + COMMAND_ARGS[command.type];
+	for (int i = 0; i < numValues; i++)
+	{
+		UINT value = 0;
+		int shift = 0;
+		for (;;)
+		{
+			if (offset >= size || shift > 28)
+			{
+				return 0;
+			}
+			unsigned char byte = pStream[offset++];
+			value |= (UINT)(byte & 0x7f) << shift;
+			shift += 7;
+			if ((byte & 0x80) == 0)
+			{
+				break;
+			}
+		}
+
+		if (i == 0)
+		{
+			command.object = value;
+		}
+		else
+		{
+			command.args[i - 1] = value;
+		}
+	}
+	return offset;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void* RecordingRenderDevice::Map(DeviceBuffer* pBuffer, DeviceMapMode mode, UINT offset, UINT size)
+{
+	Record(MapCommand, pBuffer, mode, offset, size);
+
+	FrameMap frameMap;
+	frameMap.object = GetObjectId(pBuffer);
+	frameMap.size = size;
+	frameMaps.push_back(frameMap);
+
+	if (pTarget)
+	{
+		return pTarget->Map(pBuffer, mode, offset, size);
+	}
+	return NullRenderDevice::Map(pBuffer, mode, offset, size);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::Unmap(DeviceBuffer* pBuffer)
+{
+	Record(UnmapCommand, pBuffer);
+	if (pTarget)
+	{
+		pTarget->Unmap(pBuffer);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::IASetInputLayout(DeviceInputLayout* pInputLayout)
+{
+	Record(InputLayoutCommand, pInputLayout);
+	if (pTarget)
+	{
+		pTarget->IASetInputLayout(pInputLayout);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::IASetPrimitiveTopology(DeviceTopology topology)
+{
+	Record(TopologyCommand, nullptr, topology);
+	if (pTarget)
+	{
+		pTarget->IASetPrimitiveTopology(topology);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// One command per stream: slot, stride, offset
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::IASetVertexBuffers(UINT startSlot, UINT numBuffers, DeviceBuffer* const* ppBuffers, const UINT* pStrides, const UINT* pOffsets)
+{
+	for (UINT i = 0; i < numBuffers; i++)
+	{
+		Record(VertexBuffersCommand, ppBuffers[i], startSlot + i, pStrides[i], pOffsets[i]);
+	}
+	if (pTarget)
+	{
+		pTarget->IASetVertexBuffers(startSlot, numBuffers, ppBuffers, pStrides, pOffsets);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::IASetIndexBuffer(DeviceBuffer* pIndexBuffer, DeviceIndexFormat format, UINT offset)
+{
+	Record(IndexBufferCommand, pIndexBuffer, format, offset);
+	if (pTarget)
+	{
+		pTarget->IASetIndexBuffer(pIndexBuffer, format, offset);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::VSSetShader(DeviceVertexShader* pShader)
+{
+	Record(VertexShaderCommand, pShader);
+	if (pTarget)
+	{
+		pTarget->VSSetShader(pShader);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::PSSetShader(DevicePixelShader* pShader)
+{
+	Record(PixelShaderCommand, pShader);
+	if (pTarget)
+	{
+		pTarget->PSSetShader(pShader);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::VSSetConstantBuffer(UINT slot, DeviceBuffer* pBuffer, UINT firstConstant, UINT numConstants)
+{
+	Record(VSConstantBufferCommand, pBuffer, slot, firstConstant, numConstants);
+	constantObjects[GetObjectId(pBuffer)] = pBuffer != nullptr;
+	if (pTarget)
+	{
+		pTarget->VSSetConstantBuffer(slot, pBuffer, firstConstant, numConstants);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::PSSetConstantBuffer(UINT slot, DeviceBuffer* pBuffer, UINT firstConstant, UINT numConstants)
+{
+	Record(PSConstantBufferCommand, pBuffer, slot, firstConstant, numConstants);
+	constantObjects[GetObjectId(pBuffer)] = pBuffer != nullptr;
+	if (pTarget)
+	{
+		pTarget->PSSetConstantBuffer(slot, pBuffer, firstConstant, numConstants);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::PSSetSampler(UINT slot, DeviceSampler* pSampler)
+{
+	Record(SamplerCommand, pSampler, slot);
+	if (pTarget)
+	{
+		pTarget->PSSetSampler(slot, pSampler);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::PSSetShaderResource(UINT slot, DeviceTexture* pView)
+{
+	Record(TextureCommand, pView, slot);
+	if (pTarget)
+	{
+		pTarget->PSSetShaderResource(slot, pView);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::RSSetState(DeviceRasterizerState* pState)
+{
+	Record(RasterizerCommand, pState);
+	if (pTarget)
+	{
+		pTarget->RSSetState(pState);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::OMSetDepthStencilState(DeviceDepthStencilState* pState, UINT stencilRef)
+{
+	Record(DepthStencilCommand, pState, stencilRef);
+	if (pTarget)
+	{
+		pTarget->OMSetDepthStencilState(pState, stencilRef);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::Draw(UINT vertexCount, UINT startVertex)
+{
+	Record(DrawCommand, nullptr, vertexCount, startVertex);
+	current.draws++;
+	current.instances++;
+	if (pTarget)
+	{
+		pTarget->Draw(vertexCount, startVertex);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::DrawIndexed(UINT indexCount, UINT startIndex, int baseVertex)
+{
+	Record(DrawIndexedCommand, nullptr, indexCount, startIndex, (UINT)baseVertex);
+	current.draws++;
+	current.instances++;
+	if (pTarget)
+	{
+		pTarget->DrawIndexed(indexCount, startIndex, baseVertex);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void RecordingRenderDevice::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, int baseVertex, UINT startInstance)
+{
+	Record(DrawIndexedInstancedCommand, nullptr, indexCount, instanceCount, startIndex, (UINT)baseVertex, startInstance);
+	current.draws++;
+	current.instances += instanceCount;
+	if (pTarget)
+	{
+		pTarget->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	}
+}
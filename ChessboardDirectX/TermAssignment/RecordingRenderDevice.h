@@ -0,0 +1,159 @@
+//
+// BGTD 9201
+//	A null render device that writes every call of the current frame into a
+//	compact byte stream and counts what the frame would have sent to the GPU.
+//	Given a target it passes every call on, so a frame can be recorded and drawn
+//
+
+#ifndef _RECORDING_RENDER_DEVICE_H
+#define _RECORDING_RENDER_DEVICE_H
+
+#include <vector>
+#include <unordered_map>
+
+#include "NullRenderDevice.h"
+
+// the calls a frame can make
+enum DeviceCommandType
+{
+	MapCommand,
+	UnmapCommand,
+	InputLayoutCommand,
+	TopologyCommand,
+	VertexBuffersCommand,
+	IndexBufferCommand,
+	VertexShaderCommand,
+	PixelShaderCommand,
+	VSConstantBufferCommand,
+	PSConstantBufferCommand,
+	SamplerCommand,
+	TextureCommand,
+	RasterizerCommand,
+	DepthStencilCommand,
+	DrawCommand,
+	DrawIndexedCommand,
+	DrawIndexedInstancedCommand,
+
+	NUM_DEVICE_COMMANDS
+};
+
+// one call read back out of a stream. The object is the id of whatever was bound or
+// mapped, 0 for nothing, and the arguments are the call's counts, slots and offsets in order
+struct DeviceCommand
+{
+	DeviceCommandType type;
+	UINT object;
+	UINT args[5];
+};
+
+// what one frame sent
+struct DeviceFrameStats
+{
+	int calls[NUM_DEVICE_COMMANDS];
+	int draws;
+	int instances;
+	UINT constantBytes;		// written into buffers bound as constants
+	UINT otherBytes;		// instance data and anything else mapped
+	UINT streamBytes;
+};
+
+class RecordingRenderDevice : public NullRenderDevice
+{
+public:
+	RecordingRenderDevice();
+
+	// calls are passed on to this device after they are recorded, nullptr drops them.
+	// Only change it between frames
+	void SetTarget(RenderDevice* pTargetDevice) { pTarget = pTargetDevice; }
+
+	// starting a frame throws away the last one's stream
+	void BeginFrame();
+
+	// ending one totals up its stats
+	void EndFrame();
+
+	bool SupportsConstantOffsets() const;
+	DeviceBuffer* CreateConstantBuffer(UINT sizeInBytes);
+	void ReleaseBuffer(DeviceBuffer* pBuffer);
+
+	void* Map(DeviceBuffer* pBuffer, DeviceMapMode mode, UINT offset, UINT size);
+	void Unmap(DeviceBuffer* pBuffer);
+
+	void IASetInputLayout(DeviceInputLayout* pInputLayout);
+	void IASetPrimitiveTopology(DeviceTopology topology);
+	void IASetVertexBuffers(UINT startSlot, UINT numBuffers, DeviceBuffer* const* ppBuffers, const UINT* pStrides, const UINT* pOffsets);
+	void IASetIndexBuffer(DeviceBuffer* pIndexBuffer, DeviceIndexFormat format, UINT offset);
+
+	void VSSetShader(DeviceVertexShader* pShader);
+	void PSSetShader(DevicePixelShader* pShader);
+
+	void VSSetConstantBuffer(UINT slot, DeviceBuffer* pBuffer, UINT firstConstant, UINT numConstants);
+	void PSSetConstantBuffer(UINT slot, DeviceBuffer* pBuffer, UINT firstConstant, UINT numConstants);
+
+	void PSSetSampler(UINT slot, DeviceSampler* pSampler);
+	void PSSetShaderResource(UINT slot, DeviceTexture* pView);
+
+	void RSSetState(DeviceRasterizerState* pState);
+	void OMSetDepthStencilState(DeviceDepthStencilState* pState, UINT stencilRef);
+
+	void Draw(UINT vertexCount, UINT startVertex);
+	void DrawIndexed(UINT indexCount, UINT startIndex, int baseVertex);
+	void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, int baseVertex, UINT startInstance);
+
+	// the calls made since BeginFrame. Each is a command byte, the object id and the
+	// command's arguments, the numbers as 7 bit varints
+	const std::vector<unsigned char>& GetStream() const { return stream; }
+
+	// objects keep their ids for as long as the device lives, so frames can be compared
+	UINT GetNumObjects() const { return (UINT)objectIds.size(); }
+
+	// the last finished frame, and every frame since the stats were reset
+	const DeviceFrameStats& GetFrameStats() const { return frameStats; }
+	int GetNumFrames() const { return numFrames; }
+	void ResetStats();
+
+	// writes the last frame's counts to the debug output
+	void ReportStats() const;
+
+	// arguments each command carries after its object id
+	static int GetNumArgs(DeviceCommandType type);
+
+	// read the command at offset, returns the offset of the next one or 0 at the end of
+	// the stream or if the bytes don't make a command
+	static size_t ReadCommand(const unsigned char* pStream, size_t size, size_t offset, DeviceCommand& command);
+
+private:
+
+	// write a command, unused arguments are 0
+	void Record(DeviceCommandType type, const void* pObject, UINT arg0 = 0, UINT arg1 = 0, UINT arg2 = 0, UINT arg3 = 0, UINT arg4 = 0);
+	void WriteVarint(UINT value);
+
+	// the stream's id for an object, the first time an object is seen it gets the next one
+	UINT GetObjectId(const void* pObject);
+
+	RenderDevice* pTarget;
+
+	std::vector<unsigned char> stream;
+	std::unordered_map<const void*, UINT> objectIds;
+
+	// the last pointer looked up, most calls bind or map the same thing as the one before
+	const void* pLastObject;
+	UINT lastObjectId;
+
+	// the frame's maps, sorted into constants and other data once the frame's binds are known
+	struct FrameMap
+	{
+		UINT object;
+		UINT size;
+	};
+	std::vector<FrameMap> frameMaps;
+
+	// objects that have been bound to a constant slot, indexed by id
+	std::vector<bool> constantObjects;
+
+	DeviceFrameStats current;
+	DeviceFrameStats frameStats;
+	int numFrames;
+};
+
+#endif
@@ -0,0 +1,110 @@
+//
+// BGTD 9201
+//	Every call the frame makes to the GPU goes through this interface, so the
+//	same submission code can drive Direct3D 11, a null device that accepts
+//	everything, or a device that records what it was sent. Resources are still
+//	created up front by the Direct3D code, only per-frame work passes through here
+//
+
+#ifndef _RENDER_DEVICE_H
+#define _RENDER_DEVICE_H
+
+#include "Platform.h"
+
+#ifdef _WIN32
+#include <d3d11_1.h>
+
+// on Windows the handles are the Direct3D objects themselves
+typedef ID3D11Buffer DeviceBuffer;
+typedef ID3D11InputLayout DeviceInputLayout;
+typedef ID3D11VertexShader DeviceVertexShader;
+typedef ID3D11PixelShader DevicePixelShader;
+typedef ID3D11SamplerState DeviceSampler;
+typedef ID3D11ShaderResourceView DeviceTexture;
+typedef ID3D11RasterizerState DeviceRasterizerState;
+typedef ID3D11DepthStencilState DeviceDepthStencilState;
+#else
+// elsewhere they are opaque, whichever device made them knows what they are
+struct DeviceBuffer;
+struct DeviceInputLayout;
+struct DeviceVertexShader;
+struct DevicePixelShader;
+struct DeviceSampler;
+struct DeviceTexture;
+struct DeviceRasterizerState;
+struct DeviceDepthStencilState;
+#endif
+
+// the same values as D3D11_PRIMITIVE_TOPOLOGY
+enum DeviceTopology
+{
+	UndefinedTopology = 0,
+	TriangleListTopology = 4,
+	TriangleStripTopology = 5
+};
+
+// the same values as DXGI_FORMAT
+enum DeviceIndexFormat
+{
+	UnknownIndexFormat = 0,
+	Index32Format = 42,
+	Index16Format = 57
+};
+
+// the same values as D3D11_MAP
+enum DeviceMapMode
+{
+	MapWriteDiscard = 4,
+	MapWriteNoOverwrite = 5
+};
+
+class RenderDevice
+{
+public:
+	virtual ~RenderDevice() {}
+
+	// frame boundaries, devices that count or record start a new frame here
+	virtual void BeginFrame() = 0;
+	virtual void EndFrame() = 0;
+
+	// true when constant buffers can be bound at an offset and mapped without renaming
+	virtual bool SupportsConstantOffsets() const = 0;
+
+	// a dynamic constant buffer the CPU rewrites
+	virtual DeviceBuffer* CreateConstantBuffer(UINT sizeInBytes) = 0;
+	virtual void ReleaseBuffer(DeviceBuffer* pBuffer) = 0;
+
+	// CPU access to size bytes of a dynamic buffer starting at offset, returns where
+	// offset lands or nullptr if it couldn't be mapped
+	virtual void* Map(DeviceBuffer* pBuffer, DeviceMapMode mode, UINT offset, UINT size) = 0;
+	virtual void Unmap(DeviceBuffer* pBuffer) = 0;
+
+	// input assembler
+	virtual void IASetInputLayout(DeviceInputLayout* pInputLayout) = 0;
+	virtual void IASetPrimitiveTopology(DeviceTopology topology) = 0;
+	virtual void IASetVertexBuffers(UINT startSlot, UINT numBuffers, DeviceBuffer* const* ppBuffers, const UINT* pStrides, const UINT* pOffsets) = 0;
+	virtual void IASetIndexBuffer(DeviceBuffer* pIndexBuffer, DeviceIndexFormat format, UINT offset) = 0;
+
+	// shaders
+	virtual void VSSetShader(DeviceVertexShader* pShader) = 0;
+	virtual void PSSetShader(DevicePixelShader* pShader) = 0;
+
+	// a numConstants of 0 binds the whole buffer, anything else binds that slice of it
+	virtual void VSSetConstantBuffer(UINT slot, DeviceBuffer* pBuffer, UINT firstConstant, UINT numConstants) = 0;
+	virtual void PSSetConstantBuffer(UINT slot, DeviceBuffer* pBuffer, UINT firstConstant, UINT numConstants) = 0;
+
+	// pixel shader resources
+	virtual void PSSetSampler(UINT slot, DeviceSampler* pSampler) = 0;
+	virtual void PSSetShaderResource(UINT slot, DeviceTexture* pView) = 0;
+
+	// fixed function state
+	virtual void RSSetState(DeviceRasterizerState* pState) = 0;
+	virtual void OMSetDepthStencilState(DeviceDepthStencilState* pState, UINT stencilRef) = 0;
+
+	// draws
+	virtual void Draw(UINT vertexCount, UINT startVertex) = 0;
+	virtual void DrawIndexed(UINT indexCount, UINT startIndex, int baseVertex) = 0;
+	virtual void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, int baseVertex, UINT startInstance) = 0;
+};
+
+#endif
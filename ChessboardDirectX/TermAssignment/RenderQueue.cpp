@@ -0,0 +1,174 @@
+//
+// BGTD 9201
+//	Sorts the frame's draws by a packed key before submitting them
+//
+
+#include "RenderQueue.h"
+#include <sstream>
+
+// where each field sits in the key
+static const int DEPTH_BITS = 28;
+static const int MESH_BITS = 12;
+static const int MATERIAL_BITS = 12;
+static const int SHADER_BITS = 8;
+
+static const int MESH_SHIFT = DEPTH_BITS;
+static const int MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+static const int SHADER_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+static const int PASS_SHIFT = SHADER_SHIFT + SHADER_BITS;
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+RenderQueue::RenderQueue()
+{
+	nearPlane = 1;
+	farPlane = 128;
+
+	ResetStats();
+}
+
+// ------------------------------------------------------------------------------------
+// Set the range depths are scaled over
+// ------------------------------------------------------------------------------------
+void RenderQueue::SetDepthRange(float inNearPlane, float inFarPlane)
+{
+	nearPlane = inNearPlane;
+	farPlane = inFarPlane;
+}
+
+// ------------------------------------------------------------------------------------
+// Start a new frame
+// ------------------------------------------------------------------------------------
+void RenderQueue::Begin()
+{
+	packets.clear();
+}
+
+// ------------------------------------------------------------------------------------
+// Hand out ids in the order objects are first seen, so they stay the same every frame
+// ------------------------------------------------------------------------------------
+UINT RenderQueue::GetSortId(std::map<const void*, UINT>& ids, const void* pObject, UINT maxId)
+{
+	std::map<const void*, UINT>::iterator found = ids.find(pObject);
+	if (found != ids.end())
+	{
+		return found->second;
+	}
+
+	// out of ids, later objects share the last one and only lose some batching
+	UINT id = (UINT)ids.size();
+	if (id > maxId)
+	{
+		id = maxId;
+	}
+	ids[pObject] = id;
+	return id;
+}
+
+// ------------------------------------------------------------------------------------
+// Pack the fields of a key
+// ------------------------------------------------------------------------------------
+uint64_t RenderQueue::MakeKey(RenderPass pass, const void* pShader, UINT materialId, const void* pMesh, float viewDepth)
+{
+	uint64_t shaderId = GetSortId(shaderIds, pShader, (1 << SHADER_BITS) - 1);
+	uint64_t meshId = GetSortId(meshIds, pMesh, (1 << MESH_BITS) - 1);
+
+	// materials past the last id share it the same way, rather than wrapping onto low ones
+	uint64_t materialBits = materialId < (1 << MATERIAL_BITS) - 1 ? materialId : (1 << MATERIAL_BITS) - 1;
+
+	// nearest first, anything outside the planes is clamped to them
+	float depth = (viewDepth - nearPlane) / (farPlane - nearPlane);
+	if (depth < 0) depth = 0;
+	if (depth > 1) depth = 1;
+	uint64_t depthBits = (uint64_t)(depth * ((1 << DEPTH_BITS) - 1));
+
+	return ((uint64_t)pass << PASS_SHIFT) | (shaderId << SHADER_SHIFT) | (materialBits << MATERIAL_SHIFT)
+		| (meshId << MESH_SHIFT) | depthBits;
+}
+
+// ------------------------------------------------------------------------------------
+// Add a packet
+// ------------------------------------------------------------------------------------
+void RenderQueue::Submit(const RenderPacket& packet)
+{
+	packets.push_back(packet);
+}
+
+// ------------------------------------------------------------------------------------
+// Least significant byte first radix sort, stable so equal keys keep their submit order
+// ------------------------------------------------------------------------------------
+void RenderQueue::Sort()
+{
+	size_t count = packets.size();
+	if (count < 2)
+	{
+		return;
+	}
+	scratch.resize(count);
+
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t offsets[256] = { 0 };
+		for (size_t i = 0; i < count; i++)
+		{
+			offsets[(packets[i].key >> shift) & 0xFF]++;
+		}
+
+		// every key has the same byte here, nothing would move
+		if (offsets[(packets[0].key >> shift) & 0xFF] == count)
+		{
+			radixPassesSkipped++;
+			continue;
+		}
+
+		// turn the counts into where each bucket starts
+		size_t total = 0;
+		for (int bucket = 0; bucket < 256; bucket++)
+		{
+			size_t bucketCount = offsets[bucket];
+			offsets[bucket] = total;
+			total += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			scratch[offsets[(packets[i].key >> shift) & 0xFF]++] = packets[i];
+		}
+		packets.swap(scratch);
+		radixPasses++;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Draw everything in key order
+// ------------------------------------------------------------------------------------
+void RenderQueue::Execute(RenderDevice* pRenderDevice)
+{
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		packets[i].pOwner->DrawPacket(pRenderDevice, packets[i]);
+	}
+	packetsDrawn += (int)packets.size();
+}
+
+// ------------------------------------------------------------------------------------
+// Clear the counters
+// ------------------------------------------------------------------------------------
+void RenderQueue::ResetStats()
+{
+	packetsDrawn = 0;
+	radixPasses = 0;
+	radixPassesSkipped = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// Write the counts to the debug output
+// ------------------------------------------------------------------------------------
+void RenderQueue::ReportStats() const
+{
+	std::wostringstream message;
+	message << L"RenderQueue: " << packetsDrawn << L" packets drawn, " << radixPasses << L" radix passes, "
+		<< radixPassesSkipped << L" skipped\n";
+
+	OutputDebugString(message.str().c_str());
+}
@@ -0,0 +1,103 @@
+//
+// BGTD 9201
+//	Collects the frame's draws as packets with a 64 bit sort key and radix
+//	sorts them, so draws sharing a shader, material and mesh end up next to
+//	each other and opaque draws within a group go front to back
+//
+
+#ifndef _RENDER_QUEUE_H
+#define _RENDER_QUEUE_H
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+#include "RenderDevice.h"
+
+// which part of the frame a packet is drawn in, the highest bits of the key
+enum RenderPass
+{
+	SkyPass,
+	OpaquePass,
+
+	NUM_RENDER_PASSES
+};
+
+class Renderable;
+
+// one draw waiting in the queue
+struct RenderPacket
+{
+	uint64_t key;
+	Renderable* pOwner;
+
+	// instances to draw, unused by owners that draw a single object
+	DeviceBuffer* pInstanceBuffer;
+	UINT startInstance;
+	UINT numInstances;
+};
+
+// anything that can submit packets to the queue
+class Renderable
+{
+public:
+	virtual ~Renderable() {}
+
+	// draw a packet this object submitted
+	virtual void DrawPacket(RenderDevice* pRenderDevice, const RenderPacket& packet) = 0;
+};
+
+class RenderQueue
+{
+public:
+	RenderQueue();
+
+	// view depths are scaled to fit the key between these planes
+	void SetDepthRange(float nearPlane, float farPlane);
+
+	// throw away last frame's packets
+	void Begin();
+
+	// pack a key, the pointers are turned into small ids the first time they are seen and the
+	// material id comes from the material registry.
+	// pass | shader (8 bits) | material (12 bits) | mesh (12 bits) | depth (28 bits)
+	uint64_t MakeKey(RenderPass pass, const void* pShader, UINT materialId, const void* pMesh, float viewDepth);
+
+	// add a packet for this frame
+	void Submit(const RenderPacket& packet);
+
+	// order the packets by key
+	void Sort();
+
+	// draw the packets in order
+	void Execute(RenderDevice* pRenderDevice);
+
+	// how much work the last frames did
+	int GetNumPackets() const { return (int)packets.size(); }
+	void ResetStats();
+
+	// writes the counts to the debug output
+	void ReportStats() const;
+
+private:
+
+	// the id of a pointer within one field of the key
+	static UINT GetSortId(std::map<const void*, UINT>& ids, const void* pObject, UINT maxId);
+
+	std::vector<RenderPacket> packets;
+
+	// ping-pong buffer for the radix passes
+	std::vector<RenderPacket> scratch;
+
+	std::map<const void*, UINT> shaderIds;
+	std::map<const void*, UINT> meshIds;
+
+	float nearPlane;
+	float farPlane;
+
+	int packetsDrawn;
+	int radixPasses;
+	int radixPassesSkipped;
+};
+
+#endif
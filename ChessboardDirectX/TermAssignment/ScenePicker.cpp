@@ -0,0 +1,339 @@
+//
+// BGTD 9201
+//	Ray picking for the board squares and the pieces
+//
+
+#include "ScenePicker.h"
+#include "ChessSet.h"
+#include <algorithm>
+#include <cfloat>
+
+using namespace DirectX;
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+ScenePicker::ScenePicker()
+{
+	boardTop = ChessSet::GetBoardTop();
+}
+
+// ------------------------------------------------------------------------------------
+// Back through the projection and view from the near plane to the far one
+// ------------------------------------------------------------------------------------
+PickRay ScenePicker::Unproject(float screenX, float screenY, float width, float height, const XMFLOAT4X4& view, const XMFLOAT4X4& projection)
+{
+	XMMATRIX inverseViewProjection = XMMatrixInverse(nullptr, XMLoadFloat4x4(&view) * XMLoadFloat4x4(&projection));
+
+	float x = screenX / width * 2 - 1;
+	float y = 1 - screenY / height * 2;
+	XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(x, y, 0, 1), inverseViewProjection);
+	XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(x, y, 1, 1), inverseViewProjection);
+
+	PickRay ray;
+	XMStoreFloat3(&ray.origin, nearPoint);
+	XMStoreFloat3(&ray.direction, XMVector3Normalize(farPoint - nearPoint));
+	return ray;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void ScenePicker::Begin()
+{
+	objects.clear();
+	nodes.clear();
+	boardInverses.clear();
+}
+
+// ------------------------------------------------------------------------------------
+// The box around the squares' tops, the ray only needs to reach them to hit a square
+// ------------------------------------------------------------------------------------
+void ScenePicker::AddBoard(UINT id, const XMFLOAT4X4& parentWorld)
+{
+	XMMATRIX world = XMLoadFloat4x4(&parentWorld);
+	float halfWidth = ChessSet::BOARD_SIZE * ChessSet::GRID_SCALE * 0.5f;
+
+	XMVECTOR boxMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boxMax = XMVectorReplicate(-FLT_MAX);
+	for (int corner = 0; corner < 4; corner++)
+	{
+		XMVECTOR point = XMVector3TransformCoord(XMVectorSet((corner & 1) ? halfWidth : -halfWidth, boardTop,
+			(corner & 2) ? halfWidth : -halfWidth, 1), world);
+		boxMin = XMVectorMin(boxMin, point);
+		boxMax = XMVectorMax(boxMax, point);
+	}
+
+	PickObject object;
+	XMStoreFloat3(&object.boxMin, boxMin);
+	XMStoreFloat3(&object.boxMax, boxMax);
+	object.id = id;
+	object.board = (UINT)boardInverses.size();
+	objects.push_back(object);
+
+	XMFLOAT4X4 inverse;
+	XMStoreFloat4x4(&inverse, XMMatrixInverse(nullptr, world));
+	boardInverses.push_back(inverse);
+}
+
+// ------------------------------------------------------------------------------------
+// The corners of the mesh's box moved into place, the box around them is what is picked
+// ------------------------------------------------------------------------------------
+void ScenePicker::AddPiece(UINT id, const MeshBounds& bounds, const XMFLOAT4X4& worldMatrix)
+{
+	XMMATRIX world = XMLoadFloat4x4(&worldMatrix);
+
+	XMVECTOR boxMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boxMax = XMVectorReplicate(-FLT_MAX);
+	for (int corner = 0; corner < 8; corner++)
+	{
+		XMVECTOR point = XMVector3TransformCoord(XMVectorSet((corner & 1) ? bounds.boxMax.x : bounds.boxMin.x,
+			(corner & 2) ? bounds.boxMax.y : bounds.boxMin.y, (corner & 4) ? bounds.boxMax.z : bounds.boxMin.z, 1), world);
+		boxMin = XMVectorMin(boxMin, point);
+		boxMax = XMVectorMax(boxMax, point);
+	}
+
+	PickObject object;
+	XMStoreFloat3(&object.boxMin, boxMin);
+	XMStoreFloat3(&object.boxMax, boxMax);
+	object.id = id;
+	object.board = NO_BOARD;
+	objects.push_back(object);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void ScenePicker::Build()
+{
+	nodes.clear();
+	if (objects.empty())
+	{
+		return;
+	}
+
+	// a binary tree with one object or more per leaf has fewer than twice as many nodes as objects
+	nodes.reserve(objects.size() * 2);
+	nodes.resize(1);
+	BuildNode(0, 0, (UINT)objects.size());
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+float ScenePicker::GetDoubledCentre(const PickObject& object, int axis)
+{
+	switch (axis)
+	{
+	case 0:		return object.boxMin.x + object.boxMax.x;
+	case 1:		return object.boxMin.y + object.boxMax.y;
+	default:	return object.boxMin.z + object.boxMax.z;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Split at the middle object along the longest side of the box around the centres
+// ------------------------------------------------------------------------------------
+void ScenePicker::BuildNode(UINT node, UINT first, UINT count)
+{
+	XMFLOAT3 boxMin(FLT_MAX, FLT_MAX, FLT_MAX), boxMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	XMFLOAT3 centreMin(FLT_MAX, FLT_MAX, FLT_MAX), centreMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (UINT i = first; i < first + count; i++)
+	{
+		const PickObject& object = objects[i];
+		boxMin.x = std::min(boxMin.x, object.boxMin.x);
+		boxMin.y = std::min(boxMin.y, object.boxMin.y);
+		boxMin.z = std::min(boxMin.z, object.boxMin.z);
+		boxMax.x = std::max(boxMax.x, object.boxMax.x);
+		boxMax.y = std::max(boxMax.y, object.boxMax.y);
+		boxMax.z = std::max(boxMax.z, object.boxMax.z);
+
+		float x = GetDoubledCentre(object, 0);
+		float y = GetDoubledCentre(object, 1);
+		float z = GetDoubledCentre(object, 2);
+		centreMin.x = std::min(centreMin.x, x);
+		centreMin.y = std::min(centreMin.y, y);
+		centreMin.z = std::min(centreMin.z, z);
+		centreMax.x = std::max(centreMax.x, x);
+		centreMax.y = std::max(centreMax.y, y);
+		centreMax.z = std::max(centreMax.z, z);
+	}
+
+	nodes[node].boxMin = boxMin;
+	nodes[node].boxMax = boxMax;
+
+	if (count <= MAX_LEAF_OBJECTS)
+	{
+		nodes[node].first = first;
+		nodes[node].count = count;
+		return;
+	}
+
+	float sizeX = centreMax.x - centreMin.x;
+	float sizeY = centreMax.y - centreMin.y;
+	float sizeZ = centreMax.z - centreMin.z;
+	int axis = sizeX >= sizeY && sizeX >= sizeZ ? 0 : sizeY >= sizeZ ? 1 : 2;
+
+	UINT half = count / 2;
+	std::nth_element(objects.begin() + first, objects.begin() + first + half, objects.begin() + first + count,
+		[axis](const PickObject& a, const PickObject& b)
+		{
+			return GetDoubledCentre(a, axis) < GetDoubledCentre(b, axis);
+		});
+
+	UINT children = (UINT)nodes.size();
+	nodes[node].first = children;
+	nodes[node].count = 0;
+	nodes.resize(children + 2);
+	BuildNode(children, first, half);
+	BuildNode(children + 1, first + half, count - half);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+ScenePicker::TreeRay ScenePicker::MakeTreeRay(const PickRay& ray)
+{
+	// a zero direction makes an infinite inverse, which the slabs handle
+	TreeRay treeRay;
+	treeRay.ray = ray;
+	treeRay.inverseDirection.x = 1.0f / ray.direction.x;
+	treeRay.inverseDirection.y = 1.0f / ray.direction.y;
+	treeRay.inverseDirection.z = 1.0f / ray.direction.z;
+	return treeRay;
+}
+
+// ------------------------------------------------------------------------------------
+// Slab test, where the ray is between each pair of planes and whether those overlap
+// ------------------------------------------------------------------------------------
+bool ScenePicker::HitBox(const TreeRay& ray, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, float maxDistance, float& distance)
+{
+	float x0 = (boxMin.x - ray.ray.origin.x) * ray.inverseDirection.x;
+	float x1 = (boxMax.x - ray.ray.origin.x) * ray.inverseDirection.x;
+	float y0 = (boxMin.y - ray.ray.origin.y) * ray.inverseDirection.y;
+	float y1 = (boxMax.y - ray.ray.origin.y) * ray.inverseDirection.y;
+	float z0 = (boxMin.z - ray.ray.origin.z) * ray.inverseDirection.z;
+	float z1 = (boxMax.z - ray.ray.origin.z) * ray.inverseDirection.z;
+
+	float enter = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::max(std::min(z0, z1), 0.0f));
+	float leave = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::min(std::max(z0, z1), maxDistance));
+
+	distance = enter;
+	return enter <= leave;
+}
+
+// ------------------------------------------------------------------------------------
+// A piece is hit where the ray enters its box, a board where the ray crosses its squares' tops
+// ------------------------------------------------------------------------------------
+void ScenePicker::HitObject(const TreeRay& ray, const PickObject& object, PickResult& result) const
+{
+	float distance;
+	if (!HitBox(ray, object.boxMin, object.boxMax, result.distance, distance))
+	{
+		return;
+	}
+
+	if (object.board == NO_BOARD)
+	{
+		result.object = PickedPiece;
+		result.id = object.id;
+		result.squareX = result.squareY = -1;
+		result.distance = distance;
+		return;
+	}
+
+	// the ray in the board's parent space, an affine map keeps the distances along it
+	XMMATRIX inverse = XMLoadFloat4x4(&boardInverses[object.board]);
+	XMFLOAT3 origin, direction;
+	XMStoreFloat3(&origin, XMVector3TransformCoord(XMLoadFloat3(&ray.ray.origin), inverse));
+	XMStoreFloat3(&direction, XMVector3TransformNormal(XMLoadFloat3(&ray.ray.direction), inverse));
+
+	if (direction.y == 0)
+	{
+		return;
+	}
+	distance = (boardTop - origin.y) / direction.y;
+	if (distance < 0 || distance >= result.distance)
+	{
+		return;
+	}
+
+	int x, y;
+	if (ChessSet::GetSquareAt(origin.x + direction.x * distance, origin.z + direction.z * distance, x, y))
+	{
+		result.object = PickedSquare;
+		result.id = object.id;
+		result.squareX = x;
+		result.squareY = y;
+		result.distance = distance;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Nearer children first, anything entered beyond the nearest hit so far is skipped
+// ------------------------------------------------------------------------------------
+bool ScenePicker::Pick(const PickRay& ray, PickResult& result) const
+{
+	result.object = PickedNothing;
+	result.distance = FLT_MAX;
+	if (nodes.empty())
+	{
+		return false;
+	}
+
+	TreeRay treeRay = MakeTreeRay(ray);
+	float distance;
+	if (!HitBox(treeRay, nodes[0].boxMin, nodes[0].boxMax, result.distance, distance))
+	{
+		return false;
+	}
+
+	UINT stack[MAX_TREE_DEPTH];
+	int depth = 0;
+	stack[depth++] = 0;
+	while (depth > 0)
+	{
+		const TreeNode& node = nodes[stack[--depth]];
+		if (node.count > 0)
+		{
+			for (UINT i = node.first; i < node.first + node.count; i++)
+			{
+				HitObject(treeRay, objects[i], result);
+			}
+			continue;
+		}
+
+		float nearDistance, farDistance;
+		bool hitNear = HitBox(treeRay, nodes[node.first].boxMin, nodes[node.first].boxMax, result.distance, nearDistance);
+		bool hitFar = HitBox(treeRay, nodes[node.first + 1].boxMin, nodes[node.first + 1].boxMax, result.distance, farDistance);
+		UINT nearChild = node.first;
+		UINT farChild = node.first + 1;
+		if (hitNear && hitFar && farDistance < nearDistance)
+		{
+			std::swap(nearChild, farChild);
+		}
+
+		// the stack pops the near child first
+		if (hitNear && hitFar)
+		{
+			stack[depth++] = farChild;
+			stack[depth++] = nearChild;
+		}
+		else if (hitNear || hitFar)
+		{
+			stack[depth++] = hitNear ? node.first : node.first + 1;
+		}
+	}
+
+	return result.object != PickedNothing;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+bool ScenePicker::PickEveryObject(const PickRay& ray, PickResult& result) const
+{
+	result.object = PickedNothing;
+	result.distance = FLT_MAX;
+
+	TreeRay treeRay = MakeTreeRay(ray);
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		HitObject(treeRay, objects[i], result);
+	}
+	return result.object != PickedNothing;
+}
@@ -0,0 +1,131 @@
+//
+// BGTD 9201
+//	Finds the square or piece under the mouse. The mouse is unprojected into a
+//	ray, pieces are tested by the boxes around them through a small bounding
+//	volume tree, and a board the ray reaches has its square worked out from
+//	where the ray crosses the squares' tops, so squares need no boxes of their own
+//
+
+#ifndef _SCENE_PICKER_H
+#define _SCENE_PICKER_H
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "Platform.h"
+#include "Models.h"
+
+// a ray through the scene, direction is unit length so distances are in world units
+struct PickRay
+{
+	DirectX::XMFLOAT3 origin;
+	DirectX::XMFLOAT3 direction;
+};
+
+enum PickedObject
+{
+	PickedNothing,
+	PickedSquare,
+	PickedPiece
+};
+
+// the nearest thing a ray hit
+struct PickResult
+{
+	PickedObject object;
+	UINT id;				// the id the board or piece was added with
+	int squareX;			// the square, for PickedSquare
+	int squareY;
+	float distance;			// along the ray
+};
+
+class ScenePicker
+{
+public:
+	ScenePicker();
+
+	// the ray from the camera through a point on the screen, in pixels from the top left
+	static PickRay Unproject(float screenX, float screenY, float width, float height,
+		const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection);
+
+	// throw away the last tree's boards and pieces
+	void Begin();
+
+	// a board whose squares are placed under parentWorld, the same parent GetBoardPosition is relative to
+	void AddBoard(UINT id, const DirectX::XMFLOAT4X4& parentWorld);
+
+	// a piece's mesh bounds moved into place by its world matrix
+	void AddPiece(UINT id, const MeshBounds& bounds, const DirectX::XMFLOAT4X4& worldMatrix);
+
+	// build the tree over everything added since Begin, call again whenever anything moves
+	void Build();
+
+	// the nearest square or piece along the ray, false if it missed everything
+	bool Pick(const PickRay& ray, PickResult& result) const;
+
+	// the same answer by testing every board and piece, to check and time the tree against
+	bool PickEveryObject(const PickRay& ray, PickResult& result) const;
+
+	UINT GetObjectCount() const { return (UINT)objects.size(); }
+	UINT GetNodeCount() const { return (UINT)nodes.size(); }
+
+private:
+
+	// objects a leaf can hold before it is split
+	static const UINT MAX_LEAF_OBJECTS = 4;
+
+	// deeper than any tree over 2^32 objects split in half
+	static const int MAX_TREE_DEPTH = 64;
+
+	// marks an object that is a piece rather than a board
+	static const UINT NO_BOARD = 0xFFFFFFFF;
+
+	// a box around a piece or a board's squares
+	struct PickObject
+	{
+		DirectX::XMFLOAT3 boxMin;
+		UINT id;
+		DirectX::XMFLOAT3 boxMax;
+		UINT board;				// into boardInverses, or NO_BOARD for a piece
+	};
+
+	// a leaf holds count objects from first, anything else has its children at first and first + 1
+	struct TreeNode
+	{
+		DirectX::XMFLOAT3 boxMin;
+		UINT first;
+		DirectX::XMFLOAT3 boxMax;
+		UINT count;
+	};
+
+	// a ray ready to be tested against boxes
+	struct TreeRay
+	{
+		PickRay ray;
+		DirectX::XMFLOAT3 inverseDirection;
+	};
+
+	// the middle of an object's box along an axis, twice over as only the order matters
+	static float GetDoubledCentre(const PickObject& object, int axis);
+
+	// split objects first to first + count - 1 under node, down to leaves
+	void BuildNode(UINT node, UINT first, UINT count);
+
+	// the distance the ray enters the box at, false if it misses or enters beyond maxDistance
+	static bool HitBox(const TreeRay& ray, const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax,
+		float maxDistance, float& distance);
+
+	// test one object and keep it in result if it is nearer than result.distance
+	void HitObject(const TreeRay& ray, const PickObject& object, PickResult& result) const;
+
+	static TreeRay MakeTreeRay(const PickRay& ray);
+
+	std::vector<PickObject> objects;
+	std::vector<TreeNode> nodes;
+
+	// the squares are tested in their board's parent space
+	std::vector<DirectX::XMFLOAT4X4> boardInverses;
+	float boardTop;
+};
+
+#endif
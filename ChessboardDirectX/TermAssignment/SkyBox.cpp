@@ -4,6 +4,9 @@
 
 #include "SkyBox.h"
 #include <D3Dcompiler.h>
+#include "ConstantRing.h"
+#include "StateCache.h"
+#include "AffineTransform.h"
 
 // constant buffer structure
 struct ConstantBuffer
@@ -128,43 +131,63 @@ void SkyBox::Initialize(ID3D11Device* pDevice, ID3D11DeviceContext* pDeviceConte
 // ---------------------------------------------------------------------
 // draw the skybox
 // ---------------------------------------------------------------------
-void SkyBox::Draw(ID3D11DeviceContext* pDeviceContext, const Matrix& viewMatrix, const Matrix& projMatrix)
+void SkyBox::Draw(RenderDevice* pRenderDevice, const Matrix& viewMatrix, const Matrix& projMatrix)
 {
-
-	// tell direct x to update the constants inside the shader
-	D3D11_MAPPED_SUBRESOURCE constantResource;
-
-	// gets a pointer to write constants to
-	pDeviceContext->Map(pConstants, 0, D3D11_MAP_WRITE_DISCARD, 0, &constantResource);
-	ConstantBuffer* pValues = (ConstantBuffer*)constantResource.pData;
+	ConstantBuffer values;
 
 	// when setting the matrices we need to transpose them because the expected order is different in shaders than on CPU
-	pValues->worldMatrix = Matrix::CreateScale(scale);
-	pValues->mvpMatrix = (pValues->worldMatrix * viewMatrix * projMatrix).Transpose();
-	Vector3 cam = Vector3::Transform(Vector3::Zero, viewMatrix.Invert());
-	pValues->cameraPos = Vector4(cam.x, cam.y, cam.z, 1);
+	values.worldMatrix = Matrix::CreateScale(scale);
+	values.mvpMatrix = (values.worldMatrix * viewMatrix * projMatrix).Transpose();
+	Vector3 cam = Vector3::Transform(Vector3::Zero, Matrix(AffineTransform(viewMatrix, RigidTransform).Invert()));
+	values.cameraPos = Vector4(cam.x, cam.y, cam.z, 1);
 
-	// commit the changes
-	pDeviceContext->Unmap(pConstants, 0);
+	// tell direct x to update the constants inside the shader, pConstants is only written on devices without offsets
+	ConstantAllocation allocation;
+	ConstantRing::Get().Upload(pRenderDevice, pConstants, &values, sizeof(ConstantBuffer), allocation);
 
 	// set our textures, samplers and constant
-	pDeviceContext->VSSetConstantBuffers(0, 1, &pConstants);
-	pDeviceContext->PSSetSamplers(0, 1, &pSamplerState);
+	ConstantRing::Get().BindVS(pRenderDevice, 0, allocation);
+	StateCache::Get().PSSetSampler(pRenderDevice, 0, pSamplerState);
 	
 	ID3D11ShaderResourceView* pTex = texture.GetResourceView();
-	pDeviceContext->PSSetShaderResources(0, 1, &pTex);
+	StateCache::Get().PSSetShaderResource(pRenderDevice, 0, pTex);
 
 	// set the shaders
-	pDeviceContext->VSSetShader(pVertexShader, NULL, 0);
-	pDeviceContext->PSSetShader(pPixelShader, NULL, 0);
+	StateCache::Get().VSSetShader(pRenderDevice, pVertexShader);
+	StateCache::Get().PSSetShader(pRenderDevice, pPixelShader);
 
 	// set our states - reverse the culling, no depth writes
-	pDeviceContext->RSSetState(states->CullClockwise());
-	pDeviceContext->OMSetDepthStencilState(states->DepthRead(), 0);
+	StateCache::Get().RSSetState(pRenderDevice, states->CullClockwise());
+	StateCache::Get().OMSetDepthStencilState(pRenderDevice, states->DepthRead(), 0);
 
-	skyGeo.Draw(pDeviceContext);
+	skyGeo.Draw(pRenderDevice);
 
 	// restore states
-	pDeviceContext->RSSetState(states->CullCounterClockwise());
-	pDeviceContext->OMSetDepthStencilState(states->DepthDefault(), 0);
+	StateCache::Get().RSSetState(pRenderDevice, states->CullCounterClockwise());
+	StateCache::Get().OMSetDepthStencilState(pRenderDevice, states->DepthDefault(), 0);
+}
+
+// ---------------------------------------------------------------------
+// queue the skybox for this frame
+// ---------------------------------------------------------------------
+void SkyBox::Submit(RenderQueue& queue, const Matrix& viewMatrix, const Matrix& projMatrix)
+{
+	queuedView = viewMatrix;
+	queuedProjection = projMatrix;
+
+	RenderPacket packet;
+	packet.key = queue.MakeKey(SkyPass, pVertexShader, 0, &skyGeo, 0);
+	packet.pOwner = this;
+	packet.pInstanceBuffer = nullptr;
+	packet.startInstance = 0;
+	packet.numInstances = 1;
+	queue.Submit(packet);
+}
+
+// ---------------------------------------------------------------------
+// draw the queued skybox
+// ---------------------------------------------------------------------
+void SkyBox::DrawPacket(RenderDevice* pRenderDevice, const RenderPacket& packet)
+{
+	Draw(pRenderDevice, queuedView, queuedProjection);
 }
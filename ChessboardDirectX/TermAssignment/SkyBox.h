@@ -8,9 +8,10 @@
 #include <d3d11_1.h>
 #include "TextureType.h"
 #include "IndexedPrimitive.h"
+#include "RenderQueue.h"
 #include <CommonStates.h>
 
-class SkyBox
+class SkyBox : public Renderable
 {
 public:
 	SkyBox();
@@ -20,7 +21,13 @@ public:
 	void Initialize(ID3D11Device* pDevice, ID3D11DeviceContext* pDeviceContext, const wchar_t* textureName, int size);
 
 	// draw the skybox
-	void Draw(ID3D11DeviceContext* pDeviceContext, const Matrix& viewMatrix, const Matrix& projMatrix );
+	void Draw(RenderDevice* pRenderDevice, const Matrix& viewMatrix, const Matrix& projMatrix );
+
+	// queue the skybox, it is drawn before anything opaque
+	void Submit(RenderQueue& queue, const Matrix& viewMatrix, const Matrix& projMatrix);
+
+	// called by the queue to draw a submitted packet
+	void DrawPacket(RenderDevice* pRenderDevice, const RenderPacket& packet);
 
 private:
 
@@ -36,6 +43,10 @@ private:
 
 	float scale;
 
+	// camera the skybox was queued with
+	Matrix queuedView;
+	Matrix queuedProjection;
+
 	ID3DBlob *pVertexShaderBlob;
 	ID3DBlob *pPixelShaderBlob;
 
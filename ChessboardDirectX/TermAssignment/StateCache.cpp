@@ -0,0 +1,332 @@
+//
+// BGTD 9201
+//	Drops render device calls that would bind what is already bound
+//
+
+#include "StateCache.h"
+#include <sstream>
+
+// names used when reporting, in StateCallType order
+static const wchar_t* CALL_NAMES[NUM_STATE_CALLS] =
+{
+	L"input layout", L"topology", L"vertex buffers", L"index buffer", L"vertex shader", L"pixel shader",
+	L"constant buffers", L"samplers", L"textures", L"rasterizer", L"depth stencil"
+};
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+StateCache& StateCache::Get()
+{
+	static StateCache cache;
+	return cache;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+StateCache::StateCache()
+{
+	Invalidate();
+	ResetStats();
+}
+
+// ------------------------------------------------------------------------------------
+// Forget everything, nothing is trusted until it has been bound through the cache again
+// ------------------------------------------------------------------------------------
+void StateCache::Invalidate()
+{
+	for (int i = 0; i < NUM_STATE_CALLS; i++)
+	{
+		known[i] = false;
+	}
+	for (int i = 0; i < MAX_VERTEX_STREAMS; i++)
+	{
+		vertexStreamKnown[i] = false;
+	}
+	for (int i = 0; i < MAX_CONSTANT_SLOTS; i++)
+	{
+		vsConstantKnown[i] = false;
+		psConstantKnown[i] = false;
+	}
+	for (int i = 0; i < MAX_SAMPLER_SLOTS; i++)
+	{
+		samplerKnown[i] = false;
+	}
+	for (int i = 0; i < MAX_TEXTURE_SLOTS; i++)
+	{
+		textureKnown[i] = false;
+	}
+
+	pInputLayout = nullptr;
+	topology = UndefinedTopology;
+	pIndexBuffer = nullptr;
+	indexFormat = UnknownIndexFormat;
+	indexOffset = 0;
+	pVertexShader = nullptr;
+	pPixelShader = nullptr;
+	pRasterizerState = nullptr;
+	pDepthStencilState = nullptr;
+	stencilRef = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// Count the call, and say whether it has to reach the driver
+// ------------------------------------------------------------------------------------
+bool StateCache::Filter(StateCallType type, bool changed)
+{
+	if (changed)
+	{
+		issued[type]++;
+	}
+	else
+	{
+		elided[type]++;
+	}
+	return changed;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void StateCache::IASetInputLayout(RenderDevice* pRenderDevice, DeviceInputLayout* pLayout)
+{
+	if (Filter(InputLayoutCall, !known[InputLayoutCall] || pLayout != pInputLayout))
+	{
+		pRenderDevice->IASetInputLayout(pLayout);
+		pInputLayout = pLayout;
+		known[InputLayoutCall] = true;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void StateCache::IASetPrimitiveTopology(RenderDevice* pRenderDevice, DeviceTopology newTopology)
+{
+	if (Filter(TopologyCall, !known[TopologyCall] || newTopology != topology))
+	{
+		pRenderDevice->IASetPrimitiveTopology(newTopology);
+		topology = newTopology;
+		known[TopologyCall] = true;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// The whole range is issued if any stream in it changed
+// ------------------------------------------------------------------------------------
+void StateCache::IASetVertexBuffers(RenderDevice* pRenderDevice, UINT startSlot, UINT numBuffers, DeviceBuffer* const* ppBuffers, const UINT* pStrides, const UINT* pOffsets)
+{
+	bool changed = startSlot + numBuffers > MAX_VERTEX_STREAMS;
+	for (UINT i = 0; i < numBuffers && !changed; i++)
+	{
+		UINT slot = startSlot + i;
+		changed = !vertexStreamKnown[slot] || pVertexBuffers[slot] != ppBuffers[i]
+			|| vertexStrides[slot] != pStrides[i] || vertexOffsets[slot] != pOffsets[i];
+	}
+
+	if (Filter(VertexBufferCall, changed))
+	{
+		pRenderDevice->IASetVertexBuffers(startSlot, numBuffers, ppBuffers, pStrides, pOffsets);
+
+		for (UINT i = 0; i < numBuffers && startSlot + i < MAX_VERTEX_STREAMS; i++)
+		{
+			UINT slot = startSlot + i;
+			pVertexBuffers[slot] = ppBuffers[i];
+			vertexStrides[slot] = pStrides[i];
+			vertexOffsets[slot] = pOffsets[i];
+			vertexStreamKnown[slot] = true;
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void StateCache::IASetIndexBuffer(RenderDevice* pRenderDevice, DeviceBuffer* pBuffer, DeviceIndexFormat format, UINT offset)
+{
+	bool changed = !known[IndexBufferCall] || pBuffer != pIndexBuffer || format != indexFormat || offset != indexOffset;
+	if (Filter(IndexBufferCall, changed))
+	{
+		pRenderDevice->IASetIndexBuffer(pBuffer, format, offset);
+		pIndexBuffer = pBuffer;
+		indexFormat = format;
+		indexOffset = offset;
+		known[IndexBufferCall] = true;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void StateCache::VSSetShader(RenderDevice* pRenderDevice, DeviceVertexShader* pShader)
+{
+	if (Filter(VertexShaderCall, !known[VertexShaderCall] || pShader != pVertexShader))
+	{
+		pRenderDevice->VSSetShader(pShader);
+		pVertexShader = pShader;
+		known[VertexShaderCall] = true;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void StateCache::PSSetShader(RenderDevice* pRenderDevice, DevicePixelShader* pShader)
+{
+	if (Filter(PixelShaderCall, !known[PixelShaderCall] || pShader != pPixelShader))
+	{
+		pRenderDevice->PSSetShader(pShader);
+		pPixelShader = pShader;
+		known[PixelShaderCall] = true;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// A buffer bound at a different offset is a different binding
+// ------------------------------------------------------------------------------------
+bool StateCache::VSChangeConstantBuffer(UINT slot, DeviceBuffer* pBuffer, UINT firstConstant, UINT numConstants)
+{
+	if (slot >= MAX_CONSTANT_SLOTS)
+	{
+		return Filter(ConstantBufferCall, true);
+	}
+
+	ConstantBinding& binding = vsConstants[slot];
+	bool changed = !vsConstantKnown[slot] || binding.pBuffer != pBuffer
+		|| binding.firstConstant != firstConstant || binding.numConstants != numConstants;
+
+	if (Filter(ConstantBufferCall, changed))
+	{
+		binding.pBuffer = pBuffer;
+		binding.firstConstant = firstConstant;
+		binding.numConstants = numConstants;
+		vsConstantKnown[slot] = true;
+	}
+	return changed;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+bool StateCache::PSChangeConstantBuffer(UINT slot, DeviceBuffer* pBuffer, UINT firstConstant, UINT numConstants)
+{
+	if (slot >= MAX_CONSTANT_SLOTS)
+	{
+		return Filter(ConstantBufferCall, true);
+	}
+
+	ConstantBinding& binding = psConstants[slot];
+	bool changed = !psConstantKnown[slot] || binding.pBuffer != pBuffer
+		|| binding.firstConstant != firstConstant || binding.numConstants != numConstants;
+
+	if (Filter(ConstantBufferCall, changed))
+	{
+		binding.pBuffer = pBuffer;
+		binding.firstConstant = firstConstant;
+		binding.numConstants = numConstants;
+		psConstantKnown[slot] = true;
+	}
+	return changed;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void StateCache::PSSetSampler(RenderDevice* pRenderDevice, UINT slot, DeviceSampler* pSampler)
+{
+	bool tracked = slot < MAX_SAMPLER_SLOTS;
+	if (Filter(SamplerCall, !tracked || !samplerKnown[slot] || pSamplers[slot] != pSampler))
+	{
+		pRenderDevice->PSSetSampler(slot, pSampler);
+		if (tracked)
+		{
+			pSamplers[slot] = pSampler;
+			samplerKnown[slot] = true;
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void StateCache::PSSetShaderResource(RenderDevice* pRenderDevice, UINT slot, DeviceTexture* pView)
+{
+	bool tracked = slot < MAX_TEXTURE_SLOTS;
+	if (Filter(TextureCall, !tracked || !textureKnown[slot] || pTextures[slot] != pView))
+	{
+		pRenderDevice->PSSetShaderResource(slot, pView);
+		if (tracked)
+		{
+			pTextures[slot] = pView;
+			textureKnown[slot] = true;
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void StateCache::RSSetState(RenderDevice* pRenderDevice, DeviceRasterizerState* pState)
+{
+	if (Filter(RasterizerCall, !known[RasterizerCall] || pState != pRasterizerState))
+	{
+		pRenderDevice->RSSetState(pState);
+		pRasterizerState = pState;
+		known[RasterizerCall] = true;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void StateCache::OMSetDepthStencilState(RenderDevice* pRenderDevice, DeviceDepthStencilState* pState, UINT newStencilRef)
+{
+	bool changed = !known[DepthStencilCall] || pState != pDepthStencilState || newStencilRef != stencilRef;
+	if (Filter(DepthStencilCall, changed))
+	{
+		pRenderDevice->OMSetDepthStencilState(pState, newStencilRef);
+		pDepthStencilState = pState;
+		stencilRef = newStencilRef;
+		known[DepthStencilCall] = true;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+int StateCache::GetIssued() const
+{
+	int total = 0;
+	for (int i = 0; i < NUM_STATE_CALLS; i++)
+	{
+		total += issued[i];
+	}
+	return total;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+int StateCache::GetElided() const
+{
+	int total = 0;
+	for (int i = 0; i < NUM_STATE_CALLS; i++)
+	{
+		total += elided[i];
+	}
+	return total;
+}
+
+// ------------------------------------------------------------------------------------
+// Clear the counters
+// ------------------------------------------------------------------------------------
+void StateCache::ResetStats()
+{
+	for (int i = 0; i < NUM_STATE_CALLS; i++)
+	{
+		issued[i] = 0;
+		elided[i] = 0;
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Write the counts to the debug output
+// ------------------------------------------------------------------------------------
+void StateCache::ReportStats() const
+{
+	std::wostringstream message;
+	message << L"StateCache: " << GetIssued() << L" calls issued, " << GetElided() << L" elided\n";
+	for (int i = 0; i < NUM_STATE_CALLS; i++)
+	{
+		message << L"  " << CALL_NAMES[i] << L": " << issued[i] << L" issued, " << elided[i] << L" elided\n";
+	}
+
+	OutputDebugString(message.str().c_str());
+}
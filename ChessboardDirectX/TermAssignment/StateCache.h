@@ -0,0 +1,133 @@
+//
+// BGTD 9201
+//	Remembers what is bound to the render device and drops calls that would
+//	bind the same thing again, so the driver only sees real state changes
+//
+
+#ifndef _STATE_CACHE_H
+#define _STATE_CACHE_H
+
+#include "RenderDevice.h"
+
+// the kinds of call the cache filters
+enum StateCallType
+{
+	InputLayoutCall,
+	TopologyCall,
+	VertexBufferCall,
+	IndexBufferCall,
+	VertexShaderCall,
+	PixelShaderCall,
+	ConstantBufferCall,
+	SamplerCall,
+	TextureCall,
+	RasterizerCall,
+	DepthStencilCall,
+	NUM_STATE_CALLS
+};
+
+class StateCache
+{
+public:
+	// the one cache in front of the immediate context
+	static StateCache& Get();
+
+	// forget everything bound, the next call of every kind goes to the driver.
+	// Needed whenever code outside the cache (sprite batches, the frame clear) touches the context
+	void Invalidate();
+
+	// input assembler
+	void IASetInputLayout(RenderDevice* pRenderDevice, DeviceInputLayout* pInputLayout);
+	void IASetPrimitiveTopology(RenderDevice* pRenderDevice, DeviceTopology topology);
+	void IASetVertexBuffers(RenderDevice* pRenderDevice, UINT startSlot, UINT numBuffers, DeviceBuffer* const* ppBuffers, const UINT* pStrides, const UINT* pOffsets);
+	void IASetIndexBuffer(RenderDevice* pRenderDevice, DeviceBuffer* pIndexBuffer, DeviceIndexFormat format, UINT offset);
+
+	// shaders
+	void VSSetShader(RenderDevice* pRenderDevice, DeviceVertexShader* pShader);
+	void PSSetShader(RenderDevice* pRenderDevice, DevicePixelShader* pShader);
+
+	// constant buffers are issued by the constant ring, which knows whether offsets are
+	// available. These return true when the binding changed and the call must be made
+	bool VSChangeConstantBuffer(UINT slot, DeviceBuffer* pBuffer, UINT firstConstant, UINT numConstants);
+	bool PSChangeConstantBuffer(UINT slot, DeviceBuffer* pBuffer, UINT firstConstant, UINT numConstants);
+
+	// pixel shader resources, one slot at a time
+	void PSSetSampler(RenderDevice* pRenderDevice, UINT slot, DeviceSampler* pSampler);
+	void PSSetShaderResource(RenderDevice* pRenderDevice, UINT slot, DeviceTexture* pView);
+
+	// fixed function state
+	void RSSetState(RenderDevice* pRenderDevice, DeviceRasterizerState* pState);
+	void OMSetDepthStencilState(RenderDevice* pRenderDevice, DeviceDepthStencilState* pState, UINT stencilRef);
+
+	// how many calls reached the driver and how many were dropped since the last reset
+	int GetIssued() const;
+	int GetElided() const;
+	int GetIssued(StateCallType type) const { return issued[type]; }
+	int GetElided(StateCallType type) const { return elided[type]; }
+	void ResetStats();
+
+	// writes the counts to the debug output
+	void ReportStats() const;
+
+private:
+	StateCache();
+
+	// cache is shared, never copied
+	StateCache(const StateCache&);
+	StateCache& operator=(const StateCache&);
+
+	// counts the call and says whether it has to be made
+	bool Filter(StateCallType type, bool changed);
+
+	// slots past these are passed straight through
+	static const int MAX_VERTEX_STREAMS = 2;
+	static const int MAX_CONSTANT_SLOTS = 4;
+	static const int MAX_TEXTURE_SLOTS = 4;
+	static const int MAX_SAMPLER_SLOTS = 1;
+
+	// a constant buffer binding, offsets are 0 when bound without them
+	struct ConstantBinding
+	{
+		DeviceBuffer* pBuffer;
+		UINT firstConstant;
+		UINT numConstants;
+	};
+
+	// false until something has been bound through the cache since the last Invalidate
+	bool known[NUM_STATE_CALLS];
+
+	DeviceInputLayout* pInputLayout;
+	DeviceTopology topology;
+
+	DeviceBuffer* pVertexBuffers[MAX_VERTEX_STREAMS];
+	UINT vertexStrides[MAX_VERTEX_STREAMS];
+	UINT vertexOffsets[MAX_VERTEX_STREAMS];
+	bool vertexStreamKnown[MAX_VERTEX_STREAMS];
+
+	DeviceBuffer* pIndexBuffer;
+	DeviceIndexFormat indexFormat;
+	UINT indexOffset;
+
+	DeviceVertexShader* pVertexShader;
+	DevicePixelShader* pPixelShader;
+
+	ConstantBinding vsConstants[MAX_CONSTANT_SLOTS];
+	ConstantBinding psConstants[MAX_CONSTANT_SLOTS];
+	bool vsConstantKnown[MAX_CONSTANT_SLOTS];
+	bool psConstantKnown[MAX_CONSTANT_SLOTS];
+
+	DeviceSampler* pSamplers[MAX_SAMPLER_SLOTS];
+	bool samplerKnown[MAX_SAMPLER_SLOTS];
+
+	DeviceTexture* pTextures[MAX_TEXTURE_SLOTS];
+	bool textureKnown[MAX_TEXTURE_SLOTS];
+
+	DeviceRasterizerState* pRasterizerState;
+	DeviceDepthStencilState* pDepthStencilState;
+	UINT stencilRef;
+
+	int issued[NUM_STATE_CALLS];
+	int elided[NUM_STATE_CALLS];
+};
+
+#endif
@@ -0,0 +1,799 @@
+//
+// BGTD 9201
+//	Every transform of the frame updated in one pass, several at a time
+//
+
+#include "TransformStore.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TRANSFORM_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TRANSFORM_AVX2_TARGET
+#else
+#define TRANSFORM_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#else
+#define TRANSFORM_X86 0
+#endif
+
+// vdivq_f32 is only on 64 bit ARM
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define TRANSFORM_NEON 1
+#include <arm_neon.h>
+#else
+#define TRANSFORM_NEON 0
+#endif
+
+using namespace DirectX;
+
+// transforms handed to a thread at once, a multiple of every kernel's width
+static const UINT RUN_CHUNK = 512;
+
+// floats from one transform's matrices to the next in each output array
+static const size_t WORLD_STRIDE = sizeof(XMFLOAT4X4) / sizeof(float);
+static const size_t MATRICES_STRIDE = sizeof(TransformMatrices) / sizeof(float);
+
+// where a run reads and writes, gathered once so the kernels don't touch the store
+struct RunData
+{
+	const float* local[16];
+	const unsigned char* localKinds;
+	unsigned char* worldKinds;
+	const int* parents;				// nullptr for roots
+	float* pWorlds;					// parents are read back from here, they were written a level earlier
+	float* pMatrices;				// nullptr when only the world matrices are wanted
+	const float* viewProjection;
+};
+
+// ------------------------------------------------------------------------------------
+// out = a * b, the sums in the same order as the wide kernels so every kernel agrees
+// ------------------------------------------------------------------------------------
+static void Multiply(const float* a, const float* b, float* out)
+{
+	for (int r = 0; r < 4; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			out[r * 4 + c] = ((a[r * 4] * b[c] + a[r * 4 + 1] * b[4 + c]) + a[r * 4 + 2] * b[8 + c]) + a[r * 4 + 3] * b[12 + c];
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// The kind of every world matrix from first on, true if they are all the same kind
+// ------------------------------------------------------------------------------------
+static bool UpdateKinds(const RunData& data, UINT first, UINT num, TransformKind& kind)
+{
+	bool same = true;
+	for (UINT i = first; i < first + num; i++)
+	{
+		TransformKind worldKind = (TransformKind)data.localKinds[i];
+		if (data.parents != nullptr)
+		{
+			worldKind = AffineTransform::CombineKinds(worldKind, (TransformKind)data.worldKinds[data.parents[i]]);
+		}
+		data.worldKinds[i] = (unsigned char)worldKind;
+
+		if (i == first)
+		{
+			kind = worldKind;
+		}
+		else if (worldKind != kind)
+		{
+			same = false;
+		}
+	}
+	return same;
+}
+
+// ------------------------------------------------------------------------------------
+// The inverse of the upper 3x3, which is all the normals are multiplied by. Scaled
+// rotations are transposed with each row over its length squared, as AffineTransform
+// ------------------------------------------------------------------------------------
+static void InvertRotation(const float* m, TransformKind kind, float* out)
+{
+	out[3] = out[7] = out[11] = 0;
+	out[12] = out[13] = out[14] = 0;
+	out[15] = 1;
+
+	if (kind == RigidTransform)
+	{
+		for (int r = 0; r < 3; r++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				out[c * 4 + r] = m[r * 4 + c];
+			}
+		}
+		return;
+	}
+
+	if (kind != GeneralTransform)
+	{
+		float scale[3];
+		for (int r = 0; r < 3; r++)
+		{
+			if (r == 0 || kind == AxisScaleTransform)
+			{
+				scale[r] = 1.0f / ((m[r * 4] * m[r * 4] + m[r * 4 + 1] * m[r * 4 + 1]) + m[r * 4 + 2] * m[r * 4 + 2]);
+			}
+			else
+			{
+				scale[r] = scale[0];
+			}
+		}
+		for (int r = 0; r < 3; r++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				out[c * 4 + r] = m[r * 4 + c] * scale[r];
+			}
+		}
+		return;
+	}
+
+	float c00 = m[5] * m[10] - m[6] * m[9];
+	float c01 = m[6] * m[8] - m[4] * m[10];
+	float c02 = m[4] * m[9] - m[5] * m[8];
+	float det = (m[0] * c00 + m[1] * c01) + m[2] * c02;
+	float scale = 1.0f / det;
+
+	out[0] = c00 * scale;
+	out[1] = (m[2] * m[9] - m[1] * m[10]) * scale;
+	out[2] = (m[1] * m[6] - m[2] * m[5]) * scale;
+	out[4] = c01 * scale;
+	out[5] = (m[0] * m[10] - m[2] * m[8]) * scale;
+	out[6] = (m[2] * m[4] - m[0] * m[6]) * scale;
+	out[8] = c02 * scale;
+	out[9] = (m[1] * m[8] - m[0] * m[9]) * scale;
+	out[10] = (m[0] * m[5] - m[1] * m[4]) * scale;
+}
+
+// ------------------------------------------------------------------------------------
+// One transform at a time, for the CPUs without a wide kernel and the end of each run
+// ------------------------------------------------------------------------------------
+static void UpdateScalar(const RunData& data, UINT index)
+{
+	float w[16];
+	if (data.parents != nullptr)
+	{
+		float l[16];
+		float p[16];
+		const float* pParent = data.pWorlds + data.parents[index] * WORLD_STRIDE;
+		for (int e = 0; e < 16; e++)
+		{
+			l[e] = data.local[e][index];
+			p[e] = pParent[e];
+		}
+		Multiply(l, p, w);
+	}
+	else
+	{
+		for (int e = 0; e < 16; e++)
+		{
+			w[e] = data.local[e][index];
+		}
+	}
+
+	memcpy(data.pWorlds + index * WORLD_STRIDE, w, sizeof(w));
+
+	TransformKind kind = GeneralTransform;
+	UpdateKinds(data, index, 1, kind);
+
+	if (data.pMatrices == nullptr)
+	{
+		return;
+	}
+
+	float wvp[16];
+	Multiply(w, data.viewProjection, wvp);
+
+	float* pOut = data.pMatrices + index * MATRICES_STRIDE;
+	for (int r = 0; r < 4; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			pOut[r * 4 + c] = w[c * 4 + r];
+			pOut[16 + r * 4 + c] = wvp[c * 4 + r];
+		}
+	}
+	InvertRotation(w, kind, pOut + 32);
+}
+
+#if TRANSFORM_X86 || TRANSFORM_NEON
+
+// the four wide operations, SSE2 or NEON
+#if TRANSFORM_X86
+typedef __m128 Wide4;
+
+static inline Wide4 Load4(const float* p) { return _mm_loadu_ps(p); }
+static inline void Store4(float* p, Wide4 v) { _mm_storeu_ps(p, v); }
+static inline Wide4 Splat4(float v) { return _mm_set1_ps(v); }
+static inline Wide4 Add4(Wide4 a, Wide4 b) { return _mm_add_ps(a, b); }
+static inline Wide4 Sub4(Wide4 a, Wide4 b) { return _mm_sub_ps(a, b); }
+static inline Wide4 Mul4(Wide4 a, Wide4 b) { return _mm_mul_ps(a, b); }
+static inline Wide4 Div4(Wide4 a, Wide4 b) { return _mm_div_ps(a, b); }
+static inline Wide4 Gather4(const float* p, const int* indices)
+{
+	return _mm_setr_ps(p[indices[0] * WORLD_STRIDE], p[indices[1] * WORLD_STRIDE], p[indices[2] * WORLD_STRIDE], p[indices[3] * WORLD_STRIDE]);
+}
+static inline void Transpose4(Wide4& a, Wide4& b, Wide4& c, Wide4& d) { _MM_TRANSPOSE4_PS(a, b, c, d); }
+#else
+typedef float32x4_t Wide4;
+
+static inline Wide4 Load4(const float* p) { return vld1q_f32(p); }
+static inline void Store4(float* p, Wide4 v) { vst1q_f32(p, v); }
+static inline Wide4 Splat4(float v) { return vdupq_n_f32(v); }
+static inline Wide4 Add4(Wide4 a, Wide4 b) { return vaddq_f32(a, b); }
+static inline Wide4 Sub4(Wide4 a, Wide4 b) { return vsubq_f32(a, b); }
+static inline Wide4 Mul4(Wide4 a, Wide4 b) { return vmulq_f32(a, b); }
+static inline Wide4 Div4(Wide4 a, Wide4 b) { return vdivq_f32(a, b); }
+static inline Wide4 Gather4(const float* p, const int* indices)
+{
+	float values[4] = { p[indices[0] * WORLD_STRIDE], p[indices[1] * WORLD_STRIDE], p[indices[2] * WORLD_STRIDE], p[indices[3] * WORLD_STRIDE] };
+	return vld1q_f32(values);
+}
+static inline void Transpose4(Wide4& a, Wide4& b, Wide4& c, Wide4& d)
+{
+	float32x4x2_t ab = vtrnq_f32(a, b);
+	float32x4x2_t cd = vtrnq_f32(c, d);
+	a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+	b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+	c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+	d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+#endif
+
+// ------------------------------------------------------------------------------------
+// Write four transforms' matrices, held one element per register, as whole matrices
+// ------------------------------------------------------------------------------------
+static void StoreMatrices4(const Wide4* e, float* pOut, size_t stride)
+{
+	for (int quarter = 0; quarter < 4; quarter++)
+	{
+		Wide4 a = e[quarter * 4];
+		Wide4 b = e[quarter * 4 + 1];
+		Wide4 c = e[quarter * 4 + 2];
+		Wide4 d = e[quarter * 4 + 3];
+		Transpose4(a, b, c, d);
+
+		Store4(pOut + quarter * 4, a);
+		Store4(pOut + stride + quarter * 4, b);
+		Store4(pOut + stride * 2 + quarter * 4, c);
+		Store4(pOut + stride * 3 + quarter * 4, d);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// out = a * b for four transforms at once
+// ------------------------------------------------------------------------------------
+static void Multiply4(const Wide4* a, const Wide4* b, Wide4* out)
+{
+	for (int r = 0; r < 4; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			out[r * 4 + c] = Add4(Add4(Add4(Mul4(a[r * 4], b[c]), Mul4(a[r * 4 + 1], b[4 + c])),
+				Mul4(a[r * 4 + 2], b[8 + c])), Mul4(a[r * 4 + 3], b[12 + c]));
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Four transforms from first on
+// ------------------------------------------------------------------------------------
+static void UpdateWide4(const RunData& data, UINT first)
+{
+	Wide4 w[16];
+	if (data.parents != nullptr)
+	{
+		Wide4 l[16];
+		Wide4 p[16];
+		for (int e = 0; e < 16; e++)
+		{
+			l[e] = Load4(data.local[e] + first);
+			p[e] = Gather4(data.pWorlds + e, data.parents + first);
+		}
+		Multiply4(l, p, w);
+	}
+	else
+	{
+		for (int e = 0; e < 16; e++)
+		{
+			w[e] = Load4(data.local[e] + first);
+		}
+	}
+
+	StoreMatrices4(w, data.pWorlds + first * WORLD_STRIDE, WORLD_STRIDE);
+
+	TransformKind kind = GeneralTransform;
+	bool sameKind = UpdateKinds(data, first, 4, kind);
+
+	if (data.pMatrices == nullptr)
+	{
+		return;
+	}
+
+	// the camera is the same for every transform
+	Wide4 vp[16];
+	for (int e = 0; e < 16; e++)
+	{
+		vp[e] = Splat4(data.viewProjection[e]);
+	}
+	Wide4 wvp[16];
+	Multiply4(w, vp, wvp);
+
+	// the shader wants both transposed
+	Wide4 transposed[16];
+	float* pOut = data.pMatrices + first * MATRICES_STRIDE;
+	for (int e = 0; e < 16; e++)
+	{
+		transposed[e] = w[(e % 4) * 4 + e / 4];
+	}
+	StoreMatrices4(transposed, pOut, MATRICES_STRIDE);
+	for (int e = 0; e < 16; e++)
+	{
+		transposed[e] = wvp[(e % 4) * 4 + e / 4];
+	}
+	StoreMatrices4(transposed, pOut + 16, MATRICES_STRIDE);
+
+	// inverse of the upper 3x3 as InvertRotation, one at a time when the kinds are mixed
+	if (!sameKind)
+	{
+		for (UINT i = 0; i < 4; i++)
+		{
+			InvertRotation(data.pWorlds + (first + i) * WORLD_STRIDE, (TransformKind)data.worldKinds[first + i], pOut + i * MATRICES_STRIDE + 32);
+		}
+		return;
+	}
+
+	Wide4 zero = Splat4(0);
+	Wide4 inverse[16];
+	inverse[3] = inverse[7] = inverse[11] = zero;
+	inverse[12] = inverse[13] = inverse[14] = zero;
+	inverse[15] = Splat4(1);
+
+	if (kind != GeneralTransform)
+	{
+		Wide4 scale[3];
+		for (int r = 0; r < 3; r++)
+		{
+			if (kind == RigidTransform)
+			{
+				scale[r] = Splat4(1);
+			}
+			else if (r == 0 || kind == AxisScaleTransform)
+			{
+				scale[r] = Div4(Splat4(1), Add4(Add4(Mul4(w[r * 4], w[r * 4]), Mul4(w[r * 4 + 1], w[r * 4 + 1])), Mul4(w[r * 4 + 2], w[r * 4 + 2])));
+			}
+			else
+			{
+				scale[r] = scale[0];
+			}
+		}
+		for (int r = 0; r < 3; r++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				inverse[c * 4 + r] = kind == RigidTransform ? w[r * 4 + c] : Mul4(w[r * 4 + c], scale[r]);
+			}
+		}
+		StoreMatrices4(inverse, pOut + 32, MATRICES_STRIDE);
+		return;
+	}
+
+	Wide4 c00 = Sub4(Mul4(w[5], w[10]), Mul4(w[6], w[9]));
+	Wide4 c01 = Sub4(Mul4(w[6], w[8]), Mul4(w[4], w[10]));
+	Wide4 c02 = Sub4(Mul4(w[4], w[9]), Mul4(w[5], w[8]));
+	Wide4 det = Add4(Add4(Mul4(w[0], c00), Mul4(w[1], c01)), Mul4(w[2], c02));
+	Wide4 scale = Div4(Splat4(1), det);
+
+	inverse[0] = Mul4(c00, scale);
+	inverse[1] = Mul4(Sub4(Mul4(w[2], w[9]), Mul4(w[1], w[10])), scale);
+	inverse[2] = Mul4(Sub4(Mul4(w[1], w[6]), Mul4(w[2], w[5])), scale);
+	inverse[4] = Mul4(c01, scale);
+	inverse[5] = Mul4(Sub4(Mul4(w[0], w[10]), Mul4(w[2], w[8])), scale);
+	inverse[6] = Mul4(Sub4(Mul4(w[2], w[4]), Mul4(w[0], w[6])), scale);
+	inverse[8] = Mul4(c02, scale);
+	inverse[9] = Mul4(Sub4(Mul4(w[1], w[8]), Mul4(w[0], w[9])), scale);
+	inverse[10] = Mul4(Sub4(Mul4(w[0], w[5]), Mul4(w[1], w[4])), scale);
+	StoreMatrices4(inverse, pOut + 32, MATRICES_STRIDE);
+}
+
+#endif
+
+#if TRANSFORM_X86
+
+// ------------------------------------------------------------------------------------
+// Write eight transforms' matrices, held one element per register, as whole matrices
+// ------------------------------------------------------------------------------------
+TRANSFORM_AVX2_TARGET static void StoreMatrices8(const __m256* e, float* pOut, size_t stride)
+{
+	for (int half = 0; half < 2; half++)
+	{
+		const __m256* r = e + half * 8;
+
+		__m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+		__m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+		__m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+		__m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+		__m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+		__m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+		__m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+		__m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+
+		__m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+		__m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+		__m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+		__m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+		float* pHalf = pOut + half * 8;
+		_mm256_storeu_ps(pHalf, _mm256_permute2f128_ps(s0, s4, 0x20));
+		_mm256_storeu_ps(pHalf + stride, _mm256_permute2f128_ps(s1, s5, 0x20));
+		_mm256_storeu_ps(pHalf + stride * 2, _mm256_permute2f128_ps(s2, s6, 0x20));
+		_mm256_storeu_ps(pHalf + stride * 3, _mm256_permute2f128_ps(s3, s7, 0x20));
+		_mm256_storeu_ps(pHalf + stride * 4, _mm256_permute2f128_ps(s0, s4, 0x31));
+		_mm256_storeu_ps(pHalf + stride * 5, _mm256_permute2f128_ps(s1, s5, 0x31));
+		_mm256_storeu_ps(pHalf + stride * 6, _mm256_permute2f128_ps(s2, s6, 0x31));
+		_mm256_storeu_ps(pHalf + stride * 7, _mm256_permute2f128_ps(s3, s7, 0x31));
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// out = a * b for eight transforms at once
+// ------------------------------------------------------------------------------------
+TRANSFORM_AVX2_TARGET static void Multiply8(const __m256* a, const __m256* b, __m256* out)
+{
+	for (int r = 0; r < 4; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			out[r * 4 + c] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[r * 4], b[c]), _mm256_mul_ps(a[r * 4 + 1], b[4 + c])),
+				_mm256_mul_ps(a[r * 4 + 2], b[8 + c])), _mm256_mul_ps(a[r * 4 + 3], b[12 + c]));
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Eight transforms from first on, the parents are gathered in one instruction per element
+// ------------------------------------------------------------------------------------
+TRANSFORM_AVX2_TARGET static void UpdateAVX2(const RunData& data, UINT first)
+{
+	__m256 w[16];
+	if (data.parents != nullptr)
+	{
+		// element e of a parent's world matrix is at parent * 16 + e
+		__m256i parents = _mm256_slli_epi32(_mm256_loadu_si256((const __m256i*)(data.parents + first)), 4);
+		__m256 l[16];
+		__m256 p[16];
+		for (int e = 0; e < 16; e++)
+		{
+			l[e] = _mm256_loadu_ps(data.local[e] + first);
+			p[e] = _mm256_i32gather_ps(data.pWorlds + e, parents, 4);
+		}
+		Multiply8(l, p, w);
+	}
+	else
+	{
+		for (int e = 0; e < 16; e++)
+		{
+			w[e] = _mm256_loadu_ps(data.local[e] + first);
+		}
+	}
+
+	StoreMatrices8(w, data.pWorlds + first * WORLD_STRIDE, WORLD_STRIDE);
+
+	TransformKind kind = GeneralTransform;
+	bool sameKind = UpdateKinds(data, first, 8, kind);
+
+	if (data.pMatrices == nullptr)
+	{
+		return;
+	}
+
+	__m256 vp[16];
+	for (int e = 0; e < 16; e++)
+	{
+		vp[e] = _mm256_set1_ps(data.viewProjection[e]);
+	}
+	__m256 wvp[16];
+	Multiply8(w, vp, wvp);
+
+	__m256 transposed[16];
+	float* pOut = data.pMatrices + first * MATRICES_STRIDE;
+	for (int e = 0; e < 16; e++)
+	{
+		transposed[e] = w[(e % 4) * 4 + e / 4];
+	}
+	StoreMatrices8(transposed, pOut, MATRICES_STRIDE);
+	for (int e = 0; e < 16; e++)
+	{
+		transposed[e] = wvp[(e % 4) * 4 + e / 4];
+	}
+	StoreMatrices8(transposed, pOut + 16, MATRICES_STRIDE);
+
+	if (!sameKind)
+	{
+		for (UINT i = 0; i < 8; i++)
+		{
+			InvertRotation(data.pWorlds + (first + i) * WORLD_STRIDE, (TransformKind)data.worldKinds[first + i], pOut + i * MATRICES_STRIDE + 32);
+		}
+		return;
+	}
+
+	__m256 zero = _mm256_setzero_ps();
+	__m256 inverse[16];
+	inverse[3] = inverse[7] = inverse[11] = zero;
+	inverse[12] = inverse[13] = inverse[14] = zero;
+	inverse[15] = _mm256_set1_ps(1);
+
+	if (kind != GeneralTransform)
+	{
+		__m256 scale[3];
+		for (int r = 0; r < 3; r++)
+		{
+			if (kind == RigidTransform)
+			{
+				scale[r] = _mm256_set1_ps(1);
+			}
+			else if (r == 0 || kind == AxisScaleTransform)
+			{
+				__m256 length = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(w[r * 4], w[r * 4]), _mm256_mul_ps(w[r * 4 + 1], w[r * 4 + 1])),
+					_mm256_mul_ps(w[r * 4 + 2], w[r * 4 + 2]));
+				scale[r] = _mm256_div_ps(_mm256_set1_ps(1), length);
+			}
+			else
+			{
+				scale[r] = scale[0];
+			}
+		}
+		for (int r = 0; r < 3; r++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				inverse[c * 4 + r] = kind == RigidTransform ? w[r * 4 + c] : _mm256_mul_ps(w[r * 4 + c], scale[r]);
+			}
+		}
+		StoreMatrices8(inverse, pOut + 32, MATRICES_STRIDE);
+		return;
+	}
+
+	__m256 c00 = _mm256_sub_ps(_mm256_mul_ps(w[5], w[10]), _mm256_mul_ps(w[6], w[9]));
+	__m256 c01 = _mm256_sub_ps(_mm256_mul_ps(w[6], w[8]), _mm256_mul_ps(w[4], w[10]));
+	__m256 c02 = _mm256_sub_ps(_mm256_mul_ps(w[4], w[9]), _mm256_mul_ps(w[5], w[8]));
+	__m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(w[0], c00), _mm256_mul_ps(w[1], c01)), _mm256_mul_ps(w[2], c02));
+	__m256 scale = _mm256_div_ps(_mm256_set1_ps(1), det);
+
+	inverse[0] = _mm256_mul_ps(c00, scale);
+	inverse[1] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(w[2], w[9]), _mm256_mul_ps(w[1], w[10])), scale);
+	inverse[2] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(w[1], w[6]), _mm256_mul_ps(w[2], w[5])), scale);
+	inverse[4] = _mm256_mul_ps(c01, scale);
+	inverse[5] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(w[0], w[10]), _mm256_mul_ps(w[2], w[8])), scale);
+	inverse[6] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(w[2], w[4]), _mm256_mul_ps(w[0], w[6])), scale);
+	inverse[8] = _mm256_mul_ps(c02, scale);
+	inverse[9] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(w[1], w[8]), _mm256_mul_ps(w[0], w[9])), scale);
+	inverse[10] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(w[0], w[5]), _mm256_mul_ps(w[1], w[4])), scale);
+	StoreMatrices8(inverse, pOut + 32, MATRICES_STRIDE);
+}
+
+#endif
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+TransformStore::TransformStore(int numThreads) : jobPool(numThreads)
+{
+	count = 0;
+	memset(viewProjection, 0, sizeof(viewProjection));
+	kernel = GetBestKernel();
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void TransformStore::Clear()
+{
+	for (int e = 0; e < 16; e++)
+	{
+		local[e].clear();
+	}
+	localKinds.clear();
+	worldKinds.clear();
+	parents.clear();
+	levels.clear();
+	levelStarts.clear();
+	worlds.clear();
+	matrices.clear();
+	count = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// Transforms sit in level order, so a level never reads a world matrix it is writing
+// ------------------------------------------------------------------------------------
+UINT TransformStore::Add(const XMFLOAT4X4& inLocal, UINT parent, TransformKind kind)
+{
+	int level = 0;
+	if (parent != NO_PARENT)
+	{
+		if (parent >= count)
+		{
+			OutputDebugString(L"TransformStore: a parent has to be added before its children\n");
+			assert(0);
+			return NO_TRANSFORM;
+		}
+		level = levels[parent] + 1;
+	}
+
+	// a transform in an earlier level than the last would land among transforms whose
+	// parents it doesn't have, so it isn't added at all
+	int lastLevel = (int)levelStarts.size() - 1;
+	if (level < lastLevel)
+	{
+		OutputDebugString(L"TransformStore: transforms have to be added a level at a time\n");
+		assert(0);
+		return NO_TRANSFORM;
+	}
+	if (level > lastLevel)
+	{
+		levelStarts.push_back(count);
+	}
+
+	const float* pElements = &inLocal._11;
+	for (int e = 0; e < 16; e++)
+	{
+		local[e].push_back(pElements[e]);
+	}
+	localKinds.push_back((unsigned char)kind);
+	worldKinds.push_back((unsigned char)kind);
+	parents.push_back(parent == NO_PARENT ? -1 : (int)parent);
+	levels.push_back(level);
+
+	worlds.push_back(inLocal);
+	matrices.push_back(TransformMatrices{});
+	return count++;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void TransformStore::SetLocal(UINT index, const XMFLOAT4X4& inLocal, TransformKind kind)
+{
+	const float* pElements = &inLocal._11;
+	for (int e = 0; e < 16; e++)
+	{
+		local[e][index] = pElements[e];
+	}
+	localKinds[index] = (unsigned char)kind;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void TransformStore::Update()
+{
+	Update((const float*)nullptr);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void TransformStore::Update(const XMFLOAT4X4& inViewProjection)
+{
+	Update(&inViewProjection._11);
+}
+
+// ------------------------------------------------------------------------------------
+// A level at a time, each level's children wait for every parent above them
+// ------------------------------------------------------------------------------------
+void TransformStore::Update(const float* pViewProjection)
+{
+	if (pViewProjection != nullptr)
+	{
+		memcpy(viewProjection, pViewProjection, sizeof(viewProjection));
+	}
+
+	for (size_t i = 0; i < levelStarts.size(); i++)
+	{
+		UINT end = i + 1 < levelStarts.size() ? levelStarts[i + 1] : count;
+		UpdateRun(levelStarts[i], end - levelStarts[i], pViewProjection != nullptr);
+	}
+}
+
+// ------------------------------------------------------------------------------------
+// Split a level into chunks for the threads, each chunk runs the widest kernel it can
+// and finishes off with narrower ones
+// ------------------------------------------------------------------------------------
+void TransformStore::UpdateRun(UINT first, UINT num, bool shaderMatrices)
+{
+	RunData data;
+	for (int e = 0; e < 16; e++)
+	{
+		data.local[e] = local[e].data();
+	}
+	data.localKinds = localKinds.data();
+	data.worldKinds = worldKinds.data();
+	data.parents = levels[first] > 0 ? parents.data() : nullptr;
+	data.pWorlds = &worlds[0]._11;
+	data.pMatrices = shaderMatrices ? &matrices[0].worldMatrix._11 : nullptr;
+	data.viewProjection = viewProjection;
+
+	TransformKernel runKernel = kernel;
+	size_t jobs = (num + RUN_CHUNK - 1) / RUN_CHUNK;
+
+	jobPool.ParallelFor(jobs, [&](size_t job)
+	{
+		UINT index = first + (UINT)job * RUN_CHUNK;
+		UINT end = index + RUN_CHUNK < first + num ? index + RUN_CHUNK : first + num;
+
+#if TRANSFORM_X86
+		if (runKernel == AVX2TransformKernel)
+		{
+			for (; index + 8 <= end; index += 8)
+			{
+				UpdateAVX2(data, index);
+			}
+		}
+#endif
+#if TRANSFORM_X86 || TRANSFORM_NEON
+		if (runKernel != ScalarTransformKernel)
+		{
+			for (; index + 4 <= end; index += 4)
+			{
+				UpdateWide4(data, index);
+			}
+		}
+#endif
+		for (; index < end; index++)
+		{
+			UpdateScalar(data, index);
+		}
+	});
+}
+
+// ------------------------------------------------------------------------------------
+// The widest kernel the CPU and OS support
+// ------------------------------------------------------------------------------------
+TransformKernel TransformStore::GetBestKernel()
+{
+#if TRANSFORM_X86
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] >= 7)
+	{
+		__cpuid(info, 1);
+		bool osSavesAVX = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0;
+
+		__cpuidex(info, 7, 0);
+		bool hasAVX2 = (info[1] & (1 << 5)) != 0;
+
+		if (osSavesAVX && hasAVX2 && (_xgetbv(0) & 6) == 6)
+		{
+			return AVX2TransformKernel;
+		}
+	}
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return AVX2TransformKernel;
+	}
+#endif
+	return Wide4TransformKernel;
+#elif TRANSFORM_NEON
+	return Wide4TransformKernel;
+#else
+	return ScalarTransformKernel;
+#endif
+}
+
+// ------------------------------------------------------------------------------------
+// Pick a kernel, anything the CPU can't run falls back to the best one it can
+// ------------------------------------------------------------------------------------
+void TransformStore::SetKernel(TransformKernel inKernel)
+{
+	TransformKernel best = GetBestKernel();
+	kernel = inKernel < best ? inKernel : best;
+}
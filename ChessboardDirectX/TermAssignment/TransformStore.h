@@ -0,0 +1,106 @@
+//
+// BGTD 9201
+//	Every transform of the frame kept as separate arrays of matrix elements,
+//	each with the index of its parent. One pass a frame works out the world,
+//	world * view * projection and normal matrices of all of them, eight or
+//	four at a time with AVX2, SSE2 or NEON and spread over worker threads,
+//	so draws only copy matrices instead of multiplying and inverting them
+//
+
+#ifndef _TRANSFORM_STORE_H
+#define _TRANSFORM_STORE_H
+
+#include <DirectXMath.h>
+#include <vector>
+#include <stdint.h>
+
+#include "Platform.h"
+#include "AffineTransform.h"
+#include "JobPool.h"
+
+// the loop used to update a run of transforms
+enum TransformKernel
+{
+	ScalarTransformKernel,
+	Wide4TransformKernel,		// SSE2 on x86, NEON on ARM
+	AVX2TransformKernel
+};
+
+// what a draw uploads, in the order and layout of the lit shader's per-object constants
+struct TransformMatrices
+{
+	DirectX::XMFLOAT4X4 worldMatrix;				// transposed for the shader
+	DirectX::XMFLOAT4X4 worldViewProjectionMatrix;	// transposed for the shader
+	DirectX::XMFLOAT4X4 worldMatrixIT;				// the inverse, the shader reads it transposed
+};
+
+class TransformStore
+{
+public:
+	// 0 threads uses every core, 1 keeps the work on the calling thread
+	TransformStore(int numThreads = 1);
+
+	// the parent of a transform that has none, and what Add returns when it can't add one
+	static const UINT NO_PARENT = 0xFFFFFFFF;
+	static const UINT NO_TRANSFORM = 0xFFFFFFFF;
+
+	// throw every transform away
+	void Clear();
+
+	// add a transform, its world matrix is local * the parent's world matrix. Parents are
+	// added before their children and transforms are added a level at a time: every root,
+	// then everything whose parent is a root, and so on. A transform out of that order isn't
+	// added and NO_TRANSFORM comes back. The kind says how local was built, anything cheaper
+	// than general skips the full inverse
+	UINT Add(const DirectX::XMFLOAT4X4& local, UINT parent = NO_PARENT, TransformKind kind = GeneralTransform);
+
+	// move a transform relative to its parent, seen by the next Update
+	void SetLocal(UINT index, const DirectX::XMFLOAT4X4& local, TransformKind kind = GeneralTransform);
+
+	UINT GetCount() const { return count; }
+
+	// work out every world matrix, and with a camera every draw's matrices too
+	void Update();
+	void Update(const DirectX::XMFLOAT4X4& viewProjection);
+
+	// results of the last Update
+	const DirectX::XMFLOAT4X4& GetWorld(UINT index) const { return worlds[index]; }
+	const TransformMatrices& GetMatrices(UINT index) const { return matrices[index]; }
+	TransformKind GetKind(UINT index) const { return (TransformKind)worldKinds[index]; }
+
+	// the widest kernel the CPU supports, asking for more than that falls back to it
+	static TransformKernel GetBestKernel();
+	void SetKernel(TransformKernel inKernel);
+	TransformKernel GetKernel() const { return kernel; }
+
+	int GetNumThreads() const { return jobPool.GetNumThreads(); }
+
+private:
+
+	// update transforms first to first + num - 1, which all have parents in earlier levels
+	void UpdateRun(UINT first, UINT num, bool shaderMatrices);
+	void Update(const float* pViewProjection);
+
+	// element r * 4 + c of every local matrix, one array per element
+	std::vector<float> local[16];
+	std::vector<unsigned char> localKinds;
+	std::vector<unsigned char> worldKinds;
+	std::vector<int> parents;
+
+	// where each level starts, the last entry is one past the last transform of the last level
+	std::vector<UINT> levelStarts;
+	std::vector<int> levels;
+	UINT count;
+
+	// the results as whole matrices, children read their parent's back from worlds
+	std::vector<DirectX::XMFLOAT4X4> worlds;
+	std::vector<TransformMatrices> matrices;
+
+	float viewProjection[16];
+	TransformKernel kernel;
+
+	// the levels' runs are split over these
+	JobPool jobPool;
+};
+
+#endif
@@ -0,0 +1,316 @@
+//
+// BGTD 9201
+//	The shared transposition table, and getting its memory on large pages
+//
+
+#include "TranspositionTable.h"
+#include "Platform.h"
+#include <new>
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#endif
+
+// the large page size everywhere the game runs, the table is rounded up to it
+static const size_t LARGE_PAGE_SIZE = 2 << 20;
+
+// entries looked at by GetUsage
+static const size_t USAGE_SAMPLE = 1000;
+
+#ifdef _WIN32
+// ------------------------------------------------------------------------------------
+// Large pages need the lock pages in memory privilege, which an account has to be given
+// before the process can switch it on here
+// ------------------------------------------------------------------------------------
+static bool EnableLockMemoryPrivilege()
+{
+	HANDLE token;
+	if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+	{
+		return false;
+	}
+
+	TOKEN_PRIVILEGES privileges;
+	privileges.PrivilegeCount = 1;
+	privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+	bool enabled = LookupPrivilegeValue(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid)
+		&& AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr)
+		&& GetLastError() == ERROR_SUCCESS;
+
+	CloseHandle(token);
+	return enabled;
+}
+#endif
+
+// ------------------------------------------------------------------------------------
+// Memory for the table on large pages if there are any to be had, ordinary pages if not.
+// bytes is already a multiple of LARGE_PAGE_SIZE
+// ------------------------------------------------------------------------------------
+static void* AllocateTable(size_t bytes, bool& largePages)
+{
+	largePages = false;
+
+#ifdef _WIN32
+	size_t largePageSize = GetLargePageMinimum();
+	if (largePageSize > 0 && bytes % largePageSize == 0 && EnableLockMemoryPrivilege())
+	{
+		void* pMemory = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (pMemory)
+		{
+			largePages = true;
+			return pMemory;
+		}
+	}
+	return VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	// the kernel backs the mapping with huge pages as it can once asked to, CountLargePages
+	// finds out how much of it it did
+	void* pMemory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (pMemory == MAP_FAILED)
+	{
+		return nullptr;
+	}
+#ifdef MADV_HUGEPAGE
+	madvise(pMemory, bytes, MADV_HUGEPAGE);
+#endif
+	return pMemory;
+#endif
+}
+
+#ifndef _WIN32
+// ------------------------------------------------------------------------------------
+// The bytes of the table the kernel has put on transparent huge pages, from the mapping's
+// AnonHugePages in smaps. The pages have to have been touched first
+// ------------------------------------------------------------------------------------
+static size_t CountLargePages(void* pMemory, size_t bytes)
+{
+	FILE* pMaps = fopen("/proc/self/smaps", "r");
+	if (!pMaps)
+	{
+		return 0;
+	}
+
+	uintptr_t address = (uintptr_t)pMemory;
+	bool inTable = false;
+	size_t hugeBytes = 0;
+	char line[256];
+	while (fgets(line, sizeof(line), pMaps))
+	{
+		unsigned long long start, end, kilobytes;
+		if (sscanf(line, "%llx-%llx ", &start, &end) == 2)
+		{
+			inTable = start <= address && address < end;
+		}
+		else if (inTable && sscanf(line, "AnonHugePages: %llu kB", &kilobytes) == 1)
+		{
+			hugeBytes = (size_t)kilobytes << 10;
+			break;
+		}
+	}
+	fclose(pMaps);
+
+	// the table's mapping may have been merged with a neighbour's
+	return hugeBytes < bytes ? hugeBytes : bytes;
+}
+#endif
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+static void FreeTable(void* pMemory, size_t bytes)
+{
+#ifdef _WIN32
+	(void)bytes;
+	VirtualFree(pMemory, 0, MEM_RELEASE);
+#else
+	munmap(pMemory, bytes);
+#endif
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+TranspositionTable::TranspositionTable()
+{
+	pEntries = nullptr;
+	numEntries = 0;
+	allocatedBytes = 0;
+	largePageBytes = 0;
+	generation = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+TranspositionTable::~TranspositionTable()
+{
+	Free();
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void TranspositionTable::Free()
+{
+	if (pEntries)
+	{
+		FreeTable(pEntries, allocatedBytes);
+	}
+	pEntries = nullptr;
+	numEntries = 0;
+	allocatedBytes = 0;
+	largePageBytes = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+bool TranspositionTable::Resize(size_t megabytes)
+{
+	Free();
+
+	size_t count = 1;
+	while (count * 2 * sizeof(Entry) <= (megabytes << 20))
+	{
+		count *= 2;
+	}
+	if (count * sizeof(Entry) > (megabytes << 20))
+	{
+		return false;
+	}
+
+	size_t bytes = (count * sizeof(Entry) + LARGE_PAGE_SIZE - 1) / LARGE_PAGE_SIZE * LARGE_PAGE_SIZE;
+	bool largePages;
+	void* pMemory = AllocateTable(bytes, largePages);
+	if (!pMemory)
+	{
+		OutputDebugString(L"Couldn't allocate the transposition table\n");
+		return false;
+	}
+
+	pEntries = static_cast<Entry*>(pMemory);
+	numEntries = count;
+	allocatedBytes = bytes;
+	for (size_t i = 0; i < numEntries; i++)
+	{
+		new (&pEntries[i]) Entry();
+	}
+	Clear();
+
+#ifdef _WIN32
+	largePageBytes = largePages ? bytes : 0;
+#else
+	largePageBytes = CountLargePages(pMemory, bytes);
+#endif
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+void TranspositionTable::Clear()
+{
+	for (size_t i = 0; i < numEntries; i++)
+	{
+		pEntries[i].check.store(0, std::memory_order_relaxed);
+		pEntries[i].data.store(0, std::memory_order_relaxed);
+	}
+	generation = 0;
+}
+
+// ------------------------------------------------------------------------------------
+// The generation is six bits, it only has to differ from the last few searches'
+// ------------------------------------------------------------------------------------
+void TranspositionTable::NewSearch()
+{
+	generation = (generation + 1) & 63;
+}
+
+// ------------------------------------------------------------------------------------
+// The move in bits 0 to 15, the score offset to be positive in 16 to 31, then 8 bits of
+// depth, 2 of bound and 6 of generation
+// ------------------------------------------------------------------------------------
+uint64_t TranspositionTable::Pack(ChessMove move, int score, int depth, TableBound bound, int generation)
+{
+	return (uint64_t)move
+		| ((uint64_t)(uint16_t)(score + 32768) << 16)
+		| ((uint64_t)(depth & 0xFF) << 32)
+		| ((uint64_t)bound << 40)
+		| ((uint64_t)generation << 42);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+bool TranspositionTable::Probe(uint64_t key, TableEntry& entry) const
+{
+	if (numEntries == 0)
+	{
+		return false;
+	}
+
+	const Entry& stored = pEntries[key & (numEntries - 1)];
+	uint64_t data = stored.data.load(std::memory_order_relaxed);
+	uint64_t check = stored.check.load(std::memory_order_relaxed);
+	TableBound bound = (TableBound)((data >> 40) & 3);
+	if ((check ^ data) != key || bound == NoBound)
+	{
+		return false;
+	}
+
+	entry.move = (ChessMove)(data & 0xFFFF);
+	entry.score = (int)((data >> 16) & 0xFFFF) - 32768;
+	entry.depth = (int)((data >> 32) & 0xFF);
+	entry.bound = bound;
+	return true;
+}
+
+// ------------------------------------------------------------------------------------
+// A different position replaces one from an older search or one searched no deeper, the
+// same position keeps its move if this search didn't find one
+// ------------------------------------------------------------------------------------
+void TranspositionTable::Store(uint64_t key, ChessMove move, int score, int depth, TableBound bound)
+{
+	if (numEntries == 0)
+	{
+		return;
+	}
+
+	Entry& stored = pEntries[key & (numEntries - 1)];
+	uint64_t oldData = stored.data.load(std::memory_order_relaxed);
+	uint64_t oldCheck = stored.check.load(std::memory_order_relaxed);
+	bool samePosition = (oldCheck ^ oldData) == key;
+	int oldDepth = (int)((oldData >> 32) & 0xFF);
+	int oldGeneration = (int)((oldData >> 42) & 63);
+
+	if (!samePosition && oldGeneration == generation && depth < oldDepth && oldData != 0)
+	{
+		return;
+	}
+	if (samePosition && move == NO_MOVE)
+	{
+		move = (ChessMove)(oldData & 0xFFFF);
+	}
+
+	uint64_t data = Pack(move, score, depth < 0 ? 0 : depth, bound, generation);
+	stored.check.store(key ^ data, std::memory_order_relaxed);
+	stored.data.store(data, std::memory_order_relaxed);
+}
+
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+int TranspositionTable::GetUsage() const
+{
+	size_t sample = numEntries < USAGE_SAMPLE ? numEntries : USAGE_SAMPLE;
+	if (sample == 0)
+	{
+		return 0;
+	}
+
+	size_t used = 0;
+	for (size_t i = 0; i < sample; i++)
+	{
+		uint64_t data = pEntries[i].data.load(std::memory_order_relaxed);
+		if (((data >> 40) & 3) != NoBound && (int)((data >> 42) & 63) == generation)
+		{
+			used++;
+		}
+	}
+	return (int)(used * 1000 / sample);
+}
@@ -0,0 +1,82 @@
+//
+// BGTD 9201
+//	The scores and best moves of positions already searched, shared by every
+//	search thread without a lock. Each entry is two words, the first the key
+//	XORed with the second, so an entry torn by two threads writing at once
+//	fails its check and reads as a miss. Allocated on large pages when the
+//	system will give them, the table being read at random all over
+//
+
+#ifndef _TRANSPOSITION_TABLE_H
+#define _TRANSPOSITION_TABLE_H
+
+#include <atomic>
+#include <stddef.h>
+
+#include "ChessPosition.h"
+
+// what a stored score says about the real one
+enum TableBound
+{
+	NoBound,
+	UpperBound,					// the search failed low, the score is at most this
+	LowerBound,					// it cut off, at least this
+	ExactBound
+};
+
+// a probe's answer
+struct TableEntry
+{
+	ChessMove move;
+	int score;
+	int depth;
+	TableBound bound;
+};
+
+class TranspositionTable
+{
+public:
+	TranspositionTable();
+	~TranspositionTable();
+
+	// the largest power of two entries in this many megabytes, emptied. False, with no
+	// table left, if the memory can't be had
+	bool Resize(size_t megabytes);
+	void Clear();
+
+	// entries from before this are replaced first
+	void NewSearch();
+
+	// false if the position isn't in the table
+	bool Probe(uint64_t key, TableEntry& entry) const;
+	void Store(uint64_t key, ChessMove move, int score, int depth, TableBound bound);
+
+	// how much of the table's memory is on large pages. On Linux they're only asked for,
+	// this is what the kernel actually gave
+	size_t GetSizeMegabytes() const { return (numEntries * sizeof(Entry)) >> 20; }
+	size_t GetLargePageMegabytes() const { return largePageBytes >> 20; }
+
+	// how full the table is in thousandths, of a sample of entries written this search
+	int GetUsage() const;
+
+private:
+
+	struct Entry
+	{
+		std::atomic<uint64_t> check;
+		std::atomic<uint64_t> data;		// move, score, depth, bound and generation packed by Pack
+	};
+
+	static uint64_t Pack(ChessMove move, int score, int depth, TableBound bound, int generation);
+
+	void Free();
+
+	Entry* pEntries;
+	size_t numEntries;
+	size_t allocatedBytes;
+	size_t largePageBytes;
+
+	int generation;
+};
+
+#endif
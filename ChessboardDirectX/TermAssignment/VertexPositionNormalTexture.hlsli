@@ -4,14 +4,20 @@
 //
 //
 
-// constants that are needed by the shader
+// constants that change for every object drawn
 cbuffer VS_CONSTANT_BUFFER : register(b0)
 {
-	matrix worldMatrix;					
-	matrix viewMatrix;				
-	matrix projectionMatrix;
+	matrix worldMatrix;
 	matrix worldViewProjectionMatrix;
 	matrix worldMatrixIT; // inverse transpose of the worldMatrix
+};
+
+// constants that only change once a frame
+cbuffer FRAME_BUFFER : register(b3)
+{
+	matrix viewMatrix;
+	matrix projectionMatrix;
+	matrix viewProjectionMatrix;
 	float4 worldCameraPos;	  // worldspace position of the camera
 };
 
@@ -35,13 +41,15 @@ cbuffer LIGHT_BUFFER : register(b1)
 
 }
 
-// represents a material
+// represents a table of materials, vertices pick one with their material index
 //
+#define MAX_MATERIALS 4
+
 cbuffer MATERIAL_BUFFER: register(b2)
 {
-	float4 matAmbient;
-	float4 matDiffuse;
-	float4 matSpecular;
+	float4 matAmbient[MAX_MATERIALS];
+	float4 matDiffuse[MAX_MATERIALS];
+	float4 matSpecular[MAX_MATERIALS];
 }
 
 Texture2D MainTex : register(t0);
@@ -57,6 +65,22 @@ struct VS_INPUT
 	float2 UV : TEXCOORD0;		// texture coordinate
 };
 
+// instanced vertex shader input
+//  The vertex information plus the per-instance world matrix and colour
+struct VS_INSTANCED_INPUT
+{
+	float4 Pos : SV_POSITION;	// position
+	float3 Normal: NORMAL;		// normal
+	float2 UV : TEXCOORD0;		// texture coordinate
+	uint MaterialIndex : MATERIALINDEX;	// entry in the material table
+
+	float4 InstanceWorld0 : INSTANCEWORLD0;	// rows of the instance world matrix
+	float4 InstanceWorld1 : INSTANCEWORLD1;
+	float4 InstanceWorld2 : INSTANCEWORLD2;
+	float4 InstanceWorld3 : INSTANCEWORLD3;
+	float4 InstanceColour : INSTANCECOLOUR;	// tints the ambient lighting
+};
+
 // pixel shader input
 //  Information that is passed from vertex to pixel shader
 struct PS_INPUT
@@ -66,6 +90,7 @@ struct PS_INPUT
 	float3 WorldNormal : TEXCOORD1;
 	float4 Color : COLOR;
 	float3 WorldPosition : TEXCOORD2;
+	nointerpolation uint MaterialIndex : MATERIALINDEX;
 };
 
 
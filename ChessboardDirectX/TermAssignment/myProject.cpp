@@ -5,6 +5,10 @@
 #include <DirectXColors.h>
 #include <sstream>
 #include <CommonStates.h>
+#include "MeshRegistry.h"
+#include "ConstantRing.h"
+#include "MaterialRegistry.h"
+#include "StateCache.h"
 
 /*
 * Name: Brandon Keller
@@ -27,6 +31,21 @@ float RandFloat() { return float(rand())/float(RAND_MAX); }
 
 static const float CAMERA_SPEED = XM_PI * 0.2f;
 
+// frames C records and where they go, replay_bench plays them back
+static const int CAPTURE_FRAMES = 120;
+static const char* CAPTURE_FILE = "chessboard.capture";
+
+// a full set, the pieces batched and transformed each frame
+static const UINT MAX_PIECES = 32;
+
+// the square or piece under the mouse and the piece picked up to move are tinted towards this
+static const XMVECTORF32 HIGHLIGHT_COLOUR = Colors::Gold;
+static const float HIGHLIGHT_AMOUNT = 0.5f;
+
+// how long the computer thinks about a move, and the table its threads share
+static const int ENGINE_MOVE_TIME = 1000;
+static const size_t ENGINE_HASH_MEGABYTES = 256;
+
 //----------------------------------------------------------------------------------------------
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine, int nShowCmd)
 {
@@ -51,22 +70,24 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
 // Constructor
 //----------------------------------------------------------------------------------------------
 MyProject::MyProject(HINSTANCE hInstance)
-	: DirectXClass(hInstance)
+	: DirectXClass(hInstance), pawn(PawnPiece), bishop(BishopPiece), king(KingPiece), knight(KnightPiece), queen(QueenPiece), rook(RookPiece)
 {
 	mousePos = Vector2(clientWidth * 0.5f, clientHeight * 0.5f);
 	buttonDown = false;
+	hover.object = PickedNothing;
 	
 	ClearColor = Color(DirectX::Colors::Black.v);
 
-	cameraPos = Vector3(0, 0, 6);
-
-	cameraRadius = 32;
-	cameraRadiusSpeed = 0;
-
-	cameraRotation = Vector2(0, XM_PI / 10.0f );
-	cameraRotationSpeed = Vector2::Zero;
-
-	runTime = 0;
+	statsTime = 0;
+	framesToRecord = 0;
+	capturing = false;
+	boardTransform = 0;
+	firstPieceTransform = 0;
+	engineSearch = 0;
+	enginePlaying = false;
+	analysing = false;
+	analysedKey = 0;
+	recordingDevice.SetTarget(&d3dRenderDevice);
 }
 
 //----------------------------------------------------------------------------------------------
@@ -74,6 +95,10 @@ MyProject::MyProject(HINSTANCE hInstance)
 //----------------------------------------------------------------------------------------------
 MyProject::~MyProject()
 {
+	// drop the shared meshes, each primitive releases its own references as it is destroyed
+	MeshRegistry::Get().Clear();
+	MaterialRegistry::Get().Clear();
+	ConstantRing::Get().Release();
 }
 
 //----------------------------------------------------------------------------------------------
@@ -81,36 +106,52 @@ MyProject::~MyProject()
 //----------------------------------------------------------------------------------------------
 void MyProject::InitializeObjects()
 {
+	// every shader constant is written into this ring, on 11.0 devices each object keeps its own buffer
+	ConstantRing::Get().Initialize(pRenderDevice, 64 * 1024);
+
 	skyBox.Initialize(D3DDevice, DeviceContext, L"..\\Textures\\envMap.dds", 64 );
 
 	// load the shader
 	shader.LoadShader(D3DDevice);
 
 	// load chess board
-	chessboard.Initialize(D3DDevice, &shader, Matrix::CreateScale(1, 0.5, 1), Colors::Beige.v, Colors::Brown.v); // beige and brown classic chessboard look
-
-	// load player 1 chess pieces
-	pawn.Initialize(D3DDevice, &shader, 2.25);
-	bishop.Initialize(D3DDevice, &shader, 2.25);
-	rook.Initialize(D3DDevice, &shader, 2.25);
-	king.Initialize(D3DDevice, &shader, 2.25);
-	queen.Initialize(D3DDevice, &shader, 2.25);
-	knight.Initialize(D3DDevice, &shader, 2.25);
-	
-	// load player 2 chess pieces
-	pawn2.Initialize(D3DDevice, &shader, 2.25);
-	bishop2.Initialize(D3DDevice, &shader, 2.25);
-	rook2.Initialize(D3DDevice, &shader, 2.25);
-	king2.Initialize(D3DDevice, &shader, 2.25);
-	queen2.Initialize(D3DDevice, &shader, 2.25);
-	knight2.Initialize(D3DDevice, &shader, 2.25);
+	chessboard.Initialize(D3DDevice, &shader, Matrix(ChessSet::GetBoardMatrix()), Colors::Beige.v, Colors::Brown.v); // beige and brown classic chessboard look
+
+	// load the chess pieces, shared by both players
+	pawn.Initialize(D3DDevice, &shader, ChessSet::PIECE_BASE_OFFSET);
+	bishop.Initialize(D3DDevice, &shader, ChessSet::PIECE_BASE_OFFSET);
+	rook.Initialize(D3DDevice, &shader, ChessSet::PIECE_BASE_OFFSET);
+	king.Initialize(D3DDevice, &shader, ChessSet::PIECE_BASE_OFFSET);
+	queen.Initialize(D3DDevice, &shader, ChessSet::PIECE_BASE_OFFSET);
+	knight.Initialize(D3DDevice, &shader, ChessSet::PIECE_BASE_OFFSET);
+
+	// room for all 32 pieces
+	pieceBatcher.Initialize(D3DDevice, MAX_PIECES);
+
+	// the board and every piece are roots, the squares hang off the board
+	boardTransform = transforms.Add(Matrix::Identity, TransformStore::NO_PARENT, RigidTransform);
+	firstPieceTransform = transforms.GetCount();
+	for (UINT i = 0; i < MAX_PIECES; i++)
+	{
+		transforms.Add(Matrix::Identity, TransformStore::NO_PARENT, RigidTransform);
+	}
+	chessboard.AddTransforms(transforms, boardTransform);
+
+	// each piece type is culled with the bounds of its baked mesh
+	pieceBatcher.SetBounds(PawnPiece, pawn.GetBounds());
+	pieceBatcher.SetBounds(RookPiece, rook.GetBounds());
+	pieceBatcher.SetBounds(KnightPiece, knight.GetBounds());
+	pieceBatcher.SetBounds(BishopPiece, bishop.GetBounds());
+	pieceBatcher.SetBounds(QueenPiece, queen.GetBounds());
+	pieceBatcher.SetBounds(KingPiece, king.GetBounds());
 
 	// load the textures
 	diffuseTex.Load(D3DDevice, DeviceContext, L"..\\Textures\\marble8.jpg");
 	specTex.Load(D3DDevice, DeviceContext, L"..\\Textures\\marbleSpec.jpg");
 
-	// player 1 chess pieces
+	// chess pieces
 	playerOneColour = Colors::White.v;
+	playerTwoColour = Colors::Black.v;
 	pawn.SetTextures(diffuseTex.GetResourceView(), specTex.GetResourceView());
 	bishop.SetTextures(diffuseTex.GetResourceView(), specTex.GetResourceView());
 	rook.SetTextures(diffuseTex.GetResourceView(), specTex.GetResourceView());
@@ -118,28 +159,19 @@ void MyProject::InitializeObjects()
 	queen.SetTextures(diffuseTex.GetResourceView(), specTex.GetResourceView());
 	knight.SetTextures(diffuseTex.GetResourceView(), specTex.GetResourceView());
 	
-	// player 2 chess pieces
-	playerTwoColour = Colors::Black.v;
-	pawn2.SetTextures(diffuseTex.GetResourceView(), specTex.GetResourceView());
-	bishop2.SetTextures(diffuseTex.GetResourceView(), specTex.GetResourceView());
-	rook2.SetTextures(diffuseTex.GetResourceView(), specTex.GetResourceView());
-	king2.SetTextures(diffuseTex.GetResourceView(), specTex.GetResourceView());
-	queen2.SetTextures(diffuseTex.GetResourceView(), specTex.GetResourceView());
-	knight2.SetTextures(diffuseTex.GetResourceView(), specTex.GetResourceView());
-	
 	// chessboard
 	chessboard.SetTextures(diffuseTex.GetResourceView(), specTex.GetResourceView());
 
-	// set the matrices
-	startMatrix =Matrix::CreateRotationZ(45.0f *XM_PI / 180.0f) * Matrix::CreateTranslation(-12.0f, 0, 0);
-	endMatrix = Matrix::CreateRotationZ(-45.0f * XM_PI / 180.0f) * Matrix::CreateTranslation(12.0f, 0, 0);
-	pawnMatrix = startMatrix;
-	rookMatrix = startMatrix;
-	knightMatrix = startMatrix;
-	bishopMatrix = startMatrix;
-	kingMatrix = startMatrix;
-	queenMatrix = startMatrix;
+	// the engine thinks on every core, sharing one table between them
+	engine.SetThreads(0);
+	if (!engine.SetHashSize(ENGINE_HASH_MEGABYTES))
+	{
+		OutputDebugString(L"Couldn't allocate the engine's transposition table\n");
+	}
 
+	// show how many primitives were shared instead of rebuilt
+	MeshRegistry::Get().ReportStats();
+	MaterialRegistry::Get().ReportStats();
 }
 
 //----------------------------------------------------------------------------------------------
@@ -173,26 +205,51 @@ LRESULT MyProject::ProcessWindowMessages(UINT msg, WPARAM wParam, LPARAM lParam)
 		{
 			PresentInterval = wParam - '0';
 		}
-		else if (wParam == VK_UP)	{	cameraRotationSpeed.y = 0;	}
-		else if (wParam == VK_DOWN) {	cameraRotationSpeed.y = 0; }
-		else if (wParam == VK_LEFT) {	cameraRotationSpeed.x = 0; }
-		else if (wParam == VK_RIGHT){	cameraRotationSpeed.x = 0; }
-		else if (wParam == VK_ADD)  {	cameraRadiusSpeed = 0; }
-		else if (wParam == VK_SUBTRACT)  { cameraRadiusSpeed = 0; }
+		else if (wParam == VK_UP)	{	scene.SetTiltSpeed(0);	}
+		else if (wParam == VK_DOWN) {	scene.SetTiltSpeed(0); }
+		else if (wParam == VK_LEFT) {	scene.SetOrbitSpeed(0); }
+		else if (wParam == VK_RIGHT){	scene.SetOrbitSpeed(0); }
+		else if (wParam == VK_ADD)  {	scene.SetZoomSpeed(0); }
+		else if (wParam == VK_SUBTRACT)  { scene.SetZoomSpeed(0); }
 		else if (wParam == VK_SPACE)
 		{
-			cameraRotation = Vector2::Zero;
-			cameraRadius   = 6;
+			scene.ResetCamera();
+		}
+		else if (wParam == 'R' && framesToRecord == 0)
+		{
+			framesToRecord = 1;
+		}
+		else if (wParam == 'E' && !enginePlaying)
+		{
+			SearchLimits limits = { 0, 0, ENGINE_MOVE_TIME };
+			engineSearch = engine.Start(scene.GetPosition(), limits);
+			enginePlaying = true;
+		}
+		else if (wParam == 'A')
+		{
+			// Update starts the analysis, any position differs from one never analysed
+			analysing = !analysing;
+			analysedKey = ~scene.GetPosition().GetKey();
+			if (!analysing && !enginePlaying)
+			{
+				engine.Stop();
+			}
+		}
+		else if (wParam == 'C' && framesToRecord == 0)
+		{
+			capture.Clear();
+			framesToRecord = CAPTURE_FRAMES;
+			capturing = true;
 		}
 
 		break;
 	case WM_KEYDOWN:
-		if (wParam == VK_UP)	{ cameraRotationSpeed.y = CAMERA_SPEED; }
-		else if (wParam == VK_DOWN) { cameraRotationSpeed.y = -CAMERA_SPEED; }
-		else if (wParam == VK_LEFT) { cameraRotationSpeed.x = -CAMERA_SPEED; }
-		else if (wParam == VK_RIGHT){ cameraRotationSpeed.x = CAMERA_SPEED; }
-		else if (wParam == VK_ADD)  { cameraRadiusSpeed = -1.0f; }
-		else if (wParam == VK_SUBTRACT)  { cameraRadiusSpeed = 1.0f; }
+		if (wParam == VK_UP)	{ scene.SetTiltSpeed(CAMERA_SPEED); }
+		else if (wParam == VK_DOWN) { scene.SetTiltSpeed(-CAMERA_SPEED); }
+		else if (wParam == VK_LEFT) { scene.SetOrbitSpeed(-CAMERA_SPEED); }
+		else if (wParam == VK_RIGHT){ scene.SetOrbitSpeed(CAMERA_SPEED); }
+		else if (wParam == VK_ADD)  { scene.SetZoomSpeed(-1.0f); }
+		else if (wParam == VK_SUBTRACT)  { scene.SetZoomSpeed(1.0f); }
 		break;
 
 	}
@@ -209,98 +266,132 @@ void MyProject::Render(void)
 	// calculate camera matrices
 	ComputeViewProjection();
 
-	// draw the skybox FIRST
-	skyBox.Draw(DeviceContext, viewMatrix, projectionMatrix);
+	// constants written last frame may still be in use, start from a fresh copy of the ring
+	ConstantRing::Get().BeginFrame();
+
+	// the clear and last frame's text changed the context behind the cache's back
+	StateCache::Get().Invalidate();
+
+	// the camera constants are uploaded once, every draw after this only sends its own matrices
+	shader.SetFrameConstants(pRenderDevice, viewMatrix, projectionMatrix);
+
+	// the skybox still goes FIRST, its pass sorts ahead of everything opaque
+	renderQueue.Begin();
+	skyBox.Submit(renderQueue, viewMatrix, projectionMatrix);
 
 	ID3D11ShaderResourceView* pTex = diffuseTex.GetResourceView();
-	DeviceContext->PSSetShaderResources(0, 1, &pTex);
+	StateCache::Get().PSSetShaderResource(pRenderDevice, 0, pTex);
 
 	// chessboard
 	shader.SetAmbientLight(Colors::White.v);
-	chessboard.Draw(DeviceContext, Matrix::Identity, viewMatrix, projectionMatrix);
 
-	// player 2 chess pieces
-	shader.SetAmbientLight(playerTwoColour);
-	for (int i = 0; i < 8; i++)
+	// gather the pieces, the instance colour tints the ambient light per player
+	pieceBatcher.Begin();
+
+	// every piece on its square, player two's knights turned to face the board. Moves and
+	// turns only, so the normal matrices are transposes
+	const std::vector<PiecePlacement>& placements = scene.GetPlacements();
+	size_t numPieces = placements.size() < MAX_PIECES ? placements.size() : MAX_PIECES;
+	for (size_t i = 0; i < numPieces; i++)
 	{
-		pawn2.Draw(DeviceContext, chessboard.GetBoardPosition(i, 1, pawn.GetBaseOffset()), viewMatrix, projectionMatrix);
+		transforms.SetLocal(firstPieceTransform + (UINT)i, Matrix(ChessSet::GetPlacementMatrix(placements[i], ChessSet::PIECE_BASE_OFFSET)), RigidTransform);
 	}
-	bishop2.Draw(DeviceContext, chessboard.GetBoardPosition(2, 0, bishop.GetBaseOffset()), viewMatrix, projectionMatrix);
-	bishop2.Draw(DeviceContext, chessboard.GetBoardPosition(5, 0, bishop.GetBaseOffset()), viewMatrix, projectionMatrix);
-
-	rook2.Draw(DeviceContext, chessboard.GetBoardPosition(0, 0, rook.GetBaseOffset()), viewMatrix, projectionMatrix); // left side
-	rook2.Draw(DeviceContext, chessboard.GetBoardPosition(7, 0, rook.GetBaseOffset()), viewMatrix, projectionMatrix); // right side
 
-	knight2.Draw(DeviceContext, Matrix::CreateRotationY(XM_PI) * chessboard.GetBoardPosition(1, 0, knight.GetBaseOffset()), viewMatrix, projectionMatrix); // left side
-	knight2.Draw(DeviceContext, Matrix::CreateRotationY(XM_PI) * chessboard.GetBoardPosition(6, 0, knight.GetBaseOffset()), viewMatrix, projectionMatrix); // right side
+	// pieces partway through a move are drawn where the move has got to
+	scene.GetMoves().Apply(transforms, firstPieceTransform);
 
-	king2.Draw(DeviceContext, chessboard.GetBoardPosition(4, 0, king.GetBaseOffset()), viewMatrix, projectionMatrix);
-	queen2.Draw(DeviceContext, chessboard.GetBoardPosition(3, 0, queen.GetBaseOffset()), viewMatrix, projectionMatrix);
+	// every world matrix of the frame at once, the board and pieces only read them from here on
+	transforms.Update();
 
-	// player 1 chess pieces
-	shader.SetAmbientLight(playerOneColour);
-	for (int i = 0; i < 8; i++)
+	// the mouse picks from what this frame draws, captured pieces on their way out can't be picked
+	picker.Begin();
+	picker.AddBoard(0, transforms.GetWorld(boardTransform));
+	for (size_t i = 0; i < numPieces; i++)
 	{
-		pawn.Draw(DeviceContext, chessboard.GetBoardPosition(i, 6, pawn.GetBaseOffset()), viewMatrix, projectionMatrix);
+		if (placements[i].x >= 0)
+		{
+			picker.AddPiece((UINT)i, pieceBatcher.GetBounds(placements[i].type), transforms.GetWorld(firstPieceTransform + (UINT)i));
+		}
 	}
+	picker.Build();
 
-	bishop.Draw(DeviceContext, chessboard.GetBoardPosition(2, 7, bishop.GetBaseOffset()), viewMatrix, projectionMatrix); // left side
-	bishop.Draw(DeviceContext, chessboard.GetBoardPosition(5, 7, bishop.GetBaseOffset()), viewMatrix, projectionMatrix); // right side
-
-	rook.Draw(DeviceContext, chessboard.GetBoardPosition(0, 7, rook.GetBaseOffset()), viewMatrix, projectionMatrix); // left side
-	rook.Draw(DeviceContext, chessboard.GetBoardPosition(7, 7, rook.GetBaseOffset()), viewMatrix, projectionMatrix); // right side
-
-	knight.Draw(DeviceContext, chessboard.GetBoardPosition(1, 7, knight.GetBaseOffset()), viewMatrix, projectionMatrix); // left side
-	knight.Draw(DeviceContext, chessboard.GetBoardPosition(6, 7, knight.GetBaseOffset()), viewMatrix, projectionMatrix); // right side
+	// the camera may have moved under a still mouse
+	UpdateHover();
+	if (hover.object == PickedSquare)
+	{
+		chessboard.SetHighlight(hover.squareX, hover.squareY, HIGHLIGHT_COLOUR.v);
+	}
+	else
+	{
+		chessboard.SetHighlight(-1, -1, HIGHLIGHT_COLOUR.v);
+	}
 
-	king.Draw(DeviceContext, chessboard.GetBoardPosition(4, 7, king.GetBaseOffset()), viewMatrix, projectionMatrix);
-	queen.Draw(DeviceContext, chessboard.GetBoardPosition(3, 7, queen.GetBaseOffset()), viewMatrix, projectionMatrix);
+	for (size_t i = 0; i < numPieces; i++)
+	{
+		const PiecePlacement& placement = placements[i];
+		Color colour = placement.playerOne ? playerOneColour : playerTwoColour;
+		if (i == scene.GetSelectedPiece() || (hover.object == PickedPiece && hover.id == i))
+		{
+			colour = Color::Lerp(colour, HIGHLIGHT_COLOUR.v, HIGHLIGHT_AMOUNT);
+		}
+		pieceBatcher.AddPiece(placement.type, Matrix(transforms.GetWorld(firstPieceTransform + (UINT)i)), colour);
+	}
 
-	// chess title font
-	font.PrintMessage(clientWidth/2, 60, L"CHESS", Colors::LightGray);
+	// test every square and piece against the frustum before anything is queued
+	culler.SetFrustum(viewMatrix * projectionMatrix);
+	culler.Begin();
+	chessboard.AddToCuller(culler);
+	pieceBatcher.AddToCuller(culler);
+	culler.Cull();
+	chessboard.ApplyCulling(culler);
+	pieceBatcher.ApplyCulling(culler);
 
-	// render the base class
-	DirectXClass::Render();
-}
+	float boardDepth = -Vector3::Transform(Vector3::Zero, viewMatrix).z;
+	chessboard.Submit(renderQueue, boardDepth);
 
-//----------------------------------------------------------------------------------------------
-// Given a running value, returns a value between 0 and 1 which 'ping pongs' back and forth
-//----------------------------------------------------------------------------------------------
-float PingPong(float value)
-{	
-	value = fabs(value);
-	int wholeNumber = (int)value;	// integer component
-	float decimal = value - (float)wholeNumber; // decimal parts
+	// one upload for every visible piece, then one draw per part of each piece type
+	pieceBatcher.Upload(pRenderDevice);
 
-	// if it's odd, flip it 
-	if (wholeNumber % 2 == 1)
-		decimal = 1.0f - decimal;
+	ID3D11Buffer* pInstances = pieceBatcher.GetInstanceBuffer();
+	pawn.Submit(renderQueue, pInstances, pieceBatcher.GetStartInstance(PawnPiece), pieceBatcher.GetInstanceCount(PawnPiece), pieceBatcher.GetNearestDepth(PawnPiece, viewMatrix));
+	bishop.Submit(renderQueue, pInstances, pieceBatcher.GetStartInstance(BishopPiece), pieceBatcher.GetInstanceCount(BishopPiece), pieceBatcher.GetNearestDepth(BishopPiece, viewMatrix));
+	rook.Submit(renderQueue, pInstances, pieceBatcher.GetStartInstance(RookPiece), pieceBatcher.GetInstanceCount(RookPiece), pieceBatcher.GetNearestDepth(RookPiece, viewMatrix));
+	knight.Submit(renderQueue, pInstances, pieceBatcher.GetStartInstance(KnightPiece), pieceBatcher.GetInstanceCount(KnightPiece), pieceBatcher.GetNearestDepth(KnightPiece, viewMatrix));
+	king.Submit(renderQueue, pInstances, pieceBatcher.GetStartInstance(KingPiece), pieceBatcher.GetInstanceCount(KingPiece), pieceBatcher.GetNearestDepth(KingPiece, viewMatrix));
+	queen.Submit(renderQueue, pInstances, pieceBatcher.GetStartInstance(QueenPiece), pieceBatcher.GetInstanceCount(QueenPiece), pieceBatcher.GetNearestDepth(QueenPiece, viewMatrix));
 
-	return decimal;
-}
+	// draw everything in key order
+	renderQueue.Sort();
+	renderQueue.Execute(pRenderDevice);
 
-//----------------------------------------------------------------------------------------------
-// Linear Interpolate Matrices, decomposing if possible to give nondistorting results
-//----------------------------------------------------------------------------------------------
-Matrix LerpMatrices(Matrix& start, Matrix& end, float t)
-{
-	Vector3 scaleA, scaleB;
-	Quaternion rotA, rotB;
-	Vector3 transA, transB;
 
-	Matrix result;
-	if (start.Decompose(scaleA, rotA, transA) && end.Decompose(scaleB, rotB, transB))
+	// once a second, show what one frame cost in constant uploads
+	if (statsTime >= 1.0f)
 	{
-		Vector3 scale = Vector3::Lerp(scaleA, scaleB, t);
-		Quaternion rot = Quaternion::Lerp(rotA, rotB, t);
-		Vector3 trans = Vector3::Lerp(transA, transB, t);
-		result = Matrix::CreateScale(scale)*Matrix::CreateFromQuaternion(rot)*Matrix::CreateTranslation(trans);
+		shader.ReportStats();
+		ConstantRing::Get().ReportStats();
+		StateCache::Get().ReportStats();
+		renderQueue.ReportStats();
+		culler.ReportStats();
+		statsTime = 0;
 	}
-	else
+	shader.ResetStats();
+	ConstantRing::Get().ResetStats();
+	StateCache::Get().ResetStats();
+	renderQueue.ResetStats();
+	culler.ResetStats();
+
+	// chess title font
+	font.PrintMessage(clientWidth/2, 60, L"CHESS", Colors::LightGray);
+
+	// what the computer is thinking, or thought last
+	if (!engineLine.empty())
 	{
-		result = Matrix::Lerp(start, end, t);
+		font.PrintMessage(clientWidth/2, clientHeight - 60, engineLine, Colors::LightGray);
 	}
-	return result;
+
+	// render the base class
+	DirectXClass::Render();
 }
 
 //----------------------------------------------------------------------------------------------
@@ -312,21 +403,100 @@ void MyProject::Update(float deltaTime)
 	Vector3 dir2 = { -1,1,-1 };
 	Vector3 dir = { 0, -1,0 };
 
-	// how long one movement takes
-	const float MOVEMENT_TIME_IN_SECONDS = 3.0f; 
-	runTime += deltaTime;
+	statsTime += deltaTime;
 
-	// get a 0 - 1 value
-	float blendValue = PingPong(runTime / MOVEMENT_TIME_IN_SECONDS);
+	// a recorded frame has ended, keep it if capturing and go back to the Direct3D
+	// device once the last one is done
+	if (pRenderDevice == &recordingDevice)
+	{
+		if (capturing)
+		{
+			capture.AddFrame(recordedCamera, recordingDevice.GetStream(), recordingDevice.GetNumObjects());
+		}
+		if (framesToRecord == 0)
+		{
+			recordingDevice.ReportStats();
+			if (capturing && !capture.Save(CAPTURE_FILE))
+			{
+				OutputDebugString(L"Couldn't save the capture\n");
+			}
+			capturing = false;
+			pRenderDevice = &d3dRenderDevice;
+		}
+	}
+	if (framesToRecord > 0)
+	{
+		pRenderDevice = &recordingDevice;
+		framesToRecord--;
+	}
+
+	// analysis runs without limits, over again whenever the board changes
+	if (analysing && !enginePlaying && scene.GetPosition().GetKey() != analysedKey)
+	{
+		SearchLimits limits = { 0, 0, 0 };
+		engineSearch = engine.Start(scene.GetPosition(), limits);
+		analysedKey = scene.GetPosition().GetKey();
+	}
 
-	// Linear Interpolate between the matrices
-	pawnMatrix = LerpMatrices(startMatrix, endMatrix, blendValue);
+	// the computer's move is played once its search ends, the frame never waits on it
+	if (engineSearch != 0)
+	{
+		const SearchSnapshot& snapshot = engine.Poll();
+		if (snapshot.searchId == engineSearch)
+		{
+			std::wstringstream line;
+			line << L"depth " << snapshot.depth << L"  " << snapshot.nodes * 1000 / (snapshot.milliseconds + 1) / 1000 << L" kN/s  ";
+			if (ChessEngine::IsMateScore(snapshot.score))
+			{
+				line << L"mate " << (snapshot.score > 0 ? ChessEngine::MATE_SCORE - snapshot.score + 1 : -(ChessEngine::MATE_SCORE + snapshot.score)) / 2;
+			}
+			else
+			{
+				line << std::showpos << snapshot.score / 100.0f << std::noshowpos;
+			}
+			for (int i = 0; i < snapshot.pvLength && i < 8; i++)
+			{
+				std::string move = ChessPosition::GetMoveText(snapshot.pv[i]);
+				line << L" " << std::wstring(move.begin(), move.end());
+			}
+			engineLine = line.str();
+
+			if (!snapshot.thinking)
+			{
+				if (enginePlaying && snapshot.bestMove != NO_MOVE)
+				{
+					scene.PlayMove(snapshot.bestMove);
+				}
+				enginePlaying = false;
+				engineSearch = 0;
+			}
+		}
+	}
+
+	// a drawn game says so under the board, though play can go on. The keys make the
+	// check a short scan, cheap enough for every frame
+	const ChessPosition& position = scene.GetPosition();
+	if (engineSearch == 0 && position.IsDraw())
+	{
+		MoveList moves;
+		position.GenerateMoves(moves);
+		if (moves.count > 0 || !position.IsInCheck())
+		{
+			engineLine = position.GetHalfmoveClock() >= 100 ? L"draw by the fifty move rule" : L"draw by threefold repetition";
+		}
+	}
 
-	// update the camera movement
-	UpdateCamera(deltaTime);
+	// move the camera and the pawn
+	scene.Update(deltaTime);
 
-	// update the sample object
-	pawn.Update(deltaTime);
+	// the camera the recorded frame is drawn from
+	recordedCamera.deltaTime = deltaTime;
+	recordedCamera.rotation[0] = scene.GetCameraRotation().x;
+	recordedCamera.rotation[1] = scene.GetCameraRotation().y;
+	recordedCamera.radius = scene.GetCameraRadius();
+	recordedCamera.position[0] = scene.GetCameraPosition().x;
+	recordedCamera.position[1] = scene.GetCameraPosition().y;
+	recordedCamera.position[2] = scene.GetCameraPosition().z;
 
 
 	shader.SetAmbientLight(Colors::LightBlue.v);
@@ -341,9 +511,44 @@ void MyProject::Update(float deltaTime)
 //----------------------------------------------------------------------------------------------
 void MyProject::OnMouseDown()
 {
-
 	// this is called when the left mouse button is clicked
 	// mouse position is stored in mousePos variable
+	UpdateHover();
+
+	// the board is the computer's while it thinks about its move
+	if (enginePlaying)
+	{
+		return;
+	}
+
+	const std::vector<PiecePlacement>& placements = scene.GetPlacements();
+	size_t selected = scene.GetSelectedPiece();
+
+	// player one is white
+	bool playerOneToMove = scene.GetPosition().GetSideToMove() == WhiteSide;
+
+	if (hover.object == PickedPiece && hover.id < placements.size())
+	{
+		// picking up one of the moving player's pieces, or another of them, or putting it down again
+		const PiecePlacement& clicked = placements[hover.id];
+		if (clicked.playerOne == playerOneToMove)
+		{
+			scene.SelectPiece(hover.id == selected ? ChessScene::NO_PIECE : hover.id);
+			return;
+		}
+
+		// the other player's piece is taken, if the move is legal
+		if (selected != ChessScene::NO_PIECE)
+		{
+			scene.MovePiece(selected, clicked.x, clicked.y);
+		}
+	}
+	else if (hover.object == PickedSquare && selected != ChessScene::NO_PIECE)
+	{
+		scene.MovePiece(selected, hover.squareX, hover.squareY);
+	}
+
+	scene.SelectPiece(ChessScene::NO_PIECE);
 }
 
 //----------------------------------------------------------------------------------------------
@@ -351,40 +556,25 @@ void MyProject::OnMouseDown()
 //----------------------------------------------------------------------------------------------
 void MyProject::OnMouseMove()
 {
+	UpdateHover();
 }
 
 //----------------------------------------------------------------------------------------------
-// Computes the view and camera matrix
+// Picks against the board and pieces last drawn, through last frame's camera
 //----------------------------------------------------------------------------------------------
-void MyProject::ComputeViewProjection()
+void MyProject::UpdateHover()
 {
-	viewMatrix = Matrix::CreateLookAt(cameraPos, Vector3::Zero, Vector3::UnitY);
-	projectionMatrix = Matrix::CreatePerspectiveFieldOfView(60.0f * XM_PI / 180.0f, (float)clientWidth / (float)clientHeight, 1, 128);
+	PickRay ray = ScenePicker::Unproject(mousePos.x, mousePos.y, (float)clientWidth, (float)clientHeight, viewMatrix, projectionMatrix);
+	picker.Pick(ray, hover);
 }
 
 //----------------------------------------------------------------------------------------------
+// Computes the view and camera matrix
 //----------------------------------------------------------------------------------------------
-void MyProject::UpdateCamera(float deltaTime)
+void MyProject::ComputeViewProjection()
 {
-	const float VERT_LIMIT = XM_PI * 0.35f;
+	scene.ComputeViewProjection((float)clientWidth / (float)clientHeight, viewMatrix, projectionMatrix);
 
-	// update the radius
-	cameraRadius += cameraRadiusSpeed * deltaTime;
-	if (cameraRadius < 1) cameraRadius = 1;
-
-
-	// update the rotation amounts
-	cameraRotation += cameraRotationSpeed * deltaTime;
-
-	// clamp the vertical rotation
-	if (cameraRotation.y < -VERT_LIMIT) cameraRotation.y = -VERT_LIMIT;
-	else if (cameraRotation.y > VERT_LIMIT) cameraRotation.y = VERT_LIMIT;
-
-	// calculate the height
-	cameraPos.y = cameraRadius * sinf(cameraRotation.y);
-	float r = cameraRadius * cosf(cameraRotation.y);
-
-	// calculate the orbit
-	cameraPos.x = sinf(cameraRotation.x) * r;
-	cameraPos.z = cosf(cameraRotation.x) * r;
-}
\ No newline at end of file
+	// draw depths are sorted over the same range as the projection
+	renderQueue.SetDepthRange(ChessScene::NEAR_PLANE, ChessScene::FAR_PLANE);
+}